@@ -41,7 +41,379 @@ SOFTWARE.
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <getopt.h>
+#include <sys/stat.h>
 #include "tiff_metadata.h"
+#include "tiff_layout.h"
+#include "tiff_stats.h"
+#include "tiff_batch.h"
+#include "tiff_fingerprint.h"
+#include "tiff_diff.h"
+#include "tiff_query.h"
+#include "tiff_serve.h"
+#include "tiff_edit.h"
+#include "tiff_strip.h"
+#include "tiff_validate.h"
+#include "tiff_thumbnail.h"
+#include "tiff_io.h"
+#include "tiff_aggregate.h"
+#include "tiff_tagdb.h"
+#include "tiff_geotiff.h"
+#include "tiff_model.h"
+#include "tiff_watch.h"
+#include "tiff_checkpoint.h"
+#include "tiff_catalog.h"
+#include "tiff_bitmap.h"
+
+/**                                                                      **/
+/**  Per-file options shared by the batch functions                      **/
+/**                                                                      **/
+/**  label                                                               **/
+/**      1 to print the file name before the output of each file         **/
+/**  maxValueBytes, maxArrayValues, decodeMakerNotes                     **/
+/**      copied to the same internalStruct fields                        **/
+/**  where, action                                                       **/
+/**      with --where, the query and the function run on matching files  **/
+/**      (NULL to print their names)                                     **/
+/**  thumbnailDirectory                                                  **/
+/**      with --extract-thumbnail, directory the thumbnails go to        **/
+/**  aggregate                                                           **/
+/**      with --aggregate, the aggregate files are counted in            **/
+/**  latencyUs, policy, remote                                           **/
+/**      with --simulate-latency, the latency of a round trip, the       **/
+/**      prefetch policy shared by all files and the function run on     **/
+/**      each file                                                       **/
+/**  bytesLimit, filesLimit, lowImpact                                   **/
+/**      with --low-impact, the limits of bytes and files per second     **/
+/**      shared by all threads and the function run on each file         **/
+/**                                                                      **/
+
+typedef struct mainOptions
+{
+	int label;
+	unsigned long long maxValueBytes;
+	unsigned int maxArrayValues;
+	int decodeMakerNotes;
+	const tiffQuery *where;
+	tiffBatchFunc action;
+	const char *thumbnailDirectory;
+	tiffAggregate *aggregate;
+	unsigned long long latencyUs;
+	tiffIOPolicy *policy;
+	tiffBatchFunc remote;
+	tiffIOLimit *bytesLimit;
+	tiffIOLimit *filesLimit;
+	tiffBatchFunc lowImpact;
+} mainOptions;
+
+
+/**                                                                      **/
+/**   Function: usage                                                    **/
+/**                                                                      **/
+/**   Print the command line usage.                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   progname   -- program name                                         **/
+/**                                                                      **/
+
+static void usage(const char *progname)
+{
+	fprintf(stderr, "usage: %s [--layout|--fingerprint|--metadata|"
+		"--validate]\n"
+		"           [--where expr] [--stats[=json]] [-j jobs] "
+		"[--max-bytes n]\n"
+		"           [--makernotes] [--full-arrays] "
+		"[--extract-thumbnail dir]\n"
+		"           [--aggregate tags] [--geotiff|--json] [--top n]\n"
+		"           [--simulate-latency us] "
+		"[--prefetch kb] [--prefetch-tail kb]\n"
+		"           [--tagdb file ...] "
+		"[--low-impact] [--limit-bytes n]\n"
+		"           [--limit-files n] [--checkpoint journal [--resume]]\n"
+		"           tiffFile|directory ...\n"
+		"       %s [options] --watch dir [--debounce ms] "
+		"[--reconcile s]\n"
+		"       %s [--tagdb file ...] --serve socket [-j jobs]\n"
+		"       %s diff [options] ...\n"
+		"       %s edit [options] ...\n"
+		"       %s strip [options] input output\n"
+		"       %s tagdb input output\n"
+		"       %s catalog build|query ...\n"
+		"       %s bitmap build|query ...\n", progname, progname,
+		progname, progname, progname, progname, progname, progname,
+		progname);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: metadataFile                                             **/
+/**                                                                      **/
+/**   tiffBatchFunc printing the metadata of one file.                   **/
+/**                                                                      **/
+
+static int metadataFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+
+	if(options->label)
+	{
+		tiffPrintf(internal, "File %s\n", filename);
+	}
+	internal->maxValueBytes = options->maxValueBytes;
+	internal->maxArrayValues = options->maxArrayValues;
+	internal->decodeMakerNotes = options->decodeMakerNotes;
+
+	return tiffMetadataPrintFile(filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: layoutFile                                               **/
+/**                                                                      **/
+/**   tiffBatchFunc printing the layout report of one file.              **/
+/**                                                                      **/
+
+static int layoutFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	return tiffLayoutPrint(filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: fingerprintFile                                          **/
+/**                                                                      **/
+/**   tiffBatchFunc printing the metadata fingerprint of one file.       **/
+/**                                                                      **/
+
+static int fingerprintFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	return tiffFingerprintPrint(filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: validateFile                                             **/
+/**                                                                      **/
+/**   tiffBatchFunc checking the structure of one file.                  **/
+/**                                                                      **/
+
+static int validateFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	tiffValidateResult result;
+
+	return tiffValidateFile(filename, internal, &result);
+}
+
+
+/**                                                                      **/
+/**   Function: aggregateWorker                                          **/
+/**                                                                      **/
+/**   tiffBatchWorkerFunc creating the aggregate map of a worker.        **/
+/**                                                                      **/
+
+static void *aggregateWorker(void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+
+	return tiffAggregateWorker(options->aggregate);
+}
+
+
+/**                                                                      **/
+/**   Function: aggregateFile                                            **/
+/**                                                                      **/
+/**   tiffBatchFunc counting one file in the map of its worker.          **/
+/**                                                                      **/
+
+static int aggregateFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+
+	return tiffAggregateFile(options->aggregate, internal->worker,
+		filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: thumbnailFile                                            **/
+/**                                                                      **/
+/**   tiffBatchFunc writing the thumbnail of one file.                   **/
+/**                                                                      **/
+
+static int thumbnailFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+
+	return tiffThumbnailExtract(filename, internal,
+		options->thumbnailDirectory);
+}
+
+
+/**                                                                      **/
+/**   Function: geotiffFile                                              **/
+/**                                                                      **/
+/**   tiffBatchFunc printing the GeoTIFF information of one file.        **/
+/**                                                                      **/
+
+static int geotiffFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+
+	if(options->label)
+	{
+		tiffPrintf(internal, "File %s\n", filename);
+	}
+
+	return tiffGeoTIFFPrint(filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: jsonFile                                                 **/
+/**                                                                      **/
+/**   tiffBatchFunc printing the entries of one file as NDJSON lines     **/
+/**   starting with the file name (see tiff_serve.h).                    **/
+/**                                                                      **/
+
+static int jsonFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	tiffModel model;
+
+	if(tiffModelLoad(filename, internal, &model) != 0)
+	{
+		return 1;
+	}
+	tiffServeRender(internal->out, &model, filename, -1, 0);
+	tiffModelFree(&model);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: remoteFile                                               **/
+/**                                                                      **/
+/**   tiffBatchFunc running options->remote on a file read through a     **/
+/**   read planner over a backend simulating a remote store, and         **/
+/**   reporting the round trips it took on stderr. The prefetch policy   **/
+/**   then learns from where the reads of the file landed.               **/
+/**                                                                      **/
+
+static int remoteFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+	tiffIOFile file;
+	tiffIOLatency latency;
+	tiffIOPlanner planner;
+	int status;
+
+	if(tiffIOFileOpen(&file, filename) != 0)
+	{
+		return 1;
+	}
+	tiffIOLatencyInit(&latency, &file.io, options->latencyUs);
+	tiffIOPlannerInit(&planner, &latency.io, 0);
+	planner.policy = options->policy;
+
+	internal->io = &planner.io;
+	status = options->remote(filename, internal, arg);
+	internal->io = NULL;
+
+	fprintf(stderr, "%s: %llu round trips, %llu bytes fetched\n",
+		filename, planner.roundTrips, planner.bytesFetched);
+	TIFF_STAT_ADD(internal, roundTrips, planner.roundTrips);
+	tiffIOPolicyLearn(options->policy, &planner);
+
+	tiffIOPlannerFree(&planner);
+	tiffIOFileClose(&file);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: lowImpactFile                                            **/
+/**                                                                      **/
+/**   tiffBatchFunc running options->lowImpact on a file read through a  **/
+/**   read planner over the uncached backend, within the limits of bytes **/
+/**   and files per second, and counting the page cache pages it read    **/
+/**   and left behind.                                                   **/
+/**                                                                      **/
+
+static int lowImpactFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+	tiffIOUncached file;
+	tiffIOPlanner planner;
+	int status;
+
+	tiffIOLimitTake(options->filesLimit, 1);
+	if(tiffIOUncachedOpen(&file, filename, options->bytesLimit) != 0)
+	{
+		return 1;
+	}
+	tiffIOPlannerInit(&planner, &file.io, TIFF_IO_PREFETCH);
+
+	internal->io = &planner.io;
+	status = options->lowImpact(filename, internal, arg);
+	internal->io = NULL;
+
+	TIFF_STAT_ADD(internal, roundTrips, planner.roundTrips);
+	TIFF_STAT_ADD(internal, pagesRead, file.pagesRead);
+	TIFF_STAT_ADD(internal, pagesLeft, file.pagesLeft);
+
+	tiffIOPlannerFree(&planner);
+	tiffIOUncachedClose(&file);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: whereFile                                                **/
+/**                                                                      **/
+/**   tiffBatchFunc running the action of the options on a file if it    **/
+/**   matches the --where query.                                         **/
+/**                                                                      **/
+
+static int whereFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const mainOptions *options = (const mainOptions *)arg;
+	int match;
+
+	match = tiffQueryMatch(options->where, filename, internal);
+	if(match < 0)
+	{
+		return 1;
+	}
+	if(match == 0)
+	{
+		return 0;
+	}
+
+	if(options->action == NULL)
+	{
+		tiffPrintf(internal, "%s\n", filename);
+
+		return 0;
+	}
+
+	return options->action(filename, internal, arg);
+}
+
 
 /**                                                                      **/
 /**   Function: main.                                                    **/
@@ -49,7 +421,103 @@ SOFTWARE.
 /**   Program main function.                                             **/
 /**                                                                      **/
 /**   Usage:                                                             **/
-/**   tiff_metadata tiffFile                                             **/
+/**   tiff_metadata [options] tiffFile|directory ...                     **/
+/**                                                                      **/
+/**   --layout       -- print a strip and tile layout report instead     **/
+/**                     of the metadata                                  **/
+/**   --fingerprint  -- print a 128-bit hash of the canonical metadata   **/
+/**                     of each file, ignoring file offsets              **/
+/**   --metadata     -- print the metadata (the default)                 **/
+/**   --validate     -- check the structure of each file, printing what  **/
+/**                     is wrong with it (see tiff_validate.h); exits    **/
+/**                     with 1 if any file has errors                    **/
+/**   --geotiff      -- print the coordinate reference system, affine    **/
+/**                     transform and GeoKeys of each file (see          **/
+/**                     tiff_geotiff.h)                                  **/
+/**   --json         -- print the entries of each file as NDJSON lines   **/
+/**                     (see tiff_serve.h)                               **/
+/**   --extract-thumbnail dir -- write the JPEG thumbnail of each file   **/
+/**                     into dir (see tiff_thumbnail.h)                  **/
+/**   --aggregate tags -- count files by the values of comma separated   **/
+/**                     tags, "/width" putting numbers in buckets, and   **/
+/**                     print the most frequent (see tiff_aggregate.h)   **/
+/**   --top N        -- with --aggregate, print N combinations           **/
+/**   --where expr   -- only process files matching a query (see         **/
+/**                     tiff_query.h), printing their names unless an    **/
+/**                     output option is given; given at most once       **/
+/**   --stats[=json] -- print performance counters and phase times to    **/
+/**                     stderr, as a summary or as a JSON record         **/
+/**   -j, --jobs N   -- process files with N worker threads              **/
+/**   --max-bytes N  -- print at most N bytes of each ASCII or UNDEFINED **/
+/**                     value                                            **/
+/**   --makernotes   -- decode Canon, Nikon, Sony, Fujifilm and Olympus  **/
+/**                     MakerNotes instead of dumping them               **/
+/**   --simulate-latency US -- read files through a read planner over a  **/
+/**                     backend sleeping US microseconds per round trip, **/
+/**                     reporting round trips per file (see tiff_io.h)   **/
+/**   --prefetch KB  -- with --simulate-latency, fetch the first KB      **/
+/**                     kilobytes of each file on its first read; the    **/
+/**                     window grows to where reads land, and hit rates  **/
+/**                     are printed at the end                           **/
+/**   --prefetch-tail KB -- same for the last KB kilobytes of each file  **/
+/**   --low-impact   -- read only the pages holding metadata, bypassing  **/
+/**                     or dropping from the page cache the pages that   **/
+/**                     were not cached, at idle I/O priority, and print **/
+/**                     the pages read and left behind (see tiff_io.h)   **/
+/**   --limit-bytes N -- read at most N bytes per second; implies        **/
+/**                     --low-impact                                     **/
+/**   --limit-files N -- open at most N files per second; implies        **/
+/**                     --low-impact                                     **/
+/**   --tagdb file   -- load a tag dictionary, text or compiled (see     **/
+/**                     tiff_tagdb.h), for the options that follow;      **/
+/**                     may be repeated, later dictionaries winning      **/
+/**   --checkpoint journal -- record progress in journal every 10        **/
+/**                     seconds (see tiff_checkpoint.h)                  **/
+/**   --resume       -- with --checkpoint, skip the files done by the    **/
+/**                     run that wrote journal, with the same paths, and **/
+/**                     truncate output appended to a regular file to    **/
+/**                     its size at the last checkpoint                  **/
+/**                                                                      **/
+/**   Directories are searched recursively.                              **/
+/**                                                                      **/
+/**   tiff_metadata [options] --watch dir [--debounce MS]                **/
+/**                 [--reconcile S]                                      **/
+/**                                                                      **/
+/**   watches dir for new and changed files and processes them once they **/
+/**   stayed unchanged for MS milliseconds (2000), scanning the whole    **/
+/**   tree every S seconds (300) for missed events, until interrupted;   **/
+/**   files are printed as with --json unless an output option is given  **/
+/**   (see tiff_watch.h).                                                **/
+/**                                                                      **/
+/**   tiff_metadata [--tagdb file ...] --serve socket [-j N]             **/
+/**                                                                      **/
+/**   serves requests on a Unix socket with N worker threads, see        **/
+/**   tiff_serve.h. Other options and file names are refused.            **/
+/**                                                                      **/
+/**   tiff_metadata diff ...                                             **/
+/**                                                                      **/
+/**   runs the diff subcommand, see tiffDiffMain.                        **/
+/**                                                                      **/
+/**   tiff_metadata edit ...                                             **/
+/**                                                                      **/
+/**   runs the edit subcommand, see tiffEditMain.                        **/
+/**                                                                      **/
+/**   tiff_metadata strip ...                                            **/
+/**                                                                      **/
+/**   runs the strip subcommand, see tiffStripMain.                      **/
+/**                                                                      **/
+/**   tiff_metadata tagdb input output                                   **/
+/**                                                                      **/
+/**   compiles a tag dictionary, see tiffTagDBMain.                      **/
+/**                                                                      **/
+/**   tiff_metadata catalog ...                                          **/
+/**                                                                      **/
+/**   builds or queries a catalog of files by time, see tiffCatalogMain. **/
+/**                                                                      **/
+/**   tiff_metadata bitmap ...                                           **/
+/**                                                                      **/
+/**   builds or queries a bitmap index of the tags files hold, see       **/
+/**   tiffBitmapMain.                                                    **/
 /**                                                                      **/
 /**   Input parameters:                                                  **/
 /**   argc       -- argument count                                       **/
@@ -58,13 +526,478 @@ SOFTWARE.
 
 int main(int argc, char *argv[])
 {
-	if(argc < 2)
+	static const struct option longOptions[] = {
+		{ "layout", no_argument, NULL, 'L', },
+		{ "fingerprint", no_argument, NULL, 'F', },
+		{ "stats", optional_argument, NULL, 'S', },
+		{ "jobs", required_argument, NULL, 'j', },
+		{ "max-bytes", required_argument, NULL, 'M', },
+		{ "makernotes", no_argument, NULL, 'N', },
+		{ "metadata", no_argument, NULL, 'D', },
+		{ "where", required_argument, NULL, 'W', },
+		{ "serve", required_argument, NULL, 'R', },
+		{ "validate", no_argument, NULL, 'V', },
+		{ "extract-thumbnail", required_argument, NULL, 'T', },
+		{ "simulate-latency", required_argument, NULL, 'U', },
+		{ "prefetch", required_argument, NULL, 'P', },
+		{ "prefetch-tail", required_argument, NULL, 'A', },
+		{ "aggregate", required_argument, NULL, 'G', },
+		{ "top", required_argument, NULL, 'O', },
+		{ "tagdb", required_argument, NULL, 'B', },
+		{ "geotiff", no_argument, NULL, 'E', },
+		{ "json", no_argument, NULL, 'J', },
+		{ "watch", required_argument, NULL, 'H', },
+		{ "debounce", required_argument, NULL, 'K', },
+		{ "reconcile", required_argument, NULL, 'C', },
+		{ "checkpoint", required_argument, NULL, 'Q', },
+		{ "resume", no_argument, NULL, 'Z', },
+		{ "low-impact", no_argument, NULL, 'I', },
+		{ "limit-bytes", required_argument, NULL, 'X', },
+		{ "limit-files", required_argument, NULL, 'Y', },
+		{ "full-arrays", no_argument, NULL, 'f', },
+		{ NULL, 0, NULL, 0, },
+	};
+	mainOptions options;
+	tiffIOPolicy policy;
+	tiffIOLimit bytesLimit;
+	tiffIOLimit filesLimit;
+	tiffAggregate aggregate;
+	tiffTagDB tagdbs[TIFF_TAGDB_MAX];
+	unsigned int numTagDBs = 0;
+	tiffQuery where;
+	tiffBatch batch;
+	tiffWatch watch;
+	tiffCheckpoint checkpoint;
+	struct stat st;
+	tiffBatchFunc func = NULL;
+	const char *serve = NULL;
+	const char *watchDir = NULL;
+	const char *journal = NULL;
+	int resume = 0;
+	unsigned int debounceMs = TIFF_WATCH_DEBOUNCE_MS;
+	unsigned int reconcileS = TIFF_WATCH_RECONCILE_S;
+	unsigned long long number;
+	size_t headBytes = TIFF_IO_PREFETCH;
+	size_t tailBytes = 0;
+	unsigned int top = TIFF_AGGREGATE_TOP;
+	unsigned long long bytesRate = 0;
+	unsigned long long filesRate = 0;
+	int remote = 0;
+	int lowImpact = 0;
+	int stats = 0;
+	int json = 0;
+	int jobs = 1;
+	int otherOptions = 0;
+	char *end;
+	int c;
+
+	options.maxValueBytes = 0;
+	options.maxArrayValues = TIFF_ARRAY_VALUES;
+	options.decodeMakerNotes = 0;
+	options.where = NULL;
+	options.thumbnailDirectory = NULL;
+	options.aggregate = NULL;
+	options.latencyUs = 0;
+	options.policy = NULL;
+	options.remote = NULL;
+	options.bytesLimit = NULL;
+	options.filesLimit = NULL;
+	options.lowImpact = NULL;
+
+	if( (argc > 1) && (strcmp(argv[1], "diff") == 0) )
+	{
+		return tiffDiffMain(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "edit") == 0) )
+	{
+		return tiffEditMain(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "strip") == 0) )
 	{
-		fprintf(stderr, "usage: %s tiffFile\n", argv[0]);
+		return tiffStripMain(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "tagdb") == 0) )
+	{
+		return tiffTagDBMain(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "catalog") == 0) )
+	{
+		return tiffCatalogMain(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "bitmap") == 0) )
+	{
+		return tiffBitmapMain(argc - 1, argv + 1);
+	}
+
+	while( (c = getopt_long(argc, argv, "j:", longOptions, NULL)) != -1)
+	{
+		if( (c != 'j') && (c != 'B') && (c != 'R') )
+		{
+			otherOptions++;
+		}
+		switch(c)
+		{
+			case 'L':
+			{
+				func = layoutFile;
+				break;
+			}
+			case 'F':
+			{
+				func = fingerprintFile;
+				break;
+			}
+			case 'S':
+			{
+				stats = 1;
+				if(optarg != NULL)
+				{
+					if(strcmp(optarg, "json") != 0)
+					{
+						usage(argv[0]);
+
+						return 1;
+					}
+					json = 1;
+				}
+				break;
+			}
+			case 'j':
+			{
+				jobs = (int)strtol(optarg, &end, 10);
+				if(*optarg == '\0' || *end != '\0' || jobs < 1)
+				{
+					usage(argv[0]);
+
+					return 1;
+				}
+				break;
+			}
+			case 'M':
+			{
+				options.maxValueBytes = strtoull(optarg, &end, 10);
+				if( (*optarg == '\0') || (*optarg == '-') ||
+					(*end != '\0') )
+				{
+					usage(argv[0]);
+
+					return 1;
+				}
+				break;
+			}
+			case 'N':
+			{
+				options.decodeMakerNotes = 1;
+				break;
+			}
+			case 'f':
+			{
+				options.maxArrayValues = 0;
+				break;
+			}
+			case 'U':
+			case 'P':
+			case 'A':
+			case 'O':
+			case 'K':
+			case 'C':
+			case 'X':
+			case 'Y':
+			{
+				number = strtoull(optarg, &end, 10);
+				if( (*optarg == '\0') || (*optarg == '-') ||
+					(*end != '\0') )
+				{
+					usage(argv[0]);
+
+					return 1;
+				}
+				if(c == 'U')
+				{
+					options.latencyUs = number;
+					remote = 1;
+				}
+				else if(c == 'O')
+				{
+					top = (unsigned int)number;
+				}
+				else if(c == 'K')
+				{
+					debounceMs = (unsigned int)number;
+				}
+				else if(c == 'C')
+				{
+					reconcileS = (unsigned int)number;
+				}
+				else if(c == 'X')
+				{
+					bytesRate = number;
+					lowImpact = 1;
+				}
+				else if(c == 'Y')
+				{
+					filesRate = number;
+					lowImpact = 1;
+				}
+				else if(c == 'P')
+				{
+					headBytes = (size_t)number * 1024;
+				}
+				else
+				{
+					tailBytes = (size_t)number * 1024;
+				}
+				break;
+			}
+			case 'D':
+			{
+				func = metadataFile;
+				break;
+			}
+			case 'W':
+			{
+				/* one query; combine conditions with && and || */
+				if(options.where != NULL)
+				{
+					usage(argv[0]);
+
+					return 1;
+				}
+				if(tiffQueryCompile(optarg, &where) != 0)
+				{
+					return 1;
+				}
+				options.where = &where;
+				break;
+			}
+			case 'V':
+			{
+				func = validateFile;
+				break;
+			}
+			case 'E':
+			{
+				func = geotiffFile;
+				break;
+			}
+			case 'J':
+			{
+				func = jsonFile;
+				break;
+			}
+			case 'H':
+			{
+				watchDir = optarg;
+				break;
+			}
+			case 'Q':
+			{
+				journal = optarg;
+				break;
+			}
+			case 'Z':
+			{
+				resume = 1;
+				break;
+			}
+			case 'I':
+			{
+				lowImpact = 1;
+				break;
+			}
+			case 'T':
+			{
+				options.thumbnailDirectory = optarg;
+				func = thumbnailFile;
+				break;
+			}
+			case 'G':
+			{
+				if( (options.aggregate == NULL) &&
+					(tiffAggregateCompile(optarg, &aggregate) != 0) )
+				{
+					return 1;
+				}
+				options.aggregate = &aggregate;
+				func = aggregateFile;
+				break;
+			}
+			case 'B':
+			{
+				if(numTagDBs == TIFF_TAGDB_MAX)
+				{
+					fprintf(stderr, "more than %d tag dictionaries\n",
+						TIFF_TAGDB_MAX);
+
+					return 1;
+				}
+				if( (tiffTagDBLoad(optarg, &tagdbs[numTagDBs]) != 0) ||
+					(tiffTagDBRegister(&tagdbs[numTagDBs]) != 0) )
+				{
+					return 1;
+				}
+				numTagDBs++;
+				break;
+			}
+			case 'R':
+			{
+				serve = optarg;
+				break;
+			}
+			default:
+			{
+				usage(argv[0]);
+
+				return 1;
+			}
+		}
+	}
+
+	if(serve != NULL)
+	{
+		/* a server takes tag dictionaries and a number of workers only */
+		if( (otherOptions > 0) || (optind < argc) )
+		{
+			usage(argv[0]);
+
+			return 1;
+		}
+
+		return tiffServeMain(serve, jobs);
+	}
+
+	if( ( (watchDir == NULL) == (optind >= argc) ) ||
+		( (journal == NULL) ? resume : (watchDir != NULL) ) ||
+		(lowImpact && remote) )
+	{
+		usage(argv[0]);
 
 		return 1;
 	}
 
-	return tiffMetadataPrint(argv[1]);
-}
+	if(watchDir != NULL)
+	{
+		options.label = 1;
+		if( (func == NULL) && (options.where == NULL) )
+		{
+			func = jsonFile;
+		}
+	}
+	else
+	{
+		options.label = (argc - optind > 1) ||
+			(stat(argv[optind], &st) == 0 && S_ISDIR(st.st_mode) );
+	}
+
+	options.action = func;
+	if(options.where != NULL)
+	{
+		func = whereFile;
+	}
+	else if(func == NULL)
+	{
+		func = metadataFile;
+	}
+
+	if(remote)
+	{
+		tiffIOPolicyInit(&policy, headBytes, tailBytes, TIFF_IO_MAX_WINDOW);
+		options.policy = &policy;
+		options.remote = func;
+		func = remoteFile;
+	}
 
+	if(lowImpact)
+	{
+		/* set before the workers are created, which inherit it */
+		if(tiffIOIdlePriority() != 0)
+		{
+			fprintf(stderr, "can't set idle I/O priority\n");
+		}
+		tiffIOLimitInit(&bytesLimit, (double)bytesRate);
+		tiffIOLimitInit(&filesLimit, (double)filesRate);
+		options.bytesLimit = &bytesLimit;
+		options.filesLimit = &filesLimit;
+		options.lowImpact = func;
+		func = lowImpactFile;
+	}
+
+	tiffBatchInit(&batch, func, &options);
+	batch.numThreads = jobs;
+	batch.collectStats = stats || lowImpact;
+	if(options.aggregate != NULL)
+	{
+		batch.workerInit = aggregateWorker;
+	}
+	if(journal != NULL)
+	{
+		if(tiffCheckpointOpen(&checkpoint, journal, resume, argv + optind,
+			argc - optind) != 0)
+		{
+			return 1;
+		}
+		batch.checkpoint = &checkpoint;
+	}
+
+	if(watchDir != NULL)
+	{
+		if(tiffWatchInit(&watch, watchDir, debounceMs, reconcileS) != 0)
+		{
+			return 1;
+		}
+		batch.status = tiffWatchRun(&watch, &batch);
+		tiffWatchFree(&watch);
+	}
+	else
+	{
+		tiffBatchRun(&batch, argv + optind, argc - optind);
+	}
+	if( (journal != NULL) && (tiffCheckpointClose(&checkpoint) != 0) )
+	{
+		batch.status = 1;
+	}
+
+	if(options.aggregate != NULL)
+	{
+		if( (tiffAggregateReduce(&aggregate, jobs) != 0) ||
+			(tiffAggregatePrint(stdout, &aggregate, top) != 0) )
+		{
+			batch.status = 1;
+		}
+		tiffAggregateFree(&aggregate);
+	}
+
+	if(stats)
+	{
+		tiffStatsPrint(stderr, &batch.stats, batch.wallNs, json);
+	}
+
+	if(remote)
+	{
+		tiffIOPolicyPrint(stderr, &policy);
+		tiffIOPolicyFree(&policy);
+	}
+
+	if(lowImpact)
+	{
+		fprintf(stderr, "low impact: %llu pages read, %llu left in the "
+			"page cache, %.3f s waited for limits\n",
+			batch.stats.pagesRead, batch.stats.pagesLeft,
+			(bytesLimit.waitNs + filesLimit.waitNs) / 1e9);
+		tiffIOLimitFree(&bytesLimit);
+		tiffIOLimitFree(&filesLimit);
+	}
+
+	tiffTagDBUnregister();
+	while(numTagDBs > 0)
+	{
+		tiffTagDBFree(&tagdbs[--numTagDBs]);
+	}
+
+	return batch.status;
+}
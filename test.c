@@ -25,12 +25,1750 @@ SOFTWARE.
 
 
 /**                                                                      **/
-/**   Test suite to check conditional swapping functions                 **/
+/**   Test suite to check conditional swapping functions and the         **/
+/**   analysis helpers built on them                                     **/
 /**                                                                      **/
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <utime.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "tiff_metadata.h"
+#include "tiff_layout.h"
+#include "tiff_stats.h"
+#include "tiff_fingerprint.h"
+#include "tiff_model.h"
+#include "tiff_diff.h"
+#include "tiff_makernote.h"
+#include "tiff_query.h"
+#include "tiff_serve.h"
+#include "tiff_edit.h"
+#include "tiff_strip.h"
+#include "tiff_validate.h"
+#include "tiff_thumbnail.h"
+#include "tiff_io.h"
+#include "tiff_aggregate.h"
+#include "tiff_tagdb.h"
+#include "tiff_geotiff.h"
+#include "tiff_watch.h"
+#include "tiff_checkpoint.h"
+#include "tiff_catalog.h"
+#include "tiff_bitmap.h"
+
+/**                                                                      **/
+/**   Check the strip and tile layout reductions                         **/
+/**                                                                      **/
+
+static void testLayout(void)
+{
+	/* Contiguous strips, then a gap, then one strip out of order that */
+	/* overlaps the first one, plus an empty (sparse) chunk.           */
+	const unsigned int offsets[] = { 100, 200, 300, 1000, 150, 0, };
+	const unsigned int byteCounts[] = { 100, 100, 100, 50, 100, 0, };
+	tiffLayoutStats stats;
+
+	assert(tiffLayoutAnalyze(offsets, byteCounts, 4, 1000, &stats) == 0);
+	assert(stats.chunks == 4);
+	assert(stats.totalBytes == 350);
+	assert(stats.minBytes == 50);
+	assert(stats.maxBytes == 100);
+	assert(stats.nonMonotonic == 0);
+	assert(stats.gaps == 1);
+	assert(stats.gapBytes == 600);
+	assert(stats.overlaps == 0);
+	assert(stats.pastEOF == 1);
+	assert(stats.span == 950);
+
+	assert(tiffLayoutAnalyze(offsets, byteCounts, 6, 2000, &stats) == 0);
+	assert(stats.chunks == 6);
+	assert(stats.emptyChunks == 1);
+	assert(stats.minBytes == 0);
+	assert(stats.nonMonotonic == 1);
+	assert(stats.gaps == 1);
+	assert(stats.overlaps == 2);
+	assert(stats.overlapBytes == 100);
+	assert(stats.pastEOF == 0);
+	assert( (stats.locality > 0.74) && (stats.locality < 0.76) );
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that phase timers nest and that counters merge               **/
+/**                                                                      **/
+
+static void testStats(void)
+{
+	internalStruct internal;
+	tiffStats stats;
+	tiffStats total;
+	tiffPhase_t outer;
+	tiffPhase_t inner;
+
+	tiffInitInternal(&internal);
+	tiffStatsInit(&stats);
+	tiffStatsInit(&total);
+
+	/* Disabled counters must be left alone */
+	TIFF_STAT_ADD(&internal, reads, 1);
+	assert(TIFF_STATS_ENTER(&internal, TIFF_PHASE_WALK) ==
+		TIFF_PHASE_NONE);
+
+	internal.stats = &stats;
+	TIFF_STAT_ADD(&internal, reads, 2);
+	TIFF_STAT_ADD(&internal, bytesRead, 100);
+	outer = TIFF_STATS_ENTER(&internal, TIFF_PHASE_WALK);
+	inner = TIFF_STATS_ENTER(&internal, TIFF_PHASE_FETCH);
+	assert(outer == TIFF_PHASE_NONE);
+	assert(inner == TIFF_PHASE_WALK);
+	assert(stats.phase == TIFF_PHASE_FETCH);
+	TIFF_STATS_LEAVE(&internal, inner);
+	assert(stats.phase == TIFF_PHASE_WALK);
+	TIFF_STATS_LEAVE(&internal, outer);
+	assert(stats.phase == TIFF_PHASE_NONE);
+	assert(stats.phaseNs[TIFF_PHASE_NONE] == 0);
+
+	tiffStatsMerge(&total, &stats);
+	tiffStatsMerge(&total, &stats);
+	assert(total.reads == 4);
+	assert(total.bytesRead == 200);
+	assert(total.phaseNs[TIFF_PHASE_WALK] ==
+		2 * stats.phaseNs[TIFF_PHASE_WALK]);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check the 128-bit hash against the reference implementation and    **/
+/**   that it does not depend on how the input is split                  **/
+/**                                                                      **/
+
+static void testFingerprint(void)
+{
+	static const char text[] = "The quick brown fox jumps over the lazy dog";
+	static const unsigned char expected[TIFF_FINGERPRINT_BYTES] = {
+		0x6c, 0x1b, 0x07, 0xbc, 0x7b, 0xbc, 0x4b, 0xe3,
+		0x47, 0x93, 0x9a, 0xc4, 0xa9, 0x3c, 0x43, 0x7a,
+	};
+	unsigned char digest[TIFF_FINGERPRINT_BYTES];
+	unsigned char split[TIFF_FINGERPRINT_BYTES];
+	tiffHash128 hash;
+	size_t n = strlen(text);
+	size_t i;
+
+	tiffHashInit(&hash, 0);
+	tiffHashUpdate(&hash, text, n);
+	tiffHashFinal(&hash, digest);
+	assert(memcmp(digest, expected, sizeof(digest) ) == 0);
+
+	tiffHashInit(&hash, 0);
+	for(i = 0;i < n;i++)
+	{
+		tiffHashUpdate(&hash, text + i, 1);
+	}
+	tiffHashFinal(&hash, split);
+	assert(memcmp(digest, split, sizeof(digest) ) == 0);
+
+	assert(tiffTagIsOffset(StripOffsets) );
+	assert(!tiffTagIsOffset(StripByteCounts) );
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that entries are matched by tag and compared by hash         **/
+/**                                                                      **/
+
+static void testDiff(void)
+{
+	tiffModelEntry entriesA[3];
+	tiffModelEntry entriesB[2];
+	tiffModelIFD ifdA = { IFD_TIFF, 0, 3, entriesA, };
+	tiffModelIFD ifdB = { IFD_TIFF, 0, 2, entriesB, };
+	tiffModelIFD exif = { IFD_EXIF, 0, 0, NULL, };
+	tiffModelIFD ifdsB[2];
+	tiffModel a = { 1, &ifdA, };
+	tiffModel b = { 1, &ifdB, };
+	internalStruct internal;
+
+	memset(entriesA, 0, sizeof(entriesA) );
+	memset(entriesB, 0, sizeof(entriesB) );
+	entriesA[0].tag = ImageWidth;
+	entriesA[1].tag = StripOffsets;
+	entriesA[2].tag = Make;
+	entriesA[2].hash[0] = 1;
+	entriesB[0].tag = ImageWidth;
+	entriesB[1].tag = StripOffsets;
+	entriesB[1].count = 2;
+	assert(tiffModelFind(&ifdA, StripOffsets) == &entriesA[1]);
+	assert(tiffModelFind(&ifdB, Make) == NULL);
+
+	tiffInitInternal(&internal);
+	internal.out = fopen("/dev/null", "w");
+	assert(internal.out != NULL);
+
+	assert(tiffDiffModels(&a, "a", &a, "a", &internal) == 0);
+
+	/* StripOffsets count changed and Make removed */
+	assert(tiffDiffModels(&a, "a", &b, "b", &internal) == 2);
+
+	/* Same entries, plus an added Exif IFD */
+	entriesB[1].count = 0;
+	entriesB[1].hash[0] = 2;
+	assert(tiffDiffModels(&b, "b", &b, "b", &internal) == 0);
+	ifdsB[0] = ifdB;
+	ifdsB[1] = exif;
+	a.ifds = &ifdB;
+	b.numIFDs = 2;
+	b.ifds = ifdsB;
+	assert(tiffDiffModels(&a, "a", &b, "b", &internal) == 1);
+
+	fclose(internal.out);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that ASCII values are split into views without copying       **/
+/**                                                                      **/
+
+static void testStrings(void)
+{
+	static const unsigned char bytes[] = "Canon\0EOS\0\0x";
+	tiffStringView views[4];
+	tiffEntry entry;
+	internalStruct internal;
+
+	assert(tiffSplitStrings(bytes, 6, views, 4) == 1);
+	assert( (views[0].ptr == (const char *)bytes) && (views[0].length == 5) );
+
+	/* Empty string, last string without NUL, more strings than views */
+	assert(tiffSplitStrings(bytes, sizeof(bytes) - 1, views, 4) == 4);
+	assert( (views[1].length == 3) && (views[2].length == 0) );
+	assert( (views[3].ptr == (const char *)bytes + 11) &&
+		(views[3].length == 1) );
+	assert(tiffSplitStrings(bytes, sizeof(bytes) - 1, views, 2) == 4);
+	assert(tiffSplitStrings(bytes, 0, views, 4) == 0);
+
+	tiffInitInternal(&internal);
+	memset(&entry, 0, sizeof(entry) );
+	entry.fieldType = FT_ASCII;
+	entry.totalBytes = 4;
+	entry.isInline = 1;
+	memcpy(entry.value, "ab\0c", 4);
+	assert(tiffGetStrings(&internal, &entry, views, 4) == 2);
+	assert( (views[0].ptr == (const char *)entry.value) &&
+		(views[1].length == 1) );
+
+	/* Out of line values need the file mapping */
+	entry.isInline = 0;
+	assert(tiffGetStrings(&internal, &entry, views, 4) == -1);
+	entry.fieldType = FT_BYTE;
+	entry.isInline = 1;
+	assert(tiffGetStrings(&internal, &entry, views, 4) == -1);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Big-endian file with a Make of "FUJIFILM" and an Exif IFD holding  **/
+/**   a Fujifilm MakerNote (ImageCount 4242, InternalSerialNumber        **/
+/**   "FF12345X")                                                        **/
+/**                                                                      **/
+
+static const unsigned char testFile[] = {
+	0x4d, 0x4d, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x08, 0x00, 0x02, 0x01, 0x0f,
+	0x00, 0x02, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x26, 0x87, 0x69,
+	0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00,
+	0x00, 0x00, 0x46, 0x55, 0x4a, 0x49, 0x46, 0x49, 0x4c, 0x4d, 0x00, 0x00,
+	0x00, 0x01, 0x92, 0x7c, 0x00, 0x07, 0x00, 0x00, 0x00, 0x54, 0x00, 0x00,
+	0x00, 0x42, 0x00, 0x00, 0x00, 0x00, 0x46, 0x55, 0x4a, 0x49, 0x46, 0x49,
+	0x4c, 0x4d, 0x0c, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x07, 0x00,
+	0x04, 0x00, 0x00, 0x00, 0x30, 0x31, 0x33, 0x30, 0x04, 0x14, 0x05, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x42, 0x00, 0x00, 0x00, 0x38, 0x14, 0x04, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x92, 0x10, 0x00, 0x00, 0x10, 0x00, 0x02, 0x00,
+	0x09, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xb4, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x46, 0x46, 0x31, 0x32,
+	0x33, 0x34, 0x35, 0x58, 0x00, 0x00,
+};
+
+static void writeTestFile(const char *filename)
+{
+	FILE *fp;
+
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(testFile, sizeof(testFile), 1, fp) == 1);
+	fclose(fp);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Write a file of the given byte order with Make make and an Exif    **/
+/**   IFD whose MakerNote, at offset 72, holds length bytes of note      **/
+/**                                                                      **/
+
+static void putTestShort(unsigned char *p, int bigEndian, unsigned int v)
+{
+	p[bigEndian ? 0 : 1] = (unsigned char)(v >> 8);
+	p[bigEndian ? 1 : 0] = (unsigned char)v;
+
+	return;
+}
+
+static void putTestLong(unsigned char *p, int bigEndian, unsigned int v)
+{
+	putTestShort(p + (bigEndian ? 0 : 2), bigEndian, v >> 16);
+	putTestShort(p + (bigEndian ? 2 : 0), bigEndian, v & 0xffff);
+
+	return;
+}
+
+static void putTestEntry(unsigned char *p, int bigEndian,
+	unsigned short tag, fieldType_t fieldType, unsigned int count,
+	unsigned int valueOffset)
+{
+	putTestShort(p, bigEndian, tag);
+	putTestShort(p + 2, bigEndian, fieldType);
+	putTestLong(p + 4, bigEndian, count);
+	putTestLong(p + 8, bigEndian, valueOffset);
+
+	return;
+}
+
+static void writeNoteFile(const char *filename, int bigEndian,
+	const char *make, const unsigned char *note, size_t length)
+{
+	unsigned char file[256];
+	FILE *fp;
+
+	assert( (strlen(make) >= 4) && (strlen(make) < 16) );
+	assert(72 + length <= sizeof(file) );
+	memset(file, 0, sizeof(file) );
+	memcpy(file, bigEndian ? "MM\0*" : "II*\0", 4);
+	putTestLong(file + 4, bigEndian, 8);
+	putTestShort(file + 8, bigEndian, 2);
+	putTestEntry(file + 10, bigEndian, Make, FT_ASCII,
+		(unsigned int)strlen(make) + 1, 56);
+	putTestEntry(file + 22, bigEndian, ExifIFDPointer, FT_LONG, 1, 38);
+	putTestShort(file + 38, bigEndian, 1);
+	putTestEntry(file + 40, bigEndian, MakerNote, FT_UNDEFINED,
+		(unsigned int)length, 72);
+	memcpy(file + 56, make, strlen(make) );
+	memcpy(file + 72, note, length);
+
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(file, 72 + length, 1, fp) == 1);
+	fclose(fp);
+
+	return;
+}
+
+/**                                                                      **/
+/**   MakerNote walk state: the Make and vendor expected, the note and   **/
+/**   the first value of the first entries found in it                   **/
+/**                                                                      **/
+
+typedef struct testNote
+{
+	const char *make;
+	tiffMakerNote_t vendor;
+	tiffMakerNote note;
+	unsigned int numEntries;
+	const char *names[4];
+	long long values[4];
+} testNote;
+
+static tiffWalk_t testNoteEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	testNote *test = (testNote *)ctx;
+	unsigned char bytes[8];
+	tiffValue value;
+
+	assert(entry->ifd->kind == IFD_MAKERNOTE);
+	if(test->numEntries < 4)
+	{
+		assert(tiffGetValueBytes(internal, entry, 0, bytes,
+			getFieldTypeNumBytes(entry->fieldType) ) == 0);
+		tiffDecodeValue(bytes, entry->fieldType, internal, &value);
+		test->names[test->numEntries] =
+			tiffMakerNoteTagName(&test->note, entry->tag);
+		test->values[test->numEntries] = value.integer;
+	}
+	test->numEntries++;
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor testNoteVisitor = {
+	NULL,
+	testNoteEntry,
+	NULL,
+};
+
+static tiffWalk_t testMakerNoteEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	testNote *test = (testNote *)ctx;
+
+	if(entry->tag == MakerNote)
+	{
+		assert(tiffMakerNoteOpen(internal, entry, test->make,
+			&test->note) == 0);
+		assert(test->note.vendor == test->vendor);
+		assert(tiffMakerNoteWalk("test", &test->note, &testNoteVisitor,
+			test) == TIFF_WALK_CONTINUE);
+	}
+	else if(entry->tag == Make)
+	{
+		/* Not a MakerNote */
+		assert(tiffMakerNoteOpen(internal, entry, "Canon",
+			&test->note) == 1);
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+/**                                                                      **/
+/**   Walk the MakerNote of a file, expecting a vendor                   **/
+/**                                                                      **/
+
+static void walkTestNote(const char *filename, const char *make,
+	tiffMakerNote_t vendor, testNote *test)
+{
+	static const tiffVisitor visitor = { NULL, testMakerNoteEntry, NULL, };
+	internalStruct internal;
+
+	memset(test, 0, sizeof(*test) );
+	test->make = make;
+	test->vendor = vendor;
+	tiffInitInternal(&internal);
+	assert(tiffOpen(filename, &internal) == 0);
+	assert(tiffWalkFile(filename, &internal, &visitor, test) ==
+		TIFF_WALK_CONTINUE);
+	tiffClose(&internal);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Return the value found for a MakerNote tag, or -1                  **/
+/**                                                                      **/
+
+static long long testNoteValue(const testNote *test, const char *name)
+{
+	unsigned int i;
+
+	for(i = 0;(i < test->numEntries) && (i < 4);i++)
+	{
+		if(strcmp(test->names[i], name) == 0)
+		{
+			return test->values[i];
+		}
+	}
+
+	return -1;
+}
+
+/**                                                                      **/
+/**   Check that the MakerNote layouts are walked: Fujifilm (little-     **/
+/**   endian, offsets from the note) in a big-endian file, Nikon type 3  **/
+/**   (a TIFF header of its own, of the other byte order, whose IFD is   **/
+/**   not right after it), both Olympus headers, Sony with and without   **/
+/**   a header and Canon, the last two told by the Make                  **/
+/**                                                                      **/
+
+static void testMakerNote(void)
+{
+	static const unsigned char nikon[] = {
+		'N', 'i', 'k', 'o', 'n', 0x00, 0x02, 0x10, 0x00, 0x00,
+		'M', 'M', 0x00, 0x2a, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00,
+		0x00, 0x02, 0x00, 0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+		0x06, 0x00, 0x00, 0x00, 0x00, 0xa7, 0x00, 0x04, 0x00, 0x00,
+		0x00, 0x01, 0x00, 0x00, 0x30, 0x39, 0x00, 0x00, 0x00, 0x00,
+	};
+	static const unsigned char olympus[] = {
+		'O', 'L', 'Y', 'M', 'P', 'U', 'S', 0x00, 'I', 'I',
+		0x03, 0x00, 0x01, 0x00, 0x01, 0x02, 0x03, 0x00, 0x01, 0x00,
+		0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	static const unsigned char omSystem[] = {
+		'O', 'M', ' ', 'S', 'Y', 'S', 'T', 'E', 'M', 0x00,
+		0x00, 0x00, 'M', 'M', 0x00, 0x04, 0x00, 0x01, 0x02, 0x01,
+		0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00,
+	};
+	static const unsigned char canon[] = {
+		0x00, 0x01, 0x00, 0x08, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01,
+		0x00, 0x10, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x00,
+	};
+	static const unsigned char sony[] = {
+		0x01, 0x00, 0x02, 0x20, 0x04, 0x00, 0x01, 0x00, 0x00, 0x00,
+		0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	static const unsigned char sonyDSC[] = {
+		'S', 'O', 'N', 'Y', ' ', 'D', 'S', 'C', ' ', 0x00,
+		0x00, 0x00, 0x00, 0x01, 0x20, 0x02, 0x00, 0x04, 0x00, 0x00,
+		0x00, 0x01, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
+	};
+	const char *filename = "test_makernote.tif";
+	testNote test;
+
+	writeTestFile(filename);
+	walkTestNote(filename, NULL, TIFF_MAKERNOTE_FUJIFILM, &test);
+	assert(test.numEntries == 4);
+	assert(testNoteValue(&test, "ImageCount") == 4242);
+
+	writeNoteFile(filename, 0, "NIKON", nikon, sizeof(nikon) );
+	walkTestNote(filename, "NIKON", TIFF_MAKERNOTE_NIKON, &test);
+	assert(test.numEntries == 2);
+	assert(testNoteValue(&test, "LensType") == 6);
+	assert(testNoteValue(&test, "ShutterCount") == 12345);
+
+	writeNoteFile(filename, 1, "OLYMPUS", olympus, sizeof(olympus) );
+	walkTestNote(filename, "OLYMPUS", TIFF_MAKERNOTE_OLYMPUS, &test);
+	assert(testNoteValue(&test, "Quality") == 2);
+
+	writeNoteFile(filename, 0, "OM Digital", omSystem, sizeof(omSystem) );
+	walkTestNote(filename, "OM Digital", TIFF_MAKERNOTE_OLYMPUS, &test);
+	assert(testNoteValue(&test, "Quality") == 3);
+
+	writeNoteFile(filename, 1, "Canon", canon, sizeof(canon) );
+	walkTestNote(filename, "Canon", TIFF_MAKERNOTE_CANON, &test);
+	assert(testNoteValue(&test, "FileNumber") == 1048618);
+
+	/* Headerless notes are only recognized from the Make */
+	writeNoteFile(filename, 0, "SONY", sony, sizeof(sony) );
+	walkTestNote(filename, "SONY", TIFF_MAKERNOTE_SONY, &test);
+	assert(testNoteValue(&test, "Rating") == 5);
+
+	writeNoteFile(filename, 1, "SONY", sonyDSC, sizeof(sonyDSC) );
+	walkTestNote(filename, "SONY", TIFF_MAKERNOTE_SONY, &test);
+	assert(testNoteValue(&test, "Rating") == 4);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check query compilation and evaluation with early termination      **/
+/**                                                                      **/
+
+static void testQuery(void)
+{
+	const char *filename = "test_query.tif";
+	internalStruct internal;
+	tiffQuery query;
+	tiffStats stats;
+
+	assert(tiffQueryCompile("Make == \"FUJIFILM\" && !(271 ~ \"X\")",
+		&query) == 0);
+	assert( (query.numTerms == 2) && (query.numOps == 4) );
+	assert(query.ops[3].op == TIFF_QUERY_OP_AND);
+	assert(tiffQueryCompile("Make ==", &query) == 1);
+	assert(tiffQueryCompile("NoSuchTag", &query) == 1);
+	assert(tiffQueryCompile("(Make", &query) == 1);
+
+	writeTestFile(filename);
+	tiffStatsInit(&stats);
+	tiffInitInternal(&internal);
+	internal.stats = &stats;
+
+	/* Decided by the first entry: the Exif IFD is never walked */
+	assert(tiffQueryCompile("Make ~ \"FUJI\" || MakerNote", &query) == 0);
+	assert(tiffQueryMatch(&query, filename, &internal) == 1);
+	assert( (stats.ifds == 1) && (stats.entries == 1) );
+
+	assert(tiffQueryCompile("ExifIFDPointer >= 38 && MakerNote", &query) ==
+		0);
+	assert(tiffQueryMatch(&query, filename, &internal) == 1);
+	assert(tiffQueryCompile("ImageWidth || Make != \"FUJIFILM\"",
+		&query) == 0);
+	assert(tiffQueryMatch(&query, filename, &internal) == 0);
+	assert(tiffQueryMatch(&query, "no_such_file.tif", &internal) == -1);
+
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check the server model cache and answer rendering                  **/
+/**                                                                      **/
+
+static void testServe(void)
+{
+	const char *filename = "test_serve.tif";
+	struct utimbuf times = { 1000000000, 1000000000, };
+	tiffCache cache;
+	tiffCacheEntry *first;
+	tiffCacheEntry *entry;
+	char *body = NULL;
+	size_t size = 0;
+	FILE *out;
+
+	writeTestFile(filename);
+	assert(tiffCacheInit(&cache, 1) == 0);
+	first = tiffCacheGet(&cache, filename);
+	assert(first != NULL);
+	entry = tiffCacheGet(&cache, filename);
+	assert( (entry == first) && (cache.hits == 1) && (cache.misses == 1) );
+	tiffCacheRelease(&cache, entry);
+
+	out = open_memstream(&body, &size);
+	tiffServeRender(out, &first->model, NULL, 271, 0);
+	fclose(out);
+	assert(strcmp(body, "{\"ifd\":\"IFD0\",\"tag\":271,\"name\":\"Make\","
+		"\"type\":\"ASCII\",\"count\":9,"
+		"\"value\":\"\\\"FUJIFILM\\\"\"}\n") == 0);
+	free(body);
+
+	out = open_memstream(&body, &size);
+	tiffServeRender(out, &first->model, "a\"b.tif", 271, 0);
+	fclose(out);
+	assert(strcmp(body, "{\"file\":\"a\\\"b.tif\",\"ifd\":\"IFD0\","
+		"\"tag\":271,\"name\":\"Make\",\"type\":\"ASCII\",\"count\":9,"
+		"\"value\":\"\\\"FUJIFILM\\\"\"}\n") == 0);
+	free(body);
+
+	/* A changed file is loaded again and evicts the old model, which
+	   stays valid until released */
+	assert(utime(filename, &times) == 0);
+	entry = tiffCacheGet(&cache, filename);
+	assert( (entry != NULL) && (entry != first) && (cache.misses == 2) );
+	assert( (cache.numEntries == 1) && (first->model.numIFDs > 0) );
+	tiffCacheRelease(&cache, first);
+	tiffCacheRelease(&cache, entry);
+
+	assert(tiffCacheGet(&cache, "no_such_file.tif") == NULL);
+	tiffCacheFree(&cache);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check value encoding and in-place edits, in the slot of the old    **/
+/**   value and appended                                                 **/
+/**                                                                      **/
+
+static void testEdit(void)
+{
+	const char *filename = "test_edit.tif";
+	unsigned char buffer[TIFF_EDIT_MAX_VALUE];
+	internalStruct internal;
+	const tiffModelEntry *entry;
+	tiffModel model;
+	tiffEdit edits[2];
+	unsigned int count;
+	size_t n;
+
+	tiffInitInternal(&internal);
+	internal.fileEndian = internal.machineEndian ^ 1;
+	assert(tiffEditEncode(&internal, FT_SHORT, " 1 0x1234", buffer, &count,
+		&n) == 0);
+	assert( (count == 2) && (n == 4) && (buffer[2] == 0x12) );
+	assert(tiffEditEncode(&internal, FT_RATIONAL, "300/2", buffer, &count,
+		&n) == 0);
+	assert( (n == 8) && (buffer[3] == 44) && (buffer[7] == 2) );
+	assert(tiffEditEncode(&internal, FT_SHORT, "65536", buffer, &count,
+		&n) == 1);
+	assert(tiffEditEncode(&internal, FT_LONG, "", buffer, &count, &n) == 1);
+
+	assert(tiffEditParse("StripOffsets=8", &edits[0]) == 1);
+	assert(tiffEditParse("Make", &edits[0]) == 1);
+	assert(tiffEditParse("Make=FUJI", &edits[0]) == 0);
+	assert(tiffEditParse("0x9999=1", &edits[1]) == 0);
+
+	writeTestFile(filename);
+	tiffInitInternal(&internal);
+	assert(tiffEditFile(filename, &internal, edits, 2, 0) == 1);
+	assert(tiffEditFile(filename, &internal, edits, 1, 0) == 0);
+	assert(tiffModelLoad(filename, &internal, &model) == 0);
+	entry = tiffModelFind(&model.ifds[0], 271);
+	assert( (entry->count == 5) && (memcmp(entry->value, "FUJI", 5) == 0) );
+	tiffModelFree(&model);
+
+	assert(tiffEditParse("Make=Fujifilm Corporation", &edits[0]) == 0);
+	tiffInitInternal(&internal);
+	assert(tiffEditFile(filename, &internal, edits, 1, 0) == 0);
+	assert(tiffModelLoad(filename, &internal, &model) == 0);
+	entry = tiffModelFind(&model.ifds[0], 271);
+	assert( (entry->count == 21) &&
+		(memcmp(entry->value, "Fujifilm Corporation", 21) == 0) );
+	assert(model.numIFDs == 2);
+	tiffModelFree(&model);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that stripping leaves out the MakerNote and keeps the rest   **/
+/**                                                                      **/
+
+static void testStrip(void)
+{
+	const char *input = "test_strip.tif";
+	const char *output = "test_strip_out.tif";
+	internalStruct internal;
+	tiffStripOptions options;
+	tiffStripResult result;
+	tiffModel model;
+
+	tiffStripInit(&options);
+	assert(options.numRemove == 2);
+	assert(tiffStripRemove(&options, MakerNote, 0) == 0);
+	assert(tiffStripRemove(&options, MakerNote, 1) == 0);
+	assert(tiffStripRemove(&options, MakerNote, 1) == 0);
+	assert(options.numRemove == 2);
+
+	writeTestFile(input);
+	assert(tiffStripFile(input, input, &options, &result) == 1);
+	assert(tiffStripFile(input, output, &options, &result) == 0);
+	assert( (result.ifds == 2) && (result.removed == 1) );
+	assert(result.metadataBytes < sizeof(testFile) );
+
+	tiffInitInternal(&internal);
+	assert(tiffModelLoad(output, &internal, &model) == 0);
+	assert( (model.numIFDs == 2) && (model.ifds[1].kind == IFD_EXIF) );
+	assert(tiffModelFind(&model.ifds[0], Make) != NULL);
+	assert(tiffModelFind(&model.ifds[1], MakerNote) == NULL);
+	tiffModelFree(&model);
+
+	remove(input);
+	remove(output);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that the test file validates, and that pointing the Make     **/
+/**   value into the IFD and then past the end of the file fails         **/
+/**                                                                      **/
+
+static void testValidate(void)
+{
+	const char *filename = "test_validate.tif";
+	internalStruct internal;
+	tiffValidateResult result;
+	unsigned char offset[2];
+	FILE *fp;
+
+	writeTestFile(filename);
+	tiffInitInternal(&internal);
+	assert(tiffValidateFile(filename, &internal, &result) == 0);
+	assert( (result.errors == 0) && (result.warnings == 0) );
+	assert(result.ranges >= 4);
+
+	/* Low half of the Make value offset, big-endian */
+	offset[0] = 0x00;
+	offset[1] = 0x0c;
+	fp = fopen(filename, "r+b");
+	assert(fp != NULL);
+	assert(fseek(fp, 20, SEEK_SET) == 0);
+	assert(fwrite(offset, sizeof(offset), 1, fp) == 1);
+	fclose(fp);
+	tiffInitInternal(&internal);
+	assert(tiffValidateFile(filename, &internal, &result) == 1);
+	assert(result.errors == 1);
+
+	offset[0] = 0xff;
+	fp = fopen(filename, "r+b");
+	assert(fp != NULL);
+	assert(fseek(fp, 20, SEEK_SET) == 0);
+	assert(fwrite(offset, sizeof(offset), 1, fp) == 1);
+	fclose(fp);
+	tiffInitInternal(&internal);
+	assert(tiffValidateFile(filename, &internal, &result) == 1);
+	assert(result.errors >= 1);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Little-endian file whose IFD0 holds only a 6-byte thumbnail        **/
+/**                                                                      **/
+
+static const unsigned char testThumbnailFile[] = {
+	0x49, 0x49, 0x2a, 0x00, 0x08, 0x00, 0x00, 0x00, 0x02, 0x00, 0x01, 0x02,
+	0x04, 0x00, 0x01, 0x00, 0x00, 0x00, 0x26, 0x00, 0x00, 0x00, 0x02, 0x02,
+	0x04, 0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0xff, 0xd8, 0x01, 0x02, 0xff, 0xd9,
+};
+
+/**                                                                      **/
+/**   Check that a thumbnail is found, viewed in place and extracted     **/
+/**                                                                      **/
+
+static void testThumbnail(void)
+{
+	const char *filename = "test_thumbnail.tif";
+	const char *output = "./test%5Fthumbnail.tif.jpg";
+	const char *nested = "test_thumb/nail.tif";
+	const char *flat = "test_thumb_nail.tif";
+	const unsigned char *view;
+	unsigned char buffer[16];
+	internalStruct internal;
+	tiffThumbnail thumbnail;
+	FILE *fp;
+
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(testThumbnailFile, sizeof(testThumbnailFile), 1, fp) == 1);
+	fclose(fp);
+
+	tiffInitInternal(&internal);
+	assert(tiffOpen(filename, &internal) == 0);
+	assert(tiffThumbnailFind(filename, &internal, &thumbnail) == 0);
+	assert( (thumbnail.offset == 38) && (thumbnail.length == 6) );
+	view = tiffThumbnailView(&internal, &thumbnail);
+	assert( (view == NULL) || (memcmp(view, testThumbnailFile + 38, 6) == 0) );
+	tiffClose(&internal);
+
+	tiffInitInternal(&internal);
+	assert(tiffThumbnailExtract(filename, &internal, ".") == 0);
+	fp = fopen(output, "rb");
+	assert(fp != NULL);
+	assert(fread(buffer, 1, sizeof(buffer), fp) == 6);
+	assert(memcmp(buffer, testThumbnailFile + 38, 6) == 0);
+	fclose(fp);
+
+	/* An existing thumbnail is a collision, not overwritten */
+	tiffInitInternal(&internal);
+	assert(tiffThumbnailExtract(filename, &internal, ".") == 1);
+	remove(output);
+
+	/* "/" and "_" in the source path give different names */
+	assert(mkdir("test_thumb", 0755) == 0);
+	assert(rename(filename, nested) == 0);
+	tiffInitInternal(&internal);
+	assert(tiffThumbnailExtract(nested, &internal, ".") == 0);
+	assert(rename(nested, flat) == 0);
+	tiffInitInternal(&internal);
+	assert(tiffThumbnailExtract(flat, &internal, ".") == 0);
+	assert(remove("test%5Fthumb_nail.tif.jpg") == 0);
+	assert(remove("test%5Fthumb%5Fnail.tif.jpg") == 0);
+	remove(flat);
+	rmdir("test_thumb");
+
+	writeTestFile(filename);
+	tiffInitInternal(&internal);
+	assert(tiffThumbnailExtract(filename, &internal, ".") == 1);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that a file read through a planner over a latency backend    **/
+/**   parses as the local file does, in a single round trip              **/
+/**                                                                      **/
+
+static void testIO(void)
+{
+	const char *filename = "test_io.tif";
+	unsigned char buffer[16];
+	internalStruct internal;
+	tiffIOFile file;
+	tiffIOLatency latency;
+	tiffIOPlanner planner;
+	tiffModel local;
+	tiffModel remote;
+	const tiffModelEntry *a;
+	const tiffModelEntry *b;
+
+	writeTestFile(filename);
+	tiffInitInternal(&internal);
+	assert(tiffModelLoad(filename, &internal, &local) == 0);
+
+	assert(tiffIOFileOpen(&file, filename) == 0);
+	tiffIOLatencyInit(&latency, &file.io, 0);
+	tiffIOPlannerInit(&planner, &latency.io, TIFF_IO_PREFETCH);
+	tiffInitInternal(&internal);
+	internal.io = &planner.io;
+	assert(tiffModelLoad(filename, &internal, &remote) == 0);
+	assert( (planner.roundTrips == 1) && (latency.roundTrips == 1) );
+	assert(planner.bytesFetched == sizeof(testFile) );
+
+	assert(remote.numIFDs == local.numIFDs);
+	a = tiffModelFind(&local.ifds[1], MakerNote);
+	b = tiffModelFind(&remote.ifds[1], MakerNote);
+	assert( (a != NULL) && (b != NULL) && (a->count == b->count) &&
+		(memcmp(a->value, b->value, a->count) == 0) );
+	tiffModelFree(&local);
+	tiffModelFree(&remote);
+
+	/* Reads past the end come back short without another round trip */
+	assert(tiffReadAt(&internal, sizeof(testFile) - 4, buffer,
+		sizeof(buffer) ) == 4);
+	assert(planner.roundTrips == 1);
+
+	tiffIOPlannerFree(&planner);
+	tiffIOFileClose(&file);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that a prefetch policy grows its windows to where the reads  **/
+/**   of a file landed, so that the next file hits them                  **/
+/**                                                                      **/
+
+static void testIOPolicy(void)
+{
+	const char *filename = "test_policy.tif";
+	unsigned char buffer[16];
+	internalStruct internal;
+	tiffIOPolicy policy;
+	tiffIOFile file;
+	tiffIOPlanner planner;
+	unsigned int i;
+
+	writeTestFile(filename);
+	assert(tiffIOFileOpen(&file, filename) == 0);
+	tiffIOPolicyInit(&policy, 0, 0, 64);
+
+	for(i = 0;i < 2;i++)
+	{
+		tiffIOPlannerInit(&planner, &file.io, 0);
+		planner.policy = &policy;
+		tiffInitInternal(&internal);
+		internal.io = &planner.io;
+		assert(tiffReadAt(&internal, 0, buffer, 16) == 16);
+		assert(tiffReadAt(&internal, sizeof(testFile) - 8, buffer, 8) == 8);
+		assert(planner.roundTrips == 1);
+		assert(planner.hits == i + 1);
+		tiffIOPolicyLearn(&policy, &planner);
+		tiffIOPlannerFree(&planner);
+	}
+
+	assert( (policy.headBytes == 16) && (policy.tailBytes == 8) );
+	assert( (policy.files == 2) && (policy.oneTrip == 2) );
+	assert( (policy.reads == 4) && (policy.hits == 3) );
+
+	tiffIOPolicyFree(&policy);
+	tiffIOFileClose(&file);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that the uncached backend returns the bytes of unaligned     **/
+/**   ranges, leaves no page behind, and that token buckets make the     **/
+/**   takers wait once they run short                                    **/
+/**                                                                      **/
+
+static void testIOUncached(void)
+{
+	const char *filename = "test_uncached.tif";
+	unsigned char buffer[sizeof(testFile)];
+	tiffIORange ranges[2];
+	tiffIOUncached file;
+	tiffIOLimit limit;
+
+	writeTestFile(filename);
+	tiffIOLimitInit(&limit, 6000);
+	assert(tiffIOUncachedOpen(&file, filename, &limit) == 0);
+	assert(file.io.size(file.io.handle) == sizeof(testFile) );
+
+	ranges[0].offset = 3;
+	ranges[0].length = 20;
+	ranges[0].dst = buffer;
+	ranges[1].offset = sizeof(testFile) - 5;
+	ranges[1].length = 10;
+	ranges[1].dst = buffer + 20;
+	assert(file.io.read(file.io.handle, ranges, 2) == 0);
+	assert( (ranges[0].got == 20) && (ranges[1].got == 5) );
+	assert(memcmp(buffer, testFile + 3, 20) == 0);
+	assert(memcmp(buffer + 20, testFile + sizeof(testFile) - 5, 5) == 0);
+	assert( (file.pagesRead == 2) && (file.pagesLeft == 0) );
+	tiffIOUncachedClose(&file);
+
+	/* The second page overdrew the 6000 bytes a second */
+	assert(limit.waitNs > 0);
+	tiffIOLimitTake(NULL, 1e9);
+	tiffIOLimitFree(&limit);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that files counted by two workers are reduced into one       **/
+/**   histogram, numbers being put in buckets                            **/
+/**                                                                      **/
+
+static void testAggregate(void)
+{
+	const char *fuji = "test_aggregate.tif";
+	const char *thumbnail = "test_aggregate_thumbnail.tif";
+	const char *expected =
+		"files\tMake\tJPEGInterchangeFormat/16\n"
+		"3\tFUJIFILM\t(none)\n"
+		"1\t(other 1 combinations)\n"
+		"4\t(total)\n";
+	internalStruct internal;
+	tiffAggregate aggregate;
+	void *worker[2];
+	char *body;
+	size_t size;
+	FILE *fp;
+
+	assert(tiffAggregateCompile("Make,Nope", &aggregate) == 1);
+	assert(tiffAggregateCompile("Make/0", &aggregate) == 1);
+	assert(tiffAggregateCompile("Make,JPEGInterchangeFormat/16",
+		&aggregate) == 0);
+	assert( (aggregate.numKeys == 2) && (aggregate.keys[1].tag == 513) );
+
+	writeTestFile(fuji);
+	fp = fopen(thumbnail, "wb");
+	assert(fp != NULL);
+	assert(fwrite(testThumbnailFile, sizeof(testThumbnailFile), 1, fp) == 1);
+	fclose(fp);
+
+	worker[0] = tiffAggregateWorker(&aggregate);
+	worker[1] = tiffAggregateWorker(&aggregate);
+	assert( (worker[0] != NULL) && (worker[1] != NULL) );
+	tiffInitInternal(&internal);
+	assert(tiffAggregateFile(&aggregate, worker[0], fuji, &internal) == 0);
+	assert(tiffAggregateFile(&aggregate, worker[0], fuji, &internal) == 0);
+	assert(tiffAggregateFile(&aggregate, worker[1], fuji, &internal) == 0);
+	assert(tiffAggregateFile(&aggregate, worker[1], thumbnail,
+		&internal) == 0);
+	assert(tiffAggregateFile(&aggregate, worker[1], "no_such_file.tif",
+		&internal) == 1);
+	assert(tiffAggregateReduce(&aggregate, 2) == 0);
+
+	fp = open_memstream(&body, &size);
+	assert(fp != NULL);
+	assert(tiffAggregatePrint(fp, &aggregate, 1) == 0);
+	fclose(fp);
+	assert(strcmp(body, expected) == 0);
+	free(body);
+
+	fp = open_memstream(&body, &size);
+	assert(fp != NULL);
+	assert(tiffAggregatePrint(fp, &aggregate, 2) == 0);
+	fclose(fp);
+	assert(strstr(body, "\n1\t(none)\t32-48\n4\t(total)\n") != NULL);
+	free(body);
+
+	tiffAggregateFree(&aggregate);
+	remove(fuji);
+	remove(thumbnail);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that values longer than a read chunk print the same through  **/
+/**   an I/O backend as mapped: a string across the chunk boundary and   **/
+/**   dump offsets going on past it; and that --max-bytes truncates      **/
+/**   ASCII and UNDEFINED values with a marker                           **/
+/**                                                                      **/
+
+static void testValues(void)
+{
+	/* ImageDescription of 4100 bytes at 38, whose second string */
+	/* "spanning" crosses offset 4096 of the value, and an UNDEFINED */
+	/* MakerNote of 4200 bytes at 4138 */
+	static unsigned char file[8338];
+	const char *filename = "test_values.tif";
+	internalStruct internal;
+	tiffIOFile io;
+	char *mapped = NULL;
+	char *body = NULL;
+	size_t size = 0;
+	unsigned int i;
+	FILE *fp;
+
+	memset(file, 0, sizeof(file) );
+	memcpy(file, "II*\0\x08\0\0\0\x02\0"
+		"\x0e\x01\x02\0\x04\x10\0\0\x26\0\0\0"
+		"\x7c\x92\x07\0\x68\x10\0\0\x2a\x10\0\0", 34);
+	memset(file + 38, 'a', 4090);
+	memcpy(file + 38 + 4091, "spanning", 8);
+	for(i = 0;i < 4200;i++)
+	{
+		file[4138 + i] = (unsigned char)(i * 7);
+	}
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(file, sizeof(file), 1, fp) == 1);
+	fclose(fp);
+
+	tiffInitInternal(&internal);
+	internal.out = open_memstream(&mapped, &size);
+	assert(tiffMetadataPrintFile(filename, &internal) == 0);
+	fclose(internal.out);
+
+	assert(tiffIOFileOpen(&io, filename) == 0);
+	tiffInitInternal(&internal);
+	internal.io = &io.io;
+	internal.out = open_memstream(&body, &size);
+	assert(tiffMetadataPrintFile(filename, &internal) == 0);
+	fclose(internal.out);
+	assert(strcmp(body, mapped) == 0);
+	assert(strstr(body, "\t  String \"spanning\"\n") != NULL);
+	assert(strstr(body, "\n00000ff0  90 97 9e") != NULL);
+	assert(strstr(body, "\n00001000  00 07 0e") != NULL);
+	assert(strstr(body, "\n00001068\n") != NULL);
+	free(mapped);
+	free(body);
+
+	tiffInitInternal(&internal);
+	internal.io = &io.io;
+	internal.maxValueBytes = 100;
+	internal.out = open_memstream(&body, &size);
+	assert(tiffMetadataPrintFile(filename, &internal) == 0);
+	fclose(internal.out);
+	assert(strstr(body, "a\"\n\t  ... truncated, 100 of 4100 bytes "
+		"shown\n") != NULL);
+	assert(strstr(body, "\n00000060  a0 a7 ae b5 ") != NULL);
+	assert(strstr(body, "\n00000064\n\t  ... truncated, 100 of 4200 "
+		"bytes shown\n") != NULL);
+	free(body);
+
+	tiffIOFileClose(&io);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that an IFD whose next offset points back to itself ends     **/
+/**   the walk with an error instead of looping                          **/
+/**                                                                      **/
+
+static void testIFDLoop(void)
+{
+	static const unsigned char loop[] = {
+		0x49, 0x49, 0x2a, 0x00, 0x08, 0x00, 0x00, 0x00, 0x01, 0x00,
+		0x01, 0x01, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00,
+		0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+	};
+	const char *filename = "test_loop.tif";
+	const tiffVisitor visitor = { NULL, NULL, NULL, };
+	internalStruct internal;
+	FILE *fp;
+
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(loop, sizeof(loop), 1, fp) == 1);
+	fclose(fp);
+
+	tiffInitInternal(&internal);
+	assert(tiffOpen(filename, &internal) == 0);
+	assert(tiffWalkFile(filename, &internal, &visitor, NULL) ==
+		TIFF_WALK_ERROR);
+	tiffClose(&internal);
+
+	tiffInitInternal(&internal);
+	internal.out = fopen("/dev/null", "w");
+	assert(internal.out != NULL);
+	assert(tiffMetadataPrintFile(filename, &internal) != 0);
+	fclose(internal.out);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that long arrays print their ends and a summary, and every   **/
+/**   value with maxArrayValues 0                                        **/
+/**                                                                      **/
+
+static void testArraySummary(void)
+{
+	const char *filename = "test_summary.tif";
+	unsigned char file[478];
+	internalStruct internal;
+	char *body = NULL;
+	size_t size = 0;
+	unsigned int i;
+	FILE *fp;
+
+	/* TileOffsets LONG 1000, 990, ... 10 at 38, TileByteCounts SSHORT */
+	/* 0, -1, ... -19 at 438 */
+	memset(file, 0, sizeof(file) );
+	memcpy(file, "II*\0\x08\0\0\0\x02\0"
+		"\x44\x01\x04\0\x64\0\0\0\x26\0\0\0"
+		"\x45\x01\x08\0\x14\0\0\0\xb6\x01\0\0", 34);
+	for(i = 0;i < 100;i++)
+	{
+		file[38 + 4 * i] = (unsigned char)( (1000 - 10 * i) & 0xff);
+		file[39 + 4 * i] = (unsigned char)( (1000 - 10 * i) >> 8);
+	}
+	for(i = 0;i < 20;i++)
+	{
+		file[438 + 2 * i] = (unsigned char)(-(int)i & 0xff);
+		file[439 + 2 * i] = (i > 0) ? 0xff : 0;
+	}
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(file, sizeof(file), 1, fp) == 1);
+	fclose(fp);
+
+	tiffInitInternal(&internal);
+	internal.maxArrayValues = 16;
+	internal.out = open_memstream(&body, &size);
+	assert(tiffMetadataPrintFile(filename, &internal) == 0);
+	fclose(internal.out);
+	assert(strstr(body, "\t  7 Value 930 ") != NULL);
+	assert(strstr(body, "\t  8 Value") == NULL);
+	assert(strstr(body, "\t  ... 84 values\n\t  92 Value 80 ") != NULL);
+	assert(strstr(body, "\t  99 Value 10 unknown\n\t  Summary count 100 "
+		"min 10 max 1000 sum 50500 decreasing\n") != NULL);
+	assert(strstr(body, "\t  ... 4 values\n") != NULL);
+	assert(strstr(body, "\t  Summary count 20 min -19 max 0 sum -190 "
+		"decreasing\n") != NULL);
+	free(body);
+
+	tiffInitInternal(&internal);
+	internal.out = open_memstream(&body, &size);
+	assert(tiffMetadataPrintFile(filename, &internal) == 0);
+	fclose(internal.out);
+	assert(strstr(body, "\t  50 Value 500 ") != NULL);
+	assert(strstr(body, "Summary") == NULL);
+	free(body);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that every field type decodes in both byte orders            **/
+/**                                                                      **/
+
+static void testDecode(void)
+{
+	/* SSHORT, SLONG, FLOAT, DOUBLE, SRATIONAL and BYTE, in each order */
+	static const unsigned char be[] = {
+		0xfe, 0xd4, 0xff, 0xfe, 0xee, 0x90, 0x3f, 0xc0, 0x00, 0x00,
+		0x41, 0x58, 0x54, 0xa6, 0x40, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x05, 0xff, 0xff, 0xff, 0xf9, 0xfa,
+	};
+	static const unsigned char le[] = {
+		0xd4, 0xfe, 0x90, 0xee, 0xfe, 0xff, 0x00, 0x00, 0xc0, 0x3f,
+		0x00, 0x00, 0x00, 0x40, 0xa6, 0x54, 0x58, 0x41,
+		0x05, 0x00, 0x00, 0x00, 0xf9, 0xff, 0xff, 0xff, 0xfa,
+	};
+	const unsigned char *bytes;
+	internalStruct internal;
+	tiffValue value;
+	int order;
+
+	tiffInitInternal(&internal);
+	for(order = 0;order < 2;order++)
+	{
+		internal.fileEndian = order;
+		bytes = (order == 0) ? be : le;
+
+		tiffDecodeValue(bytes, FT_SSHORT, &internal, &value);
+		assert( (value.integer == -300) && (value.real == -300.0) );
+		tiffDecodeValue(bytes + 2, FT_SLONG, &internal, &value);
+		assert(value.integer == -70000);
+		tiffDecodeValue(bytes + 6, FT_FLOAT, &internal, &value);
+		assert(value.real == 1.5);
+		tiffDecodeValue(bytes + 10, FT_DOUBLE, &internal, &value);
+		assert(value.real == 6378137.0);
+		tiffDecodeValue(bytes + 18, FT_SRATIONAL, &internal, &value);
+		assert( (value.integer == 5) && (value.denominator == -7) );
+		tiffDecodeValue(bytes + 26, FT_SBYTE, &internal, &value);
+		assert(value.integer == -6);
+		tiffDecodeValue(bytes + 26, FT_BYTE, &internal, &value);
+		assert(value.integer == 250);
+		tiffDecodeValue(bytes + 2, FT_LONG, &internal, &value);
+		assert(value.integer == 0xfffeee90LL);
+	}
+
+	assert(getFieldTypeNumBytes(FT_DOUBLE) == 8);
+	assert(getFieldTypeNumBytes( (fieldType_t)99) == 0);
+	assert(strcmp(getTIFFTypeDesc(FT_SRATIONAL), "SRATIONAL") == 0);
+	assert(strcmp(getTIFFTypeDesc( (fieldType_t)99), "unknown") == 0);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that a text dictionary and its compiled form answer the same **/
+/**   lookups, and that registering one extends the built-in tags.       **/
+/**                                                                      **/
+
+static void testTagDB(void)
+{
+	const char *text = "test_tagdb.txt";
+	const char *compiled = "test_tagdb.tdb";
+	tiffTagDB db[2];
+	FILE *fp;
+	int i;
+
+	fp = fopen(text, "w");
+	assert(fp != NULL);
+	fprintf(fp, "# DNG\n"
+		"50717 WhiteLevel SHORT|LONG\n"
+		"\n"
+		"50778  CalibrationIlluminant1  SHORT  17=Standard light A;"
+		"21=D65\n"
+		"0x8830 SensitivityType - 2=Recommended exposure index\n");
+	fclose(fp);
+
+	assert(tiffTagDBLoad(text, &db[0]) == 0);
+	assert(tiffTagDBSave(&db[0], compiled) == 0);
+	assert(tiffTagDBLoad(compiled, &db[1]) == 0);
+	assert(!db[0].mapped && db[1].mapped);
+
+	for(i = 0; i < 2; i++)
+	{
+		assert(db[i].header->numTags == 3);
+		assert(db[i].header->numValues == 3);
+		assert(tiffTagDBFind(&db[i], 50717)->types ==
+			( (1 << FT_SHORT) | (1 << FT_LONG) ) );
+		assert(tiffTagDBFind(&db[i], 0x8830)->types == 0);
+		assert(tiffTagDBFind(&db[i], 50718) == NULL);
+		assert(tiffTagDBFindName(&db[i], "CalibrationIlluminant1") ==
+			50778);
+		assert(tiffTagDBFindName(&db[i], "WhiteLeve") == -1);
+		assert(strcmp(tiffTagDBFindValue(&db[i], 50778, 21), "D65") == 0);
+		assert(tiffTagDBFindValue(&db[i], 50778, 2) == NULL);
+	}
+
+	assert(strcmp(getTagDescriptor(50717), "unknown") == 0);
+	assert(tiffTagDBRegister(&db[1]) == 0);
+	assert(strcmp(getTagDescriptor(50717), "WhiteLevel") == 0);
+	assert(strcmp(getTagDescriptor(271), "Make") == 0);
+	assert(getTagNumber("SensitivityType") == 0x8830);
+	assert(getTagNumber("Make") == 271);
+	assert(strcmp(getTIFFValueDesc(50778, 17), "Standard light A") == 0);
+	assert(strcmp(getTIFFValueDesc(50778, 18), "") == 0);
+	assert(strcmp(getTIFFValueDesc(259, 1), "No compression") == 0);
+	assert(tiffTagDBTypes(50717) == ( (1 << FT_SHORT) | (1 << FT_LONG) ) );
+	tiffTagDBUnregister();
+	assert(getTagNumber("SensitivityType") == -1);
+	tiffTagDBFree(&db[1]);
+	tiffTagDBFree(&db[0]);
+
+	fp = fopen(text, "w");
+	assert(fp != NULL);
+	fprintf(fp, "50717 WhiteLevel SHORT\n50717 Other LONG\n");
+	fclose(fp);
+	assert(tiffTagDBLoad(text, &db[0]) == 1);
+
+	fp = fopen(text, "w");
+	assert(fp != NULL);
+	fprintf(fp, "50717 WhiteLevel WORD\n");
+	fclose(fp);
+	assert(tiffTagDBLoad(text, &db[0]) == 1);
+
+	fp = fopen(compiled, "r+b");
+	assert(fp != NULL);
+	assert(fseek(fp, 12, SEEK_SET) == 0);
+	fputc(0x7f, fp);
+	fclose(fp);
+	assert(tiffTagDBLoad(compiled, &db[0]) == 1);
+
+	remove(text);
+	remove(compiled);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Big-endian file whose IFD0 holds a pixel scale, a tie point and    **/
+/**   four GeoKeys, one of them in GeoDoubleParamsTag and one in         **/
+/**   GeoAsciiParamsTag                                                  **/
+/**                                                                      **/
+
+static const unsigned char testGeoTIFFFile[] = {
+	0x4d, 0x4d, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x08, 0x00, 0x05, 0x83, 0x0e,
+	0x00, 0x0c, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x4a, 0x84, 0x82,
+	0x00, 0x0c, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x62, 0x87, 0xaf,
+	0x00, 0x03, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x92, 0x87, 0xb0,
+	0x00, 0x0c, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xba, 0x87, 0xb1,
+	0x00, 0x02, 0x00, 0x00, 0x00, 0x17, 0x00, 0x00, 0x00, 0xc2, 0x00, 0x00,
+	0x00, 0x00, 0x40, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x3e,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x41, 0x1a, 0xe6, 0x40, 0x00, 0x00, 0x00, 0x00, 0x41, 0x4c,
+	0x9e, 0xcc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x04, 0x04, 0x00,
+	0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x04, 0x02, 0x87, 0xb1, 0x00, 0x16,
+	0x00, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x01, 0x7f, 0x79, 0x0c, 0x0a,
+	0x87, 0xb0, 0x00, 0x01, 0x00, 0x00, 0x41, 0x1e, 0x84, 0x80, 0x00, 0x00,
+	0x00, 0x00, 0x57, 0x47, 0x53, 0x20, 0x38, 0x34, 0x20, 0x2f, 0x20, 0x55,
+	0x54, 0x4d, 0x20, 0x7a, 0x6f, 0x6e, 0x65, 0x20, 0x33, 0x33, 0x4e, 0x7c,
+	0x00,
+
+};
+
+/**                                                                      **/
+/**   Check that GeoKeys resolve into their param tags, and that the     **/
+/**   CRS and transform are derived from them                            **/
+/**                                                                      **/
+
+static void testGeoTIFF(void)
+{
+	const char *filename = "test_geotiff.tif";
+	internalStruct internal;
+	tiffStringView view;
+	tiffGeoTIFF geo;
+	tiffGeoKey key;
+	unsigned int value;
+	double real;
+	FILE *fp;
+
+	fp = fopen(filename, "wb");
+	assert(fp != NULL);
+	assert(fwrite(testGeoTIFFFile, sizeof(testGeoTIFFFile), 1, fp) == 1);
+	fclose(fp);
+
+	tiffInitInternal(&internal);
+	assert(tiffOpen(filename, &internal) == 0);
+	assert(tiffGeoTIFFRead(filename, &internal, &geo) == 0);
+	assert( (geo.version == 1) && (geo.numKeys == 4) );
+	assert( (geo.model == 1) && (geo.epsg == 32633) );
+	assert(geo.hasTransform);
+	assert( (geo.transform[0] == 30.0) && (geo.transform[1] == 0.0) &&
+		(geo.transform[2] == 440720.0) && (geo.transform[4] == -30.0) &&
+		(geo.transform[5] == 3751320.0) );
+
+	assert(tiffGeoTIFFFindKey(&geo, 3082, &key) == 0);
+	assert(tiffGeoTIFFDouble(&geo, &key, 0, &real) == 0);
+	assert(real == 500000.0);
+	assert(tiffGeoTIFFShort(&geo, &key, 0, &value) == 1);
+	assert(tiffGeoTIFFDouble(&geo, &key, 1, &real) == 1);
+
+	assert(tiffGeoTIFFFindKey(&geo, TIFF_GEO_CITATION, &key) == 0);
+	assert(tiffGeoTIFFAscii(&geo, &key, &view) == 0);
+	assert( (view.length == 21) &&
+		(memcmp(view.ptr, "WGS 84 / UTM zone 33N", 21) == 0) );
+	assert(tiffGeoTIFFFindKey(&geo, 4096, &key) == 1);
+	assert(strcmp(tiffGeoKeyName(3072), "ProjectedCSTypeGeoKey") == 0);
+	tiffGeoTIFFFree(&geo);
+	tiffClose(&internal);
+
+	writeTestFile(filename);
+	tiffInitInternal(&internal);
+	assert(tiffOpen(filename, &internal) == 0);
+	assert(tiffGeoTIFFRead(filename, &internal, &geo) == 1);
+	tiffClose(&internal);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that new files are reported once they settle, only once, and **/
+/**   that a reconciliation scan finds changes that raised no event.     **/
+/**                                                                      **/
+
+static void testWatch(void)
+{
+	tiffWatch watch;
+	char **paths;
+
+	mkdir("test_watch", 0755);
+	writeTestFile("test_watch/old.tif");
+	assert(tiffWatchInit(&watch, "test_watch", 200, 0) == 0);
+	assert(tiffWatchReady(&watch, &paths) == 0);
+
+	/* Pending until the debounce interval passed */
+	writeTestFile("test_watch/new.tif");
+	assert(tiffWatchWait(&watch, 100) == 0);
+	assert( (watch.events > 0) && (watch.numPending == 1) );
+	assert(tiffWatchReady(&watch, &paths) == 0);
+	usleep(250000);
+	assert(tiffWatchReady(&watch, &paths) == 1);
+	assert(strcmp(paths[0], "test_watch/new.tif") == 0);
+	assert(tiffWatchReady(&watch, &paths) == 0);
+
+	/* Files of a new directory are found with it */
+	mkdir("test_watch/sub", 0755);
+	writeTestFile("test_watch/sub/a.tif");
+	assert(tiffWatchWait(&watch, 100) == 0);
+	usleep(250000);
+	assert(tiffWatchReady(&watch, &paths) == 1);
+	assert(strcmp(paths[0], "test_watch/sub/a.tif") == 0);
+
+	/* A touched file raises no event, but is found by the scan */
+	assert(utime("test_watch/old.tif", NULL) == 0);
+	remove("test_watch/new.tif");
+	assert(tiffWatchWait(&watch, 0) == 0);
+	assert(watch.numPending == 0);
+	assert(tiffWatchReconcile(&watch) == 0);
+	assert( (watch.numPending == 1) && (watch.scans == 2) );
+	usleep(250000);
+	assert(tiffWatchReady(&watch, &paths) == 1);
+	assert(strcmp(paths[0], "test_watch/old.tif") == 0);
+
+	tiffWatchFree(&watch);
+	remove("test_watch/sub/a.tif");
+	remove("test_watch/old.tif");
+	rmdir("test_watch/sub");
+	rmdir("test_watch");
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that a journal cut short resumes from its last complete      **/
+/**   block, skipping the files done before and past the cursor and the  **/
+/**   directories before it.                                             **/
+/**                                                                      **/
+
+static void testCheckpoint(void)
+{
+	const char *filename = "test_checkpoint.txt";
+	const char *crashed = "test_crashed.txt";
+	char *paths[] = { "d" };
+	char *other[] = { "e" };
+	char a[] = "d/a.tif";
+	char b[] = "d/b.tif";
+	char c[] = "d/s/c.tif";
+	char buffer[1024];
+	tiffCheckpoint cp;
+	size_t n;
+	FILE *fp;
+
+	assert(tiffCheckpointOpen(&cp, filename, 0, paths, 1) == 0);
+	cp.intervalNs = 0;
+	tiffCheckpointBegin(&cp, 0, a);
+	tiffCheckpointBegin(&cp, 0, b);
+	tiffCheckpointBegin(&cp, 0, c);
+	tiffCheckpointDone(&cp, c);
+	tiffCheckpointDone(&cp, a);
+	assert( (cp.files == 2) && (strcmp(cp.cursor, "d/a.tif") == 0) );
+
+	/* The journal as a crash while writing the next block leaves it */
+	fp = fopen(filename, "r");
+	assert(fp != NULL);
+	n = fread(buffer, 1, sizeof(buffer), fp);
+	fclose(fp);
+	fp = fopen(crashed, "w");
+	assert(fp != NULL);
+	fwrite(buffer, 1, n, fp);
+	fputs("C 0 d/b.tif\nO 1", fp);
+	fclose(fp);
+	assert(tiffCheckpointClose(&cp) == 0);
+	remove(filename);
+
+	assert(tiffCheckpointOpen(&cp, crashed, 1, other, 1) == 1);
+	assert(tiffCheckpointOpen(&cp, crashed, 1, paths, 1) == 0);
+	assert(cp.files == 2);
+	assert(tiffCheckpointSkip(&cp, 0, "d/-", 1) == 1);
+	assert(tiffCheckpointSkip(&cp, 0, "d/a.tif", 0) == 1);
+	assert(tiffCheckpointSkip(&cp, 0, "d/b.tif", 0) == 0);
+	tiffCheckpointBegin(&cp, 0, b);
+	assert(tiffCheckpointSkip(&cp, 0, "d/s", 1) == 0);
+	assert(tiffCheckpointSkip(&cp, 0, "d/s/c.tif", 0) == 1);
+	tiffCheckpointDone(&cp, b);
+	assert( (cp.files == 3) && (strcmp(cp.cursor, "d/s/c.tif") == 0) );
+	assert(tiffCheckpointClose(&cp) == 0);
+
+	/* The torn block was cut off before appending */
+	fp = fopen(crashed, "r");
+	assert(fp != NULL);
+	n = fread(buffer, 1, sizeof(buffer) - 1, fp);
+	fclose(fp);
+	buffer[n] = '\0';
+	assert(strstr(buffer, "d/b.tif") == NULL);
+	assert(strcmp(buffer + n - 3, " 3\n") == 0);
+	remove(crashed);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Little-endian file whose IFD0 only holds a DateTime at offset 26   **/
+/**                                                                      **/
+
+static const unsigned char testDateFile[] = {
+	0x49, 0x49, 0x2a, 0x00, 0x08, 0x00, 0x00, 0x00, 0x01, 0x00, 0x32, 0x01,
+	0x02, 0x00, 0x14, 0x00, 0x00, 0x00, 0x1a, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, '2', '0', '1', '9', ':', '0', '7', ':', '0', '1', ' ', '1',
+	'2', ':', '3', '4', ':', '5', '6', 0x00,
+};
+
+/**                                                                      **/
+/**   Check the parsing of times, and that a catalog of files with       **/
+/**   different DateTimes answers range queries in time order            **/
+/**                                                                      **/
+
+static void testCatalog(void)
+{
+	static const char *dates[] = { "2019:07:01 12:34:56",
+		"2001:02:03 04:05:06", "    :  :     :  :  ", "2019:07:01 00:00:00",
+	};
+	const char *filename = "test_catalog.cat";
+	unsigned char file[sizeof(testDateFile)];
+	char names[4][32];
+	char text[TIFF_CATALOG_MAX_TIME];
+	internalStruct internal;
+	tiffCatalogBuild build;
+	tiffCatalogHeader header;
+	tiffCatalog catalog;
+	long long timeUs;
+	unsigned int first;
+	void *worker;
+	unsigned int i;
+	FILE *fp;
+
+	assert(tiffCatalogParseTime("1970:01:01 00:00:00", &timeUs) == 0);
+	assert(timeUs == 0);
+	assert(tiffCatalogParseTime("2000-03-01T00:00:01", &timeUs) == 0);
+	assert(timeUs == 951868801000000LL);
+	assert(tiffCatalogParseTime("2000:02:29 23:59:59", &timeUs) == 0);
+	assert(tiffCatalogParseTime("1900:02:29 00:00:00", &timeUs) == 1);
+	assert(tiffCatalogParseTime("0000:00:00 00:00:00", &timeUs) == 1);
+	assert(tiffCatalogParseTime("2019:13:01 00:00:00", &timeUs) == 1);
+	assert(tiffCatalogParseTime("2019:07:01 24:00:00", &timeUs) == 1);
+	assert(tiffCatalogParseTime("2019/07/01 00:00:00", &timeUs) == 1);
+	assert(tiffCatalogParseTime("2019:07:01\0\0\0\0\0\0\0\0\0", &timeUs) == 1);
+	tiffCatalogFormatTime(-1, text);
+	assert(strcmp(text, "1969:12:31 23:59:59.999999") == 0);
+	assert(tiffCatalogTag("DateTime") == 1);
+	assert(tiffCatalogTag("Make") == -1);
+
+	tiffCatalogInit(&build);
+	worker = tiffCatalogWorker(&build);
+	for(i = 0;i < 4;i++)
+	{
+		snprintf(names[i], sizeof(names[i]), "test_catalog%u.tif", i);
+		memcpy(file, testDateFile, sizeof(file) );
+		memcpy(file + 26, dates[i], 19);
+		fp = fopen(names[i], "wb");
+		assert(fp != NULL);
+		assert(fwrite(file, sizeof(file), 1, fp) == 1);
+		fclose(fp);
+		tiffInitInternal(&internal);
+		assert(tiffCatalogFile(worker, names[i], &internal) == 0);
+		remove(names[i]);
+	}
+	assert(tiffCatalogSave(&build, filename, &header) == 0);
+	assert( (header.numFiles == 3) && (header.numEntries == 3) );
+	tiffCatalogBuildFree(&build);
+
+	assert(tiffCatalogLoad(filename, &catalog) == 0);
+	assert(tiffCatalogRange(&catalog, 0, 0, LLONG_MAX, &first) == 0);
+	tiffCatalogParseTime("2019:07:01 00:00:00", &timeUs);
+	assert(tiffCatalogRange(&catalog, 1, 0, timeUs, &first) == 1);
+	assert(strcmp(tiffCatalogPath(&catalog, &catalog.entries[first]),
+		"test_catalog1.tif") == 0);
+	assert(tiffCatalogRange(&catalog, 1, timeUs, LLONG_MAX, &first) == 2);
+	assert(strcmp(tiffCatalogPath(&catalog, &catalog.entries[first]),
+		"test_catalog3.tif") == 0);
+	assert(strcmp(tiffCatalogPath(&catalog, &catalog.entries[first + 1]),
+		"test_catalog0.tif") == 0);
+	tiffCatalogFree(&catalog);
+
+	fp = fopen(filename, "r+b");
+	assert(fp != NULL);
+	fputc('X', fp);
+	fclose(fp);
+	assert(tiffCatalogLoad(filename, &catalog) == 1);
+	remove(filename);
+
+	return;
+}
+
+/**                                                                      **/
+/**   Check that a bitmap index of files holding DateTime, an overflow   **/
+/**   tag or neither answers queries of tags, and leaves out files that  **/
+/**   can't be read                                                      **/
+/**                                                                      **/
+
+static void testBitmap(void)
+{
+	const char *filename = "test_bitmap.bm";
+	unsigned char file[sizeof(testDateFile)];
+	char names[4][32];
+	internalStruct internal;
+	tiffBitmapBuild build;
+	tiffBitmapHeader header;
+	tiffBitmapIndex index;
+	tiffQuery query;
+	unsigned long long *bits;
+	void *worker;
+	unsigned int i;
+	FILE *fp;
+
+	assert(tiffBitmapInit(&build) == 0);
+	worker = tiffBitmapWorker(&build);
+	for(i = 0;i < 4;i++)
+	{
+		snprintf(names[i], sizeof(names[i]), "test_bitmap%u.tif", i);
+		memcpy(file, testDateFile, sizeof(file) );
+		if(i == 1)
+		{
+			file[10] = 0x99;
+			file[11] = 0x99;
+		}
+		if(i == 2)
+		{
+			file[0] = 'X';
+		}
+		fp = fopen(names[i], "wb");
+		assert(fp != NULL);
+		assert(fwrite(file, sizeof(file), 1, fp) == 1);
+		fclose(fp);
+		tiffInitInternal(&internal);
+		assert(tiffBitmapFile(&build, worker, names[i], &internal) ==
+			(i == 2) );
+		remove(names[i]);
+	}
+	assert(tiffBitmapSave(&build, filename, &header) == 0);
+	assert( (header.numFiles == 3) && (header.numColumns == 2) );
+	assert(header.words == TIFF_BITMAP_ALIGN / 8);
+	tiffBitmapBuildFree(&build);
+
+	assert(tiffBitmapLoad(filename, &index) == 0);
+	assert(tiffBitmapColumn(&index, 0x9999) != NULL);
+	assert(tiffBitmapColumn(&index, 0x010f) == NULL);
+	assert(strcmp(tiffBitmapPath(&index, 2), "test_bitmap3.tif") == 0);
+	assert(tiffBitmapPath(&index, 3) == NULL);
+
+	assert(tiffQueryCompile("DateTime", &query) == 0);
+	bits = tiffBitmapEval(&index, &query);
+	assert( (bits != NULL) && (bits[0] == 5) );
+	assert(tiffBitmapCount(&index, bits) == 2);
+	free(bits);
+
+	assert(tiffQueryCompile("!DateTime && !Make", &query) == 0);
+	bits = tiffBitmapEval(&index, &query);
+	assert( (bits != NULL) && (bits[0] == 2) );
+	assert(tiffBitmapCount(&index, bits) == 1);
+	free(bits);
+
+	assert(tiffQueryCompile("39321 || DateTime", &query) == 0);
+	bits = tiffBitmapEval(&index, &query);
+	assert( (bits != NULL) && (bits[0] == 7) && (bits[1] == 0) );
+	free(bits);
+
+	assert(tiffQueryCompile("Make == \"x\"", &query) == 0);
+	assert(tiffBitmapEval(&index, &query) == NULL);
+	tiffBitmapFree(&index);
+
+	fp = fopen(filename, "r+b");
+	assert(fp != NULL);
+	fputc('X', fp);
+	fclose(fp);
+	assert(tiffBitmapLoad(filename, &index) == 1);
+	remove(filename);
+
+	return;
+}
 
 int main(int argc, char *argv[])
 {
@@ -89,6 +1827,33 @@ int main(int argc, char *argv[])
 	f3 = cSwapFloat(f2, &test);
 	assert(f3 == f1);
 
+	testLayout();
+	testStats();
+	testFingerprint();
+	testDiff();
+	testStrings();
+	testMakerNote();
+	testQuery();
+	testServe();
+	testEdit();
+	testStrip();
+	testValidate();
+	testThumbnail();
+	testIO();
+	testIOPolicy();
+	testIOUncached();
+	testAggregate();
+	testDecode();
+	testValues();
+	testIFDLoop();
+	testArraySummary();
+	testTagDB();
+	testGeoTIFF();
+	testWatch();
+	testCheckpoint();
+	testCatalog();
+	testBitmap();
+
 	printf("Test completed with no errors.\n");
 
 	return 0;
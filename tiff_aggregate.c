@@ -0,0 +1,997 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Aggregate statistics over tag values across many files.            **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "tiff_metadata.h"
+#include "tiff_query.h"
+#include "tiff_aggregate.h"
+
+
+/* value of tags a file doesn't hold, and of values of unknown type */
+#define AGGREGATE_NONE "(none)"
+#define AGGREGATE_UNKNOWN "(unknown)"
+
+/* smallest table of a shard */
+#define AGGREGATE_MIN_SLOTS 64
+
+
+/**                                                                      **/
+/**  Interned string, NULL text for a free slot                          **/
+/**                                                                      **/
+
+typedef struct aggregateString
+{
+	const char *text;
+	unsigned int hash;
+} aggregateString;
+
+
+/**                                                                      **/
+/**  Combination of values counted, 0 count for a free slot              **/
+/**                                                                      **/
+/**  count                                                               **/
+/**      number of files holding the combination                         **/
+/**  hash                                                                **/
+/**      hash of the combination, which picks its shard                  **/
+/**  values                                                              **/
+/**      interned values, one per key, NULL past the last key            **/
+/**                                                                      **/
+
+typedef struct aggregateRow
+{
+	unsigned long long count;
+	unsigned int hash;
+	const char *values[TIFF_AGGREGATE_MAX_KEYS];
+} aggregateRow;
+
+
+/**                                                                      **/
+/**  Shard of a map: open addressing tables of interned strings and of   **/
+/**  rows, whose sizes are powers of two                                 **/
+/**                                                                      **/
+
+typedef struct aggregateShard
+{
+	unsigned int numStrings;
+	unsigned int maxStrings;
+	aggregateString *strings;
+	unsigned int numRows;
+	unsigned int maxRows;
+	aggregateRow *rows;
+} aggregateShard;
+
+
+/**                                                                      **/
+/**  Map of one worker, or of the whole run                              **/
+/**                                                                      **/
+
+typedef struct aggregateMap
+{
+	struct aggregateMap *next;
+	aggregateShard shards[TIFF_AGGREGATE_SHARDS];
+} aggregateMap;
+
+
+/**                                                                      **/
+/**  State of one file being aggregated                                  **/
+/**                                                                      **/
+/**  aggregate                                                           **/
+/**      aggregate                                                       **/
+/**  numFound, found                                                     **/
+/**      number of keys whose value is known, and which ones             **/
+/**  values                                                              **/
+/**      value of each key found                                         **/
+/**                                                                      **/
+
+typedef struct aggregateCtx
+{
+	const tiffAggregate *aggregate;
+	unsigned int numFound;
+	int found[TIFF_AGGREGATE_MAX_KEYS];
+	char values[TIFF_AGGREGATE_MAX_KEYS][TIFF_AGGREGATE_MAX_STRING];
+} aggregateCtx;
+
+
+/**                                                                      **/
+/**  Reduction thread: merges shards first, first + step, ...            **/
+/**                                                                      **/
+
+typedef struct aggregateReducer
+{
+	tiffAggregate *aggregate;
+	unsigned int first;
+	unsigned int step;
+	int status;
+} aggregateReducer;
+
+
+/**                                                                      **/
+/**   Function: aggregateError                                           **/
+/**                                                                      **/
+/**   Print an error in a specification. Returns 1.                      **/
+/**                                                                      **/
+
+static int aggregateError(const char *spec, const char *message)
+{
+	fprintf(stderr, "bad aggregate \"%s\": %s\n", spec, message);
+
+	return 1;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffAggregateCompile                                     **/
+/**                                                                      **/
+/**   Parse a comma separated list of tags, each a name or a number      **/
+/**   optionally followed by "/" and a bucket width, and initialize an   **/
+/**   aggregate over them. Returns 0 on success, 1 on failure.           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   spec       -- specification                                        **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   aggregate  -- aggregate, to be freed with tiffAggregateFree        **/
+/**                                                                      **/
+
+int tiffAggregateCompile(const char *spec, tiffAggregate *aggregate)
+{
+	tiffAggregateKey *key;
+	const char *p = spec;
+	char name[64];
+	unsigned long number;
+	size_t n;
+	char *end;
+	int tag;
+
+	memset(aggregate, 0, sizeof(*aggregate) );
+
+	for(;;)
+	{
+		if(aggregate->numKeys == TIFF_AGGREGATE_MAX_KEYS)
+		{
+			return aggregateError(spec, "too many tags");
+		}
+		key = &aggregate->keys[aggregate->numKeys];
+
+		n = strcspn(p, ",/");
+		if( (n == 0) || (n >= sizeof(name) ) )
+		{
+			return aggregateError(spec, "tag expected");
+		}
+		memcpy(name, p, n);
+		name[n] = '\0';
+		p += n;
+
+		if(isdigit( (unsigned char)name[0]) )
+		{
+			number = strtoul(name, &end, 0);
+			if( (*end != '\0') || (number > 0xffff) )
+			{
+				return aggregateError(spec, "bad tag number");
+			}
+			tag = (int)number;
+		}
+		else
+		{
+			tag = getTagNumber(name);
+			if(tag < 0)
+			{
+				return aggregateError(spec, "unknown tag");
+			}
+		}
+		key->tag = (unsigned short)tag;
+
+		if(*p == '/')
+		{
+			key->bucket = strtod(p + 1, &end);
+			if( (end == p + 1) || !(key->bucket > 0) )
+			{
+				return aggregateError(spec, "bucket width expected");
+			}
+			p = end;
+		}
+		aggregate->numKeys++;
+
+		if(*p == '\0')
+		{
+			break;
+		}
+		if(*p != ',')
+		{
+			return aggregateError(spec, "\",\" expected");
+		}
+		p++;
+	}
+
+	pthread_mutex_init(&aggregate->lock, NULL);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: hashString                                               **/
+/**                                                                      **/
+/**   Return the FNV-1a hash of a string.                                **/
+/**                                                                      **/
+
+static unsigned int hashString(const char *text)
+{
+	unsigned int hash = 2166136261u;
+
+	while(*text != '\0')
+	{
+		hash = (hash ^ (unsigned char)*text++) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+/**                                                                      **/
+/**   Function: growStrings                                              **/
+/**                                                                      **/
+/**   Double the string table of a shard. Returns 0 on success, 1 on     **/
+/**   failure.                                                           **/
+/**                                                                      **/
+
+static int growStrings(aggregateShard *shard)
+{
+	aggregateString *strings;
+	unsigned int maxStrings;
+	unsigned int i;
+	unsigned int j;
+
+	maxStrings = (shard->maxStrings == 0) ? AGGREGATE_MIN_SLOTS :
+		shard->maxStrings * 2;
+	strings = (aggregateString *)calloc(maxStrings, sizeof(*strings) );
+	if(strings == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0;i < shard->maxStrings;i++)
+	{
+		if(shard->strings[i].text == NULL)
+		{
+			continue;
+		}
+		j = shard->strings[i].hash & (maxStrings - 1);
+		while(strings[j].text != NULL)
+		{
+			j = (j + 1) & (maxStrings - 1);
+		}
+		strings[j] = shard->strings[i];
+	}
+
+	free(shard->strings);
+	shard->strings = strings;
+	shard->maxStrings = maxStrings;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: internString                                             **/
+/**                                                                      **/
+/**   Return the copy of a string held by a shard, adding it if needed.  **/
+/**   Returns NULL on failure.                                           **/
+/**                                                                      **/
+
+static const char *internString(aggregateShard *shard, const char *text,
+	unsigned int hash)
+{
+	aggregateString *string;
+	unsigned int i;
+
+	if( ( (shard->numStrings + 1) * 4 > shard->maxStrings * 3) &&
+		(growStrings(shard) != 0) )
+	{
+		return NULL;
+	}
+
+	i = hash & (shard->maxStrings - 1);
+	while(shard->strings[i].text != NULL)
+	{
+		string = &shard->strings[i];
+		if( (string->hash == hash) && (strcmp(string->text, text) == 0) )
+		{
+			return string->text;
+		}
+		i = (i + 1) & (shard->maxStrings - 1);
+	}
+
+	string = &shard->strings[i];
+	string->text = strdup(text);
+	if(string->text == NULL)
+	{
+		return NULL;
+	}
+	string->hash = hash;
+	shard->numStrings++;
+
+	return string->text;
+}
+
+
+/**                                                                      **/
+/**   Function: growRows                                                 **/
+/**                                                                      **/
+/**   Double the row table of a shard. Returns 0 on success, 1 on        **/
+/**   failure.                                                           **/
+/**                                                                      **/
+
+static int growRows(aggregateShard *shard)
+{
+	aggregateRow *rows;
+	unsigned int maxRows;
+	unsigned int i;
+	unsigned int j;
+
+	maxRows = (shard->maxRows == 0) ? AGGREGATE_MIN_SLOTS :
+		shard->maxRows * 2;
+	rows = (aggregateRow *)calloc(maxRows, sizeof(*rows) );
+	if(rows == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0;i < shard->maxRows;i++)
+	{
+		if(shard->rows[i].count == 0)
+		{
+			continue;
+		}
+		j = (shard->rows[i].hash / TIFF_AGGREGATE_SHARDS) & (maxRows - 1);
+		while(rows[j].count != 0)
+		{
+			j = (j + 1) & (maxRows - 1);
+		}
+		rows[j] = shard->rows[i];
+	}
+
+	free(shard->rows);
+	shard->rows = rows;
+	shard->maxRows = maxRows;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: shardAdd                                                 **/
+/**                                                                      **/
+/**   Add count files to a combination of values in a shard. Returns 0   **/
+/**   on success, 1 on failure.                                          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   shard    -- shard the combination hashes to                        **/
+/**   numKeys  -- number of values                                       **/
+/**   values   -- values, not necessarily interned in shard              **/
+/**   hashes   -- hash of each value                                     **/
+/**   hash     -- hash of the combination                                **/
+/**   count    -- number of files                                        **/
+/**                                                                      **/
+
+static int shardAdd(aggregateShard *shard, unsigned int numKeys,
+	const char *const *values, const unsigned int *hashes,
+	unsigned int hash, unsigned long long count)
+{
+	const char *interned[TIFF_AGGREGATE_MAX_KEYS];
+	aggregateRow *row;
+	unsigned int i;
+
+	memset(interned, 0, sizeof(interned) );
+	for(i = 0;i < numKeys;i++)
+	{
+		interned[i] = internString(shard, values[i], hashes[i]);
+		if(interned[i] == NULL)
+		{
+			return 1;
+		}
+	}
+
+	if( ( (shard->numRows + 1) * 4 > shard->maxRows * 3) &&
+		(growRows(shard) != 0) )
+	{
+		return 1;
+	}
+
+	/* Interned values of a shard compare by address */
+	i = (hash / TIFF_AGGREGATE_SHARDS) & (shard->maxRows - 1);
+	while(shard->rows[i].count != 0)
+	{
+		row = &shard->rows[i];
+		if( (row->hash == hash) &&
+			(memcmp(row->values, interned, sizeof(interned) ) == 0) )
+		{
+			row->count += count;
+
+			return 0;
+		}
+		i = (i + 1) & (shard->maxRows - 1);
+	}
+
+	row = &shard->rows[i];
+	row->count = count;
+	row->hash = hash;
+	memcpy(row->values, interned, sizeof(interned) );
+	shard->numRows++;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: mapAdd                                                   **/
+/**                                                                      **/
+/**   Add count files to a combination of values in a map. Returns 0 on  **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+
+static int mapAdd(aggregateMap *map, unsigned int numKeys,
+	const char *const *values, unsigned long long count)
+{
+	unsigned int hashes[TIFF_AGGREGATE_MAX_KEYS];
+	unsigned int hash = 2166136261u;
+	unsigned int i;
+
+	for(i = 0;i < numKeys;i++)
+	{
+		hashes[i] = hashString(values[i]);
+		hash = (hash ^ hashes[i]) * 16777619u;
+	}
+
+	return shardAdd(&map->shards[hash % TIFF_AGGREGATE_SHARDS], numKeys,
+		values, hashes, hash, count);
+}
+
+
+/**                                                                      **/
+/**   Function: mapFree                                                  **/
+/**                                                                      **/
+/**   Free a map and the strings it holds.                               **/
+/**                                                                      **/
+
+static void mapFree(aggregateMap *map)
+{
+	aggregateShard *shard;
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0;i < TIFF_AGGREGATE_SHARDS;i++)
+	{
+		shard = &map->shards[i];
+		for(j = 0;j < shard->maxStrings;j++)
+		{
+			free( (char *)shard->strings[j].text);
+		}
+		free(shard->strings);
+		free(shard->rows);
+	}
+	free(map);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffAggregateWorker                                      **/
+/**                                                                      **/
+/**   Create the map of a batch worker; see tiffBatchWorkerFunc. The     **/
+/**   aggregate owns it. Returns NULL on failure.                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   aggregate  -- aggregate                                            **/
+/**                                                                      **/
+
+void *tiffAggregateWorker(tiffAggregate *aggregate)
+{
+	aggregateMap *map;
+
+	map = (aggregateMap *)calloc(1, sizeof(*map) );
+	if(map == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&aggregate->lock);
+	map->next = aggregate->maps;
+	aggregate->maps = map;
+	pthread_mutex_unlock(&aggregate->lock);
+
+	return map;
+}
+
+
+/**                                                                      **/
+/**   Function: formatValue                                              **/
+/**                                                                      **/
+/**   Format the first value of an entry as aggregated over a key.       **/
+/**                                                                      **/
+
+static void formatValue(const tiffAggregateKey *key,
+	const tiffQueryValue *value, char *text)
+{
+	long long n;
+	double q;
+	size_t length;
+	size_t i;
+
+	if(!value->hasValue)
+	{
+		strcpy(text, AGGREGATE_UNKNOWN);
+	}
+	else if(value->isString)
+	{
+		/* Values are printed tab separated, one combination a line */
+		length = strlen(value->string);
+		for(i = 0;i < length;i++)
+		{
+			text[i] = ( (unsigned char)value->string[i] < 32) ? ' ' :
+				value->string[i];
+		}
+		while( (length > 0) && (text[length - 1] == ' ') )
+		{
+			length--;
+		}
+		text[length] = '\0';
+	}
+	else if(key->bucket > 0)
+	{
+		q = value->number / key->bucket;
+		n = (long long)q;
+		if( (double)n > q)
+		{
+			n--;
+		}
+		snprintf(text, TIFF_AGGREGATE_MAX_STRING, "%.15g-%.15g",
+			n * key->bucket, (n + 1) * key->bucket);
+	}
+	else
+	{
+		snprintf(text, TIFF_AGGREGATE_MAX_STRING, "%.15g", value->number);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  IFD walker callback taking the values of the keys of the entry's    **/
+/**  tag, which stops the walk once every key is known                   **/
+/**                                                                      **/
+
+static tiffWalk_t aggregateEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	aggregateCtx *aggregate = (aggregateCtx *)ctx;
+	const tiffAggregateKey *key;
+	tiffQueryValue value;
+	int fetched = 0;
+	unsigned int i;
+
+	for(i = 0;i < aggregate->aggregate->numKeys;i++)
+	{
+		key = &aggregate->aggregate->keys[i];
+		if( (key->tag != entry->tag) || aggregate->found[i])
+		{
+			continue;
+		}
+
+		if(!fetched)
+		{
+			if(tiffQueryFetch(internal, entry, &value) != 0)
+			{
+				return TIFF_WALK_ERROR;
+			}
+			fetched = 1;
+		}
+		formatValue(key, &value, aggregate->values[i]);
+		aggregate->found[i] = 1;
+		aggregate->numFound++;
+	}
+
+	return (aggregate->numFound == aggregate->aggregate->numKeys) ?
+		TIFF_WALK_STOP : TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor aggregateVisitor = {
+	NULL,
+	aggregateEntry,
+	NULL,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffAggregateFile                                        **/
+/**                                                                      **/
+/**   Count a file in the map of a worker, reading no more of it than    **/
+/**   needed. Returns 0 on success, 1 on failure.                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   aggregate  -- aggregate                                            **/
+/**   worker     -- map returned by tiffAggregateWorker                  **/
+/**   filename   -- file name                                            **/
+/**   internal   -- struct initialized with tiffInitInternal             **/
+/**                                                                      **/
+
+int tiffAggregateFile(tiffAggregate *aggregate, void *worker,
+	const char *filename, internalStruct *internal)
+{
+	const char *values[TIFF_AGGREGATE_MAX_KEYS];
+	aggregateCtx ctx;
+	tiffWalk_t status;
+	unsigned int i;
+
+	if(worker == NULL)
+	{
+		fprintf(stderr, "can't allocate aggregate for %s\n", filename);
+
+		return 1;
+	}
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	memset(&ctx, 0, sizeof(ctx) );
+	ctx.aggregate = aggregate;
+	status = tiffWalkFile(filename, internal, &aggregateVisitor, &ctx);
+
+	tiffClose(internal);
+
+	if(status == TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+
+	for(i = 0;i < aggregate->numKeys;i++)
+	{
+		values[i] = ctx.found[i] ? ctx.values[i] : AGGREGATE_NONE;
+	}
+
+	if(mapAdd( (aggregateMap *)worker, aggregate->numKeys, values, 1) != 0)
+	{
+		fprintf(stderr, "can't allocate aggregate for %s\n", filename);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: reduceShards                                             **/
+/**                                                                      **/
+/**   Reduction thread main function: merge the shards of a reducer      **/
+/**   from every worker map into the total.                              **/
+/**                                                                      **/
+
+static void *reduceShards(void *arg)
+{
+	aggregateReducer *reducer = (aggregateReducer *)arg;
+	tiffAggregate *aggregate = reducer->aggregate;
+	unsigned int hashes[TIFF_AGGREGATE_MAX_KEYS];
+	const aggregateShard *shard;
+	const aggregateRow *row;
+	const aggregateMap *map;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	for(i = reducer->first;i < TIFF_AGGREGATE_SHARDS;i += reducer->step)
+	{
+		for(map = aggregate->maps;map != NULL;map = map->next)
+		{
+			shard = &map->shards[i];
+			for(j = 0;j < shard->maxRows;j++)
+			{
+				row = &shard->rows[j];
+				if(row->count == 0)
+				{
+					continue;
+				}
+				for(k = 0;k < aggregate->numKeys;k++)
+				{
+					hashes[k] = hashString(row->values[k]);
+				}
+				if(shardAdd(&aggregate->total->shards[i],
+					aggregate->numKeys, row->values, hashes, row->hash,
+					row->count) != 0)
+				{
+					reducer->status = 1;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffAggregateReduce                                      **/
+/**                                                                      **/
+/**   Merge the worker maps into the total of the run, with up to        **/
+/**   numThreads threads each merging different shards. Returns 0 on     **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   aggregate   -- aggregate                                           **/
+/**   numThreads  -- most threads to use                                 **/
+/**                                                                      **/
+
+int tiffAggregateReduce(tiffAggregate *aggregate, int numThreads)
+{
+	aggregateReducer reducers[TIFF_AGGREGATE_SHARDS];
+	pthread_t threads[TIFF_AGGREGATE_SHARDS];
+	int started[TIFF_AGGREGATE_SHARDS];
+	aggregateMap *map;
+	int status = 0;
+	int i;
+
+	/* A single worker map is the total already */
+	if( (aggregate->maps != NULL) && (aggregate->maps->next == NULL) )
+	{
+		aggregate->total = aggregate->maps;
+		aggregate->maps = NULL;
+
+		return 0;
+	}
+
+	aggregate->total = (aggregateMap *)calloc(1, sizeof(aggregateMap) );
+	if(aggregate->total == NULL)
+	{
+		fprintf(stderr, "can't allocate aggregate\n");
+
+		return 1;
+	}
+
+	if(numThreads > TIFF_AGGREGATE_SHARDS)
+	{
+		numThreads = TIFF_AGGREGATE_SHARDS;
+	}
+	if(numThreads < 1)
+	{
+		numThreads = 1;
+	}
+
+	for(i = 0;i < numThreads;i++)
+	{
+		reducers[i].aggregate = aggregate;
+		reducers[i].first = (unsigned int)i;
+		reducers[i].step = (unsigned int)numThreads;
+		reducers[i].status = 0;
+		started[i] = (i > 0) && (pthread_create(&threads[i], NULL,
+			reduceShards, &reducers[i]) == 0);
+	}
+
+	/* Shards of threads that couldn't start are merged here */
+	for(i = 0;i < numThreads;i++)
+	{
+		if(!started[i])
+		{
+			reduceShards(&reducers[i]);
+		}
+	}
+	for(i = 0;i < numThreads;i++)
+	{
+		if(started[i])
+		{
+			pthread_join(threads[i], NULL);
+		}
+		status |= reducers[i].status;
+	}
+
+	while(aggregate->maps != NULL)
+	{
+		map = aggregate->maps;
+		aggregate->maps = map->next;
+		mapFree(map);
+	}
+
+	if(status != 0)
+	{
+		fprintf(stderr, "can't allocate aggregate\n");
+	}
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: compareRows                                              **/
+/**                                                                      **/
+/**   qsort comparison function sorting rows by decreasing count, then   **/
+/**   by values.                                                         **/
+/**                                                                      **/
+
+static int compareRows(const void *a, const void *b)
+{
+	const aggregateRow *rowA = *(const aggregateRow *const *)a;
+	const aggregateRow *rowB = *(const aggregateRow *const *)b;
+	unsigned int i;
+	int c;
+
+	if(rowA->count != rowB->count)
+	{
+		return (rowA->count > rowB->count) ? -1 : 1;
+	}
+
+	for(i = 0;i < TIFF_AGGREGATE_MAX_KEYS;i++)
+	{
+		if(rowA->values[i] == NULL)
+		{
+			break;
+		}
+		c = strcmp(rowA->values[i], rowB->values[i]);
+		if(c != 0)
+		{
+			return c;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffAggregatePrint                                       **/
+/**                                                                      **/
+/**   Print the top combinations of a reduced aggregate, the number of   **/
+/**   files of the others, and the total. Returns 0 on success, 1 on     **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   out        -- output stream                                        **/
+/**   aggregate  -- aggregate reduced with tiffAggregateReduce           **/
+/**   top        -- most combinations printed                            **/
+/**                                                                      **/
+
+int tiffAggregatePrint(FILE *out, const tiffAggregate *aggregate,
+	unsigned int top)
+{
+	const aggregateMap *total = aggregate->total;
+	const aggregateRow **rows;
+	const aggregateShard *shard;
+	const tiffAggregateKey *key;
+	unsigned long long numRows = 0;
+	unsigned long long files = 0;
+	unsigned long long other = 0;
+	unsigned long long n = 0;
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0;(total != NULL) && (i < TIFF_AGGREGATE_SHARDS);i++)
+	{
+		numRows += total->shards[i].numRows;
+	}
+
+	rows = (const aggregateRow **)malloc( (numRows + 1) * sizeof(*rows) );
+	if(rows == NULL)
+	{
+		fprintf(stderr, "can't allocate aggregate\n");
+
+		return 1;
+	}
+
+	for(i = 0;(total != NULL) && (i < TIFF_AGGREGATE_SHARDS);i++)
+	{
+		shard = &total->shards[i];
+		for(j = 0;j < shard->maxRows;j++)
+		{
+			if(shard->rows[j].count != 0)
+			{
+				rows[n++] = &shard->rows[j];
+				files += shard->rows[j].count;
+			}
+		}
+	}
+	qsort(rows, n, sizeof(*rows), compareRows);
+
+	fprintf(out, "files");
+	for(i = 0;i < aggregate->numKeys;i++)
+	{
+		key = &aggregate->keys[i];
+		if(strcmp(getTagDescriptor(key->tag), "unknown") == 0)
+		{
+			fprintf(out, "\t%u", key->tag);
+		}
+		else
+		{
+			fprintf(out, "\t%s", getTagDescriptor(key->tag) );
+		}
+		if(key->bucket > 0)
+		{
+			fprintf(out, "/%.15g", key->bucket);
+		}
+	}
+	fprintf(out, "\n");
+
+	for(n = 0;n < numRows;n++)
+	{
+		if(n >= top)
+		{
+			other += rows[n]->count;
+			continue;
+		}
+		fprintf(out, "%llu", rows[n]->count);
+		for(i = 0;i < aggregate->numKeys;i++)
+		{
+			fprintf(out, "\t%s", rows[n]->values[i]);
+		}
+		fprintf(out, "\n");
+	}
+	if(numRows > top)
+	{
+		fprintf(out, "%llu\t(other %llu combinations)\n", other,
+			numRows - top);
+	}
+	fprintf(out, "%llu\t(total)\n", files);
+
+	free(rows);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffAggregateFree                                        **/
+/**                                                                      **/
+/**   Free the maps of an aggregate.                                     **/
+/**                                                                      **/
+
+void tiffAggregateFree(tiffAggregate *aggregate)
+{
+	aggregateMap *map;
+
+	while(aggregate->maps != NULL)
+	{
+		map = aggregate->maps;
+		aggregate->maps = map->next;
+		mapFree(map);
+	}
+	if(aggregate->total != NULL)
+	{
+		mapFree(aggregate->total);
+		aggregate->total = NULL;
+	}
+	pthread_mutex_destroy(&aggregate->lock);
+
+	return;
+}
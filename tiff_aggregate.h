@@ -0,0 +1,130 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Aggregate statistics over tag values across many files.            **/
+/**                                                                      **/
+/**   A specification such as                                            **/
+/**                                                                      **/
+/**       Make,Model,Compression,ImageWidth/1000                         **/
+/**                                                                      **/
+/**   counts the files holding every combination of the values of its    **/
+/**   tags, numbers being put in buckets when a width follows "/". Each  **/
+/**   tag is decided by the first entry holding it (main IFD chain       **/
+/**   first, then Exif), and the walk stops once all are known.          **/
+/**                                                                      **/
+/**   Every batch worker counts into its own hash map, so that workers   **/
+/**   never wait for each other. Value strings are interned: a map holds **/
+/**   each distinct string once per shard, and combinations refer to     **/
+/**   them, so that memory grows with the number of distinct values and  **/
+/**   not with the number of files. Maps are split into                  **/
+/**   TIFF_AGGREGATE_SHARDS shards by the hash of the combination; once  **/
+/**   the run is over, shards are reduced in parallel, each thread       **/
+/**   merging the same shards of every worker map.                       **/
+/**                                                                      **/
+/**   Results print as tab separated lines, the most frequent first:     **/
+/**                                                                      **/
+/**       files  Make  Model                                             **/
+/**       1234   Canon  Canon EOS 5D                                     **/
+/**       ...                                                            **/
+/**       56     (other 210 combinations)                                **/
+/**       5678   (total)                                                 **/
+/**                                                                      **/
+/**   Absent tags have the value "(none)".                               **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_AGGREGATE_H
+#define _TIFF_AGGREGATE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Most tags of a specification, shards of a map, longest value kept   **/
+/**  and combinations printed by default                                 **/
+/**                                                                      **/
+
+#define TIFF_AGGREGATE_MAX_KEYS 8
+#define TIFF_AGGREGATE_SHARDS 16
+#define TIFF_AGGREGATE_MAX_STRING 128
+#define TIFF_AGGREGATE_TOP 20
+
+
+/**                                                                      **/
+/**  Tag aggregated over                                                 **/
+/**                                                                      **/
+/**  tag                                                                 **/
+/**      tag number                                                      **/
+/**  bucket                                                              **/
+/**      width of the buckets numbers are put in, 0 to keep them         **/
+/**                                                                      **/
+
+typedef struct tiffAggregateKey
+{
+	unsigned short tag;
+	double bucket;
+} tiffAggregateKey;
+
+
+/**                                                                      **/
+/**  Aggregate of a run                                                  **/
+/**                                                                      **/
+/**  numKeys, keys                                                       **/
+/**      tags aggregated over                                            **/
+/**  lock                                                                **/
+/**      protects maps while workers start                               **/
+/**  maps                                                                **/
+/**      list of worker maps, reduced into total                         **/
+/**  total                                                               **/
+/**      map of the whole run once reduced, or NULL                      **/
+/**                                                                      **/
+
+typedef struct tiffAggregate
+{
+	unsigned int numKeys;
+	tiffAggregateKey keys[TIFF_AGGREGATE_MAX_KEYS];
+	pthread_mutex_t lock;
+	struct aggregateMap *maps;
+	struct aggregateMap *total;
+} tiffAggregate;
+
+
+/**                                                                      **/
+/**  Aggregate API function declarations                                 **/
+/**                                                                      **/
+
+int tiffAggregateCompile(const char *spec, tiffAggregate *aggregate);
+void *tiffAggregateWorker(tiffAggregate *aggregate);
+int tiffAggregateFile(tiffAggregate *aggregate, void *worker,
+	const char *filename, internalStruct *internal);
+int tiffAggregateReduce(tiffAggregate *aggregate, int numThreads);
+int tiffAggregatePrint(FILE *out, const tiffAggregate *aggregate,
+	unsigned int top);
+void tiffAggregateFree(tiffAggregate *aggregate);
+
+#endif
@@ -0,0 +1,513 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Batch processing of many files.                                    **/
+/**                                                                      **/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_checkpoint.h"
+#include "tiff_batch.h"
+
+
+/**                                                                      **/
+/**  Bounded queue of paths shared by the producer and the workers       **/
+/**                                                                      **/
+/**  paths                                                               **/
+/**      ring buffer of TIFF_BATCH_QUEUE_SIZE heap allocated paths       **/
+/**  head, count                                                         **/
+/**      index of the oldest path and number of queued paths             **/
+/**  done                                                                **/
+/**      set by the producer once all paths have been queued             **/
+/**  lock, notEmpty, notFull                                             **/
+/**      protect and signal changes of the fields above                  **/
+/**  outputLock                                                          **/
+/**      serializes writes to stdout and the merging of stats            **/
+/**                                                                      **/
+
+typedef struct batchQueue
+{
+	char *paths[TIFF_BATCH_QUEUE_SIZE];
+	int head;
+	int count;
+	int done;
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+	pthread_mutex_t outputLock;
+} batchQueue;
+
+
+/**                                                                      **/
+/**  State shared by the functions of one batch run; root is the index   **/
+/**  of the path being expanded, and expandStatus the status of the      **/
+/**  expansion of the paths, only touched by the producer and merged     **/
+/**  into status once the workers are joined                             **/
+/**                                                                      **/
+
+typedef struct batchRun
+{
+	tiffBatch *batch;
+	batchQueue queue;
+	int threaded;
+	void *worker;
+	int status;
+	int expandStatus;
+	int root;
+} batchRun;
+
+
+/**                                                                      **/
+/**   Function: tiffBatchInit                                            **/
+/**                                                                      **/
+/**   Initialize batch parameters for a single threaded run without      **/
+/**   stats.                                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   batch  -- batch parameters                                         **/
+/**   func   -- per-file function                                        **/
+/**   arg    -- argument passed to func                                  **/
+/**                                                                      **/
+
+void tiffBatchInit(tiffBatch *batch, tiffBatchFunc func, void *arg)
+{
+	memset(batch, 0, sizeof(*batch));
+	batch->numThreads = 1;
+	batch->func = func;
+	batch->arg = arg;
+	tiffStatsInit(&batch->stats);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: batchFile                                                **/
+/**                                                                      **/
+/**   Run the per-file function on one file and account for its result.  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   batch  -- batch parameters                                         **/
+/**   path   -- file name                                                **/
+/**   out    -- output stream                                            **/
+/**   stats  -- worker counters                                          **/
+/**   worker -- worker state                                             **/
+/**                                                                      **/
+
+static int batchFile(tiffBatch *batch, const char *path, FILE *out,
+	tiffStats *stats, void *worker)
+{
+	internalStruct internal;
+	int status;
+
+	tiffInitInternal(&internal);
+	internal.out = out;
+	internal.stats = batch->collectStats ? stats : NULL;
+	internal.worker = worker;
+
+	status = batch->func(path, &internal, batch->arg);
+
+	TIFF_STAT_ADD(&internal, files, 1);
+	if(status != 0)
+	{
+		TIFF_STAT_ADD(&internal, errors, 1);
+	}
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: batchPush                                                **/
+/**                                                                      **/
+/**   Hand one path to the workers, or process it right away when the    **/
+/**   run is single threaded. Takes ownership of path.                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   run   -- batch run                                                 **/
+/**   path  -- heap allocated file name                                  **/
+/**                                                                      **/
+
+static void batchPush(batchRun *run, char *path)
+{
+	batchQueue *queue = &run->queue;
+	tiffCheckpoint *checkpoint = run->batch->checkpoint;
+	int status;
+
+	if(checkpoint != NULL)
+	{
+		tiffCheckpointBegin(checkpoint, run->root, path);
+	}
+
+	if(!run->threaded)
+	{
+		status = batchFile(run->batch, path, stdout, &run->batch->stats,
+			run->worker);
+		if(status > run->status)
+		{
+			run->status = status;
+		}
+		if(checkpoint != NULL)
+		{
+			tiffCheckpointDone(checkpoint, path);
+		}
+		free(path);
+
+		return;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	while(queue->count == TIFF_BATCH_QUEUE_SIZE)
+	{
+		pthread_cond_wait(&queue->notFull, &queue->lock);
+	}
+	queue->paths[(queue->head + queue->count) % TIFF_BATCH_QUEUE_SIZE] =
+		path;
+	queue->count++;
+	pthread_cond_signal(&queue->notEmpty);
+	pthread_mutex_unlock(&queue->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: batchPop                                                 **/
+/**                                                                      **/
+/**   Take the next path off the queue, waiting for the producer if      **/
+/**   needed. Returns NULL once the queue is drained and closed.         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   queue  -- batch queue                                              **/
+/**                                                                      **/
+
+static char *batchPop(batchQueue *queue)
+{
+	char *path = NULL;
+
+	pthread_mutex_lock(&queue->lock);
+	while(queue->count == 0 && !queue->done)
+	{
+		pthread_cond_wait(&queue->notEmpty, &queue->lock);
+	}
+	if(queue->count != 0)
+	{
+		path = queue->paths[queue->head];
+		queue->head = (queue->head + 1) % TIFF_BATCH_QUEUE_SIZE;
+		queue->count--;
+		pthread_cond_signal(&queue->notFull);
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return path;
+}
+
+
+/**                                                                      **/
+/**   Function: batchWorker                                              **/
+/**                                                                      **/
+/**   Worker thread main function.                                       **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   arg  -- batch run                                                  **/
+/**                                                                      **/
+
+static void *batchWorker(void *arg)
+{
+	batchRun *run = (batchRun *)arg;
+	tiffStats stats;
+	void *worker = NULL;
+	char *path;
+	char *buffer;
+	size_t size;
+	FILE *out;
+	int status;
+	int worst = 0;
+
+	tiffStatsInit(&stats);
+	if(run->batch->workerInit != NULL)
+	{
+		worker = run->batch->workerInit(run->batch->arg);
+	}
+
+	while( (path = batchPop(&run->queue)) != NULL)
+	{
+		buffer = NULL;
+		size = 0;
+		out = open_memstream(&buffer, &size);
+		if(out == NULL)
+		{
+			fprintf(stderr, "can't allocate output for %s\n", path);
+			status = 1;
+		}
+		else
+		{
+			status = batchFile(run->batch, path, out, &stats, worker);
+			fclose(out);
+		}
+
+		/* Checkpoints are taken between the outputs of two files */
+		pthread_mutex_lock(&run->queue.outputLock);
+		if(out != NULL)
+		{
+			fwrite(buffer, 1, size, stdout);
+		}
+		if(run->batch->checkpoint != NULL)
+		{
+			tiffCheckpointDone(run->batch->checkpoint, path);
+		}
+		pthread_mutex_unlock(&run->queue.outputLock);
+		free(buffer);
+		if(status > worst)
+		{
+			worst = status;
+		}
+		free(path);
+	}
+
+	pthread_mutex_lock(&run->queue.outputLock);
+	tiffStatsMerge(&run->batch->stats, &stats);
+	if(worst > run->status)
+	{
+		run->status = worst;
+	}
+	pthread_mutex_unlock(&run->queue.outputLock);
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: compareNames                                             **/
+/**                                                                      **/
+/**   scandir comparison function sorting entries by byte value so that  **/
+/**   the order does not depend on the locale.                           **/
+/**                                                                      **/
+
+static int compareNames(const struct dirent **a, const struct dirent **b)
+{
+	return strcmp( (*a)->d_name, (*b)->d_name);
+}
+
+
+/**                                                                      **/
+/**   Function: batchExpand                                              **/
+/**                                                                      **/
+/**   Queue a file, or every file below a directory, skipping what the   **/
+/**   checkpoint says is done. Symbolic links to directories are only    **/
+/**   followed when named explicitly, so that link cycles cannot make    **/
+/**   the walk loop forever.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   run       -- batch run                                             **/
+/**   path      -- file or directory name                                **/
+/**   explicit  -- 1 if path was named by the user                       **/
+/**                                                                      **/
+
+static void batchExpand(batchRun *run, const char *path, int explicit)
+{
+	struct dirent **names;
+	struct stat st;
+	char *child;
+	char *copy;
+	size_t length;
+	int n;
+	int i;
+
+	if( (explicit ? stat(path, &st) : lstat(path, &st) ) != 0)
+	{
+		fprintf(stderr, "can't open %s\n", path);
+		run->expandStatus = 1;
+
+		return;
+	}
+
+	if( (run->batch->checkpoint != NULL) &&
+		tiffCheckpointSkip(run->batch->checkpoint, run->root, path,
+		S_ISDIR(st.st_mode) ) )
+	{
+		return;
+	}
+
+	if(!S_ISDIR(st.st_mode) )
+	{
+		if(explicit || S_ISREG(st.st_mode) ||
+			(S_ISLNK(st.st_mode) && stat(path, &st) == 0 &&
+			S_ISREG(st.st_mode) ) )
+		{
+			copy = strdup(path);
+			if(copy == NULL)
+			{
+				fprintf(stderr, "can't allocate name of %s\n", path);
+				run->expandStatus = 1;
+
+				return;
+			}
+			batchPush(run, copy);
+		}
+
+		return;
+	}
+
+	n = scandir(path, &names, NULL, compareNames);
+	if(n < 0)
+	{
+		fprintf(stderr, "can't read directory %s\n", path);
+		run->expandStatus = 1;
+
+		return;
+	}
+
+	for(i = 0;i < n;i++)
+	{
+		if(strcmp(names[i]->d_name, ".") != 0 &&
+			strcmp(names[i]->d_name, "..") != 0)
+		{
+			length = strlen(path) + strlen(names[i]->d_name) + 2;
+			child = (char *)malloc(length);
+			if(child != NULL)
+			{
+				snprintf(child, length, "%s/%s", path,
+					names[i]->d_name);
+				batchExpand(run, child, 0);
+				free(child);
+			}
+			else
+			{
+				fprintf(stderr, "can't allocate name of %s/%s\n", path,
+					names[i]->d_name);
+				run->expandStatus = 1;
+			}
+		}
+		free(names[i]);
+	}
+	free(names);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBatchRun                                             **/
+/**                                                                      **/
+/**   Run the per-file function on every file named by paths. Returns    **/
+/**   the highest status of all files, which is also left in             **/
+/**   batch->status.                                                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   batch     -- batch parameters set up with tiffBatchInit            **/
+/**   paths     -- file and directory names                              **/
+/**   numPaths  -- number of names                                       **/
+/**                                                                      **/
+
+int tiffBatchRun(tiffBatch *batch, char *const paths[], int numPaths)
+{
+	batchRun run;
+	pthread_t *threads = NULL;
+	unsigned long long start;
+	int numThreads = 0;
+	int i;
+
+	memset(&run, 0, sizeof(run));
+	run.batch = batch;
+	start = tiffStatsClock();
+
+	if(batch->numThreads > 1)
+	{
+		threads = (pthread_t *)malloc(batch->numThreads * sizeof(*threads));
+	}
+	if(threads != NULL)
+	{
+		pthread_mutex_init(&run.queue.lock, NULL);
+		pthread_cond_init(&run.queue.notEmpty, NULL);
+		pthread_cond_init(&run.queue.notFull, NULL);
+		pthread_mutex_init(&run.queue.outputLock, NULL);
+		run.threaded = 1;
+
+		for(i = 0;i < batch->numThreads;i++)
+		{
+			if(pthread_create(&threads[numThreads], NULL, batchWorker,
+				&run) == 0)
+			{
+				numThreads++;
+			}
+		}
+		if(numThreads == 0)
+		{
+			run.threaded = 0;
+		}
+	}
+	if(!run.threaded && (batch->workerInit != NULL) )
+	{
+		run.worker = batch->workerInit(batch->arg);
+	}
+
+	for(i = 0;i < numPaths;i++)
+	{
+		run.root = i;
+		batchExpand(&run, paths[i], 1);
+	}
+
+	if(run.threaded)
+	{
+		pthread_mutex_lock(&run.queue.lock);
+		run.queue.done = 1;
+		pthread_cond_broadcast(&run.queue.notEmpty);
+		pthread_mutex_unlock(&run.queue.lock);
+
+		for(i = 0;i < numThreads;i++)
+		{
+			pthread_join(threads[i], NULL);
+		}
+	}
+
+	if(threads != NULL)
+	{
+		pthread_mutex_destroy(&run.queue.lock);
+		pthread_cond_destroy(&run.queue.notEmpty);
+		pthread_cond_destroy(&run.queue.notFull);
+		pthread_mutex_destroy(&run.queue.outputLock);
+		free(threads);
+	}
+
+	if(run.expandStatus > run.status)
+	{
+		run.status = run.expandStatus;
+	}
+	batch->wallNs = tiffStatsClock() - start;
+	batch->status = run.status;
+
+	return run.status;
+}
@@ -0,0 +1,120 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Batch processing of many files.                                    **/
+/**                                                                      **/
+/**   Paths given on the command line are expanded (directories are      **/
+/**   walked recursively in name order) and handed to a per-file         **/
+/**   function. With more than one thread, a producer thread feeds a     **/
+/**   bounded queue drained by worker threads; each worker formats into  **/
+/**   a private memory stream which is copied to stdout in one piece     **/
+/**   once the file is done, so the output of different files is never   **/
+/**   interleaved. Each worker keeps its own tiffStats, and may keep     **/
+/**   state of the caller's, such as partial results to be reduced once  **/
+/**   the run is over.                                                   **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_BATCH_H
+#define _TIFF_BATCH_H
+
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_checkpoint.h"
+
+
+/**                                                                      **/
+/**  Maximum number of paths waiting in the batch queue                  **/
+/**                                                                      **/
+
+#define TIFF_BATCH_QUEUE_SIZE 1024
+
+
+/**                                                                      **/
+/**  Per-file function run by the batch driver. internal is initialized  **/
+/**  with tiffInitInternal, its out and stats fields already point to    **/
+/**  the worker's output stream and counters. Returns 0 on success.      **/
+/**                                                                      **/
+
+typedef int (*tiffBatchFunc)(const char *filename, internalStruct *internal,
+	void *arg);
+
+
+/**                                                                      **/
+/**  Per-worker function called by each worker, or once for a single     **/
+/**  threaded run, before its first file. What it returns is left in     **/
+/**  the worker field of internal for every file of the worker; the      **/
+/**  caller owns it.                                                     **/
+/**                                                                      **/
+
+typedef void *(*tiffBatchWorkerFunc)(void *arg);
+
+
+/**                                                                      **/
+/**  Batch parameters and results                                        **/
+/**                                                                      **/
+/**  numThreads                                                          **/
+/**      number of worker threads, 1 to run everything in the caller     **/
+/**  func, arg                                                           **/
+/**      per-file function and its argument                              **/
+/**  workerInit                                                          **/
+/**      per-worker function, or NULL                                    **/
+/**  collectStats                                                        **/
+/**      1 to maintain stats, 0 to leave the counters disabled           **/
+/**  checkpoint                                                          **/
+/**      journal skipping the files done by an interrupted run and       **/
+/**      recording progress (see tiff_checkpoint.h), or NULL             **/
+/**  stats                                                               **/
+/**      counters summed over all workers                                **/
+/**  status                                                              **/
+/**      highest status returned by func, or 1 if a path could not be    **/
+/**      expanded                                                        **/
+/**  wallNs                                                              **/
+/**      elapsed wall clock time in nanoseconds                          **/
+/**                                                                      **/
+
+typedef struct tiffBatch
+{
+	int numThreads;
+	tiffBatchFunc func;
+	void *arg;
+	tiffBatchWorkerFunc workerInit;
+	int collectStats;
+	tiffCheckpoint *checkpoint;
+	tiffStats stats;
+	int status;
+	unsigned long long wallNs;
+} tiffBatch;
+
+
+/**                                                                      **/
+/**  Batch API function declarations                                     **/
+/**                                                                      **/
+
+void tiffBatchInit(tiffBatch *batch, tiffBatchFunc func, void *arg);
+int tiffBatchRun(tiffBatch *batch, char *const paths[], int numPaths);
+
+#endif
@@ -0,0 +1,1279 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Tag presence bitmaps of many files.                                **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "tiff_metadata.h"
+#include "tiff_query.h"
+#include "tiff_batch.h"
+#include "tiff_bitmap.h"
+
+
+/* value of the byteOrder field as written by this machine */
+#define BITMAP_BYTE_ORDER 0x01020304
+
+/* number of tag numbers */
+#define BITMAP_TAGS 65536
+
+/* words of each column evaluated at once, 16384 files */
+#define BITMAP_CHUNK_WORDS 256
+
+#define BITMAP_MIN_FILES 256
+
+/* unit of the bitwise operations: several words at once where the */
+/* compiler provides vector types, or else one */
+#ifdef __GNUC__
+typedef unsigned long long bitmapLane
+	__attribute__((vector_size(32), may_alias) );
+#else
+typedef unsigned long long bitmapLane;
+#endif
+
+#define BITMAP_LANE_WORDS (sizeof(bitmapLane) / sizeof(unsigned long long) )
+
+
+/**                                                                      **/
+/**  Tag outside the fixed universe held by a file                       **/
+/**                                                                      **/
+
+typedef struct bitmapExtra
+{
+	unsigned int file;
+	unsigned int tag;
+} bitmapExtra;
+
+
+/**                                                                      **/
+/**  Rows and names collected by a worker                                **/
+/**                                                                      **/
+/**  next                                                                **/
+/**      next worker of the build                                        **/
+/**  rows, numFiles, maxFiles                                            **/
+/**      row of rowWords words of each file                              **/
+/**  files                                                               **/
+/**      offset in names of the name of each file                        **/
+/**  extras, numExtras, maxExtras                                        **/
+/**      overflow tags of the files                                      **/
+/**  names, nameBytes, maxNameBytes                                      **/
+/**      file names, each followed by a NUL                              **/
+/**                                                                      **/
+
+typedef struct bitmapWorker
+{
+	struct bitmapWorker *next;
+	unsigned long long *rows;
+	unsigned int numFiles;
+	unsigned int maxFiles;
+	unsigned long long *files;
+	bitmapExtra *extras;
+	unsigned int numExtras;
+	unsigned int maxExtras;
+	char *names;
+	unsigned long long nameBytes;
+	unsigned long long maxNameBytes;
+} bitmapWorker;
+
+
+/**                                                                      **/
+/**  Walk state of a file: the build, the worker, the row of the file    **/
+/**  and whether an overflow tag could not be recorded                   **/
+/**                                                                      **/
+
+typedef struct bitmapCtx
+{
+	const tiffBitmapBuild *build;
+	bitmapWorker *worker;
+	unsigned long long *row;
+	int failed;
+} bitmapCtx;
+
+
+/**                                                                      **/
+/**   Function: lowestBit                                                **/
+/**                                                                      **/
+/**   Return the index of the lowest bit set in a nonzero word.          **/
+/**                                                                      **/
+
+static unsigned int lowestBit(unsigned long long bits)
+{
+#ifdef __GNUC__
+	return (unsigned int)__builtin_ctzll(bits);
+#else
+	unsigned int i = 0;
+
+	while( (bits & 1) == 0)
+	{
+		bits >>= 1;
+		i++;
+	}
+
+	return i;
+#endif
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapInit                                           **/
+/**                                                                      **/
+/**   Initialize an empty build, numbering the bits of the rows after    **/
+/**   the built-in tags. Returns 0 on success, 1 if out of memory.       **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   build   -- index build                                             **/
+/**                                                                      **/
+
+int tiffBitmapInit(tiffBitmapBuild *build)
+{
+	unsigned int i;
+	int tag;
+
+	memset(build, 0, sizeof(*build) );
+
+	build->fixedBits = (unsigned short *)calloc(BITMAP_TAGS,
+		sizeof(*build->fixedBits) );
+	for(i = 0;getBuiltinTag(i) >= 0;i++)
+	{
+		continue;
+	}
+	build->fixedTags = (unsigned short *)calloc(i + 1,
+		sizeof(*build->fixedTags) );
+	if( (build->fixedBits == NULL) || (build->fixedTags == NULL) )
+	{
+		fprintf(stderr, "out of memory\n");
+		free(build->fixedBits);
+		free(build->fixedTags);
+
+		return 1;
+	}
+
+	for(i = 0;(tag = getBuiltinTag(i) ) >= 0;i++)
+	{
+		if(build->fixedBits[tag] == 0)
+		{
+			build->fixedTags[build->numFixed] = (unsigned short)tag;
+			build->fixedBits[tag] = (unsigned short)++build->numFixed;
+		}
+	}
+	build->rowWords = (build->numFixed + 63) / 64;
+	pthread_mutex_init(&build->lock, NULL);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapWorker                                         **/
+/**                                                                      **/
+/**   Add the state of a worker to a build, for tiffBatch workerInit     **/
+/**   functions. Returns NULL if out of memory, tiffBitmapFile then      **/
+/**   failing for every file of the worker.                              **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build   -- index build                                             **/
+/**                                                                      **/
+
+void *tiffBitmapWorker(tiffBitmapBuild *build)
+{
+	bitmapWorker *worker;
+
+	worker = (bitmapWorker *)calloc(1, sizeof(*worker) );
+	if(worker == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&build->lock);
+	worker->next = build->workers;
+	build->workers = worker;
+	pthread_mutex_unlock(&build->lock);
+
+	return worker;
+}
+
+
+/**                                                                      **/
+/**  IFD walker callback setting the bit of the entry's tag in the row   **/
+/**  of the file, or recording it as an overflow tag                     **/
+/**                                                                      **/
+
+static tiffWalk_t bitmapEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	bitmapCtx *bitmap = (bitmapCtx *)ctx;
+	bitmapWorker *worker = bitmap->worker;
+	unsigned int bit = bitmap->build->fixedBits[entry->tag];
+	unsigned int maxExtras;
+	bitmapExtra *extras;
+	unsigned int i;
+
+	(void)internal;
+
+	if(bit != 0)
+	{
+		bitmap->row[(bit - 1) / 64] |= 1ULL << ( (bit - 1) % 64);
+
+		return TIFF_WALK_CONTINUE;
+	}
+
+	/* the overflow tags of the file are the last ones recorded */
+	for(i = worker->numExtras;(i > 0) &&
+		(worker->extras[i - 1].file == worker->numFiles);i--)
+	{
+		if(worker->extras[i - 1].tag == entry->tag)
+		{
+			return TIFF_WALK_CONTINUE;
+		}
+	}
+
+	if(worker->numExtras == worker->maxExtras)
+	{
+		maxExtras = (worker->maxExtras == 0) ? BITMAP_MIN_FILES :
+			worker->maxExtras * 2;
+		extras = (bitmapExtra *)realloc(worker->extras,
+			maxExtras * sizeof(*extras) );
+		if(extras == NULL)
+		{
+			bitmap->failed = 1;
+
+			return TIFF_WALK_STOP;
+		}
+		worker->extras = extras;
+		worker->maxExtras = maxExtras;
+	}
+	worker->extras[worker->numExtras].file = worker->numFiles;
+	worker->extras[worker->numExtras].tag = entry->tag;
+	worker->numExtras++;
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor bitmapVisitor = {
+	NULL,
+	bitmapEntry,
+	NULL,
+};
+
+
+/**                                                                      **/
+/**   Function: workerGrow                                               **/
+/**                                                                      **/
+/**   Make room in the state of a worker for one more file and its       **/
+/**   name. Returns 0 on success, 1 if out of memory.                    **/
+/**                                                                      **/
+
+static int workerGrow(const tiffBitmapBuild *build, bitmapWorker *worker,
+	unsigned long long length)
+{
+	unsigned long long maxNameBytes;
+	unsigned int maxFiles;
+	void *grown;
+
+	if(worker->numFiles == worker->maxFiles)
+	{
+		maxFiles = (worker->maxFiles == 0) ? BITMAP_MIN_FILES :
+			worker->maxFiles * 2;
+		grown = realloc(worker->rows, (size_t)maxFiles * build->rowWords *
+			sizeof(*worker->rows) );
+		if(grown == NULL)
+		{
+			return 1;
+		}
+		worker->rows = (unsigned long long *)grown;
+		grown = realloc(worker->files, maxFiles * sizeof(*worker->files) );
+		if(grown == NULL)
+		{
+			return 1;
+		}
+		worker->files = (unsigned long long *)grown;
+		worker->maxFiles = maxFiles;
+	}
+
+	if(worker->nameBytes + length > worker->maxNameBytes)
+	{
+		maxNameBytes = (worker->maxNameBytes == 0) ?
+			BITMAP_MIN_FILES * 64 : worker->maxNameBytes * 2;
+		while(worker->nameBytes + length > maxNameBytes)
+		{
+			maxNameBytes *= 2;
+		}
+		grown = realloc(worker->names, (size_t)maxNameBytes);
+		if(grown == NULL)
+		{
+			return 1;
+		}
+		worker->names = (char *)grown;
+		worker->maxNameBytes = maxNameBytes;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapFile                                           **/
+/**                                                                      **/
+/**   Record the tags a file holds in the state of a worker. Returns 0   **/
+/**   on success, 1 on failure, the file then being left out.            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build     -- index build                                           **/
+/**   worker    -- state returned by tiffBitmapWorker                    **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+int tiffBitmapFile(const tiffBitmapBuild *build, void *worker,
+	const char *filename, internalStruct *internal)
+{
+	bitmapWorker *state = (bitmapWorker *)worker;
+	unsigned long long length = strlen(filename) + 1;
+	unsigned int numExtras;
+	bitmapCtx ctx;
+	tiffWalk_t status;
+
+	if( (state == NULL) || (workerGrow(build, state, length) != 0) )
+	{
+		fprintf(stderr, "can't allocate bitmap for %s\n", filename);
+
+		return 1;
+	}
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	ctx.build = build;
+	ctx.worker = state;
+	ctx.row = state->rows + (size_t)state->numFiles * build->rowWords;
+	ctx.failed = 0;
+	memset(ctx.row, 0, build->rowWords * sizeof(*ctx.row) );
+	numExtras = state->numExtras;
+	status = tiffWalkFile(filename, internal, &bitmapVisitor, &ctx);
+
+	tiffClose(internal);
+
+	if( (status == TIFF_WALK_ERROR) || ctx.failed)
+	{
+		if(ctx.failed)
+		{
+			fprintf(stderr, "can't allocate bitmap for %s\n", filename);
+		}
+		state->numExtras = numExtras;
+
+		return 1;
+	}
+
+	memcpy(state->names + state->nameBytes, filename, (size_t)length);
+	state->files[state->numFiles] = state->nameBytes;
+	state->nameBytes += length;
+	state->numFiles++;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: compareTags                                              **/
+/**                                                                      **/
+/**   qsort comparison of tag numbers.                                   **/
+/**                                                                      **/
+
+static int compareTags(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a;
+	unsigned int y = *(const unsigned int *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/**                                                                      **/
+/**   Function: writeIndex                                               **/
+/**                                                                      **/
+/**   Write the parts of an index. Returns 0 on success, 1 on failure.   **/
+/**                                                                      **/
+
+static int writeIndex(const tiffBitmapBuild *build, const char *filename,
+	const tiffBitmapHeader *header, const unsigned int *tags,
+	const unsigned long long *columns, const unsigned long long *files)
+{
+	static const unsigned char zeros[TIFF_BITMAP_ALIGN];
+	const bitmapWorker *worker;
+	size_t tagBytes = header->numColumns * sizeof(*tags);
+	size_t pad = (TIFF_BITMAP_ALIGN - tagBytes % TIFF_BITMAP_ALIGN) %
+		TIFF_BITMAP_ALIGN;
+	FILE *file;
+	int bad;
+
+	file = fopen(filename, "wb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	bad = (fwrite(header, sizeof(*header), 1, file) != 1) ||
+		(fwrite(zeros, TIFF_BITMAP_ALIGN - sizeof(*header), 1, file) != 1) ||
+		(fwrite(tags, 1, tagBytes, file) != tagBytes) ||
+		(fwrite(zeros, 1, pad, file) != pad) ||
+		(fwrite(columns, sizeof(*columns),
+		(size_t)header->numColumns * header->words, file) !=
+		(size_t)header->numColumns * header->words) ||
+		(fwrite(files, sizeof(*files), header->numFiles, file) !=
+		header->numFiles);
+	for(worker = build->workers;(worker != NULL) && !bad;
+		worker = worker->next)
+	{
+		bad = (fwrite(worker->names, 1, (size_t)worker->nameBytes, file) !=
+			worker->nameBytes);
+	}
+
+	if( (fclose(file) != 0) || bad)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapSave                                           **/
+/**                                                                      **/
+/**   Turn the rows and overflow tags collected by the workers of a      **/
+/**   build into columns, and write the index. Returns 0 on success, 1   **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build     -- index build, whose workers are done                   **/
+/**   filename  -- file name written                                     **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   header    -- header of the index written                           **/
+/**                                                                      **/
+
+int tiffBitmapSave(const tiffBitmapBuild *build, const char *filename,
+	tiffBitmapHeader *header)
+{
+	const bitmapWorker *worker;
+	unsigned long long *present = NULL;
+	unsigned long long *columns = NULL;
+	unsigned long long *files = NULL;
+	unsigned int *columnOf = NULL;
+	unsigned int *tags = NULL;
+	unsigned long long numFiles = 0;
+	unsigned long long nameBase = 0;
+	unsigned long long bits;
+	const unsigned long long *row;
+	unsigned int fileBase = 0;
+	unsigned int maxColumns;
+	unsigned int file;
+	unsigned int column;
+	unsigned int i;
+	unsigned int w;
+	int result = 1;
+
+	memset(header, 0, sizeof(*header) );
+	memcpy(header->magic, TIFF_BITMAP_MAGIC, sizeof(header->magic) );
+	header->byteOrder = BITMAP_BYTE_ORDER;
+
+	maxColumns = build->numFixed;
+	for(worker = build->workers;worker != NULL;worker = worker->next)
+	{
+		numFiles += worker->numFiles;
+		header->stringBytes += worker->nameBytes;
+		maxColumns += worker->numExtras;
+	}
+	if(numFiles > UINT_MAX - TIFF_BITMAP_ALIGN * 8)
+	{
+		fprintf(stderr, "%s: too many files to index\n", filename);
+
+		return 1;
+	}
+	header->numFiles = (unsigned int)numFiles;
+	header->words = (header->numFiles + TIFF_BITMAP_ALIGN * 8 - 1) /
+		(TIFF_BITMAP_ALIGN * 8) * (TIFF_BITMAP_ALIGN / 8);
+
+	present = (unsigned long long *)calloc(build->rowWords + 1,
+		sizeof(*present) );
+	tags = (unsigned int *)calloc(maxColumns + 1, sizeof(*tags) );
+	columnOf = (unsigned int *)calloc(BITMAP_TAGS, sizeof(*columnOf) );
+	files = (unsigned long long *)calloc(numFiles + 1, sizeof(*files) );
+	if( (present == NULL) || (tags == NULL) || (columnOf == NULL) ||
+		(files == NULL) )
+	{
+		fprintf(stderr, "%s: out of memory\n", filename);
+		free(present);
+		free(tags);
+		free(columnOf);
+		free(files);
+
+		return 1;
+	}
+
+	/* columns of the built-in tags some file holds, and of the overflow */
+	/* tags, in tag order */
+	for(worker = build->workers;worker != NULL;worker = worker->next)
+	{
+		for(file = 0;file < worker->numFiles;file++)
+		{
+			for(w = 0;w < build->rowWords;w++)
+			{
+				present[w] |= worker->rows[(size_t)file * build->rowWords +
+					w];
+			}
+		}
+		for(i = 0;i < worker->numExtras;i++)
+		{
+			if(columnOf[worker->extras[i].tag] == 0)
+			{
+				columnOf[worker->extras[i].tag] = 1;
+				tags[header->numColumns++] = worker->extras[i].tag;
+			}
+		}
+	}
+	for(w = 0;w < build->rowWords;w++)
+	{
+		for(bits = present[w];bits != 0;bits &= bits - 1)
+		{
+			tags[header->numColumns++] =
+				build->fixedTags[w * 64 + lowestBit(bits)];
+		}
+	}
+	qsort(tags, header->numColumns, sizeof(*tags), compareTags);
+	for(i = 0;i < header->numColumns;i++)
+	{
+		columnOf[tags[i]] = i;
+	}
+
+	columns = (unsigned long long *)calloc(
+		(size_t)header->numColumns * header->words + 1, sizeof(*columns) );
+	if(columns == NULL)
+	{
+		fprintf(stderr, "%s: out of memory\n", filename);
+	}
+
+	for(worker = build->workers;(worker != NULL) && (columns != NULL);
+		worker = worker->next)
+	{
+		for(file = 0;file < worker->numFiles;file++)
+		{
+			row = worker->rows + (size_t)file * build->rowWords;
+			for(w = 0;w < build->rowWords;w++)
+			{
+				for(bits = row[w];bits != 0;bits &= bits - 1)
+				{
+					column = columnOf[build->fixedTags[w * 64 +
+						lowestBit(bits)]];
+					columns[(size_t)column * header->words +
+						(fileBase + file) / 64] |=
+						1ULL << ( (fileBase + file) % 64);
+				}
+			}
+			files[fileBase + file] = nameBase + worker->files[file];
+		}
+		for(i = 0;i < worker->numExtras;i++)
+		{
+			column = columnOf[worker->extras[i].tag];
+			file = fileBase + worker->extras[i].file;
+			columns[(size_t)column * header->words + file / 64] |=
+				1ULL << (file % 64);
+		}
+		fileBase += worker->numFiles;
+		nameBase += worker->nameBytes;
+	}
+
+	if(columns != NULL)
+	{
+		result = writeIndex(build, filename, header, tags, columns, files);
+	}
+
+	free(present);
+	free(tags);
+	free(columnOf);
+	free(files);
+	free(columns);
+
+	return result;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapBuildFree                                      **/
+/**                                                                      **/
+/**   Release a build and the state of its workers.                      **/
+/**                                                                      **/
+
+void tiffBitmapBuildFree(tiffBitmapBuild *build)
+{
+	bitmapWorker *worker;
+
+	while(build->workers != NULL)
+	{
+		worker = build->workers;
+		build->workers = worker->next;
+		free(worker->rows);
+		free(worker->files);
+		free(worker->extras);
+		free(worker->names);
+		free(worker);
+	}
+	free(build->fixedTags);
+	free(build->fixedBits);
+	pthread_mutex_destroy(&build->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapLoad                                           **/
+/**                                                                      **/
+/**   Map an index read-only and check its header. Returns 0 on          **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- index file name                                       **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   index     -- index, freed with tiffBitmapFree                      **/
+/**                                                                      **/
+
+int tiffBitmapLoad(const char *filename, tiffBitmapIndex *index)
+{
+	const tiffBitmapHeader *header;
+	unsigned long long tagBytes;
+	unsigned long long size;
+	struct stat st;
+	void *map;
+	int fd;
+	int bad;
+	unsigned int i;
+
+	memset(index, 0, sizeof(*index) );
+
+	fd = open(filename, O_RDONLY);
+	if( (fd < 0) || (fstat(fd, &st) != 0) )
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+		if(fd >= 0)
+		{
+			close(fd);
+		}
+
+		return 1;
+	}
+	if( (unsigned long long)st.st_size < TIFF_BITMAP_ALIGN)
+	{
+		fprintf(stderr, "%s: not a bitmap index\n", filename);
+		close(fd);
+
+		return 1;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+	index->base = (unsigned char *)map;
+	index->size = (size_t)st.st_size;
+	header = (const tiffBitmapHeader *)index->base;
+
+	if(memcmp(header->magic, TIFF_BITMAP_MAGIC, sizeof(header->magic) ) !=
+		0)
+	{
+		fprintf(stderr, "%s: not a bitmap index\n", filename);
+		tiffBitmapFree(index);
+
+		return 1;
+	}
+	if(header->byteOrder != BITMAP_BYTE_ORDER)
+	{
+		fprintf(stderr, "%s: written with another byte order\n", filename);
+		tiffBitmapFree(index);
+
+		return 1;
+	}
+
+	tagBytes = ( (unsigned long long)header->numColumns * sizeof(unsigned int) +
+		TIFF_BITMAP_ALIGN - 1) / TIFF_BITMAP_ALIGN * TIFF_BITMAP_ALIGN;
+	size = TIFF_BITMAP_ALIGN + tagBytes +
+		(unsigned long long)header->numColumns * header->words *
+		sizeof(unsigned long long) +
+		(unsigned long long)header->numFiles * sizeof(unsigned long long);
+	bad = (header->numColumns > BITMAP_TAGS) ||
+		(header->words % (TIFF_BITMAP_ALIGN / 8) != 0) ||
+		( (unsigned long long)header->words * 64 < header->numFiles) ||
+		(header->stringBytes > index->size) ||
+		(size + header->stringBytes != index->size) ||
+		( (header->numFiles > 0) && (header->stringBytes == 0) ) ||
+		( (header->stringBytes > 0) &&
+		(index->base[index->size - 1] != '\0') );
+	if(!bad)
+	{
+		index->tags = (const unsigned int *)(index->base +
+			TIFF_BITMAP_ALIGN);
+		for(i = 0;i < header->numColumns;i++)
+		{
+			bad |= (index->tags[i] >= BITMAP_TAGS) ||
+				( (i > 0) && (index->tags[i] <= index->tags[i - 1]) );
+		}
+	}
+	if(bad)
+	{
+		fprintf(stderr, "%s: bad bitmap index header\n", filename);
+		tiffBitmapFree(index);
+
+		return 1;
+	}
+
+	index->header = header;
+	index->columns = (const unsigned long long *)(index->base +
+		TIFF_BITMAP_ALIGN + tagBytes);
+	index->files = index->columns +
+		(size_t)header->numColumns * header->words;
+	index->strings = (const char *)(index->files + header->numFiles);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapFree                                           **/
+/**                                                                      **/
+/**   Unmap an index loaded with tiffBitmapLoad.                         **/
+/**                                                                      **/
+
+void tiffBitmapFree(tiffBitmapIndex *index)
+{
+	if(index->base != NULL)
+	{
+		munmap(index->base, index->size);
+	}
+	memset(index, 0, sizeof(*index) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapColumn                                         **/
+/**                                                                      **/
+/**   Return the column of a tag, or NULL if no file holds it.           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   index  -- index                                                    **/
+/**   tag    -- tag number                                               **/
+/**                                                                      **/
+
+const unsigned long long *tiffBitmapColumn(const tiffBitmapIndex *index,
+	unsigned short tag)
+{
+	unsigned int begin = 0;
+	unsigned int end = index->header->numColumns;
+	unsigned int half;
+
+	while(end > begin)
+	{
+		half = (end - begin) / 2;
+		if(index->tags[begin + half] < tag)
+		{
+			begin += half + 1;
+		}
+		else
+		{
+			end = begin + half;
+		}
+	}
+
+	if( (begin == index->header->numColumns) || (index->tags[begin] != tag) )
+	{
+		return NULL;
+	}
+
+	return index->columns + (size_t)begin * index->header->words;
+}
+
+
+/**                                                                      **/
+/**   Function: evalChunk                                                **/
+/**                                                                      **/
+/**   Evaluate a query over lanes of the columns starting at a word,     **/
+/**   leaving the result at the bottom of the stack, whose entries are   **/
+/**   BITMAP_CHUNK_WORDS words apart.                                    **/
+/**                                                                      **/
+
+static void evalChunk(const tiffQuery *query,
+	const unsigned long long *const columns[], size_t start,
+	unsigned int lanes, bitmapLane *stack)
+{
+	const unsigned int stride = BITMAP_CHUNK_WORDS / BITMAP_LANE_WORDS;
+	const unsigned long long *column;
+	bitmapLane *a;
+	bitmapLane *b;
+	unsigned int depth = 0;
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0;i < query->numOps;i++)
+	{
+		a = stack + (size_t)(depth - 1) * stride;
+		b = stack + (size_t)depth * stride;
+		switch(query->ops[i].op)
+		{
+			case TIFF_QUERY_OP_TERM:
+			{
+				column = columns[query->ops[i].term];
+				if(column != NULL)
+				{
+					memcpy(b, column + start, lanes * sizeof(*b) );
+				}
+				else
+				{
+					memset(b, 0, lanes * sizeof(*b) );
+				}
+				depth++;
+				break;
+			}
+			case TIFF_QUERY_OP_NOT:
+			{
+				for(j = 0;j < lanes;j++)
+				{
+					a[j] = ~a[j];
+				}
+				break;
+			}
+			case TIFF_QUERY_OP_AND:
+			{
+				a -= stride;
+				b -= stride;
+				for(j = 0;j < lanes;j++)
+				{
+					a[j] &= b[j];
+				}
+				depth--;
+				break;
+			}
+			case TIFF_QUERY_OP_OR:
+			{
+				a -= stride;
+				b -= stride;
+				for(j = 0;j < lanes;j++)
+				{
+					a[j] |= b[j];
+				}
+				depth--;
+				break;
+			}
+		}
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapEval                                           **/
+/**                                                                      **/
+/**   Evaluate a query of tags alone over an index. Returns a bitmap     **/
+/**   of header->words words, bit i set when file i matches, to be       **/
+/**   released with free, or NULL with a message on stderr if the        **/
+/**   query compares values or memory runs out.                          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   index  -- index                                                    **/
+/**   query  -- query compiled with tiffQueryCompile                     **/
+/**                                                                      **/
+
+unsigned long long *tiffBitmapEval(const tiffBitmapIndex *index,
+	const tiffQuery *query)
+{
+	const unsigned long long *columns[TIFF_QUERY_MAX_TERMS];
+	size_t words = index->header->words;
+	unsigned int numFiles = index->header->numFiles;
+	unsigned long long *result;
+	void *stack;
+	void *bits;
+	size_t start;
+	size_t count;
+	unsigned int i;
+
+	for(i = 0;i < query->numTerms;i++)
+	{
+		if(query->terms[i].cmp != TIFF_QUERY_EXISTS)
+		{
+			fprintf(stderr, "bitmap indexes only tell which tags files "
+				"hold, not their values\n");
+
+			return NULL;
+		}
+		columns[i] = tiffBitmapColumn(index, query->terms[i].tag);
+	}
+
+	if(posix_memalign(&stack, TIFF_BITMAP_ALIGN, (query->numOps + 1) *
+		BITMAP_CHUNK_WORDS * sizeof(unsigned long long) ) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+
+		return NULL;
+	}
+	if(posix_memalign(&bits, TIFF_BITMAP_ALIGN,
+		(words + 1) * sizeof(unsigned long long) ) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		free(stack);
+
+		return NULL;
+	}
+	result = (unsigned long long *)bits;
+
+	/* words is a multiple of TIFF_BITMAP_ALIGN / 8, and so of lanes */
+	for(start = 0;start < words;start += BITMAP_CHUNK_WORDS)
+	{
+		count = (words - start < BITMAP_CHUNK_WORDS) ? words - start :
+			BITMAP_CHUNK_WORDS;
+		evalChunk(query, columns, start,
+			(unsigned int)(count / BITMAP_LANE_WORDS), (bitmapLane *)stack);
+		memcpy(result + start, stack, count * sizeof(*result) );
+	}
+	free(stack);
+
+	/* NOT sets the bits past the last file */
+	for(start = numFiles / 64;start < words;start++)
+	{
+		result[start] &= (start == numFiles / 64) ?
+			(1ULL << (numFiles % 64) ) - 1 : 0;
+	}
+
+	return result;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapCount                                          **/
+/**                                                                      **/
+/**   Return the number of files set in a bitmap of an index.            **/
+/**                                                                      **/
+
+unsigned long long tiffBitmapCount(const tiffBitmapIndex *index,
+	const unsigned long long *bits)
+{
+	unsigned long long count = 0;
+#ifndef __GNUC__
+	unsigned long long word;
+#endif
+	unsigned int i;
+
+	for(i = 0;i < index->header->words;i++)
+	{
+#ifdef __GNUC__
+		count += (unsigned long long)__builtin_popcountll(bits[i]);
+#else
+		for(word = bits[i];word != 0;word &= word - 1)
+		{
+			count++;
+		}
+#endif
+	}
+
+	return count;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapPath                                           **/
+/**                                                                      **/
+/**   Return the name of a file of an index, or NULL if the index is     **/
+/**   corrupt.                                                           **/
+/**                                                                      **/
+
+const char *tiffBitmapPath(const tiffBitmapIndex *index, unsigned int file)
+{
+	if( (file >= index->header->numFiles) ||
+		(index->files[file] >= index->header->stringBytes) )
+	{
+		return NULL;
+	}
+
+	return index->strings + index->files[file];
+}
+
+
+/**                                                                      **/
+/**   Function: usage                                                    **/
+/**                                                                      **/
+/**   Print the usage of the bitmap subcommand.                          **/
+/**                                                                      **/
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tiff_metadata bitmap build [-j jobs] "
+		"index tiffFile|directory ...\n"
+		"       tiff_metadata bitmap query [--count] index expression\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: bitmapWorkerInit                                         **/
+/**                                                                      **/
+/**   tiffBatchWorkerFunc adding the state of a worker to the build.     **/
+/**                                                                      **/
+
+static void *bitmapWorkerInit(void *arg)
+{
+	return tiffBitmapWorker( (tiffBitmapBuild *)arg);
+}
+
+
+/**                                                                      **/
+/**   Function: bitmapFile                                               **/
+/**                                                                      **/
+/**   tiffBatchFunc recording the tags of one file.                      **/
+/**                                                                      **/
+
+static int bitmapFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	return tiffBitmapFile( (const tiffBitmapBuild *)arg, internal->worker,
+		filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: bitmapBuild                                              **/
+/**                                                                      **/
+/**   Run the build form of the bitmap subcommand.                       **/
+/**                                                                      **/
+
+static int bitmapBuild(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "jobs", required_argument, NULL, 'j', },
+		{ NULL, 0, NULL, 0, },
+	};
+	tiffBitmapBuild build;
+	tiffBitmapHeader header;
+	tiffBatch batch;
+	int jobs = 1;
+	char *end;
+	int c;
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "j:", longOptions, NULL)) != -1)
+	{
+		if(c != 'j')
+		{
+			usage();
+
+			return 1;
+		}
+		jobs = (int)strtol(optarg, &end, 10);
+		if(*optarg == '\0' || *end != '\0' || jobs < 1)
+		{
+			usage();
+
+			return 1;
+		}
+	}
+	if(argc - optind < 2)
+	{
+		usage();
+
+		return 1;
+	}
+
+	if(tiffBitmapInit(&build) != 0)
+	{
+		return 1;
+	}
+	tiffBatchInit(&batch, bitmapFile, &build);
+	batch.numThreads = jobs;
+	batch.workerInit = bitmapWorkerInit;
+	tiffBatchRun(&batch, argv + optind + 1, argc - optind - 1);
+
+	if(tiffBitmapSave(&build, argv[optind], &header) != 0)
+	{
+		batch.status = 1;
+	}
+	else
+	{
+		printf("%s: %u files, %u columns\n", argv[optind], header.numFiles,
+			header.numColumns);
+	}
+	tiffBitmapBuildFree(&build);
+
+	return batch.status;
+}
+
+
+/**                                                                      **/
+/**   Function: bitmapQuery                                              **/
+/**                                                                      **/
+/**   Run the query form of the bitmap subcommand.                       **/
+/**                                                                      **/
+
+static int bitmapQuery(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "count", no_argument, NULL, 'c', },
+		{ NULL, 0, NULL, 0, },
+	};
+	tiffBitmapIndex index;
+	tiffQuery query;
+	unsigned long long *result;
+	unsigned long long bits;
+	const char *path;
+	unsigned int file;
+	unsigned int w;
+	int countOnly = 0;
+	int status = 0;
+	int c;
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "c", longOptions, NULL)) != -1)
+	{
+		if(c != 'c')
+		{
+			usage();
+
+			return 1;
+		}
+		countOnly = 1;
+	}
+	if(argc - optind != 2)
+	{
+		usage();
+
+		return 1;
+	}
+
+	if(tiffQueryCompile(argv[optind + 1], &query) != 0)
+	{
+		return 1;
+	}
+	if(tiffBitmapLoad(argv[optind], &index) != 0)
+	{
+		return 1;
+	}
+
+	result = tiffBitmapEval(&index, &query);
+	if(result == NULL)
+	{
+		tiffBitmapFree(&index);
+
+		return 1;
+	}
+
+	if(countOnly)
+	{
+		printf("%llu\n", tiffBitmapCount(&index, result) );
+	}
+	for(w = 0;(w < index.header->words) && !countOnly;w++)
+	{
+		for(bits = result[w];bits != 0;bits &= bits - 1)
+		{
+			file = w * 64 + lowestBit(bits);
+			path = tiffBitmapPath(&index, file);
+			if(path == NULL)
+			{
+				fprintf(stderr, "%s: bad bitmap index file %u\n",
+					argv[optind], file);
+				status = 1;
+				continue;
+			}
+			printf("%s\n", path);
+		}
+	}
+
+	free(result);
+	tiffBitmapFree(&index);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffBitmapMain                                           **/
+/**                                                                      **/
+/**   Main function of the bitmap subcommand. Returns 0 on success, 1    **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+/**   Usage:                                                             **/
+/**   tiff_metadata bitmap build [-j N] index tiffFile|directory ...     **/
+/**                                                                      **/
+/**   writes the bitmap index of the tags the files hold, processed with **/
+/**   N worker threads.                                                  **/
+/**                                                                      **/
+/**   tiff_metadata bitmap query [--count] index expression              **/
+/**                                                                      **/
+/**   prints the names of the files matching an expression of tags,      **/
+/**   such as "TileOffsets && !34675", in the order of the index, or     **/
+/**   their number.                                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   argc       -- argument count, argv[0] being "bitmap"               **/
+/**   argv       -- argument vector                                      **/
+/**                                                                      **/
+
+int tiffBitmapMain(int argc, char *argv[])
+{
+	if( (argc > 1) && (strcmp(argv[1], "build") == 0) )
+	{
+		return bitmapBuild(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "query") == 0) )
+	{
+		return bitmapQuery(argc - 1, argv + 1);
+	}
+
+	usage();
+
+	return 1;
+}
@@ -0,0 +1,172 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Tag presence bitmaps of many files.                                **/
+/**                                                                      **/
+/**   Filters such as "has GPS", "has a MakerNote" or "is tiled" only    **/
+/**   ask which tags a file holds. A bitmap index answers them for a     **/
+/**   whole corpus without opening any image again: a scan               **/
+/**   ("tiff_metadata bitmap build out.bm paths...") walks every file    **/
+/**   once and records the tags present in its main IFD chain and Exif   **/
+/**   IFD, and the index keeps one column per tag, bit i of a column     **/
+/**   being set when file i holds the tag.                               **/
+/**                                                                      **/
+/**   The universe of tags is fixed: the built-in tags of tagNum_t, in   **/
+/**   which every file gets a row of bits while the scan runs, followed  **/
+/**   by the tags outside it met during the scan, recorded per file as   **/
+/**   overflow and given columns of their own. Only columns with a bit   **/
+/**   set are written; a tag without a column is held by no file.        **/
+/**                                                                      **/
+/**   The index file holds a header, the tags of the columns in          **/
+/**   increasing order, the columns, the offsets of the file names and   **/
+/**   the names. Columns are padded to TIFF_BITMAP_ALIGN bytes and start **/
+/**   at multiples of it, so that the mapped file is used in place.      **/
+/**   Queries are tiff_query.h expressions of tags alone, such as tiled  **/
+/**   files without an ICC profile (tag 34675):                          **/
+/**                                                                      **/
+/**       TileOffsets && !34675                                          **/
+/**                                                                      **/
+/**   They are evaluated over the columns with vector operations (GCC    **/
+/**   vector extensions, where available) a block of files at a time, so **/
+/**   that intermediate results stay in cache. Indexes are specific to   **/
+/**   the byte order of the machine that wrote them.                     **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_BITMAP_H
+#define _TIFF_BITMAP_H
+
+#include <pthread.h>
+#include "tiff_metadata.h"
+#include "tiff_query.h"
+
+
+/**                                                                      **/
+/**  Magic number of indexes, and alignment of their columns in bytes    **/
+/**                                                                      **/
+
+#define TIFF_BITMAP_MAGIC "TIFFBMP1"
+#define TIFF_BITMAP_ALIGN 64
+
+
+/**                                                                      **/
+/**  Header of an index, followed by its column tags, columns, files and **/
+/**  strings, each part starting at a multiple of TIFF_BITMAP_ALIGN      **/
+/**                                                                      **/
+/**  magic, byteOrder                                                    **/
+/**      TIFF_BITMAP_MAGIC, and 0x01020304 as written by the machine     **/
+/**  numFiles, numColumns                                                **/
+/**      number of files, and of columns                                 **/
+/**  words                                                               **/
+/**      64-bit words of each column, a multiple of TIFF_BITMAP_ALIGN / 8**/
+/**  stringBytes                                                         **/
+/**      size of the file names, each followed by a NUL                  **/
+/**                                                                      **/
+
+typedef struct tiffBitmapHeader
+{
+	char magic[8];
+	unsigned int byteOrder;
+	unsigned int numFiles;
+	unsigned int numColumns;
+	unsigned int words;
+	unsigned long long stringBytes;
+} tiffBitmapHeader;
+
+
+/**                                                                      **/
+/**  Loaded index                                                        **/
+/**                                                                      **/
+/**  base, size                                                          **/
+/**      the mapped file                                                 **/
+/**  header, tags, columns, files, strings                               **/
+/**      parts of the file; column i, of tag tags[i], is columns + i *   **/
+/**      header->words, and files holds the offset of the name of each   **/
+/**      file in strings                                                 **/
+/**                                                                      **/
+
+typedef struct tiffBitmapIndex
+{
+	unsigned char *base;
+	size_t size;
+	const tiffBitmapHeader *header;
+	const unsigned int *tags;
+	const unsigned long long *columns;
+	const unsigned long long *files;
+	const char *strings;
+} tiffBitmapIndex;
+
+
+/**                                                                      **/
+/**  Index being built                                                   **/
+/**                                                                      **/
+/**  lock                                                                **/
+/**      protects workers while workers start                            **/
+/**  workers                                                             **/
+/**      list of the rows and names collected by each worker             **/
+/**  numFixed, rowWords                                                  **/
+/**      number of built-in tags, and 64-bit words of a row              **/
+/**  fixedTags                                                           **/
+/**      tag of each bit of a row                                        **/
+/**  fixedBits                                                           **/
+/**      one plus the bit of each tag number in a row, 0 for overflow    **/
+/**      tags                                                            **/
+/**                                                                      **/
+
+typedef struct tiffBitmapBuild
+{
+	pthread_mutex_t lock;
+	struct bitmapWorker *workers;
+	unsigned int numFixed;
+	unsigned int rowWords;
+	unsigned short *fixedTags;
+	unsigned short *fixedBits;
+} tiffBitmapBuild;
+
+
+/**                                                                      **/
+/**  Bitmap API function declarations                                    **/
+/**                                                                      **/
+
+int tiffBitmapInit(tiffBitmapBuild *build);
+void *tiffBitmapWorker(tiffBitmapBuild *build);
+int tiffBitmapFile(const tiffBitmapBuild *build, void *worker,
+	const char *filename, internalStruct *internal);
+int tiffBitmapSave(const tiffBitmapBuild *build, const char *filename,
+	tiffBitmapHeader *header);
+void tiffBitmapBuildFree(tiffBitmapBuild *build);
+int tiffBitmapLoad(const char *filename, tiffBitmapIndex *index);
+void tiffBitmapFree(tiffBitmapIndex *index);
+const unsigned long long *tiffBitmapColumn(const tiffBitmapIndex *index,
+	unsigned short tag);
+unsigned long long *tiffBitmapEval(const tiffBitmapIndex *index,
+	const tiffQuery *query);
+unsigned long long tiffBitmapCount(const tiffBitmapIndex *index,
+	const unsigned long long *bits);
+const char *tiffBitmapPath(const tiffBitmapIndex *index, unsigned int file);
+int tiffBitmapMain(int argc, char *argv[]);
+
+#endif
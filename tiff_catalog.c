@@ -0,0 +1,1274 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Catalog of files by capture time.                                  **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "tiff_metadata.h"
+#include "tiff_query.h"
+#include "tiff_batch.h"
+#include "tiff_catalog.h"
+
+
+/* value of the byteOrder field as written by this machine */
+#define CATALOG_BYTE_ORDER 0x01020304
+
+/* length of "YYYY:MM:DD HH:MM:SS", and of the fraction of a second kept */
+#define CATALOG_TIME_LENGTH 19
+#define CATALOG_FRACTION_DIGITS 6
+
+#define CATALOG_MIN_ITEMS 256
+
+
+/**                                                                      **/
+/**  Date tag catalogued, and the tag holding its fraction of a second   **/
+/**                                                                      **/
+
+typedef struct catalogTag
+{
+	unsigned short tag;
+	unsigned short subSec;
+} catalogTag;
+
+static const catalogTag catalogTags[TIFF_CATALOG_TAGS] = {
+	{ DateTimeOriginal, SubSecTimeOriginal, },
+	{ DateTime, SubSecTime, },
+	{ DateTimeDigitized, SubSecTimeDigitized, },
+};
+
+/* characters of a time, '0' standing for any digit; the second format is */
+/* only accepted in query arguments, but costs nothing to check for */
+static const char catalogFormat[] = "0000:00:00 00:00:00";
+static const char catalogAltFormat[] = "0000-00-00T00:00:00";
+
+/* days of each month of a common year, padded to be indexed by 4 bits */
+static const unsigned int catalogMonthDays[16] = {
+	31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31, 0, 0, 0, 0,
+};
+
+
+/**                                                                      **/
+/**  Time collected by a worker                                          **/
+/**                                                                      **/
+/**  timeUs                                                              **/
+/**      microseconds since the epoch                                    **/
+/**  file                                                                **/
+/**      index of the file among the files of the worker                 **/
+/**  tag                                                                 **/
+/**      index of the tag in catalogTags                                 **/
+/**                                                                      **/
+
+typedef struct catalogItem
+{
+	long long timeUs;
+	unsigned int file;
+	unsigned int tag;
+} catalogItem;
+
+
+/**                                                                      **/
+/**  Times and names collected by a worker                               **/
+/**                                                                      **/
+/**  next                                                                **/
+/**      next worker of the build                                        **/
+/**  items, numItems, maxItems                                           **/
+/**      times found                                                     **/
+/**  files, numFiles, maxFiles                                           **/
+/**      offset in names of the name of each file holding a time         **/
+/**  names, nameBytes, maxNameBytes                                      **/
+/**      file names, each followed by a NUL                              **/
+/**                                                                      **/
+
+typedef struct catalogWorker
+{
+	struct catalogWorker *next;
+	catalogItem *items;
+	unsigned int numItems;
+	unsigned int maxItems;
+	unsigned long long *files;
+	unsigned int numFiles;
+	unsigned int maxFiles;
+	char *names;
+	unsigned long long nameBytes;
+	unsigned long long maxNameBytes;
+} catalogWorker;
+
+
+/**                                                                      **/
+/**  Walk state of a file: its times, and the fractions of a second      **/
+/**  of their SubSecTime tags                                            **/
+/**                                                                      **/
+/**  found                                                               **/
+/**      bit 0 set once the date tag of index i was seen, bit 1 once     **/
+/**      its SubSecTime tag was; the first entry holding a tag decides   **/
+/**  valid                                                               **/
+/**      1 if the date tag of index i held a time                        **/
+/**  numFound                                                            **/
+/**      number of bits set in found                                     **/
+/**                                                                      **/
+
+typedef struct catalogCtx
+{
+	long long timeUs[TIFF_CATALOG_TAGS];
+	long long fractionUs[TIFF_CATALOG_TAGS];
+	unsigned int found[TIFF_CATALOG_TAGS];
+	int valid[TIFF_CATALOG_TAGS];
+	unsigned int numFound;
+} catalogCtx;
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogParseTime                                     **/
+/**                                                                      **/
+/**   Parse a time in the "YYYY:MM:DD HH:MM:SS" format of TIFF and Exif  **/
+/**   (or "YYYY-MM-DDTHH:MM:SS") into microseconds since the epoch. The  **/
+/**   19 characters are all read, whatever they hold, so text must have  **/
+/**   that many readable bytes; only the final result depends on them.   **/
+/**   Unknown times, written with blanks or zeros, and impossible dates  **/
+/**   are refused. Returns 0 on success, 1 if text is not such a time.   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   text    -- at least 19 characters                                  **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   timeUs  -- the time, when 0 is returned                            **/
+/**                                                                      **/
+
+int tiffCatalogParseTime(const char *text, long long *timeUs)
+{
+	unsigned int digits[CATALOG_TIME_LENGTH];
+	unsigned int bad = 0;
+	unsigned int isDigit;
+	unsigned int c;
+	unsigned int year;
+	unsigned int month;
+	unsigned int day;
+	unsigned int hour;
+	unsigned int minute;
+	unsigned int second;
+	unsigned int leap;
+	long long y;
+	long long era;
+	long long yoe;
+	long long doy;
+	long long days;
+	unsigned int i;
+
+	for(i = 0;i < CATALOG_TIME_LENGTH;i++)
+	{
+		c = (unsigned char)text[i];
+		isDigit = (catalogFormat[i] == '0');
+		bad |= isDigit & (c - '0' > 9);
+		bad |= (isDigit ^ 1) & (c != (unsigned char)catalogFormat[i]) &
+			(c != (unsigned char)catalogAltFormat[i]);
+		/* keeps the arithmetic below in range whatever text holds */
+		digits[i] = (c - '0') & 15;
+	}
+
+	year = digits[0] * 1000 + digits[1] * 100 + digits[2] * 10 + digits[3];
+	month = digits[5] * 10 + digits[6];
+	day = digits[8] * 10 + digits[9];
+	hour = digits[11] * 10 + digits[12];
+	minute = digits[14] * 10 + digits[15];
+	second = digits[17] * 10 + digits[18];
+
+	leap = ( (year % 4 == 0) & (year % 100 != 0) ) | (year % 400 == 0);
+	bad |= (year == 0) | (month - 1 > 11) |
+		(day - 1 >= catalogMonthDays[(month - 1) & 15] +
+		(leap & (month == 2) ) ) |
+		(hour > 23) | (minute > 59) | (second > 60);
+
+	/* days from 1970:01:01, with years starting in March so that the */
+	/* leap day comes last */
+	y = (long long)year - (month <= 2);
+	era = y / 400;
+	yoe = y - era * 400;
+	doy = (153 * ( (long long)month + 9 - 12 * (month > 2) ) + 2) / 5 +
+		day - 1;
+	days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+
+	*timeUs = (days * 86400 + hour * 3600 + minute * 60 + second) *
+		1000000LL;
+
+	return (bad != 0);
+}
+
+
+/**                                                                      **/
+/**   Function: parseFraction                                            **/
+/**                                                                      **/
+/**   Return the fraction of a second written in a SubSecTime string,    **/
+/**   in microseconds; its digits stand for tenths, hundredths and so    **/
+/**   on. Returns 0 if the string holds no digits.                       **/
+/**                                                                      **/
+
+static long long parseFraction(const char *text)
+{
+	long long us = 0;
+	unsigned int n;
+
+	while(*text == ' ')
+	{
+		text++;
+	}
+	for(n = 0;(n < CATALOG_FRACTION_DIGITS) && (text[n] >= '0') &&
+		(text[n] <= '9');n++)
+	{
+		us = us * 10 + (text[n] - '0');
+	}
+	for(;n < CATALOG_FRACTION_DIGITS;n++)
+	{
+		us *= 10;
+	}
+
+	return us;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogFormatTime                                    **/
+/**                                                                      **/
+/**   Format a time in the "YYYY:MM:DD HH:MM:SS" format, followed by     **/
+/**   the microseconds if there are any.                                 **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   timeUs  -- microseconds since the epoch                            **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   text    -- TIFF_CATALOG_MAX_TIME bytes                             **/
+/**                                                                      **/
+
+void tiffCatalogFormatTime(long long timeUs, char *text)
+{
+	long long seconds;
+	long long us;
+	long long days;
+	long long rest;
+	long long era;
+	long long doe;
+	long long yoe;
+	long long doy;
+	long long mp;
+	long long year;
+	long long month;
+	long long day;
+
+	seconds = timeUs / 1000000;
+	seconds -= (seconds * 1000000 > timeUs);
+	us = timeUs - seconds * 1000000;
+	days = seconds / 86400;
+	days -= (days * 86400 > seconds);
+	rest = seconds - days * 86400;
+
+	days += 719468;
+	era = ( (days >= 0) ? days : days - 146096) / 146097;
+	doe = days - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+	day = doy - (153 * mp + 2) / 5 + 1;
+	month = (mp < 10) ? mp + 3 : mp - 9;
+	year = yoe + era * 400 + (month <= 2);
+
+	/* the modulos only bound the lengths for the compiler; parsed times */
+	/* lie within them */
+	snprintf(text, TIFF_CATALOG_MAX_TIME, "%04u:%02u:%02u %02u:%02u:%02u",
+		(unsigned int)year % 10000, (unsigned int)month % 100,
+		(unsigned int)day % 100, (unsigned int)(rest / 3600) % 100,
+		(unsigned int)(rest / 60) % 60, (unsigned int)rest % 60);
+	if(us != 0)
+	{
+		snprintf(text + CATALOG_TIME_LENGTH, TIFF_CATALOG_MAX_TIME -
+			CATALOG_TIME_LENGTH, ".%06u", (unsigned int)us % 1000000);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogTag                                           **/
+/**                                                                      **/
+/**   Return the index of a catalogued date tag, given by name, or -1 if **/
+/**   it is not one.                                                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   name    -- tag name                                                **/
+/**                                                                      **/
+
+int tiffCatalogTag(const char *name)
+{
+	int tag;
+	int i;
+
+	tag = getTagNumber(name);
+	for(i = 0;i < TIFF_CATALOG_TAGS;i++)
+	{
+		if(tag == catalogTags[i].tag)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogInit                                          **/
+/**                                                                      **/
+/**   Initialize an empty catalog build.                                 **/
+/**                                                                      **/
+
+void tiffCatalogInit(tiffCatalogBuild *build)
+{
+	pthread_mutex_init(&build->lock, NULL);
+	build->workers = NULL;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogWorker                                        **/
+/**                                                                      **/
+/**   Add the state of a worker to a build, for tiffBatch workerInit     **/
+/**   functions. Returns NULL if out of memory, tiffCatalogFile then     **/
+/**   failing for every file of the worker.                              **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build   -- catalog build                                           **/
+/**                                                                      **/
+
+void *tiffCatalogWorker(tiffCatalogBuild *build)
+{
+	catalogWorker *worker;
+
+	worker = (catalogWorker *)calloc(1, sizeof(*worker) );
+	if(worker == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&build->lock);
+	worker->next = build->workers;
+	build->workers = worker;
+	pthread_mutex_unlock(&build->lock);
+
+	return worker;
+}
+
+
+/**                                                                      **/
+/**  IFD walker callback noting the times and fractions of a second of   **/
+/**  the date tags, which stops the walk once every tag was seen         **/
+/**                                                                      **/
+
+static tiffWalk_t catalogEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	catalogCtx *catalog = (catalogCtx *)ctx;
+	tiffQueryValue value;
+	char text[CATALOG_TIME_LENGTH + 1];
+	unsigned int bit;
+	unsigned int i;
+
+	for(i = 0;i < TIFF_CATALOG_TAGS;i++)
+	{
+		if(entry->tag == catalogTags[i].tag)
+		{
+			bit = 1;
+		}
+		else if(entry->tag == catalogTags[i].subSec)
+		{
+			bit = 2;
+		}
+		else
+		{
+			continue;
+		}
+		if(catalog->found[i] & bit)
+		{
+			break;
+		}
+
+		if(tiffQueryFetch(internal, entry, &value) != 0)
+		{
+			return TIFF_WALK_ERROR;
+		}
+		catalog->found[i] |= bit;
+		catalog->numFound++;
+		if(!value.hasValue || !value.isString)
+		{
+			break;
+		}
+
+		if(bit == 1)
+		{
+			/* padded with NULs, which the parser refuses */
+			memset(text, 0, sizeof(text) );
+			memcpy(text, value.string, strnlen(value.string,
+				CATALOG_TIME_LENGTH) );
+			catalog->valid[i] = (tiffCatalogParseTime(text,
+				&catalog->timeUs[i]) == 0);
+		}
+		else
+		{
+			catalog->fractionUs[i] = parseFraction(value.string);
+		}
+		break;
+	}
+
+	return (catalog->numFound == 2 * TIFF_CATALOG_TAGS) ?
+		TIFF_WALK_STOP : TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor catalogVisitor = {
+	NULL,
+	catalogEntry,
+	NULL,
+};
+
+
+/**                                                                      **/
+/**   Function: workerAdd                                                **/
+/**                                                                      **/
+/**   Add a file and its times to the state of a worker. Returns 0 on    **/
+/**   success, 1 if out of memory.                                       **/
+/**                                                                      **/
+
+static int workerAdd(catalogWorker *worker, const char *filename,
+	const catalogCtx *ctx)
+{
+	unsigned long long length = strlen(filename) + 1;
+	unsigned long long maxNameBytes;
+	unsigned int maxItems;
+	unsigned int maxFiles;
+	void *grown;
+	unsigned int i;
+
+	if(worker->numItems + TIFF_CATALOG_TAGS > worker->maxItems)
+	{
+		maxItems = (worker->maxItems == 0) ? CATALOG_MIN_ITEMS :
+			worker->maxItems * 2;
+		grown = realloc(worker->items, maxItems * sizeof(catalogItem) );
+		if(grown == NULL)
+		{
+			return 1;
+		}
+		worker->items = (catalogItem *)grown;
+		worker->maxItems = maxItems;
+	}
+	if(worker->numFiles == worker->maxFiles)
+	{
+		maxFiles = (worker->maxFiles == 0) ? CATALOG_MIN_ITEMS :
+			worker->maxFiles * 2;
+		grown = realloc(worker->files, maxFiles * sizeof(*worker->files) );
+		if(grown == NULL)
+		{
+			return 1;
+		}
+		worker->files = (unsigned long long *)grown;
+		worker->maxFiles = maxFiles;
+	}
+	if(worker->nameBytes + length > worker->maxNameBytes)
+	{
+		maxNameBytes = (worker->maxNameBytes == 0) ?
+			CATALOG_MIN_ITEMS * 64 : worker->maxNameBytes * 2;
+		while(worker->nameBytes + length > maxNameBytes)
+		{
+			maxNameBytes *= 2;
+		}
+		grown = realloc(worker->names, (size_t)maxNameBytes);
+		if(grown == NULL)
+		{
+			return 1;
+		}
+		worker->names = (char *)grown;
+		worker->maxNameBytes = maxNameBytes;
+	}
+
+	memcpy(worker->names + worker->nameBytes, filename, (size_t)length);
+	worker->files[worker->numFiles] = worker->nameBytes;
+	worker->nameBytes += length;
+
+	for(i = 0;i < TIFF_CATALOG_TAGS;i++)
+	{
+		if(ctx->valid[i])
+		{
+			worker->items[worker->numItems].timeUs = ctx->timeUs[i] +
+				ctx->fractionUs[i];
+			worker->items[worker->numItems].file = worker->numFiles;
+			worker->items[worker->numItems].tag = i;
+			worker->numItems++;
+		}
+	}
+	worker->numFiles++;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogFile                                          **/
+/**                                                                      **/
+/**   Collect the times of a file in the state of a worker, reading no   **/
+/**   more of it than needed. Files without any time are left out.       **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   worker    -- state returned by tiffCatalogWorker                   **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+int tiffCatalogFile(void *worker, const char *filename,
+	internalStruct *internal)
+{
+	catalogCtx ctx;
+	tiffWalk_t status;
+	unsigned int i;
+
+	if(worker == NULL)
+	{
+		fprintf(stderr, "can't allocate catalog for %s\n", filename);
+
+		return 1;
+	}
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	memset(&ctx, 0, sizeof(ctx) );
+	status = tiffWalkFile(filename, internal, &catalogVisitor, &ctx);
+
+	tiffClose(internal);
+
+	if(status == TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+
+	for(i = 0;(i < TIFF_CATALOG_TAGS) && !ctx.valid[i];i++)
+	{
+		continue;
+	}
+	if(i == TIFF_CATALOG_TAGS)
+	{
+		return 0;
+	}
+
+	if(workerAdd( (catalogWorker *)worker, filename, &ctx) != 0)
+	{
+		fprintf(stderr, "can't allocate catalog for %s\n", filename);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: compareEntries                                           **/
+/**                                                                      **/
+/**   qsort comparison of entries by time, then file.                    **/
+/**                                                                      **/
+
+static int compareEntries(const void *a, const void *b)
+{
+	const tiffCatalogEntry *x = (const tiffCatalogEntry *)a;
+	const tiffCatalogEntry *y = (const tiffCatalogEntry *)b;
+
+	if(x->timeUs != y->timeUs)
+	{
+		return (x->timeUs < y->timeUs) ? -1 : 1;
+	}
+
+	return (x->file > y->file) - (x->file < y->file);
+}
+
+
+/**                                                                      **/
+/**   Function: writeCatalog                                             **/
+/**                                                                      **/
+/**   Write the parts of a catalog. Returns 0 on success, 1 on failure.  **/
+/**                                                                      **/
+
+static int writeCatalog(const tiffCatalogBuild *build, const char *filename,
+	const tiffCatalogHeader *header, const tiffCatalogEntry *entries,
+	const unsigned long long *files)
+{
+	const catalogWorker *worker;
+	FILE *file;
+	int bad;
+
+	file = fopen(filename, "wb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	bad = (fwrite(header, sizeof(*header), 1, file) != 1) ||
+		(fwrite(entries, sizeof(*entries), header->numEntries, file) !=
+		header->numEntries) ||
+		(fwrite(files, sizeof(*files), header->numFiles, file) !=
+		header->numFiles);
+	for(worker = build->workers;(worker != NULL) && !bad;
+		worker = worker->next)
+	{
+		bad = (fwrite(worker->names, 1, (size_t)worker->nameBytes, file) !=
+			worker->nameBytes);
+	}
+
+	if( (fclose(file) != 0) || bad)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogSave                                          **/
+/**                                                                      **/
+/**   Gather the times and names collected by the workers of a build,    **/
+/**   sort them, and write the catalog. Returns 0 on success, 1 on       **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build     -- catalog build, whose workers are done                 **/
+/**   filename  -- file name written                                     **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   header    -- header of the catalog written                         **/
+/**                                                                      **/
+
+int tiffCatalogSave(const tiffCatalogBuild *build, const char *filename,
+	tiffCatalogHeader *header)
+{
+	const catalogWorker *worker;
+	tiffCatalogEntry *entries;
+	unsigned long long *files;
+	unsigned long long numFiles = 0;
+	unsigned long long numEntries = 0;
+	unsigned long long nameBase;
+	unsigned int next[TIFF_CATALOG_TAGS];
+	unsigned int fileBase;
+	const catalogItem *item;
+	unsigned int i;
+	int result;
+
+	memset(header, 0, sizeof(*header) );
+	memcpy(header->magic, TIFF_CATALOG_MAGIC, sizeof(header->magic) );
+	header->byteOrder = CATALOG_BYTE_ORDER;
+
+	for(worker = build->workers;worker != NULL;worker = worker->next)
+	{
+		numFiles += worker->numFiles;
+		numEntries += worker->numItems;
+		header->stringBytes += worker->nameBytes;
+		for(i = 0;i < worker->numItems;i++)
+		{
+			header->runs[worker->items[i].tag + 1]++;
+		}
+	}
+	if( (numFiles > UINT_MAX) || (numEntries > UINT_MAX) )
+	{
+		fprintf(stderr, "%s: too many files to catalog\n", filename);
+
+		return 1;
+	}
+	header->numFiles = (unsigned int)numFiles;
+	header->numEntries = (unsigned int)numEntries;
+	for(i = 0;i < TIFF_CATALOG_TAGS;i++)
+	{
+		header->runs[i + 1] += header->runs[i];
+		next[i] = header->runs[i];
+	}
+
+	entries = (tiffCatalogEntry *)calloc(numEntries + 1, sizeof(*entries) );
+	files = (unsigned long long *)calloc(numFiles + 1, sizeof(*files) );
+	if( (entries == NULL) || (files == NULL) )
+	{
+		fprintf(stderr, "%s: out of memory\n", filename);
+		free(entries);
+		free(files);
+
+		return 1;
+	}
+
+	fileBase = 0;
+	nameBase = 0;
+	for(worker = build->workers;worker != NULL;worker = worker->next)
+	{
+		for(i = 0;i < worker->numItems;i++)
+		{
+			item = &worker->items[i];
+			entries[next[item->tag]].timeUs = item->timeUs;
+			entries[next[item->tag]].file = fileBase + item->file;
+			next[item->tag]++;
+		}
+		for(i = 0;i < worker->numFiles;i++)
+		{
+			files[fileBase + i] = nameBase + worker->files[i];
+		}
+		fileBase += worker->numFiles;
+		nameBase += worker->nameBytes;
+	}
+
+	for(i = 0;i < TIFF_CATALOG_TAGS;i++)
+	{
+		qsort(entries + header->runs[i], header->runs[i + 1] -
+			header->runs[i], sizeof(*entries), compareEntries);
+	}
+
+	result = writeCatalog(build, filename, header, entries, files);
+
+	free(entries);
+	free(files);
+
+	return result;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogBuildFree                                     **/
+/**                                                                      **/
+/**   Release a catalog build and the state of its workers.              **/
+/**                                                                      **/
+
+void tiffCatalogBuildFree(tiffCatalogBuild *build)
+{
+	catalogWorker *worker;
+
+	while(build->workers != NULL)
+	{
+		worker = build->workers;
+		build->workers = worker->next;
+		free(worker->items);
+		free(worker->files);
+		free(worker->names);
+		free(worker);
+	}
+	pthread_mutex_destroy(&build->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogLoad                                          **/
+/**                                                                      **/
+/**   Map a catalog read-only and check its header, which is all that    **/
+/**   is read until queries are made. Returns 0 on success, 1 on         **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- catalog file name                                     **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   catalog   -- catalog, freed with tiffCatalogFree                   **/
+/**                                                                      **/
+
+int tiffCatalogLoad(const char *filename, tiffCatalog *catalog)
+{
+	const tiffCatalogHeader *header;
+	struct stat st;
+	unsigned long long size;
+	void *map;
+	int fd;
+	int bad;
+	unsigned int i;
+
+	memset(catalog, 0, sizeof(*catalog) );
+
+	fd = open(filename, O_RDONLY);
+	if( (fd < 0) || (fstat(fd, &st) != 0) )
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+		if(fd >= 0)
+		{
+			close(fd);
+		}
+
+		return 1;
+	}
+	if( (unsigned long long)st.st_size < sizeof(tiffCatalogHeader) )
+	{
+		fprintf(stderr, "%s: not a catalog\n", filename);
+		close(fd);
+
+		return 1;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+	catalog->base = (unsigned char *)map;
+	catalog->size = (size_t)st.st_size;
+	header = (const tiffCatalogHeader *)catalog->base;
+
+	if(memcmp(header->magic, TIFF_CATALOG_MAGIC, sizeof(header->magic) ) !=
+		0)
+	{
+		fprintf(stderr, "%s: not a catalog\n", filename);
+		tiffCatalogFree(catalog);
+
+		return 1;
+	}
+	if(header->byteOrder != CATALOG_BYTE_ORDER)
+	{
+		fprintf(stderr, "%s: written with another byte order\n", filename);
+		tiffCatalogFree(catalog);
+
+		return 1;
+	}
+
+	size = sizeof(*header) +
+		(unsigned long long)header->numEntries * sizeof(tiffCatalogEntry) +
+		(unsigned long long)header->numFiles * sizeof(unsigned long long);
+	bad = (header->runs[0] != 0) ||
+		(header->runs[TIFF_CATALOG_TAGS] != header->numEntries) ||
+		(header->stringBytes > catalog->size) ||
+		(size + header->stringBytes != catalog->size) ||
+		( (header->numFiles > 0) && (header->stringBytes == 0) );
+	for(i = 0;i < TIFF_CATALOG_TAGS;i++)
+	{
+		bad |= (header->runs[i] > header->runs[i + 1]);
+	}
+	if(bad || ( (header->stringBytes > 0) &&
+		(catalog->base[catalog->size - 1] != '\0') ) )
+	{
+		fprintf(stderr, "%s: bad catalog header\n", filename);
+		tiffCatalogFree(catalog);
+
+		return 1;
+	}
+
+	catalog->header = header;
+	catalog->entries = (const tiffCatalogEntry *)(catalog->base +
+		sizeof(*header) );
+	catalog->files = (const unsigned long long *)(catalog->entries +
+		header->numEntries);
+	catalog->strings = (const char *)(catalog->files + header->numFiles);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogFree                                          **/
+/**                                                                      **/
+/**   Unmap a catalog loaded with tiffCatalogLoad.                       **/
+/**                                                                      **/
+
+void tiffCatalogFree(tiffCatalog *catalog)
+{
+	if(catalog->base != NULL)
+	{
+		munmap(catalog->base, catalog->size);
+	}
+	memset(catalog, 0, sizeof(*catalog) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: lowerBound                                               **/
+/**                                                                      **/
+/**   Return the index of the first entry from begin to end whose time   **/
+/**   is not before timeUs, or end.                                      **/
+/**                                                                      **/
+
+static unsigned int lowerBound(const tiffCatalogEntry *entries,
+	unsigned int begin, unsigned int end, long long timeUs)
+{
+	unsigned int half;
+
+	while(end > begin)
+	{
+		half = (end - begin) / 2;
+		if(entries[begin + half].timeUs < timeUs)
+		{
+			begin += half + 1;
+		}
+		else
+		{
+			end = begin + half;
+		}
+	}
+
+	return begin;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogRange                                         **/
+/**                                                                      **/
+/**   Find the entries of a tag from one time up to, but excluding,      **/
+/**   another. Returns their number, the entries being                   **/
+/**   catalog->entries[*first] onwards in time order.                    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   catalog  -- catalog                                                **/
+/**   tag      -- index of the tag, see tiffCatalogTag                   **/
+/**   fromUs   -- first time included                                    **/
+/**   toUs     -- first time excluded                                    **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   first    -- index of the first entry                               **/
+/**                                                                      **/
+
+unsigned int tiffCatalogRange(const tiffCatalog *catalog, int tag,
+	long long fromUs, long long toUs, unsigned int *first)
+{
+	unsigned int begin = catalog->header->runs[tag];
+	unsigned int end = catalog->header->runs[tag + 1];
+	unsigned int last;
+
+	*first = lowerBound(catalog->entries, begin, end, fromUs);
+	last = lowerBound(catalog->entries, *first, end, toUs);
+
+	return last - *first;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogPath                                          **/
+/**                                                                      **/
+/**   Return the name of the file of an entry, or NULL if the entry is   **/
+/**   corrupt.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   catalog  -- catalog                                                **/
+/**   entry    -- entry of the catalog                                   **/
+/**                                                                      **/
+
+const char *tiffCatalogPath(const tiffCatalog *catalog,
+	const tiffCatalogEntry *entry)
+{
+	if( (entry->file >= catalog->header->numFiles) ||
+		(catalog->files[entry->file] >= catalog->header->stringBytes) )
+	{
+		return NULL;
+	}
+
+	return catalog->strings + catalog->files[entry->file];
+}
+
+
+/**                                                                      **/
+/**   Function: usage                                                    **/
+/**                                                                      **/
+/**   Print the usage of the catalog subcommand.                         **/
+/**                                                                      **/
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tiff_metadata catalog build [-j jobs] "
+		"catalog tiffFile|directory ...\n"
+		"       tiff_metadata catalog query [--tag name] catalog from "
+		"[to]\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: parseArgument                                            **/
+/**                                                                      **/
+/**   Parse a time given on the command line: a date, or a date and      **/
+/**   time followed by an optional fraction of a second. Returns 0 on    **/
+/**   success, 1 with a message on stderr on failure.                    **/
+/**                                                                      **/
+
+static int parseArgument(const char *text, long long *timeUs)
+{
+	char buffer[] = "0000:00:00 00:00:00";
+	size_t length = strlen(text);
+
+	if( (length == 10) || (length == CATALOG_TIME_LENGTH) ||
+		( (length > CATALOG_TIME_LENGTH) &&
+		(text[CATALOG_TIME_LENGTH] == '.') ) )
+	{
+		memcpy(buffer, text, (length == 10) ? 10 : CATALOG_TIME_LENGTH);
+		if(tiffCatalogParseTime(buffer, timeUs) == 0)
+		{
+			if(length > CATALOG_TIME_LENGTH)
+			{
+				*timeUs += parseFraction(text + CATALOG_TIME_LENGTH + 1);
+			}
+
+			return 0;
+		}
+	}
+
+	fprintf(stderr, "bad time \"%s\": YYYY:MM:DD[ HH:MM:SS[.ffffff]] "
+		"expected\n", text);
+
+	return 1;
+}
+
+
+/**                                                                      **/
+/**   Function: catalogWorkerInit                                        **/
+/**                                                                      **/
+/**   tiffBatchWorkerFunc adding the state of a worker to the build.     **/
+/**                                                                      **/
+
+static void *catalogWorkerInit(void *arg)
+{
+	return tiffCatalogWorker( (tiffCatalogBuild *)arg);
+}
+
+
+/**                                                                      **/
+/**   Function: catalogFile                                              **/
+/**                                                                      **/
+/**   tiffBatchFunc collecting the times of one file.                    **/
+/**                                                                      **/
+
+static int catalogFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	(void)arg;
+
+	return tiffCatalogFile(internal->worker, filename, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: catalogBuild                                             **/
+/**                                                                      **/
+/**   Run the build form of the catalog subcommand.                      **/
+/**                                                                      **/
+
+static int catalogBuild(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "jobs", required_argument, NULL, 'j', },
+		{ NULL, 0, NULL, 0, },
+	};
+	tiffCatalogBuild build;
+	tiffCatalogHeader header;
+	tiffBatch batch;
+	int jobs = 1;
+	char *end;
+	int c;
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "j:", longOptions, NULL)) != -1)
+	{
+		if(c != 'j')
+		{
+			usage();
+
+			return 1;
+		}
+		jobs = (int)strtol(optarg, &end, 10);
+		if(*optarg == '\0' || *end != '\0' || jobs < 1)
+		{
+			usage();
+
+			return 1;
+		}
+	}
+	if(argc - optind < 2)
+	{
+		usage();
+
+		return 1;
+	}
+
+	tiffCatalogInit(&build);
+	tiffBatchInit(&batch, catalogFile, &build);
+	batch.numThreads = jobs;
+	batch.workerInit = catalogWorkerInit;
+	tiffBatchRun(&batch, argv + optind + 1, argc - optind - 1);
+
+	if(tiffCatalogSave(&build, argv[optind], &header) != 0)
+	{
+		batch.status = 1;
+	}
+	else
+	{
+		printf("%s: %u files, %u times\n", argv[optind], header.numFiles,
+			header.numEntries);
+	}
+	tiffCatalogBuildFree(&build);
+
+	return batch.status;
+}
+
+
+/**                                                                      **/
+/**   Function: catalogQuery                                             **/
+/**                                                                      **/
+/**   Run the query form of the catalog subcommand.                      **/
+/**                                                                      **/
+
+static int catalogQuery(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "tag", required_argument, NULL, 't', },
+		{ NULL, 0, NULL, 0, },
+	};
+	char text[TIFF_CATALOG_MAX_TIME];
+	const tiffCatalogEntry *entry;
+	const char *path;
+	tiffCatalog catalog;
+	long long fromUs;
+	long long toUs = LLONG_MAX;
+	unsigned int first;
+	unsigned int count;
+	unsigned int i;
+	int tag = 0;
+	int status = 0;
+	int c;
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "t:", longOptions, NULL)) != -1)
+	{
+		if(c != 't')
+		{
+			usage();
+
+			return 1;
+		}
+		tag = tiffCatalogTag(optarg);
+		if(tag < 0)
+		{
+			fprintf(stderr, "%s is not a catalogued tag\n", optarg);
+
+			return 1;
+		}
+	}
+	if( (argc - optind < 2) || (argc - optind > 3) )
+	{
+		usage();
+
+		return 1;
+	}
+	if( (parseArgument(argv[optind + 1], &fromUs) != 0) ||
+		( (argc - optind == 3) &&
+		(parseArgument(argv[optind + 2], &toUs) != 0) ) )
+	{
+		return 1;
+	}
+
+	if(tiffCatalogLoad(argv[optind], &catalog) != 0)
+	{
+		return 1;
+	}
+
+	count = tiffCatalogRange(&catalog, tag, fromUs, toUs, &first);
+	for(i = 0;i < count;i++)
+	{
+		entry = &catalog.entries[first + i];
+		path = tiffCatalogPath(&catalog, entry);
+		if(path == NULL)
+		{
+			fprintf(stderr, "%s: bad catalog entry %u\n", argv[optind],
+				first + i);
+			status = 1;
+			continue;
+		}
+		tiffCatalogFormatTime(entry->timeUs, text);
+		printf("%s\t%s\n", text, path);
+	}
+
+	tiffCatalogFree(&catalog);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCatalogMain                                          **/
+/**                                                                      **/
+/**   Main function of the catalog subcommand. Returns 0 on success, 1   **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+/**   Usage:                                                             **/
+/**   tiff_metadata catalog build [-j N] catalog tiffFile|directory ...  **/
+/**                                                                      **/
+/**   writes the catalog of the times of the files, processed with N     **/
+/**   worker threads.                                                    **/
+/**                                                                      **/
+/**   tiff_metadata catalog query [--tag name] catalog from [to]         **/
+/**                                                                      **/
+/**   prints the time and name of the files whose DateTimeOriginal (or   **/
+/**   the tag given) is from "from" up to, but excluding, "to", in time  **/
+/**   order. Times are "YYYY:MM:DD", "YYYY:MM:DD HH:MM:SS" or that       **/
+/**   followed by ".ffffff"; "-" and "T" may separate the fields.        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   argc       -- argument count, argv[0] being "catalog"              **/
+/**   argv       -- argument vector                                      **/
+/**                                                                      **/
+
+int tiffCatalogMain(int argc, char *argv[])
+{
+	if( (argc > 1) && (strcmp(argv[1], "build") == 0) )
+	{
+		return catalogBuild(argc - 1, argv + 1);
+	}
+
+	if( (argc > 1) && (strcmp(argv[1], "query") == 0) )
+	{
+		return catalogQuery(argc - 1, argv + 1);
+	}
+
+	usage();
+
+	return 1;
+}
@@ -0,0 +1,182 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Catalog of files by capture time.                                  **/
+/**                                                                      **/
+/**   Finding the files taken between two times otherwise means parsing  **/
+/**   the date strings of every file again. A catalog holds, for every   **/
+/**   file of a scan, the times of its DateTimeOriginal, DateTime and    **/
+/**   DateTimeDigitized tags, with the fractions of a second of the      **/
+/**   matching SubSecTime tags, as microseconds since the epoch. The     **/
+/**   strings are in the fixed "YYYY:MM:DD HH:MM:SS" format and are      **/
+/**   parsed without branching on their contents: every character is     **/
+/**   checked and the fields computed whatever it holds, and a single    **/
+/**   test of the accumulated error decides at the end. Times carry no   **/
+/**   time zone and are taken as UTC.                                    **/
+/**                                                                      **/
+/**   A catalog is built once into a file ("tiff_metadata catalog build  **/
+/**   out.cat paths...") holding a header, the times of each tag sorted  **/
+/**   with the ids of their files, the offsets of the file names, and    **/
+/**   the names:                                                         **/
+/**                                                                      **/
+/**       header  entries[DateTimeOriginal] entries[DateTime]            **/
+/**               entries[DateTimeDigitized]  files  strings             **/
+/**                                                                      **/
+/**   It is mapped read-only and used in place: loading checks the       **/
+/**   header only, whatever the number of files, and a range query is    **/
+/**   two binary searches over the entries of a tag. File ids and        **/
+/**   string offsets are checked when a name is looked up. Catalogs are  **/
+/**   specific to the byte order of the machine that wrote them.         **/
+/**                                                                      **/
+/**   The build runs as a tiffBatch, every worker collecting the times   **/
+/**   and names of its files on its own; they are gathered and sorted    **/
+/**   once the run is over.                                              **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_CATALOG_H
+#define _TIFF_CATALOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Magic number of catalogs, number of date tags catalogued, and       **/
+/**  size of formatted times                                             **/
+/**                                                                      **/
+
+#define TIFF_CATALOG_MAGIC "TIFFCAT1"
+#define TIFF_CATALOG_TAGS 3
+#define TIFF_CATALOG_MAX_TIME 32
+
+
+/**                                                                      **/
+/**  Header of a catalog, followed by its entries, files and strings     **/
+/**                                                                      **/
+/**  magic, byteOrder                                                    **/
+/**      TIFF_CATALOG_MAGIC, and 0x01020304 as written by the machine    **/
+/**  numFiles, numEntries                                                **/
+/**      number of files, and of entries, at most TIFF_CATALOG_TAGS a    **/
+/**      file                                                            **/
+/**  runs                                                                **/
+/**      the entries of the tag of index i (see tiffCatalogTag) are      **/
+/**      entries[runs[i]] to entries[runs[i + 1] - 1]                    **/
+/**  stringBytes                                                         **/
+/**      size of the file names, each followed by a NUL                  **/
+/**                                                                      **/
+
+typedef struct tiffCatalogHeader
+{
+	char magic[8];
+	unsigned int byteOrder;
+	unsigned int numFiles;
+	unsigned int numEntries;
+	unsigned int runs[TIFF_CATALOG_TAGS + 1];
+	unsigned int pad;
+	unsigned long long stringBytes;
+} tiffCatalogHeader;
+
+
+/**                                                                      **/
+/**  Time of a file, entries of a tag being sorted by time then file     **/
+/**                                                                      **/
+/**  timeUs                                                              **/
+/**      microseconds since 1970:01:01 00:00:00                          **/
+/**  file                                                                **/
+/**      index of the file in the files of the catalog                   **/
+/**                                                                      **/
+
+typedef struct tiffCatalogEntry
+{
+	long long timeUs;
+	unsigned int file;
+	unsigned int pad;
+} tiffCatalogEntry;
+
+
+/**                                                                      **/
+/**  Loaded catalog                                                      **/
+/**                                                                      **/
+/**  base, size                                                          **/
+/**      the mapped file                                                 **/
+/**  header, entries, files, strings                                     **/
+/**      parts of the file; files holds the offset of the name of each   **/
+/**      file in strings                                                 **/
+/**                                                                      **/
+
+typedef struct tiffCatalog
+{
+	unsigned char *base;
+	size_t size;
+	const tiffCatalogHeader *header;
+	const tiffCatalogEntry *entries;
+	const unsigned long long *files;
+	const char *strings;
+} tiffCatalog;
+
+
+/**                                                                      **/
+/**  Catalog being built                                                 **/
+/**                                                                      **/
+/**  lock                                                                **/
+/**      protects workers while workers start                            **/
+/**  workers                                                             **/
+/**      list of the times and names collected by each worker            **/
+/**                                                                      **/
+
+typedef struct tiffCatalogBuild
+{
+	pthread_mutex_t lock;
+	struct catalogWorker *workers;
+} tiffCatalogBuild;
+
+
+/**                                                                      **/
+/**  Catalog API function declarations                                   **/
+/**                                                                      **/
+
+int tiffCatalogParseTime(const char *text, long long *timeUs);
+void tiffCatalogFormatTime(long long timeUs, char *text);
+int tiffCatalogTag(const char *name);
+void tiffCatalogInit(tiffCatalogBuild *build);
+void *tiffCatalogWorker(tiffCatalogBuild *build);
+int tiffCatalogFile(void *worker, const char *filename,
+	internalStruct *internal);
+int tiffCatalogSave(const tiffCatalogBuild *build, const char *filename,
+	tiffCatalogHeader *header);
+void tiffCatalogBuildFree(tiffCatalogBuild *build);
+int tiffCatalogLoad(const char *filename, tiffCatalog *catalog);
+void tiffCatalogFree(tiffCatalog *catalog);
+unsigned int tiffCatalogRange(const tiffCatalog *catalog, int tag,
+	long long fromUs, long long toUs, unsigned int *first);
+const char *tiffCatalogPath(const tiffCatalog *catalog,
+	const tiffCatalogEntry *entry);
+int tiffCatalogMain(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,738 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Checkpoints of batch runs.                                         **/
+/**                                                                      **/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "tiff_stats.h"
+#include "tiff_checkpoint.h"
+
+
+/**                                                                      **/
+/**  First line of a journal                                             **/
+/**                                                                      **/
+
+#define CHECKPOINT_MAGIC "tiff_metadata checkpoint 1"
+
+
+/**                                                                      **/
+/**   Function: checkpointPutName                                        **/
+/**                                                                      **/
+/**   Write a file name followed by a newline, escaping backslashes and  **/
+/**   newlines.                                                          **/
+/**                                                                      **/
+
+static void checkpointPutName(FILE *fp, const char *name)
+{
+	for(;*name != '\0';name++)
+	{
+		if(*name == '\\')
+		{
+			fputs("\\\\", fp);
+		}
+		else if(*name == '\n')
+		{
+			fputs("\\n", fp);
+		}
+		else
+		{
+			fputc(*name, fp);
+		}
+	}
+	fputc('\n', fp);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointGetName                                        **/
+/**                                                                      **/
+/**   Undo the escapes of checkpointPutName in place. Returns name.      **/
+/**                                                                      **/
+
+static char *checkpointGetName(char *name)
+{
+	char *from;
+	char *to;
+
+	for(from = to = name;*from != '\0';from++)
+	{
+		if( (*from == '\\') && (from[1] != '\0') )
+		{
+			from++;
+			*to++ = (*from == 'n') ? '\n' : *from;
+		}
+		else
+		{
+			*to++ = *from;
+		}
+	}
+	*to = '\0';
+
+	return name;
+}
+
+
+/**                                                                      **/
+/**   Function: compareNames                                             **/
+/**                                                                      **/
+/**   qsort and bsearch comparison function of file names.               **/
+/**                                                                      **/
+
+static int compareNames(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointBefore                                         **/
+/**                                                                      **/
+/**   Tell whether a file, or every file below a directory, comes no     **/
+/**   later than the cursor in walk order. Walks sort the names of each  **/
+/**   directory with strcmp, so paths compare component by component,    **/
+/**   the end of a component coming before any character.                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   path    -- file or directory name                                  **/
+/**   cursor  -- cursor file name, from the same path of the run         **/
+/**   isDir   -- 1 if path is a directory                                **/
+/**                                                                      **/
+
+static int checkpointBefore(const char *path, const char *cursor, int isDir)
+{
+	unsigned int a;
+	unsigned int b;
+	size_t i = 0;
+
+	while( (path[i] != '\0') && (path[i] == cursor[i]) )
+	{
+		i++;
+	}
+
+	if(path[i] == '\0')
+	{
+		/* A directory holding the cursor is not finished */
+		if(cursor[i] == '\0')
+		{
+			return !isDir;
+		}
+
+		return cursor[i] != '/';
+	}
+	if(cursor[i] == '\0')
+	{
+		return 0;
+	}
+
+	a = (path[i] == '/') ? 0 : (unsigned char)path[i];
+	b = (cursor[i] == '/') ? 0 : (unsigned char)cursor[i];
+
+	return a < b;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointPush                                           **/
+/**                                                                      **/
+/**   Append a file to the entries. Takes ownership of path. Returns 0   **/
+/**   on success, 1 if memory runs out.                                  **/
+/**                                                                      **/
+
+static int checkpointPush(tiffCheckpoint *cp, const char *key, char *path,
+	int root, int done)
+{
+	tiffCheckpointEntry *entries;
+	tiffCheckpointEntry *entry;
+	unsigned int size;
+
+	if(path == NULL)
+	{
+		return 1;
+	}
+
+	if(cp->first + cp->count == cp->size)
+	{
+		if(cp->first > 0)
+		{
+			memmove(cp->entries, cp->entries + cp->first,
+				cp->count * sizeof(*cp->entries) );
+			cp->first = 0;
+		}
+		else
+		{
+			size = (cp->size > 0) ? cp->size * 2 : 64;
+			entries = (tiffCheckpointEntry *)realloc(cp->entries,
+				size * sizeof(*entries) );
+			if(entries == NULL)
+			{
+				free(path);
+
+				return 1;
+			}
+			cp->entries = entries;
+			cp->size = size;
+		}
+	}
+
+	entry = &cp->entries[cp->first + cp->count];
+	entry->key = key;
+	entry->path = path;
+	entry->root = root;
+	entry->done = done;
+	cp->count++;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointAdvance                                        **/
+/**                                                                      **/
+/**   Move the cursor past the files done in walk order.                 **/
+/**                                                                      **/
+
+static void checkpointAdvance(tiffCheckpoint *cp)
+{
+	tiffCheckpointEntry *entry;
+
+	while( (cp->count > 0) && cp->entries[cp->first].done)
+	{
+		entry = &cp->entries[cp->first];
+		free(cp->cursor);
+		cp->cursor = entry->path;
+		cp->cursorRoot = entry->root;
+		cp->first++;
+		cp->count--;
+	}
+	if(cp->count == 0)
+	{
+		cp->first = 0;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointWrite                                          **/
+/**                                                                      **/
+/**   Flush and sync the output, then append a block to the journal and  **/
+/**   sync it. Called with the lock held and no output being written.    **/
+/**                                                                      **/
+
+static void checkpointWrite(tiffCheckpoint *cp)
+{
+	tiffCheckpointEntry *entry;
+	struct stat st;
+	off_t offset;
+	unsigned int i;
+
+	if(cp->failed)
+	{
+		return;
+	}
+
+	fflush(stdout);
+	if( (fstat(STDOUT_FILENO, &st) == 0) && S_ISREG(st.st_mode) )
+	{
+		fsync(STDOUT_FILENO);
+	}
+	offset = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+
+	if(cp->cursor != NULL)
+	{
+		fprintf(cp->journal, "C %d ", cp->cursorRoot);
+		checkpointPutName(cp->journal, cp->cursor);
+	}
+	for(i = 0;i < cp->count;i++)
+	{
+		entry = &cp->entries[cp->first + i];
+		if(entry->done)
+		{
+			fputs("F ", cp->journal);
+			checkpointPutName(cp->journal, entry->path);
+		}
+	}
+	fprintf(cp->journal, "O %lld %llu\n", (long long)offset, cp->files);
+
+	if( (fflush(cp->journal) != 0) || (fsync(fileno(cp->journal) ) != 0) )
+	{
+		fprintf(stderr, "can't write checkpoint %s: %s\n", cp->filename,
+			strerror(errno) );
+		cp->failed = 1;
+	}
+	cp->lastNs = tiffStatsClock();
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointFree                                           **/
+/**                                                                      **/
+/**   Close the journal, if open, and free everything cp holds.          **/
+/**                                                                      **/
+
+static void checkpointFree(tiffCheckpoint *cp)
+{
+	unsigned int i;
+
+	if(cp->journal != NULL)
+	{
+		fclose(cp->journal);
+	}
+	for(i = 0;i < cp->numResumeFiles;i++)
+	{
+		free(cp->resumeFiles[i]);
+	}
+	free(cp->resumeFiles);
+	free(cp->resumeCursor);
+	for(i = 0;i < cp->count;i++)
+	{
+		free(cp->entries[cp->first + i].path);
+	}
+	free(cp->entries);
+	free(cp->cursor);
+	free(cp->filename);
+	pthread_mutex_destroy(&cp->lock);
+	memset(cp, 0, sizeof(*cp) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointLoad                                           **/
+/**                                                                      **/
+/**   Read a journal up to its last complete block, check it was written **/
+/**   for the same paths, and cut off what follows. Returns 0 on         **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cp        -- checkpoint with the journal open for update           **/
+/**   paths     -- paths of the run                                      **/
+/**   numPaths  -- number of paths                                       **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   offset    -- output size at the checkpoint, -1 if unknown or none  **/
+/**                                                                      **/
+
+static int checkpointLoad(tiffCheckpoint *cp, char *const paths[],
+	int numPaths, long long *offset)
+{
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t length;
+	off_t good = 0;
+	char *blockCursor = NULL;
+	char **blockFiles = NULL;
+	char **files;
+	unsigned int numBlockFiles = 0;
+	unsigned int maxBlockFiles = 0;
+	unsigned long long done;
+	long long size;
+	int blockRoot = -1;
+	int numRoots = 0;
+	int status = 0;
+	char *end;
+	unsigned int i;
+
+	*offset = -1;
+	length = getline(&line, &capacity, cp->journal);
+	if( (length < 0) || (strcmp(line, CHECKPOINT_MAGIC "\n") != 0) )
+	{
+		fprintf(stderr, "%s is not a checkpoint journal\n", cp->filename);
+		free(line);
+
+		return 1;
+	}
+	good = ftello(cp->journal);
+
+	while( (length = getline(&line, &capacity, cp->journal) ) > 0)
+	{
+		/* A line cut short ends the journal */
+		if( (line[length - 1] != '\n') || (length < 3) || (line[1] != ' ') )
+		{
+			break;
+		}
+		line[length - 1] = '\0';
+
+		if(line[0] == 'P')
+		{
+			if( (numRoots >= numPaths) ||
+				(strcmp(checkpointGetName(line + 2), paths[numRoots]) != 0) )
+			{
+				status = 1;
+				break;
+			}
+			numRoots++;
+			good = ftello(cp->journal);
+		}
+		else if(line[0] == 'C')
+		{
+			blockRoot = (int)strtol(line + 2, &end, 10);
+			if(*end != ' ')
+			{
+				break;
+			}
+			free(blockCursor);
+			blockCursor = strdup(checkpointGetName(end + 1) );
+		}
+		else if(line[0] == 'F')
+		{
+			if(numBlockFiles == maxBlockFiles)
+			{
+				maxBlockFiles = (maxBlockFiles > 0) ? maxBlockFiles * 2 : 64;
+				files = (char **)realloc(blockFiles,
+					maxBlockFiles * sizeof(*files) );
+				if(files == NULL)
+				{
+					break;
+				}
+				blockFiles = files;
+			}
+			blockFiles[numBlockFiles] = strdup(checkpointGetName(line + 2) );
+			if(blockFiles[numBlockFiles] != NULL)
+			{
+				numBlockFiles++;
+			}
+		}
+		else if( (line[0] == 'O') &&
+			(sscanf(line + 2, "%lld %llu", &size, &done) == 2) )
+		{
+			for(i = 0;i < cp->numResumeFiles;i++)
+			{
+				free(cp->resumeFiles[i]);
+			}
+			free(cp->resumeFiles);
+			free(cp->resumeCursor);
+			cp->resumeRoot = blockRoot;
+			cp->resumeCursor = blockCursor;
+			cp->resumeFiles = blockFiles;
+			cp->numResumeFiles = numBlockFiles;
+			cp->files = done;
+			*offset = size;
+			blockCursor = NULL;
+			blockFiles = NULL;
+			numBlockFiles = 0;
+			maxBlockFiles = 0;
+			good = ftello(cp->journal);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	free(line);
+	free(blockCursor);
+	for(i = 0;i < numBlockFiles;i++)
+	{
+		free(blockFiles[i]);
+	}
+	free(blockFiles);
+
+	if( (status != 0) || (numRoots != numPaths) )
+	{
+		fprintf(stderr, "%s was written for other paths\n", cp->filename);
+
+		return 1;
+	}
+
+	if(cp->numResumeFiles > 0)
+	{
+		qsort(cp->resumeFiles, cp->numResumeFiles,
+			sizeof(*cp->resumeFiles), compareNames);
+	}
+	if( (ftruncate(fileno(cp->journal), good) != 0) ||
+		(fseeko(cp->journal, good, SEEK_SET) != 0) )
+	{
+		fprintf(stderr, "%s: %s\n", cp->filename, strerror(errno) );
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: checkpointTruncateOutput                                 **/
+/**                                                                      **/
+/**   Cut a regular file on stdout back to its size at the checkpoint.   **/
+/**   Returns 0 on success, 1 if it is shorter than that, unless empty.  **/
+/**                                                                      **/
+
+static int checkpointTruncateOutput(tiffCheckpoint *cp, long long offset)
+{
+	struct stat st;
+
+	if( (offset < 0) || (fstat(STDOUT_FILENO, &st) != 0) ||
+		!S_ISREG(st.st_mode) || (st.st_size == 0) )
+	{
+		return 0;
+	}
+	if(st.st_size < offset)
+	{
+		fprintf(stderr, "output is shorter than at the checkpoint of %s\n",
+			cp->filename);
+
+		return 1;
+	}
+	if( (ftruncate(STDOUT_FILENO, offset) != 0) ||
+		(lseek(STDOUT_FILENO, 0, SEEK_END) < 0) )
+	{
+		fprintf(stderr, "can't truncate output: %s\n", strerror(errno) );
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCheckpointOpen                                       **/
+/**                                                                      **/
+/**   Start a new journal, or resume from the last checkpoint of an      **/
+/**   existing one, truncating output appended to a regular file to its  **/
+/**   size at that checkpoint. Returns 0 on success, 1 on failure.       **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cp        -- checkpoint                                            **/
+/**   filename  -- journal file name                                     **/
+/**   resume    -- 1 to resume                                           **/
+/**   paths     -- paths of the run                                      **/
+/**   numPaths  -- number of paths                                       **/
+/**                                                                      **/
+
+int tiffCheckpointOpen(tiffCheckpoint *cp, const char *filename,
+	int resume, char *const paths[], int numPaths)
+{
+	long long offset;
+	int i;
+
+	memset(cp, 0, sizeof(*cp) );
+	pthread_mutex_init(&cp->lock, NULL);
+	cp->resumeRoot = -1;
+	cp->cursorRoot = -1;
+	cp->intervalNs = TIFF_CHECKPOINT_INTERVAL_S * 1000000000ULL;
+	cp->lastNs = tiffStatsClock();
+	cp->filename = strdup(filename);
+	if(cp->filename == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+		checkpointFree(cp);
+
+		return 1;
+	}
+
+	cp->journal = fopen(filename, resume ? "r+" : "w");
+	if(cp->journal == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+		checkpointFree(cp);
+
+		return 1;
+	}
+
+	if(resume)
+	{
+		if( (checkpointLoad(cp, paths, numPaths, &offset) != 0) ||
+			(checkpointTruncateOutput(cp, offset) != 0) )
+		{
+			checkpointFree(cp);
+
+			return 1;
+		}
+		if(cp->resumeCursor != NULL)
+		{
+			cp->cursor = strdup(cp->resumeCursor);
+			cp->cursorRoot = cp->resumeRoot;
+		}
+		fprintf(stderr, "resuming %s after %llu files\n", filename,
+			cp->files);
+
+		return 0;
+	}
+
+	fprintf(cp->journal, "%s\n", CHECKPOINT_MAGIC);
+	for(i = 0;i < numPaths;i++)
+	{
+		fputs("P ", cp->journal);
+		checkpointPutName(cp->journal, paths[i]);
+	}
+	if( (fflush(cp->journal) != 0) || (fsync(fileno(cp->journal) ) != 0) )
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+		checkpointFree(cp);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCheckpointClose                                      **/
+/**                                                                      **/
+/**   Take a last checkpoint and close the journal. Returns 0 on         **/
+/**   success, 1 if the journal could not be written.                    **/
+/**                                                                      **/
+
+int tiffCheckpointClose(tiffCheckpoint *cp)
+{
+	int status;
+
+	pthread_mutex_lock(&cp->lock);
+	checkpointWrite(cp);
+	pthread_mutex_unlock(&cp->lock);
+	status = cp->failed;
+	if(fclose(cp->journal) != 0)
+	{
+		status = 1;
+	}
+	cp->journal = NULL;
+	checkpointFree(cp);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCheckpointSkip                                       **/
+/**                                                                      **/
+/**   Tell whether a file or directory was done before the run resumed.  **/
+/**   Called by the producer in walk order, before tiffCheckpointBegin   **/
+/**   for the files that are not skipped.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cp     -- checkpoint                                               **/
+/**   root   -- index of the path of the run path comes from             **/
+/**   path   -- file or directory name                                   **/
+/**   isDir  -- 1 if path is a directory                                 **/
+/**                                                                      **/
+
+int tiffCheckpointSkip(tiffCheckpoint *cp, int root, const char *path,
+	int isDir)
+{
+	if( (cp->resumeCursor != NULL) && ( (root < cp->resumeRoot) ||
+		( (root == cp->resumeRoot) &&
+		checkpointBefore(path, cp->resumeCursor, isDir) ) ) )
+	{
+		return 1;
+	}
+
+	if(isDir || (cp->numResumeFiles == 0) ||
+		(bsearch(&path, cp->resumeFiles, cp->numResumeFiles,
+		sizeof(*cp->resumeFiles), compareNames) == NULL) )
+	{
+		return 0;
+	}
+
+	/* Keep listing it until the cursor passes it */
+	pthread_mutex_lock(&cp->lock);
+	if(checkpointPush(cp, NULL, strdup(path), root, 1) != 0)
+	{
+		cp->failed = 1;
+	}
+	checkpointAdvance(cp);
+	pthread_mutex_unlock(&cp->lock);
+
+	return 1;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCheckpointBegin                                      **/
+/**                                                                      **/
+/**   Record a file handed to the workers, in walk order. path must stay **/
+/**   allocated until tiffCheckpointDone is called with it.              **/
+/**                                                                      **/
+
+void tiffCheckpointBegin(tiffCheckpoint *cp, int root, const char *path)
+{
+	pthread_mutex_lock(&cp->lock);
+	if(checkpointPush(cp, path, strdup(path), root, 0) != 0)
+	{
+		if(!cp->failed)
+		{
+			fprintf(stderr, "can't alloc buffer, checkpoints stopped\n");
+		}
+		cp->failed = 1;
+	}
+	pthread_mutex_unlock(&cp->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCheckpointDone                                       **/
+/**                                                                      **/
+/**   Record that the output of a file was written, taking a checkpoint  **/
+/**   when the interval elapsed. Called with the same path as            **/
+/**   tiffCheckpointBegin, while no other output is being written.       **/
+/**                                                                      **/
+
+void tiffCheckpointDone(tiffCheckpoint *cp, const char *path)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&cp->lock);
+	for(i = 0;i < cp->count;i++)
+	{
+		if( (cp->entries[cp->first + i].key == path) &&
+			!cp->entries[cp->first + i].done)
+		{
+			cp->entries[cp->first + i].done = 1;
+			cp->files++;
+			break;
+		}
+	}
+	checkpointAdvance(cp);
+	if(tiffStatsClock() - cp->lastNs >= cp->intervalNs)
+	{
+		checkpointWrite(cp);
+	}
+	pthread_mutex_unlock(&cp->lock);
+
+	return;
+}
@@ -0,0 +1,155 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Checkpoints of batch runs, so that an interrupted scan resumes     **/
+/**   where it stopped.                                                  **/
+/**                                                                      **/
+/**   Batch runs walk their paths in a fixed order (the paths as given,  **/
+/**   directories in name order), so progress is a cursor: the last file **/
+/**   in walk order such that it and every file before it are done.      **/
+/**   Worker threads finish files out of order, so the files done past   **/
+/**   the cursor are listed as well; there are at most about as many     **/
+/**   as the batch queue holds.                                          **/
+/**                                                                      **/
+/**   The journal is a text file starting with the paths of the run,     **/
+/**   followed by one block per checkpoint:                              **/
+/**                                                                      **/
+/**       tiff_metadata checkpoint 1                                     **/
+/**       P archive                                                      **/
+/**       C 0 archive/2019/07/img_0412.tif                               **/
+/**       F archive/2019/07/img_0415.tif                                 **/
+/**       O 73400320 18342                                               **/
+/**                                                                      **/
+/**   C is the index of the path the cursor file came from and the       **/
+/**   cursor, F a file done past it, O the size of the output and the    **/
+/**   number of files done. File names escape backslash and newline. A   **/
+/**   block is written every interval with the files whose output was    **/
+/**   written, after the output is flushed and synced, and is itself     **/
+/**   synced; a block cut short by a crash lacks its O line and is       **/
+/**   ignored.                                                           **/
+/**                                                                      **/
+/**   On resume the last complete block is loaded. Directories entirely  **/
+/**   before the cursor are not even read, files before it and those     **/
+/**   listed are skipped, and output appended to a regular file is       **/
+/**   truncated back to the size it had at the checkpoint, so the output **/
+/**   of files done after it appears once.                               **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_CHECKPOINT_H
+#define _TIFF_CHECKPOINT_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+
+/**                                                                      **/
+/**  Default time between checkpoints                                    **/
+/**                                                                      **/
+
+#define TIFF_CHECKPOINT_INTERVAL_S 10
+
+
+/**                                                                      **/
+/**  File handed to the workers, in walk order                           **/
+/**                                                                      **/
+/**  key                                                                 **/
+/**      the path as queued, identifying the file until it is done, or   **/
+/**      NULL for files skipped on resume                                **/
+/**  path, root                                                          **/
+/**      file name, and index of the path it came from                   **/
+/**  done                                                                **/
+/**      1 once its output was written                                   **/
+/**                                                                      **/
+
+typedef struct tiffCheckpointEntry
+{
+	const char *key;
+	char *path;
+	int root;
+	int done;
+} tiffCheckpointEntry;
+
+
+/**                                                                      **/
+/**  Checkpoint journal of a batch run                                   **/
+/**                                                                      **/
+/**  journal, filename                                                   **/
+/**      journal stream and name                                         **/
+/**  intervalNs, lastNs                                                  **/
+/**      time between checkpoints and time of the last one               **/
+/**  lock                                                                **/
+/**      protects the fields below against the producer and workers      **/
+/**  resumeRoot, resumeCursor                                            **/
+/**      cursor loaded on resume, resumeCursor NULL if none              **/
+/**  resumeFiles, numResumeFiles                                         **/
+/**      sorted names of the files done past it                          **/
+/**  entries, first, count, size                                         **/
+/**      files not yet passed by the cursor, from entries[first] on      **/
+/**  cursorRoot, cursor                                                  **/
+/**      current cursor, cursor NULL if none                             **/
+/**  files                                                               **/
+/**      number of files done, including those of previous runs          **/
+/**  failed                                                              **/
+/**      1 once the journal could not be written; no more checkpoints    **/
+/**      are taken                                                       **/
+/**                                                                      **/
+
+typedef struct tiffCheckpoint
+{
+	FILE *journal;
+	char *filename;
+	unsigned long long intervalNs;
+	unsigned long long lastNs;
+	pthread_mutex_t lock;
+	int resumeRoot;
+	char *resumeCursor;
+	char **resumeFiles;
+	unsigned int numResumeFiles;
+	tiffCheckpointEntry *entries;
+	unsigned int first;
+	unsigned int count;
+	unsigned int size;
+	int cursorRoot;
+	char *cursor;
+	unsigned long long files;
+	int failed;
+} tiffCheckpoint;
+
+
+/**                                                                      **/
+/**  Checkpoint API function declarations                                **/
+/**                                                                      **/
+
+int tiffCheckpointOpen(tiffCheckpoint *cp, const char *filename,
+	int resume, char *const paths[], int numPaths);
+int tiffCheckpointClose(tiffCheckpoint *cp);
+int tiffCheckpointSkip(tiffCheckpoint *cp, int root, const char *path,
+	int isDir);
+void tiffCheckpointBegin(tiffCheckpoint *cp, int root, const char *path);
+void tiffCheckpointDone(tiffCheckpoint *cp, const char *path);
+
+#endif
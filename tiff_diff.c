@@ -0,0 +1,425 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Metadata diff between files.                                       **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <getopt.h>
+#include <pthread.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_batch.h"
+#include "tiff_model.h"
+#include "tiff_diff.h"
+
+
+/**                                                                      **/
+/**  State of one diff: output, file names and number of differences     **/
+/**  found so far. The file names are printed before the first one.      **/
+/**                                                                      **/
+
+typedef struct diffCtx
+{
+	const internalStruct *internal;
+	const char *nameA;
+	const char *nameB;
+	unsigned int count;
+} diffCtx;
+
+
+/**                                                                      **/
+/**  Baseline shared by the workers of a batch diff                      **/
+/**                                                                      **/
+/**  model, name                                                         **/
+/**      parsed baseline and its file name                               **/
+/**  lock                                                                **/
+/**      protects differing                                              **/
+/**  differing                                                           **/
+/**      number of files differing from the baseline                     **/
+/**                                                                      **/
+
+typedef struct diffBaseline
+{
+	const tiffModel *model;
+	const char *name;
+	pthread_mutex_t lock;
+	unsigned int differing;
+} diffBaseline;
+
+
+/**                                                                      **/
+/**   Function: diffBegin                                                **/
+/**                                                                      **/
+/**   Count one difference and start the line reporting it.              **/
+/**                                                                      **/
+
+static void diffBegin(diffCtx *ctx, const tiffModelIFD *ifd)
+{
+	if(ctx->count++ == 0)
+	{
+		tiffPrintf(ctx->internal, "--- %s\n+++ %s\n", ctx->nameA,
+			ctx->nameB);
+	}
+	tiffModelPrintIFDName(ctx->internal, ifd);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: diffEntry                                                **/
+/**                                                                      **/
+/**   Report an entry present in only one file (a or b is NULL) or       **/
+/**   present in both with a different value.                            **/
+/**                                                                      **/
+
+static void diffEntry(diffCtx *ctx, const tiffModelIFD *ifd,
+	const tiffModelEntry *a, const tiffModelEntry *b)
+{
+	const tiffModelEntry *e = (a != NULL) ? a : b;
+
+	if( (a != NULL) && (b != NULL) && (a->fieldType == b->fieldType) &&
+		(a->count == b->count) &&
+		(memcmp(a->hash, b->hash, sizeof(a->hash) ) == 0) )
+	{
+		return;
+	}
+
+	diffBegin(ctx, ifd);
+	tiffPrintf(ctx->internal, " %s (%d) %s\n", getTagDescriptor(e->tag),
+		e->tag, (a == NULL) ? "added" : (b == NULL) ? "removed" :
+		"changed");
+
+	if(a != NULL)
+	{
+		tiffPrintf(ctx->internal, "\t- ");
+		tiffModelPrintValue(ctx->internal, a);
+		tiffPrintf(ctx->internal, "\n");
+	}
+	if(b != NULL)
+	{
+		tiffPrintf(ctx->internal, "\t+ ");
+		tiffModelPrintValue(ctx->internal, b);
+		tiffPrintf(ctx->internal, "\n");
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: diffIFD                                                  **/
+/**                                                                      **/
+/**   Compare two IFDs holding the same position in both files. Both     **/
+/**   entry lists are sorted by tag, so they are merged in one pass.     **/
+/**                                                                      **/
+
+static void diffIFD(diffCtx *ctx, const tiffModelIFD *a,
+	const tiffModelIFD *b)
+{
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	while( (i < a->numEntries) || (j < b->numEntries) )
+	{
+		if( (j == b->numEntries) || ( (i < a->numEntries) &&
+			(a->entries[i].tag < b->entries[j].tag) ) )
+		{
+			diffEntry(ctx, a, &a->entries[i++], NULL);
+		}
+		else if( (i == a->numEntries) ||
+			(b->entries[j].tag < a->entries[i].tag) )
+		{
+			diffEntry(ctx, b, NULL, &b->entries[j++]);
+		}
+		else
+		{
+			diffEntry(ctx, a, &a->entries[i++], &b->entries[j++]);
+		}
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: compareIFDs                                              **/
+/**                                                                      **/
+/**   Order IFDs as the walker visits them: main chain, then Exif.       **/
+/**                                                                      **/
+
+static int compareIFDs(const tiffModelIFD *a, const tiffModelIFD *b)
+{
+	if(a->kind != b->kind)
+	{
+		return (a->kind < b->kind) ? -1 : 1;
+	}
+
+	return (a->index < b->index) ? -1 : (a->index > b->index);
+}
+
+
+/**                                                                      **/
+/**   Function: tiffDiffModels                                           **/
+/**                                                                      **/
+/**   Print the differences between two models and return their          **/
+/**   number. Nothing is printed when the models are the same.           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   a, nameA  -- first model and its file name                         **/
+/**   b, nameB  -- second model and its file name                        **/
+/**   internal  -- struct containing the output stream                   **/
+/**                                                                      **/
+
+unsigned int tiffDiffModels(const tiffModel *a, const char *nameA,
+	const tiffModel *b, const char *nameB, const internalStruct *internal)
+{
+	diffCtx ctx;
+	unsigned int i = 0;
+	unsigned int j = 0;
+	int order;
+	tiffPhase_t phase;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+
+	ctx.internal = internal;
+	ctx.nameA = nameA;
+	ctx.nameB = nameB;
+	ctx.count = 0;
+
+	while( (i < a->numIFDs) || (j < b->numIFDs) )
+	{
+		if(j == b->numIFDs)
+		{
+			order = -1;
+		}
+		else if(i == a->numIFDs)
+		{
+			order = 1;
+		}
+		else
+		{
+			order = compareIFDs(&a->ifds[i], &b->ifds[j]);
+		}
+
+		if(order < 0)
+		{
+			diffBegin(&ctx, &a->ifds[i]);
+			tiffPrintf(internal, " removed (%u entries)\n",
+				a->ifds[i++].numEntries);
+		}
+		else if(order > 0)
+		{
+			diffBegin(&ctx, &b->ifds[j]);
+			tiffPrintf(internal, " added (%u entries)\n",
+				b->ifds[j++].numEntries);
+		}
+		else
+		{
+			diffIFD(&ctx, &a->ifds[i++], &b->ifds[j++]);
+		}
+	}
+
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return ctx.count;
+}
+
+
+/**                                                                      **/
+/**   Function: diffFile                                                 **/
+/**                                                                      **/
+/**   tiffBatchFunc comparing one file with the baseline.                **/
+/**                                                                      **/
+
+static int diffFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	diffBaseline *baseline = (diffBaseline *)arg;
+	tiffModel model;
+
+	if(tiffModelLoad(filename, internal, &model) != 0)
+	{
+		return 1;
+	}
+
+	if(tiffDiffModels(baseline->model, baseline->name, &model, filename,
+		internal) != 0)
+	{
+		pthread_mutex_lock(&baseline->lock);
+		baseline->differing++;
+		pthread_mutex_unlock(&baseline->lock);
+	}
+
+	tiffModelFree(&model);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: usage                                                    **/
+/**                                                                      **/
+/**   Print the diff command line usage.                                 **/
+/**                                                                      **/
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tiff_metadata diff fileA fileB\n"
+		"       tiff_metadata diff --baseline file [-j jobs] "
+		"tiffFile|directory ...\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffDiffMain                                             **/
+/**                                                                      **/
+/**   Main function of the diff subcommand. Like diff(1), returns 0 when **/
+/**   the files are the same, 1 when they differ and 2 on failure.       **/
+/**                                                                      **/
+/**   Usage:                                                             **/
+/**   tiff_metadata diff fileA fileB                                     **/
+/**   tiff_metadata diff --baseline file [-j jobs] tiffFile|directory ...**/
+/**                                                                      **/
+/**   -b, --baseline file -- compare every file with file, which is      **/
+/**                          parsed only once                            **/
+/**   -j, --jobs N        -- compare files with N worker threads         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   argc       -- argument count, argv[0] being "diff"                 **/
+/**   argv       -- argument vector                                      **/
+/**                                                                      **/
+
+int tiffDiffMain(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "baseline", required_argument, NULL, 'b', },
+		{ "jobs", required_argument, NULL, 'j', },
+		{ NULL, 0, NULL, 0, },
+	};
+	internalStruct internal;
+	tiffModel a;
+	tiffModel b;
+	diffBaseline baseline;
+	tiffBatch batch;
+	const char *baselineName = NULL;
+	int jobs = 1;
+	int status;
+	char *end;
+	int c;
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "b:j:", longOptions, NULL)) != -1)
+	{
+		switch(c)
+		{
+			case 'b':
+			{
+				baselineName = optarg;
+				break;
+			}
+			case 'j':
+			{
+				jobs = (int)strtol(optarg, &end, 10);
+				if(*optarg == '\0' || *end != '\0' || jobs < 1)
+				{
+					usage();
+
+					return 2;
+				}
+				break;
+			}
+			default:
+			{
+				usage();
+
+				return 2;
+			}
+		}
+	}
+
+	if( (baselineName == NULL) ? (argc - optind != 2) : (optind >= argc) )
+	{
+		usage();
+
+		return 2;
+	}
+
+	tiffInitInternal(&internal);
+
+	if(baselineName == NULL)
+	{
+		if(tiffModelLoad(argv[optind], &internal, &a) != 0)
+		{
+			return 2;
+		}
+		tiffInitInternal(&internal);
+		if(tiffModelLoad(argv[optind + 1], &internal, &b) != 0)
+		{
+			tiffModelFree(&a);
+
+			return 2;
+		}
+
+		status = (tiffDiffModels(&a, argv[optind], &b, argv[optind + 1],
+			&internal) != 0) ? 1 : 0;
+
+		tiffModelFree(&a);
+		tiffModelFree(&b);
+
+		return status;
+	}
+
+	if(tiffModelLoad(baselineName, &internal, &a) != 0)
+	{
+		return 2;
+	}
+
+	baseline.model = &a;
+	baseline.name = baselineName;
+	baseline.differing = 0;
+	pthread_mutex_init(&baseline.lock, NULL);
+
+	tiffBatchInit(&batch, diffFile, &baseline);
+	batch.numThreads = jobs;
+	tiffBatchRun(&batch, argv + optind, argc - optind);
+
+	pthread_mutex_destroy(&baseline.lock);
+	tiffModelFree(&a);
+
+	if(batch.status != 0)
+	{
+		return 2;
+	}
+
+	return (baseline.differing != 0) ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Metadata diff between files.                                       **/
+/**                                                                      **/
+/**   Both files are loaded into the entry model (tiff_model.h). IFDs    **/
+/**   are matched by chain and position and entries by tag, so           **/
+/**   differences in file offsets or in the layout of the files are      **/
+/**   ignored.                                                           **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_DIFF_H
+#define _TIFF_DIFF_H
+
+#include "tiff_metadata.h"
+#include "tiff_model.h"
+
+
+/**                                                                      **/
+/**  Diff API function declarations                                      **/
+/**                                                                      **/
+
+unsigned int tiffDiffModels(const tiffModel *a, const char *nameA,
+	const tiffModel *b, const char *nameB, const internalStruct *internal);
+int tiffDiffMain(int argc, char *argv[]);
+
+#endif
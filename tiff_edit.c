@@ -0,0 +1,784 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   In-place editing of tag values.                                    **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <limits.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "tiff_metadata.h"
+#include "tiff_batch.h"
+#include "tiff_fingerprint.h"
+#include "tiff_edit.h"
+
+
+/**                                                                      **/
+/**  Entry to edit                                                       **/
+/**                                                                      **/
+/**  found                                                               **/
+/**      1 once the entry holding the tag has been walked                **/
+/**  entry                                                               **/
+/**      copy of the entry                                               **/
+/**  entryPos                                                            **/
+/**      position of the entry in the file                               **/
+/**                                                                      **/
+
+typedef struct editTarget
+{
+	int found;
+	tiffEntry entry;
+	unsigned long long entryPos;
+} editTarget;
+
+
+/**                                                                      **/
+/**  Walk state looking for the entries to edit                          **/
+/**                                                                      **/
+
+typedef struct editCtx
+{
+	const tiffEdit *edits;
+	unsigned int numEdits;
+	unsigned int numFound;
+	editTarget targets[TIFF_EDIT_MAX_EDITS];
+} editCtx;
+
+
+/**                                                                      **/
+/**  Writes applying the edits of a file                                 **/
+/**                                                                      **/
+/**  values, valueBytes, valuePos                                        **/
+/**      new value written outside its entry, its size and position;     **/
+/**      values[i] is NULL for inline values                             **/
+/**  entries                                                             **/
+/**      new entries, in file byte order                                 **/
+/**                                                                      **/
+
+typedef struct editPlan
+{
+	unsigned char *values[TIFF_EDIT_MAX_EDITS];
+	size_t valueBytes[TIFF_EDIT_MAX_EDITS];
+	unsigned long long valuePos[TIFF_EDIT_MAX_EDITS];
+	unsigned char entries[TIFF_EDIT_MAX_EDITS][12];
+} editPlan;
+
+
+/**                                                                      **/
+/**  Edits applied by the workers of a batch                             **/
+/**                                                                      **/
+
+typedef struct editBatch
+{
+	const tiffEdit *edits;
+	unsigned int numEdits;
+	int append;
+} editBatch;
+
+
+/**                                                                      **/
+/**   Function: tiffEditParse                                            **/
+/**                                                                      **/
+/**   Parse an edit written as Tag=value, the tag being a name or a      **/
+/**   number. Returns 0 on success, 1 on failure.                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   spec  -- edit text, which must outlive the edit                    **/
+/**   edit  -- edit to fill in                                           **/
+/**                                                                      **/
+
+int tiffEditParse(const char *spec, tiffEdit *edit)
+{
+	const char *equal;
+	char name[64];
+	char *end;
+	long tag;
+
+	equal = strchr(spec, '=');
+	if( (equal == NULL) || (equal == spec) ||
+		( (size_t)(equal - spec) >= sizeof(name) ) )
+	{
+		fprintf(stderr, "bad edit \"%s\": Tag=value expected\n", spec);
+
+		return 1;
+	}
+
+	memcpy(name, spec, (size_t)(equal - spec) );
+	name[equal - spec] = '\0';
+
+	tag = strtol(name, &end, 0);
+	if(*end != '\0')
+	{
+		tag = getTagNumber(name);
+	}
+	if( (tag < 0) || (tag > 0xffff) )
+	{
+		fprintf(stderr, "bad edit \"%s\": unknown tag %s\n", spec, name);
+
+		return 1;
+	}
+
+	if(tiffTagIsOffset( (unsigned short)tag) )
+	{
+		fprintf(stderr, "bad edit \"%s\": %s holds file offsets\n", spec,
+			name);
+
+		return 1;
+	}
+
+	edit->tag = (unsigned short)tag;
+	edit->text = equal + 1;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: encodeInteger                                            **/
+/**                                                                      **/
+/**   Parse an integer between min and max. Returns 0 on success, 1 on   **/
+/**   failure.                                                           **/
+/**                                                                      **/
+
+static int encodeInteger(const char **text, long long min, long long max,
+	long long *value)
+{
+	char *end;
+
+	*value = strtoll(*text, &end, 0);
+	if( (end == *text) || (*value < min) || (*value > max) )
+	{
+		return 1;
+	}
+	*text = end;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: encodeNumber                                             **/
+/**                                                                      **/
+/**   Parse one number of a numeric type and store it in file byte       **/
+/**   order. Returns 0 on success, 1 on failure.                         **/
+/**                                                                      **/
+
+static int encodeNumber(const internalStruct *internal,
+	unsigned short fieldType, const char **text, unsigned char *dst)
+{
+	long long value;
+	long long denominator = 1;
+	unsigned short us;
+	unsigned int ui[2];
+	unsigned int swap;
+	float f;
+	double d;
+	char *end;
+	int status = 0;
+
+	switch(fieldType)
+	{
+		case FT_BYTE:
+		case FT_SBYTE:
+		{
+			status = (fieldType == FT_BYTE) ?
+				encodeInteger(text, 0, UCHAR_MAX, &value) :
+				encodeInteger(text, SCHAR_MIN, SCHAR_MAX, &value);
+			dst[0] = (unsigned char)value;
+			break;
+		}
+		case FT_SHORT:
+		case FT_SSHORT:
+		{
+			status = (fieldType == FT_SHORT) ?
+				encodeInteger(text, 0, USHRT_MAX, &value) :
+				encodeInteger(text, SHRT_MIN, SHRT_MAX, &value);
+			us = cSwapUShort( (unsigned short)value, internal);
+			memcpy(dst, &us, sizeof(us) );
+			break;
+		}
+		case FT_LONG:
+		case FT_SLONG:
+		{
+			status = (fieldType == FT_LONG) ?
+				encodeInteger(text, 0, UINT_MAX, &value) :
+				encodeInteger(text, INT_MIN, INT_MAX, &value);
+			ui[0] = cSwapUInt( (unsigned int)value, internal);
+			memcpy(dst, ui, sizeof(ui[0]) );
+			break;
+		}
+		case FT_RATIONAL:
+		case FT_SRATIONAL:
+		{
+			status = (fieldType == FT_RATIONAL) ?
+				encodeInteger(text, 0, UINT_MAX, &value) :
+				encodeInteger(text, INT_MIN, INT_MAX, &value);
+			if( (status == 0) && (**text == '/') )
+			{
+				(*text)++;
+				status = (fieldType == FT_RATIONAL) ?
+					encodeInteger(text, 1, UINT_MAX, &denominator) :
+					encodeInteger(text, INT_MIN, INT_MAX, &denominator);
+			}
+			ui[0] = cSwapUInt( (unsigned int)value, internal);
+			ui[1] = cSwapUInt( (unsigned int)denominator, internal);
+			memcpy(dst, ui, sizeof(ui) );
+			break;
+		}
+		case FT_FLOAT:
+		{
+			f = strtof(*text, &end);
+			status = (end == *text);
+			*text = end;
+			f = cSwapFloat(f, internal);
+			memcpy(dst, &f, sizeof(f) );
+			break;
+		}
+		case FT_DOUBLE:
+		{
+			d = strtod(*text, &end);
+			status = (end == *text);
+			*text = end;
+
+			/* Swap each half, then the halves */
+			memcpy(ui, &d, sizeof(d) );
+			if(internal->machineEndian != internal->fileEndian)
+			{
+				swap = cSwapUInt(ui[0], internal);
+				ui[0] = cSwapUInt(ui[1], internal);
+				ui[1] = swap;
+			}
+			memcpy(dst, ui, sizeof(ui) );
+			break;
+		}
+		default:
+		{
+			return 1;
+		}
+	}
+
+	if( (status != 0) || ( (**text != '\0') && !isspace( (int)**text) ) )
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffEditEncode                                           **/
+/**                                                                      **/
+/**   Encode the new value of a tag in the byte order of the file.       **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal   -- struct holding the file byte order                   **/
+/**   fieldType  -- field type of the entry                              **/
+/**   text       -- new value, see tiffEdit                              **/
+/**   buffer     -- TIFF_EDIT_MAX_VALUE bytes receiving the value        **/
+/**   count      -- receives the number of values                        **/
+/**   numBytes   -- receives the number of bytes                         **/
+/**                                                                      **/
+
+int tiffEditEncode(const internalStruct *internal, unsigned short fieldType,
+	const char *text, unsigned char *buffer, unsigned int *count,
+	size_t *numBytes)
+{
+	size_t size;
+	size_t n;
+
+	/* Strings are kept as they are, ASCII with its NUL */
+	if( (fieldType == FT_ASCII) || (fieldType == FT_UNDEFINED) )
+	{
+		n = strlen(text) + (fieldType == FT_ASCII);
+		if( (n == 0) || (n > TIFF_EDIT_MAX_VALUE) )
+		{
+			return 1;
+		}
+		memcpy(buffer, text, n);
+		*count = (unsigned int)n;
+		*numBytes = n;
+
+		return 0;
+	}
+
+	if( (fieldType < FT_MIN) || (fieldType > FT_MAX) )
+	{
+		return 1;
+	}
+	size = getFieldTypeNumBytes( (fieldType_t)fieldType);
+
+	*count = 0;
+	while(1)
+	{
+		while(isspace( (int)*text) )
+		{
+			text++;
+		}
+		if(*text == '\0')
+		{
+			break;
+		}
+
+		if( ( (*count + 1) * size > TIFF_EDIT_MAX_VALUE) ||
+			(encodeNumber(internal, fieldType, &text,
+			buffer + *count * size) != 0) )
+		{
+			return 1;
+		}
+		(*count)++;
+	}
+	*numBytes = *count * size;
+
+	return (*count == 0);
+}
+
+
+/**                                                                      **/
+/**   Function: editEntry                                                **/
+/**                                                                      **/
+/**   Visitor entry callback remembering the first entry of each tag to  **/
+/**   edit, stopping once all are found.                                 **/
+/**                                                                      **/
+
+static tiffWalk_t editEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	editCtx *edit = (editCtx *)ctx;
+	editTarget *target;
+	unsigned int i;
+
+	for(i = 0;i < edit->numEdits;i++)
+	{
+		target = &edit->targets[i];
+		if( (edit->edits[i].tag == entry->tag) && !target->found)
+		{
+			target->found = 1;
+			target->entry = *entry;
+			target->entry.ifd = NULL;
+			target->entryPos = (unsigned long long)internal->tiffOffset +
+				entry->ifd->offset + 2 + 12ULL * entry->index;
+			edit->numFound++;
+		}
+	}
+
+	return (edit->numFound == edit->numEdits) ? TIFF_WALK_STOP :
+		TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: writeAt                                                  **/
+/**                                                                      **/
+/**   Write n bytes at a position. Returns 0 on success, 1 on failure.   **/
+/**                                                                      **/
+
+static int writeAt(int fd, const void *buffer, size_t n,
+	unsigned long long pos)
+{
+	ssize_t put;
+
+	while(n > 0)
+	{
+		put = pwrite(fd, buffer, n, (off_t)pos);
+		if(put <= 0)
+		{
+			return 1;
+		}
+		buffer = (const unsigned char *)buffer + put;
+		n -= (size_t)put;
+		pos += (unsigned long long)put;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: planEdits                                                **/
+/**                                                                      **/
+/**   Encode the new values of the found entries and choose where they   **/
+/**   go, filling in plan. Returns 0 on success, 1 on failure.           **/
+/**                                                                      **/
+
+static int planEdits(const char *filename, internalStruct *internal,
+	const editCtx *ctx, int append, unsigned long long end, editPlan *plan)
+{
+	const editTarget *target;
+	const tiffEdit *edit;
+	unsigned char buffer[TIFF_EDIT_MAX_VALUE];
+	unsigned char *entry;
+	unsigned short us;
+	unsigned int ui;
+	unsigned int count;
+	unsigned int i;
+	size_t n;
+
+	for(i = 0;i < ctx->numEdits;i++)
+	{
+		target = &ctx->targets[i];
+		edit = &ctx->edits[i];
+		entry = plan->entries[i];
+		if(!target->found)
+		{
+			fprintf(stderr, "%s: no %s (%u) tag to edit\n", filename,
+				getTagDescriptor(edit->tag), edit->tag);
+
+			return 1;
+		}
+
+		if(tiffEditEncode(internal, target->entry.fieldType, edit->text,
+			buffer, &count, &n) != 0)
+		{
+			fprintf(stderr, "%s: bad %s value for %s: %s\n", filename,
+				getTIFFTypeDesc( (fieldType_t)target->entry.fieldType),
+				getTagDescriptor(edit->tag), edit->text);
+
+			return 1;
+		}
+
+		us = cSwapUShort(target->entry.tag, internal);
+		memcpy(entry, &us, 2);
+		us = cSwapUShort(target->entry.fieldType, internal);
+		memcpy(entry + 2, &us, 2);
+		ui = cSwapUInt(count, internal);
+		memcpy(entry + 4, &ui, 4);
+
+		if(n <= 4)
+		{
+			memset(entry + 8, 0, 4);
+			memcpy(entry + 8, buffer, n);
+			continue;
+		}
+
+		if(!append && !target->entry.isInline &&
+			(n <= target->entry.totalBytes) )
+		{
+			plan->valuePos[i] = (unsigned long long)internal->tiffOffset +
+				target->entry.valueOffset;
+		}
+		else
+		{
+			/* Offsets are relative to the TIFF header, which for a
+			   JPEG sits inside a segment that can't grow */
+			if(internal->tiffOffset != 0)
+			{
+				fprintf(stderr, "%s: new %s value doesn't fit in place\n",
+					filename, getTagDescriptor(edit->tag) );
+
+				return 1;
+			}
+
+			/* Values start on a word boundary */
+			plan->valuePos[i] = (end + 1) & ~1ULL;
+			end = plan->valuePos[i] + n;
+			if(end > UINT_MAX)
+			{
+				fprintf(stderr, "%s: file too large to append to\n",
+					filename);
+
+				return 1;
+			}
+		}
+
+		ui = cSwapUInt(
+			(unsigned int)(plan->valuePos[i] - internal->tiffOffset),
+			internal);
+		memcpy(entry + 8, &ui, 4);
+
+		plan->values[i] = (unsigned char *)tiffMalloc(n, internal);
+		if(plan->values[i] == NULL)
+		{
+			return 1;
+		}
+		memcpy(plan->values[i], buffer, n);
+		plan->valueBytes[i] = n;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: writeEdits                                               **/
+/**                                                                      **/
+/**   Write the values of a plan, then the entries committing them.      **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+
+static int writeEdits(const char *filename, int fd, const editCtx *ctx,
+	const editPlan *plan)
+{
+	unsigned int i;
+
+	for(i = 0;i < ctx->numEdits;i++)
+	{
+		if( (plan->values[i] != NULL) && (writeAt(fd, plan->values[i],
+			plan->valueBytes[i], plan->valuePos[i]) != 0) )
+		{
+			fprintf(stderr, "can't write %s\n", filename);
+
+			return 1;
+		}
+	}
+	if(fdatasync(fd) != 0)
+	{
+		fprintf(stderr, "can't write %s\n", filename);
+
+		return 1;
+	}
+
+	for(i = 0;i < ctx->numEdits;i++)
+	{
+		if(writeAt(fd, plan->entries[i], 12, ctx->targets[i].entryPos) != 0)
+		{
+			fprintf(stderr, "can't write %s\n", filename);
+
+			return 1;
+		}
+	}
+	if(fdatasync(fd) != 0)
+	{
+		fprintf(stderr, "can't write %s\n", filename);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffEditFile                                             **/
+/**                                                                      **/
+/**   Apply edits to a file, as described in tiff_edit.h. Nothing is     **/
+/**   written unless every edited tag is found and every new value can   **/
+/**   be encoded. Returns 0 on success, 1 on failure.                    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**   edits     -- edits, with different tags                            **/
+/**   numEdits  -- number of edits, at most TIFF_EDIT_MAX_EDITS          **/
+/**   append    -- 1 to append values that don't fit inline rather       **/
+/**                than rewrite them in their old slot                   **/
+/**                                                                      **/
+
+int tiffEditFile(const char *filename, internalStruct *internal,
+	const tiffEdit *edits, unsigned int numEdits, int append)
+{
+	static const tiffVisitor visitor = { NULL, editEntry, NULL, };
+	editCtx ctx;
+	editPlan plan;
+	unsigned long long end;
+	unsigned int i;
+	tiffWalk_t walk;
+	int status;
+	int fd;
+
+	memset(&ctx, 0, sizeof(ctx) );
+	memset(&plan, 0, sizeof(plan) );
+	ctx.edits = edits;
+	ctx.numEdits = numEdits;
+
+	fd = open(filename, O_RDWR);
+	if(fd < 0)
+	{
+		fprintf(stderr, "can't open %s to write\n", filename);
+
+		return 1;
+	}
+	if( (flock(fd, LOCK_EX) != 0) || (tiffOpen(filename, internal) != 0) )
+	{
+		close(fd);
+
+		return 1;
+	}
+	walk = tiffWalkFile(filename, internal, &visitor, &ctx);
+	end = tiffFileSize(internal);
+	tiffClose(internal);
+
+	status = (walk == TIFF_WALK_ERROR) ||
+		(planEdits(filename, internal, &ctx, append, end, &plan) != 0) ||
+		(writeEdits(filename, fd, &ctx, &plan) != 0);
+
+	for(i = 0;i < numEdits;i++)
+	{
+		free(plan.values[i]);
+	}
+	close(fd);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: editFile                                                 **/
+/**                                                                      **/
+/**   tiffBatchFunc editing one file.                                    **/
+/**                                                                      **/
+
+static int editFile(const char *filename, internalStruct *internal,
+	void *arg)
+{
+	const editBatch *batch = (const editBatch *)arg;
+
+	return tiffEditFile(filename, internal, batch->edits, batch->numEdits,
+		batch->append);
+}
+
+
+/**                                                                      **/
+/**   Function: usage                                                    **/
+/**                                                                      **/
+/**   Print the edit command line usage.                                 **/
+/**                                                                      **/
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tiff_metadata edit --set Tag=value ... "
+		"[--append] [-j jobs]\n"
+		"           tiffFile|directory ...\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffEditMain                                             **/
+/**                                                                      **/
+/**   Main function of the edit subcommand. Returns 0 when every file    **/
+/**   was edited, 1 otherwise.                                           **/
+/**                                                                      **/
+/**   Usage:                                                             **/
+/**   tiff_metadata edit --set Tag=value ... [--append] [-j jobs]        **/
+/**       tiffFile|directory ...                                         **/
+/**                                                                      **/
+/**   -s, --set Tag=value -- change the value of a tag, see tiffEdit     **/
+/**   -a, --append        -- append values that don't fit inline         **/
+/**                          rather than rewrite them in place           **/
+/**   -j, --jobs N        -- edit files with N worker threads            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   argc       -- argument count, argv[0] being "edit"                 **/
+/**   argv       -- argument vector                                      **/
+/**                                                                      **/
+
+int tiffEditMain(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "set", required_argument, NULL, 's', },
+		{ "append", no_argument, NULL, 'a', },
+		{ "jobs", required_argument, NULL, 'j', },
+		{ NULL, 0, NULL, 0, },
+	};
+	tiffEdit edits[TIFF_EDIT_MAX_EDITS];
+	editBatch edit;
+	tiffBatch batch;
+	unsigned int i;
+	int jobs = 1;
+	char *end;
+	int c;
+
+	edit.edits = edits;
+	edit.numEdits = 0;
+	edit.append = 0;
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "s:aj:", longOptions, NULL)) != -1)
+	{
+		switch(c)
+		{
+			case 's':
+			{
+				if(edit.numEdits == TIFF_EDIT_MAX_EDITS)
+				{
+					fprintf(stderr, "too many edits\n");
+
+					return 1;
+				}
+				if(tiffEditParse(optarg, &edits[edit.numEdits]) != 0)
+				{
+					return 1;
+				}
+				for(i = 0;i < edit.numEdits;i++)
+				{
+					if(edits[i].tag == edits[edit.numEdits].tag)
+					{
+						fprintf(stderr, "%s edited twice\n",
+							getTagDescriptor(edits[i].tag) );
+
+						return 1;
+					}
+				}
+				edit.numEdits++;
+				break;
+			}
+			case 'a':
+			{
+				edit.append = 1;
+				break;
+			}
+			case 'j':
+			{
+				jobs = (int)strtol(optarg, &end, 10);
+				if(*optarg == '\0' || *end != '\0' || jobs < 1)
+				{
+					usage();
+
+					return 1;
+				}
+				break;
+			}
+			default:
+			{
+				usage();
+
+				return 1;
+			}
+		}
+	}
+
+	if( (edit.numEdits == 0) || (optind >= argc) )
+	{
+		usage();
+
+		return 1;
+	}
+
+	tiffBatchInit(&batch, editFile, &edit);
+	batch.numThreads = jobs;
+
+	return (tiffBatchRun(&batch, argv + optind, argc - optind) != 0);
+}
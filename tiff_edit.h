@@ -0,0 +1,91 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   In-place editing of tag values.                                    **/
+/**                                                                      **/
+/**   An edit replaces the value of an existing tag, found in the first  **/
+/**   entry holding it (main IFD chain first, then Exif). The new value  **/
+/**   is encoded in the byte order of the file and written where it      **/
+/**   fits: inline in the 4 byte value field of the entry, in the slot   **/
+/**   of the old value, or else appended at the end of the file, the     **/
+/**   entry then pointing to it. Image data and the rest of the file     **/
+/**   are never read or moved, so an edit costs a walk of the IFDs and a **/
+/**   few small writes whatever the size of the file.                    **/
+/**                                                                      **/
+/**   All edits of a file are checked before anything is written. Then   **/
+/**   values are written and flushed to disk before the 12 byte entries  **/
+/**   pointing to them, each entry being replaced by a single write. A   **/
+/**   value rewritten in its old slot may be left half written by a      **/
+/**   crash; with append set, values that don't fit inline are always    **/
+/**   appended, so a crash leaves each tag with either its old or its    **/
+/**   new value. The file is locked with flock(2) while it is edited.    **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_EDIT_H
+#define _TIFF_EDIT_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Most number of edits applied at once, and largest new value         **/
+/**                                                                      **/
+
+#define TIFF_EDIT_MAX_EDITS 32
+#define TIFF_EDIT_MAX_VALUE 65536
+
+
+/**                                                                      **/
+/**  One edit                                                            **/
+/**                                                                      **/
+/**  tag                                                                 **/
+/**      tag to change                                                   **/
+/**  text                                                                **/
+/**      new value: a string for ASCII and UNDEFINED tags, otherwise     **/
+/**      numbers separated by spaces, rationals written as n/d           **/
+/**                                                                      **/
+
+typedef struct tiffEdit
+{
+	unsigned short tag;
+	const char *text;
+} tiffEdit;
+
+
+/**                                                                      **/
+/**  Edit API function declarations                                      **/
+/**                                                                      **/
+
+int tiffEditParse(const char *spec, tiffEdit *edit);
+int tiffEditEncode(const internalStruct *internal, unsigned short fieldType,
+	const char *text, unsigned char *buffer, unsigned int *count,
+	size_t *numBytes);
+int tiffEditFile(const char *filename, internalStruct *internal,
+	const tiffEdit *edits, unsigned int numEdits, int append);
+int tiffEditMain(int argc, char *argv[]);
+
+#endif
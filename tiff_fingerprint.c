@@ -0,0 +1,503 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Canonical metadata fingerprints.                                   **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdio.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_fingerprint.h"
+
+
+/**                                                                      **/
+/**  MurmurHash3_x64_128 constants                                       **/
+/**                                                                      **/
+
+#define HASH_C1 0x87c37b91114253d5ULL
+#define HASH_C2 0x4cf5ad432745937fULL
+
+#define ROTL64(x, r) ( ( (x) << (r) ) | ( (x) >> (64 - (r) ) ) )
+
+
+/**                                                                      **/
+/**  Bytes of an out of line value hashed per read                       **/
+/**                                                                      **/
+
+#define HASH_CHUNK_BYTES 4096
+
+
+/**                                                                      **/
+/**   Function: load64                                                   **/
+/**                                                                      **/
+/**   Load 8 bytes as a little-endian number, whatever the byte order of **/
+/**   this machine.                                                      **/
+/**                                                                      **/
+
+static unsigned long long load64(const unsigned char *p)
+{
+	return (unsigned long long)p[0] |
+		( (unsigned long long)p[1] << 8) |
+		( (unsigned long long)p[2] << 16) |
+		( (unsigned long long)p[3] << 24) |
+		( (unsigned long long)p[4] << 32) |
+		( (unsigned long long)p[5] << 40) |
+		( (unsigned long long)p[6] << 48) |
+		( (unsigned long long)p[7] << 56);
+}
+
+
+/**                                                                      **/
+/**   Function: fmix64                                                   **/
+/**                                                                      **/
+/**   MurmurHash3 finalization mix.                                      **/
+/**                                                                      **/
+
+static unsigned long long fmix64(unsigned long long k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return k;
+}
+
+
+/**                                                                      **/
+/**   Function: hashBlock                                                **/
+/**                                                                      **/
+/**   Mix one 16 byte block into the hash state.                         **/
+/**                                                                      **/
+
+static void hashBlock(tiffHash128 *hash, const unsigned char *block)
+{
+	unsigned long long k1 = load64(block);
+	unsigned long long k2 = load64(block + 8);
+
+	k1 *= HASH_C1;
+	k1 = ROTL64(k1, 31);
+	k1 *= HASH_C2;
+	hash->h1 ^= k1;
+
+	hash->h1 = ROTL64(hash->h1, 27);
+	hash->h1 += hash->h2;
+	hash->h1 = hash->h1 * 5 + 0x52dce729;
+
+	k2 *= HASH_C2;
+	k2 = ROTL64(k2, 33);
+	k2 *= HASH_C1;
+	hash->h2 ^= k2;
+
+	hash->h2 = ROTL64(hash->h2, 31);
+	hash->h2 += hash->h1;
+	hash->h2 = hash->h2 * 5 + 0x38495ab5;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffHashInit                                             **/
+/**                                                                      **/
+/**   Start a new hash.                                                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   hash  -- hash state                                                **/
+/**   seed  -- hash seed                                                 **/
+/**                                                                      **/
+
+void tiffHashInit(tiffHash128 *hash, unsigned int seed)
+{
+	memset(hash, 0, sizeof(*hash));
+	hash->h1 = seed;
+	hash->h2 = seed;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffHashUpdate                                           **/
+/**                                                                      **/
+/**   Add bytes to a hash. The result does not depend on how the input   **/
+/**   is split between calls.                                            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   hash  -- hash state                                                **/
+/**   data  -- bytes to hash                                             **/
+/**   n     -- number of bytes                                           **/
+/**                                                                      **/
+
+void tiffHashUpdate(tiffHash128 *hash, const void *data, size_t n)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	size_t take;
+
+	hash->totalBytes += n;
+
+	if(hash->tailBytes != 0)
+	{
+		take = 16 - hash->tailBytes;
+		if(take > n)
+		{
+			take = n;
+		}
+		memcpy(hash->tail + hash->tailBytes, p, take);
+		hash->tailBytes += take;
+		p += take;
+		n -= take;
+
+		if(hash->tailBytes < 16)
+		{
+			return;
+		}
+		hashBlock(hash, hash->tail);
+		hash->tailBytes = 0;
+	}
+
+	while(n >= 16)
+	{
+		hashBlock(hash, p);
+		p += 16;
+		n -= 16;
+	}
+
+	memcpy(hash->tail, p, n);
+	hash->tailBytes = n;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffHashFinal                                            **/
+/**                                                                      **/
+/**   Finish a hash. The digest holds h1 then h2 as little-endian        **/
+/**   numbers, the byte order used by the reference implementation. The  **/
+/**   state is left untouched so more data can still be added.           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   hash    -- hash state                                              **/
+/**   digest  -- TIFF_FINGERPRINT_BYTES bytes receiving the hash         **/
+/**                                                                      **/
+
+void tiffHashFinal(const tiffHash128 *hash,
+	unsigned char digest[TIFF_FINGERPRINT_BYTES])
+{
+	unsigned char tail[16];
+	unsigned long long h1 = hash->h1;
+	unsigned long long h2 = hash->h2;
+	unsigned long long k1;
+	unsigned long long k2;
+	int i;
+
+	memset(tail, 0, sizeof(tail));
+	memcpy(tail, hash->tail, hash->tailBytes);
+	k1 = load64(tail);
+	k2 = load64(tail + 8);
+
+	if(hash->tailBytes > 8)
+	{
+		k2 *= HASH_C2;
+		k2 = ROTL64(k2, 33);
+		k2 *= HASH_C1;
+		h2 ^= k2;
+	}
+	if(hash->tailBytes > 0)
+	{
+		k1 *= HASH_C1;
+		k1 = ROTL64(k1, 31);
+		k1 *= HASH_C2;
+		h1 ^= k1;
+	}
+
+	h1 ^= hash->totalBytes;
+	h2 ^= hash->totalBytes;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+
+	for(i = 0;i < 8;i++)
+	{
+		digest[i] = (unsigned char)(h1 >> (i * 8) );
+		digest[i + 8] = (unsigned char)(h2 >> (i * 8) );
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagIsOffset                                          **/
+/**                                                                      **/
+/**   Return 1 if the value of a tag is a file offset (or a table of     **/
+/**   them) that changes whenever a file is rewritten, 0 otherwise.      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   tag  -- tag number                                                 **/
+/**                                                                      **/
+
+int tiffTagIsOffset(unsigned short tag)
+{
+	switch(tag)
+	{
+		case StripOffsets:
+		case FreeOffsets:
+		case TileOffsets:
+		case 330:	/* SubIFDs */
+		case JPEGInterchangeFormat:
+		case JPEGQTables:
+		case JPEGDCTables:
+		case JPEGACTables:
+		case ExifIFDPointer:
+		case 34853:	/* GPSInfoIFDPointer */
+		case 40965:	/* InteroperabilityIFDPointer */
+		{
+			return 1;
+		}
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+
+/**                                                                      **/
+/**   Function: tiffHashEntry                                            **/
+/**                                                                      **/
+/**   Hash the canonical header of an IFD entry: IFD chain and index,    **/
+/**   tag, type and count, all as little-endian numbers.                 **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   hash   -- hash state                                               **/
+/**   entry  -- IFD entry                                                **/
+/**                                                                      **/
+
+void tiffHashEntry(tiffHash128 *hash, const tiffEntry *entry)
+{
+	unsigned char record[13];
+	int i;
+
+	record[0] = (unsigned char)entry->ifd->kind;
+	for(i = 0;i < 4;i++)
+	{
+		record[1 + i] = (unsigned char)(entry->ifd->index >> (i * 8) );
+		record[9 + i] = (unsigned char)(entry->count >> (i * 8) );
+	}
+	record[5] = (unsigned char)entry->tag;
+	record[6] = (unsigned char)(entry->tag >> 8);
+	record[7] = (unsigned char)entry->fieldType;
+	record[8] = (unsigned char)(entry->fieldType >> 8);
+
+	tiffHashUpdate(hash, record, sizeof(record) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffHashValues                                           **/
+/**                                                                      **/
+/**   Hash the value bytes of an IFD entry, converted to little-endian   **/
+/**   order. RATIONALs are converted as two LONGs. Values stored out of  **/
+/**   line are read in chunks, so no buffer the size of the value is     **/
+/**   needed. The first keepBytes converted bytes are also copied to     **/
+/**   keep. Returns 0 on success, 1 on failure.                          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   hash       -- hash state                                           **/
+/**   internal   -- struct containing internal program data              **/
+/**   entry      -- IFD entry                                            **/
+/**   keep       -- buffer for the start of the value, or NULL           **/
+/**   keepBytes  -- size of keep, at most the size of the value          **/
+/**                                                                      **/
+
+int tiffHashValues(tiffHash128 *hash, internalStruct *internal,
+	const tiffEntry *entry, unsigned char *keep, size_t keepBytes)
+{
+	unsigned char chunk[HASH_CHUNK_BYTES];
+	unsigned long long done;
+	size_t n;
+	size_t unit;
+	size_t i;
+	size_t j;
+	unsigned char c;
+
+	unit = getFieldTypeNumBytes( (fieldType_t)entry->fieldType);
+	if( (entry->fieldType == FT_RATIONAL) ||
+		(entry->fieldType == FT_SRATIONAL) )
+	{
+		unit = 4;
+	}
+
+	for(done = 0;done < entry->totalBytes;done += n)
+	{
+		n = HASH_CHUNK_BYTES;
+		if(entry->totalBytes - done < n)
+		{
+			n = (size_t)(entry->totalBytes - done);
+		}
+
+		if(tiffGetValueBytes(internal, entry, done, chunk, n) != 0)
+		{
+			return 1;
+		}
+
+		/* fileEndian is 1 for little-endian files */
+		if( (internal->fileEndian == 0) && (unit > 1) )
+		{
+			for(i = 0;i < n;i += unit)
+			{
+				for(j = 0;j < unit / 2;j++)
+				{
+					c = chunk[i + j];
+					chunk[i + j] = chunk[i + unit - 1 - j];
+					chunk[i + unit - 1 - j] = c;
+				}
+			}
+		}
+
+		tiffHashUpdate(hash, chunk, n);
+
+		if(done < keepBytes)
+		{
+			memcpy(keep + done, chunk,
+				(keepBytes - done < n) ? (size_t)(keepBytes - done) : n);
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**  IFD walker callback adding every entry to the fingerprint           **/
+/**                                                                      **/
+
+static tiffWalk_t fingerprintEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	tiffHash128 *hash = (tiffHash128 *)ctx;
+
+	tiffHashEntry(hash, entry);
+
+	if(!tiffTagIsOffset(entry->tag) )
+	{
+		if(tiffHashValues(hash, internal, entry, NULL, 0) != 0)
+		{
+			return TIFF_WALK_ERROR;
+		}
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor fingerprintVisitor = {
+	NULL,
+	fingerprintEntry,
+	NULL,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffFingerprint                                          **/
+/**                                                                      **/
+/**   Compute the canonical metadata fingerprint of a file. Returns 0 on **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**   digest    -- TIFF_FINGERPRINT_BYTES bytes receiving the fingerprint**/
+/**                                                                      **/
+
+int tiffFingerprint(const char *filename, internalStruct *internal,
+	unsigned char digest[TIFF_FINGERPRINT_BYTES])
+{
+	tiffHash128 hash;
+	tiffWalk_t status;
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	tiffHashInit(&hash, 0);
+	status = tiffWalkFile(filename, internal, &fingerprintVisitor, &hash);
+	tiffClose(internal);
+
+	if(status == TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+
+	tiffHashFinal(&hash, digest);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffFingerprintPrint                                     **/
+/**                                                                      **/
+/**   Print the fingerprint of a file as 32 hex digits followed by the   **/
+/**   file name, in the format of md5sum. Returns 0 on success, 1 on     **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+int tiffFingerprintPrint(const char *filename, internalStruct *internal)
+{
+	unsigned char digest[TIFF_FINGERPRINT_BYTES];
+	tiffPhase_t phase;
+	int i;
+
+	if(tiffFingerprint(filename, internal, digest) != 0)
+	{
+		return 1;
+	}
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+	for(i = 0;i < TIFF_FINGERPRINT_BYTES;i++)
+	{
+		tiffPrintf(internal, "%02x", digest[i]);
+	}
+	tiffPrintf(internal, "  %s\n", filename);
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Canonical metadata fingerprints.                                   **/
+/**                                                                      **/
+/**   Every IFD entry is reduced to a canonical record (IFD chain and    **/
+/**   index, tag, type, count and value bytes in little-endian order)    **/
+/**   which is fed to a streaming 128-bit MurmurHash3 while the IFDs are **/
+/**   walked. Values of tags holding file offsets are left out, so files **/
+/**   with the same metadata laid out differently, or written in a       **/
+/**   different byte order, get the same fingerprint.                    **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_FINGERPRINT_H
+#define _TIFF_FINGERPRINT_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Size of a fingerprint in bytes                                      **/
+/**                                                                      **/
+
+#define TIFF_FINGERPRINT_BYTES 16
+
+
+/**                                                                      **/
+/**  Streaming MurmurHash3_x64_128 state                                 **/
+/**                                                                      **/
+/**  h1, h2                                                              **/
+/**      hash state                                                      **/
+/**  tail, tailBytes                                                     **/
+/**      input bytes not yet forming a full 16 byte block                **/
+/**  totalBytes                                                          **/
+/**      number of bytes hashed so far                                   **/
+/**                                                                      **/
+
+typedef struct tiffHash128
+{
+	unsigned long long h1;
+	unsigned long long h2;
+	unsigned char tail[16];
+	unsigned int tailBytes;
+	unsigned long long totalBytes;
+} tiffHash128;
+
+
+/**                                                                      **/
+/**  Fingerprint API function declarations                               **/
+/**                                                                      **/
+
+void tiffHashInit(tiffHash128 *hash, unsigned int seed);
+void tiffHashUpdate(tiffHash128 *hash, const void *data, size_t n);
+void tiffHashFinal(const tiffHash128 *hash,
+	unsigned char digest[TIFF_FINGERPRINT_BYTES]);
+int tiffTagIsOffset(unsigned short tag);
+void tiffHashEntry(tiffHash128 *hash, const tiffEntry *entry);
+int tiffHashValues(tiffHash128 *hash, internalStruct *internal,
+	const tiffEntry *entry, unsigned char *keep, size_t keepBytes);
+int tiffFingerprint(const char *filename, internalStruct *internal,
+	unsigned char digest[TIFF_FINGERPRINT_BYTES]);
+int tiffFingerprintPrint(const char *filename, internalStruct *internal);
+
+#endif
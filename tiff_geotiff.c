@@ -0,0 +1,768 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   GeoTIFF georeferencing, see tiff_geotiff.h.                        **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "tiff_metadata.h"
+#include "tiff_geotiff.h"
+
+
+/* SHORTs of the key directory header and of each key */
+#define GEO_KEY_SHORTS 4
+
+
+/**                                                                      **/
+/**  GeoKey names of the GeoTIFF 1.0 specification                       **/
+/**                                                                      **/
+
+typedef struct geoKeyName
+{
+	unsigned short id;
+	const char *name;
+} geoKeyName;
+
+static const geoKeyName geoKeyNames[] = {
+	{ 1024, "GTModelTypeGeoKey", },
+	{ 1025, "GTRasterTypeGeoKey", },
+	{ 1026, "GTCitationGeoKey", },
+	{ 2048, "GeographicTypeGeoKey", },
+	{ 2049, "GeogCitationGeoKey", },
+	{ 2050, "GeogGeodeticDatumGeoKey", },
+	{ 2051, "GeogPrimeMeridianGeoKey", },
+	{ 2052, "GeogLinearUnitsGeoKey", },
+	{ 2053, "GeogLinearUnitSizeGeoKey", },
+	{ 2054, "GeogAngularUnitsGeoKey", },
+	{ 2055, "GeogAngularUnitSizeGeoKey", },
+	{ 2056, "GeogEllipsoidGeoKey", },
+	{ 2057, "GeogSemiMajorAxisGeoKey", },
+	{ 2058, "GeogSemiMinorAxisGeoKey", },
+	{ 2059, "GeogInvFlatteningGeoKey", },
+	{ 2060, "GeogAzimuthUnitsGeoKey", },
+	{ 2061, "GeogPrimeMeridianLongGeoKey", },
+	{ 3072, "ProjectedCSTypeGeoKey", },
+	{ 3073, "PCSCitationGeoKey", },
+	{ 3074, "ProjectionGeoKey", },
+	{ 3075, "ProjCoordTransGeoKey", },
+	{ 3076, "ProjLinearUnitsGeoKey", },
+	{ 3077, "ProjLinearUnitSizeGeoKey", },
+	{ 3078, "ProjStdParallel1GeoKey", },
+	{ 3079, "ProjStdParallel2GeoKey", },
+	{ 3080, "ProjNatOriginLongGeoKey", },
+	{ 3081, "ProjNatOriginLatGeoKey", },
+	{ 3082, "ProjFalseEastingGeoKey", },
+	{ 3083, "ProjFalseNorthingGeoKey", },
+	{ 3084, "ProjFalseOriginLongGeoKey", },
+	{ 3085, "ProjFalseOriginLatGeoKey", },
+	{ 3086, "ProjFalseOriginEastingGeoKey", },
+	{ 3087, "ProjFalseOriginNorthingGeoKey", },
+	{ 3088, "ProjCenterLongGeoKey", },
+	{ 3089, "ProjCenterLatGeoKey", },
+	{ 3090, "ProjCenterEastingGeoKey", },
+	{ 3091, "ProjCenterNorthingGeoKey", },
+	{ 3092, "ProjScaleAtNatOriginGeoKey", },
+	{ 3093, "ProjScaleAtCenterGeoKey", },
+	{ 3094, "ProjAzimuthAngleGeoKey", },
+	{ 3095, "ProjStraightVertPoleLongGeoKey", },
+	{ 4096, "VerticalCSTypeGeoKey", },
+	{ 4097, "VerticalCitationGeoKey", },
+	{ 4098, "VerticalDatumGeoKey", },
+	{ 4099, "VerticalUnitsGeoKey", },
+};
+
+
+/**                                                                      **/
+/**  GeoTIFF walk state                                                  **/
+/**                                                                      **/
+/**  geo                                                                 **/
+/**      information being read                                          **/
+/**  status                                                              **/
+/**      1 once a value couldn't be read                                 **/
+/**                                                                      **/
+
+typedef struct geoCtx
+{
+	tiffGeoTIFF *geo;
+	int status;
+} geoCtx;
+
+
+/**                                                                      **/
+/**   Function: geoBeginIFD                                              **/
+/**                                                                      **/
+/**   Visitor callback reading IFD0 only.                                **/
+/**                                                                      **/
+
+static tiffWalk_t geoBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	return (ifd->index == 0) ? TIFF_WALK_CONTINUE : TIFF_WALK_STOP;
+}
+
+
+/**                                                                      **/
+/**   Function: geoEntry                                                 **/
+/**                                                                      **/
+/**   Visitor callback pointing the arrays of the GeoTIFF tags at their  **/
+/**   values: into the file mapping when possible, into a buffer read    **/
+/**   otherwise. Tags of another type than the specification's are       **/
+/**   ignored.                                                           **/
+/**                                                                      **/
+
+static tiffWalk_t geoEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	geoCtx *walk = (geoCtx *)ctx;
+	tiffGeoTIFF *geo = walk->geo;
+	tiffGeoArray *array;
+	fieldType_t type;
+
+	switch(entry->tag)
+	{
+		case GeoKeyDirectoryTag:
+		{
+			array = &geo->directory;
+			type = FT_SHORT;
+			break;
+		}
+		case GeoDoubleParamsTag:
+		{
+			array = &geo->doubles;
+			type = FT_DOUBLE;
+			break;
+		}
+		case GeoAsciiParamsTag:
+		{
+			array = &geo->ascii;
+			type = FT_ASCII;
+			break;
+		}
+		case ModelPixelScaleTag:
+		{
+			array = &geo->pixelScale;
+			type = FT_DOUBLE;
+			break;
+		}
+		case ModelTiepointTag:
+		{
+			array = &geo->tiepoints;
+			type = FT_DOUBLE;
+			break;
+		}
+		case ModelTransformationTag:
+		{
+			array = &geo->transformation;
+			type = FT_DOUBLE;
+			break;
+		}
+		default:
+		{
+			return TIFF_WALK_CONTINUE;
+		}
+	}
+
+	if( (entry->fieldType != type) || (array->data != NULL) ||
+		(entry->count == 0) )
+	{
+		return TIFF_WALK_CONTINUE;
+	}
+
+	if(!entry->isInline && ( (unsigned long long)internal->tiffOffset +
+		entry->valueOffset + entry->totalBytes > tiffFileSize(internal) ) )
+	{
+		fprintf(stderr, "%s values end past the end of the file\n",
+			getTagDescriptor(entry->tag) );
+		walk->status = 1;
+
+		return TIFF_WALK_CONTINUE;
+	}
+
+	/* Inline values live in the entry, which the walk reuses */
+	if(!entry->isInline)
+	{
+		array->data = tiffGetValuePointer(internal, entry);
+	}
+	if(array->data == NULL)
+	{
+		array->owned = (unsigned char *)tiffMalloc(
+			(size_t)entry->totalBytes, internal);
+		if(array->owned == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+
+			return TIFF_WALK_ERROR;
+		}
+		if(tiffGetValueBytes(internal, entry, 0, array->owned,
+			(size_t)entry->totalBytes) != 0)
+		{
+			free(array->owned);
+			array->owned = NULL;
+			walk->status = 1;
+
+			return TIFF_WALK_CONTINUE;
+		}
+		array->data = array->owned;
+	}
+	array->count = entry->count;
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: geoEndIFD                                                **/
+/**                                                                      **/
+/**   Visitor callback stopping after IFD0.                              **/
+/**                                                                      **/
+
+static tiffWalk_t geoEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	return TIFF_WALK_STOP;
+}
+
+
+/**                                                                      **/
+/**   Functions: getShort, getDouble                                     **/
+/**                                                                      **/
+/**   Return the index-th value of an array of SHORTs or DOUBLEs.        **/
+/**                                                                      **/
+
+static unsigned int getShort(const tiffGeoTIFF *geo,
+	const tiffGeoArray *array, unsigned int index)
+{
+	tiffValue value;
+
+	tiffDecodeValue(array->data + 2 * (size_t)index, FT_SHORT,
+		geo->internal, &value);
+
+	return (unsigned int)value.integer;
+}
+
+static double getDouble(const tiffGeoTIFF *geo, const tiffGeoArray *array,
+	unsigned int index)
+{
+	tiffValue value;
+
+	tiffDecodeValue(array->data + 8 * (size_t)index, FT_DOUBLE,
+		geo->internal, &value);
+
+	return value.real;
+}
+
+
+/**                                                                      **/
+/**   Function: setTransform                                             **/
+/**                                                                      **/
+/**   Derive the affine transform from ModelTransformationTag, or else   **/
+/**   from the first tie point (I, J, K, X, Y, Z) and the pixel scale    **/
+/**   (ScaleX, ScaleY, ScaleZ), rows going down as Y decreases.          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information whose arrays are set                **/
+/**                                                                      **/
+
+static void setTransform(tiffGeoTIFF *geo)
+{
+	double *t = geo->transform;
+	double scaleX;
+	double scaleY;
+
+	if(geo->transformation.count >= 16)
+	{
+		t[0] = getDouble(geo, &geo->transformation, 0);
+		t[1] = getDouble(geo, &geo->transformation, 1);
+		t[2] = getDouble(geo, &geo->transformation, 3);
+		t[3] = getDouble(geo, &geo->transformation, 4);
+		t[4] = getDouble(geo, &geo->transformation, 5);
+		t[5] = getDouble(geo, &geo->transformation, 7);
+		geo->hasTransform = 1;
+	}
+	else if( (geo->tiepoints.count >= 6) && (geo->pixelScale.count >= 2) )
+	{
+		scaleX = getDouble(geo, &geo->pixelScale, 0);
+		scaleY = getDouble(geo, &geo->pixelScale, 1);
+		t[0] = scaleX;
+		t[1] = 0.0;
+		t[2] = getDouble(geo, &geo->tiepoints, 3) -
+			getDouble(geo, &geo->tiepoints, 0) * scaleX;
+		t[3] = 0.0;
+		t[4] = -scaleY;
+		t[5] = getDouble(geo, &geo->tiepoints, 4) +
+			getDouble(geo, &geo->tiepoints, 1) * scaleY;
+		geo->hasTransform = 1;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoTIFFRead                                          **/
+/**                                                                      **/
+/**   Read the GeoTIFF information of IFD0 of a file opened with         **/
+/**   tiffOpen. Returns 0 when it has a valid key directory or model     **/
+/**   tags, 1 with a message on stderr otherwise. The arrays stay valid  **/
+/**   until tiffGeoTIFFFree, which must precede tiffClose.               **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name, for messages                               **/
+/**   internal  -- struct of the open file                               **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   geo       -- GeoTIFF information                                   **/
+/**                                                                      **/
+
+int tiffGeoTIFFRead(const char *filename, internalStruct *internal,
+	tiffGeoTIFF *geo)
+{
+	static const tiffVisitor visitor = {
+		geoBeginIFD, geoEntry, geoEndIFD,
+	};
+	tiffGeoKey key;
+	unsigned int value;
+	geoCtx walk;
+
+	memset(geo, 0, sizeof(*geo) );
+	geo->internal = internal;
+	walk.geo = geo;
+	walk.status = 0;
+
+	if( (tiffIFDWalk(filename, internal, IFD_TIFF, &visitor, &walk) ==
+		TIFF_WALK_ERROR) || (walk.status != 0) )
+	{
+		tiffGeoTIFFFree(geo);
+
+		return 1;
+	}
+
+	if(geo->directory.data != NULL)
+	{
+		if(geo->directory.count < GEO_KEY_SHORTS)
+		{
+			fprintf(stderr, "%s: GeoKeyDirectoryTag too short\n", filename);
+			tiffGeoTIFFFree(geo);
+
+			return 1;
+		}
+		geo->version = (unsigned short)getShort(geo, &geo->directory, 0);
+		geo->revision = (unsigned short)getShort(geo, &geo->directory, 1);
+		geo->minorRevision = (unsigned short)getShort(geo,
+			&geo->directory, 2);
+		geo->numKeys = (unsigned short)getShort(geo, &geo->directory, 3);
+		if( ( (unsigned long)geo->numKeys + 1) * GEO_KEY_SHORTS >
+			geo->directory.count)
+		{
+			fprintf(stderr, "%s: GeoKeyDirectoryTag holds %u keys, not %u\n",
+				filename, geo->directory.count / GEO_KEY_SHORTS - 1,
+				geo->numKeys);
+			tiffGeoTIFFFree(geo);
+
+			return 1;
+		}
+	}
+	else if( (geo->transformation.data == NULL) &&
+		(geo->tiepoints.data == NULL) )
+	{
+		fprintf(stderr, "%s has no GeoTIFF tags\n", filename);
+		tiffGeoTIFFFree(geo);
+
+		return 1;
+	}
+
+	if( (tiffGeoTIFFFindKey(geo, TIFF_GEO_MODEL_TYPE, &key) == 0) &&
+		(tiffGeoTIFFShort(geo, &key, 0, &value) == 0) )
+	{
+		geo->model = (int)value;
+	}
+
+	if( ( ( (tiffGeoTIFFFindKey(geo, TIFF_GEO_PROJECTED_TYPE, &key) == 0) &&
+		(geo->model != 2) ) ||
+		(tiffGeoTIFFFindKey(geo, TIFF_GEO_GEOGRAPHIC_TYPE, &key) == 0) ) &&
+		(tiffGeoTIFFShort(geo, &key, 0, &value) == 0) )
+	{
+		geo->epsg = (int)value;
+	}
+
+	setTransform(geo);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoTIFFFree                                          **/
+/**                                                                      **/
+/**   Release the buffers values were read into.                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information                                     **/
+/**                                                                      **/
+
+void tiffGeoTIFFFree(tiffGeoTIFF *geo)
+{
+	free(geo->directory.owned);
+	free(geo->doubles.owned);
+	free(geo->ascii.owned);
+	free(geo->pixelScale.owned);
+	free(geo->tiepoints.owned);
+	free(geo->transformation.owned);
+	memset(geo, 0, sizeof(*geo) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoTIFFKey                                           **/
+/**                                                                      **/
+/**   Decode the index-th key of the key directory. Returns 0 on         **/
+/**   success, 1 if there is no such key.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information                                     **/
+/**   index   -- key index, below geo->numKeys                           **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   key     -- the key                                                 **/
+/**                                                                      **/
+
+int tiffGeoTIFFKey(const tiffGeoTIFF *geo, unsigned int index,
+	tiffGeoKey *key)
+{
+	unsigned int first = (index + 1) * GEO_KEY_SHORTS;
+
+	if(index >= geo->numKeys)
+	{
+		return 1;
+	}
+
+	key->id = (unsigned short)getShort(geo, &geo->directory, first);
+	key->location = (unsigned short)getShort(geo, &geo->directory,
+		first + 1);
+	key->count = (unsigned short)getShort(geo, &geo->directory, first + 2);
+	key->value = (unsigned short)getShort(geo, &geo->directory, first + 3);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoTIFFFindKey                                       **/
+/**                                                                      **/
+/**   Find a key by id. Returns 0 on success, 1 if the file has none.    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information                                     **/
+/**   id      -- key id                                                  **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   key     -- the key                                                 **/
+/**                                                                      **/
+
+int tiffGeoTIFFFindKey(const tiffGeoTIFF *geo, unsigned short id,
+	tiffGeoKey *key)
+{
+	unsigned int i;
+
+	/* Keys should be sorted by id, but writers don't all sort them */
+	for(i = 0;i < geo->numKeys;i++)
+	{
+		if( (tiffGeoTIFFKey(geo, i, key) == 0) && (key->id == id) )
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+/**                                                                      **/
+/**   Functions: tiffGeoTIFFShort, tiffGeoTIFFDouble                     **/
+/**                                                                      **/
+/**   Get the index-th value of a SHORT or DOUBLE key, decoded from the  **/
+/**   array holding it. Returns 0 on success, 1 if the key isn't of      **/
+/**   that type or its values lie outside the array.                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information                                     **/
+/**   key     -- the key                                                 **/
+/**   index   -- value index, below key->count                           **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   value   -- the value                                               **/
+/**                                                                      **/
+
+int tiffGeoTIFFShort(const tiffGeoTIFF *geo, const tiffGeoKey *key,
+	unsigned int index, unsigned int *value)
+{
+	if(index >= key->count)
+	{
+		return 1;
+	}
+
+	if(key->location == 0)
+	{
+		if(index != 0)
+		{
+			return 1;
+		}
+		*value = key->value;
+
+		return 0;
+	}
+
+	if( (key->location != GeoKeyDirectoryTag) ||
+		( (unsigned int)key->value + key->count > geo->directory.count) )
+	{
+		return 1;
+	}
+	*value = getShort(geo, &geo->directory, key->value + index);
+
+	return 0;
+}
+
+int tiffGeoTIFFDouble(const tiffGeoTIFF *geo, const tiffGeoKey *key,
+	unsigned int index, double *value)
+{
+	if( (key->location != GeoDoubleParamsTag) || (index >= key->count) ||
+		( (unsigned int)key->value + key->count > geo->doubles.count) )
+	{
+		return 1;
+	}
+	*value = getDouble(geo, &geo->doubles, key->value + index);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoTIFFAscii                                         **/
+/**                                                                      **/
+/**   Get a view of the string of an ASCII key in GeoAsciiParamsTag,     **/
+/**   without its "|" terminator. Returns 0 on success, 1 if the key     **/
+/**   isn't ASCII or its string lies outside the tag.                    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information                                     **/
+/**   key     -- the key                                                 **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   view    -- the string, valid as long as geo                        **/
+/**                                                                      **/
+
+int tiffGeoTIFFAscii(const tiffGeoTIFF *geo, const tiffGeoKey *key,
+	tiffStringView *view)
+{
+	if( (key->location != GeoAsciiParamsTag) ||
+		( (unsigned int)key->value + key->count > geo->ascii.count) )
+	{
+		return 1;
+	}
+
+	view->ptr = (const char *)geo->ascii.data + key->value;
+	view->length = key->count;
+	while( (view->length > 0) &&
+		( (view->ptr[view->length - 1] == '|') ||
+		(view->ptr[view->length - 1] == '\0') ) )
+	{
+		view->length--;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoKeyName                                           **/
+/**                                                                      **/
+/**   Return the name of a GeoKey, or "unknown".                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   id      -- key id                                                  **/
+/**                                                                      **/
+
+const char *tiffGeoKeyName(unsigned short id)
+{
+	unsigned int i;
+
+	for(i = 0;i < sizeof(geoKeyNames) / sizeof(*geoKeyNames);i++)
+	{
+		if(geoKeyNames[i].id == id)
+		{
+			return geoKeyNames[i].name;
+		}
+	}
+
+	return "unknown";
+}
+
+
+/**                                                                      **/
+/**   Function: printKey                                                 **/
+/**                                                                      **/
+/**   Print one key and its values.                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   geo     -- GeoTIFF information                                     **/
+/**   key     -- the key                                                 **/
+/**                                                                      **/
+
+static void printKey(const tiffGeoTIFF *geo, const tiffGeoKey *key)
+{
+	const internalStruct *internal = geo->internal;
+	tiffStringView view;
+	unsigned int value;
+	unsigned int i;
+	double real;
+
+	tiffPrintf(internal, "Key %u %s", key->id, tiffGeoKeyName(key->id) );
+
+	if(tiffGeoTIFFAscii(geo, key, &view) == 0)
+	{
+		tiffPrintf(internal, " \"%.*s\"", (int)view.length, view.ptr);
+	}
+	else
+	{
+		for(i = 0;i < key->count;i++)
+		{
+			if(tiffGeoTIFFShort(geo, key, i, &value) == 0)
+			{
+				tiffPrintf(internal, " %u", value);
+			}
+			else if(tiffGeoTIFFDouble(geo, key, i, &real) == 0)
+			{
+				tiffPrintf(internal, " %.15g", real);
+			}
+			else
+			{
+				tiffPrintf(internal, " (bad location %u)", key->location);
+				break;
+			}
+		}
+	}
+	tiffPrintf(internal, "\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffGeoTIFFPrint                                         **/
+/**                                                                      **/
+/**   Print the GeoTIFF information of a file: the key directory         **/
+/**   version, the coordinate reference system, the affine transform     **/
+/**   and every key. Returns 0 on success, 1 on failure.                 **/
+/**                                                                      **/
+/**       GeoTIFF 1.1.0, 3 keys                                          **/
+/**       CRS projected EPSG:32633 "WGS 84 / UTM zone 33N"               **/
+/**       Transform 30 0 440720 0 -30 3751320                            **/
+/**       Key 1024 GTModelTypeGeoKey 1                                   **/
+/**       ...                                                            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct containing internal program data               **/
+/**                                                                      **/
+
+int tiffGeoTIFFPrint(const char *filename, internalStruct *internal)
+{
+	static const char *const models[] = {
+		"unknown", "projected", "geographic", "geocentric",
+	};
+	static const unsigned short citations[] = {
+		TIFF_GEO_PCS_CITATION, TIFF_GEO_GEOG_CITATION, TIFF_GEO_CITATION,
+	};
+	const char *model;
+	tiffStringView view;
+	tiffGeoTIFF geo;
+	tiffGeoKey key;
+	unsigned int i;
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	if(tiffGeoTIFFRead(filename, internal, &geo) != 0)
+	{
+		tiffClose(internal);
+
+		return 1;
+	}
+
+	tiffPrintf(internal, "GeoTIFF %u.%u.%u, %u keys\n", geo.version,
+		geo.revision, geo.minorRevision, geo.numKeys);
+
+	model = models[0];
+	if( (geo.model > 0) &&
+		( (size_t)geo.model < sizeof(models) / sizeof(*models) ) )
+	{
+		model = models[geo.model];
+	}
+	tiffPrintf(internal, "CRS %s", model);
+	if(geo.epsg == TIFF_GEO_USER_DEFINED)
+	{
+		tiffPrintf(internal, " user-defined");
+	}
+	else if(geo.epsg != 0)
+	{
+		tiffPrintf(internal, " EPSG:%d", geo.epsg);
+	}
+	for(i = 0;i < sizeof(citations) / sizeof(*citations);i++)
+	{
+		if( (tiffGeoTIFFFindKey(&geo, citations[i], &key) == 0) &&
+			(tiffGeoTIFFAscii(&geo, &key, &view) == 0) )
+		{
+			tiffPrintf(internal, " \"%.*s\"", (int)view.length, view.ptr);
+			break;
+		}
+	}
+	tiffPrintf(internal, "\n");
+
+	if(geo.hasTransform)
+	{
+		tiffPrintf(internal, "Transform %.15g %.15g %.15g %.15g %.15g "
+			"%.15g\n", geo.transform[0], geo.transform[1],
+			geo.transform[2], geo.transform[3], geo.transform[4],
+			geo.transform[5]);
+	}
+
+	for(i = 0;tiffGeoTIFFKey(&geo, i, &key) == 0;i++)
+	{
+		printKey(&geo, &key);
+	}
+
+	tiffGeoTIFFFree(&geo);
+	tiffClose(internal);
+
+	return 0;
+}
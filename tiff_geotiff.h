@@ -0,0 +1,171 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   GeoTIFF georeferencing.                                            **/
+/**                                                                      **/
+/**   The GeoKeyDirectoryTag of IFD0 is an array of SHORTs: a header     **/
+/**   (version, revision, minor revision, number of keys) followed by    **/
+/**   four SHORTs per key: its id, the tag holding its value (0 when the **/
+/**   value is the SHORT itself, GeoDoubleParamsTag, GeoAsciiParamsTag,  **/
+/**   or GeoKeyDirectoryTag for SHORT arrays), its count and its value   **/
+/**   or index into that tag. Those tags and the model tags              **/
+/**   (ModelPixelScaleTag, ModelTiepointTag, ModelTransformationTag) are **/
+/**   used in place in the mapped file, and their values decoded from    **/
+/**   file byte order only when asked for; they are read into buffers    **/
+/**   only when the file isn't mapped.                                   **/
+/**                                                                      **/
+/**   From the keys and model tags are derived the model type            **/
+/**   (projected, geographic or geocentric), the EPSG code of the        **/
+/**   coordinate reference system and the affine transform from raster   **/
+/**   space (column, row) to model space:                                **/
+/**                                                                      **/
+/**       x = a * column + b * row + c                                   **/
+/**       y = d * column + e * row + f                                   **/
+/**                                                                      **/
+/**   taken from ModelTransformationTag, or else from the first tie      **/
+/**   point and the pixel scale.                                         **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_GEOTIFF_H
+#define _TIFF_GEOTIFF_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  GeoKeys deciding the coordinate system, and value of user defined   **/
+/**  systems                                                             **/
+/**                                                                      **/
+
+#define TIFF_GEO_MODEL_TYPE 1024
+#define TIFF_GEO_CITATION 1026
+#define TIFF_GEO_GEOGRAPHIC_TYPE 2048
+#define TIFF_GEO_GEOG_CITATION 2049
+#define TIFF_GEO_PROJECTED_TYPE 3072
+#define TIFF_GEO_PCS_CITATION 3073
+#define TIFF_GEO_USER_DEFINED 32767
+
+
+/**                                                                      **/
+/**  Values of a GeoTIFF tag, in file byte order                         **/
+/**                                                                      **/
+/**  data, count                                                         **/
+/**      the values, NULL if the file has no such tag, and their number  **/
+/**  owned                                                               **/
+/**      buffer data points into when the values were read, or NULL      **/
+/**                                                                      **/
+
+typedef struct tiffGeoArray
+{
+	const unsigned char *data;
+	unsigned int count;
+	unsigned char *owned;
+} tiffGeoArray;
+
+
+/**                                                                      **/
+/**  GeoKey, as stored in the key directory                              **/
+/**                                                                      **/
+/**  id                                                                  **/
+/**      key id, such as TIFF_GEO_MODEL_TYPE                             **/
+/**  location                                                            **/
+/**      0 when value is the value, or the tag holding the values        **/
+/**  count, value                                                        **/
+/**      number of values, and value or index of the first one           **/
+/**                                                                      **/
+
+typedef struct tiffGeoKey
+{
+	unsigned short id;
+	unsigned short location;
+	unsigned short count;
+	unsigned short value;
+} tiffGeoKey;
+
+
+/**                                                                      **/
+/**  GeoTIFF information of a file                                       **/
+/**                                                                      **/
+/**  internal                                                            **/
+/**      open file the arrays point into, and its byte order             **/
+/**  version, revision, minorRevision, numKeys                           **/
+/**      key directory header                                            **/
+/**  directory, doubles, ascii                                           **/
+/**      GeoKeyDirectoryTag, GeoDoubleParamsTag and GeoAsciiParamsTag    **/
+/**  pixelScale, tiepoints, transformation                               **/
+/**      model tags                                                      **/
+/**  model                                                               **/
+/**      GTModelTypeGeoKey: 1 projected, 2 geographic, 3 geocentric, 0   **/
+/**      if absent                                                       **/
+/**  epsg                                                                **/
+/**      EPSG code of the projected or geographic coordinate system,     **/
+/**      TIFF_GEO_USER_DEFINED when user defined, 0 if absent            **/
+/**  hasTransform, transform                                             **/
+/**      1 when the affine transform a, b, c, d, e, f is known           **/
+/**                                                                      **/
+
+typedef struct tiffGeoTIFF
+{
+	const internalStruct *internal;
+	unsigned short version;
+	unsigned short revision;
+	unsigned short minorRevision;
+	unsigned short numKeys;
+	tiffGeoArray directory;
+	tiffGeoArray doubles;
+	tiffGeoArray ascii;
+	tiffGeoArray pixelScale;
+	tiffGeoArray tiepoints;
+	tiffGeoArray transformation;
+	int model;
+	int epsg;
+	int hasTransform;
+	double transform[6];
+} tiffGeoTIFF;
+
+
+/**                                                                      **/
+/**  GeoTIFF API function declarations                                   **/
+/**                                                                      **/
+
+int tiffGeoTIFFRead(const char *filename, internalStruct *internal,
+	tiffGeoTIFF *geo);
+void tiffGeoTIFFFree(tiffGeoTIFF *geo);
+int tiffGeoTIFFKey(const tiffGeoTIFF *geo, unsigned int index,
+	tiffGeoKey *key);
+int tiffGeoTIFFFindKey(const tiffGeoTIFF *geo, unsigned short id,
+	tiffGeoKey *key);
+int tiffGeoTIFFShort(const tiffGeoTIFF *geo, const tiffGeoKey *key,
+	unsigned int index, unsigned int *value);
+int tiffGeoTIFFDouble(const tiffGeoTIFF *geo, const tiffGeoKey *key,
+	unsigned int index, double *value);
+int tiffGeoTIFFAscii(const tiffGeoTIFF *geo, const tiffGeoKey *key,
+	tiffStringView *view);
+const char *tiffGeoKeyName(unsigned short id);
+int tiffGeoTIFFPrint(const char *filename, internalStruct *internal);
+
+#endif
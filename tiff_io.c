@@ -0,0 +1,1293 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Random-access I/O backends.                                        **/
+/**                                                                      **/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_io.h"
+
+
+/**                                                                      **/
+/**   Function: fileRead                                                 **/
+/**                                                                      **/
+/**   tiffIO read function of the local file backend.                    **/
+/**                                                                      **/
+
+static int fileRead(void *handle, tiffIORange *ranges, unsigned int numRanges)
+{
+	tiffIOFile *file = (tiffIOFile *)handle;
+	tiffIORange *range;
+	unsigned int i;
+	ssize_t got;
+
+	for(i = 0;i < numRanges;i++)
+	{
+		range = &ranges[i];
+		range->got = 0;
+		while(range->got < range->length)
+		{
+			got = pread(file->fd, range->dst + range->got,
+				range->length - range->got,
+				(off_t)(range->offset + range->got) );
+			if( (got < 0) && (errno == EINTR) )
+			{
+				continue;
+			}
+			if(got < 0)
+			{
+				return 1;
+			}
+			if(got == 0)
+			{
+				break;
+			}
+			range->got += (size_t)got;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: fileSize                                                 **/
+/**                                                                      **/
+/**   tiffIO size function of the local file backend.                    **/
+/**                                                                      **/
+
+static unsigned long long fileSize(void *handle)
+{
+	return ( (tiffIOFile *)handle)->size;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOFileOpen                                           **/
+/**                                                                      **/
+/**   Open a local file as a backend. Returns 0 on success, 1 with a     **/
+/**   message on stderr on failure.                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   file      -- backend to open                                       **/
+/**   filename  -- file name                                             **/
+/**                                                                      **/
+
+int tiffIOFileOpen(tiffIOFile *file, const char *filename)
+{
+	struct stat st;
+
+	memset(file, 0, sizeof(*file) );
+
+	file->fd = open(filename, O_RDONLY);
+	if(file->fd < 0)
+	{
+		fprintf(stderr, "can't open %s to read\n", filename);
+
+		return 1;
+	}
+	if(fstat(file->fd, &st) != 0)
+	{
+		fprintf(stderr, "can't stat %s\n", filename);
+		close(file->fd);
+		file->fd = -1;
+
+		return 1;
+	}
+
+	file->size = (unsigned long long)st.st_size;
+	file->io.read = fileRead;
+	file->io.prefetch = NULL;
+	file->io.size = fileSize;
+	file->io.handle = file;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOFileClose                                          **/
+/**                                                                      **/
+/**   Close a backend opened with tiffIOFileOpen.                        **/
+/**                                                                      **/
+
+void tiffIOFileClose(tiffIOFile *file)
+{
+	if(file->fd >= 0)
+	{
+		close(file->fd);
+		file->fd = -1;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOLimitInit                                          **/
+/**                                                                      **/
+/**   Initialize a token bucket, full.                                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   limit  -- bucket to initialize                                     **/
+/**   rate   -- units per second, 0 for no limit                         **/
+/**                                                                      **/
+
+void tiffIOLimitInit(tiffIOLimit *limit, double rate)
+{
+	memset(limit, 0, sizeof(*limit) );
+
+	pthread_mutex_init(&limit->lock, NULL);
+	limit->rate = rate;
+	limit->tokens = rate;
+	limit->lastNs = tiffStatsClock();
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOLimitFree                                          **/
+/**                                                                      **/
+/**   Free a token bucket initialized with tiffIOLimitInit.              **/
+/**                                                                      **/
+
+void tiffIOLimitFree(tiffIOLimit *limit)
+{
+	pthread_mutex_destroy(&limit->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOLimitTake                                          **/
+/**                                                                      **/
+/**   Take units from a token bucket, sleeping until the bucket has paid **/
+/**   them off when it runs short. Units are taken at once even beyond   **/
+/**   what the bucket holds, so a read larger than a second worth of     **/
+/**   units still goes through, and the threads coming after wait for    **/
+/**   the debt. Does nothing for a NULL bucket or one without a limit.   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   limit  -- bucket, or NULL                                          **/
+/**   units  -- units taken                                              **/
+/**                                                                      **/
+
+void tiffIOLimitTake(tiffIOLimit *limit, double units)
+{
+	struct timespec delay;
+	unsigned long long now;
+	unsigned long long waitNs = 0;
+
+	if( (limit == NULL) || (limit->rate <= 0) )
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&limit->lock);
+	now = tiffStatsClock();
+	limit->tokens += limit->rate * (double)(now - limit->lastNs) / 1e9;
+	if(limit->tokens > limit->rate)
+	{
+		limit->tokens = limit->rate;
+	}
+	limit->lastNs = now;
+	limit->tokens -= units;
+	if(limit->tokens < 0)
+	{
+		waitNs = (unsigned long long)(-limit->tokens / limit->rate * 1e9);
+		limit->waitNs += waitNs;
+	}
+	pthread_mutex_unlock(&limit->lock);
+
+	delay.tv_sec = (time_t)(waitNs / 1000000000ULL);
+	delay.tv_nsec = (long)(waitNs % 1000000000ULL);
+	while( (waitNs > 0) && (nanosleep(&delay, &delay) != 0) &&
+		(errno == EINTR) )
+	{
+		continue;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: uncachedResident                                         **/
+/**                                                                      **/
+/**   Fill vec with the page cache residency of the pages of a span of   **/
+/**   the file, one byte per page of file->align bytes. Returns 0 on     **/
+/**   success, 1 if it can't be told.                                    **/
+/**                                                                      **/
+
+static int uncachedResident(tiffIOUncached *file, unsigned long long offset,
+	size_t length, unsigned char *vec)
+{
+	void *map;
+	int status;
+
+	map = mmap(NULL, length, PROT_READ, MAP_SHARED, file->fd,
+		(off_t)offset);
+	if(map == MAP_FAILED)
+	{
+		return 1;
+	}
+	status = mincore(map, length, vec);
+	munmap(map, length);
+
+	return (status == 0) ? 0 : 1;
+}
+
+
+/**                                                                      **/
+/**   Function: uncachedSpan                                             **/
+/**                                                                      **/
+/**   Read one aligned span of the file into the buffer, leaving in the  **/
+/**   page cache only the pages that were there before. Pages are        **/
+/**   counted in file->align bytes, the system page size that mincore    **/
+/**   reports in, of which TIFF_IO_PAGE is only the smallest. When       **/
+/**   mincore can't tell which pages were cached, none are dropped,      **/
+/**   since evicting pages someone else cached costs more than keeping   **/
+/**   ours. Returns the bytes read, or -1 on error.                      **/
+/**                                                                      **/
+
+static ssize_t uncachedSpan(tiffIOUncached *file, unsigned long long offset,
+	size_t length)
+{
+	size_t pages;
+	/* one byte per page, sized for the smallest page size */
+	unsigned char before[TIFF_IO_MAX_SPAN / TIFF_IO_PAGE];
+	unsigned char after[TIFF_IO_MAX_SPAN / TIFF_IO_PAGE];
+	int known;
+	size_t got = 0;
+	size_t i;
+	size_t run;
+	ssize_t n;
+
+	/* pages past the end of the file are neither read nor cached */
+	pages = (size_t)( (file->size - offset < length) ?
+		file->size - offset : length);
+	pages = (pages + file->align - 1) / file->align;
+
+	tiffIOLimitTake(file->limit, (double)length);
+
+	known = (uncachedResident(file, offset, length, before) == 0);
+	while(got < length)
+	{
+		n = pread(file->fd, file->buffer + got, length - got,
+			(off_t)(offset + got) );
+		if( (n < 0) && (errno == EINTR) )
+		{
+			continue;
+		}
+		if( (n < 0) && (errno == EINVAL) && file->direct)
+		{
+			/* the file system takes O_DIRECT opens but not reads */
+			fcntl(file->fd, F_SETFL,
+				fcntl(file->fd, F_GETFL) & ~O_DIRECT);
+			file->direct = 0;
+			continue;
+		}
+		if(n < 0)
+		{
+			return -1;
+		}
+		if(n == 0)
+		{
+			break;
+		}
+		got += (size_t)n;
+	}
+
+	if( (!file->direct) && known)
+	{
+		/* drop the runs of pages this read brought in */
+		for(i = 0;i < pages;i = run)
+		{
+			for(run = i;(run < pages) && !(before[run] & 1);run++)
+			{
+				continue;
+			}
+			if(run > i)
+			{
+				posix_fadvise(file->fd,
+					(off_t)(offset + i * file->align),
+					(off_t)( (run - i) * file->align),
+					POSIX_FADV_DONTNEED);
+			}
+			else
+			{
+				run++;
+			}
+		}
+	}
+
+	file->pagesRead += pages;
+	if(known && (uncachedResident(file, offset, length, after) == 0) )
+	{
+		for(i = 0;i < pages;i++)
+		{
+			if( (after[i] & 1) && !(before[i] & 1) )
+			{
+				file->pagesLeft++;
+			}
+		}
+	}
+
+	return (ssize_t)got;
+}
+
+
+/**                                                                      **/
+/**   Function: uncachedRead                                             **/
+/**                                                                      **/
+/**   tiffIO read function of the uncached backend. Every range is read  **/
+/**   as whole aligned pages, in spans of at most TIFF_IO_MAX_SPAN.      **/
+/**                                                                      **/
+
+static int uncachedRead(void *handle, tiffIORange *ranges,
+	unsigned int numRanges)
+{
+	tiffIOUncached *file = (tiffIOUncached *)handle;
+	tiffIORange *range;
+	unsigned long long start;
+	unsigned long long end;
+	unsigned long long offset;
+	size_t length;
+	size_t skip;
+	size_t copy;
+	ssize_t got;
+	unsigned int i;
+
+	for(i = 0;i < numRanges;i++)
+	{
+		range = &ranges[i];
+		range->got = 0;
+		while( (range->got < range->length) &&
+			(range->offset + range->got < file->size) )
+		{
+			offset = range->offset + range->got;
+			start = offset / file->align * file->align;
+			end = start + TIFF_IO_MAX_SPAN;
+			if(end > offset + (range->length - range->got) )
+			{
+				end = offset + (range->length - range->got);
+			}
+			end = (end + file->align - 1) / file->align * file->align;
+			length = (size_t)(end - start);
+
+			got = uncachedSpan(file, start, length);
+			if(got < 0)
+			{
+				return 1;
+			}
+			skip = (size_t)(offset - start);
+			if( (size_t)got <= skip)
+			{
+				break;
+			}
+			copy = (size_t)got - skip;
+			if(copy > range->length - range->got)
+			{
+				copy = range->length - range->got;
+			}
+			memcpy(range->dst + range->got, file->buffer + skip, copy);
+			range->got += copy;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: uncachedSize                                             **/
+/**                                                                      **/
+/**   tiffIO size function of the uncached backend.                      **/
+/**                                                                      **/
+
+static unsigned long long uncachedSize(void *handle)
+{
+	return ( (tiffIOUncached *)handle)->size;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOUncachedOpen                                       **/
+/**                                                                      **/
+/**   Open a local file as an uncached backend, with O_DIRECT if the file**/
+/**   system allows it. Returns 0 on success, 1 with a message on stderr **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   file      -- backend to open                                       **/
+/**   filename  -- file name                                             **/
+/**   limit     -- limit of bytes per second shared with other backends, **/
+/**                or NULL                                               **/
+/**                                                                      **/
+
+int tiffIOUncachedOpen(tiffIOUncached *file, const char *filename,
+	tiffIOLimit *limit)
+{
+	static const int flags[] = { O_DIRECT | O_NOATIME, O_DIRECT,
+		O_NOATIME, 0 };
+	struct stat st;
+	long pageSize;
+	unsigned int i;
+
+	memset(file, 0, sizeof(*file) );
+
+	/* O_NOATIME is refused for files of other users, O_DIRECT by some */
+	/* file systems */
+	file->fd = -1;
+	for(i = 0;(file->fd < 0) && (i < sizeof(flags) / sizeof(flags[0]) );
+		i++)
+	{
+		file->fd = open(filename, O_RDONLY | flags[i]);
+		if( (file->fd < 0) && (errno != EINVAL) && (errno != EPERM) )
+		{
+			break;
+		}
+		file->direct = ( (file->fd >= 0) && (flags[i] & O_DIRECT) );
+	}
+	if(file->fd < 0)
+	{
+		fprintf(stderr, "can't open %s to read\n", filename);
+
+		return 1;
+	}
+	if(fstat(file->fd, &st) != 0)
+	{
+		fprintf(stderr, "can't stat %s\n", filename);
+		close(file->fd);
+		file->fd = -1;
+
+		return 1;
+	}
+
+	pageSize = sysconf(_SC_PAGESIZE);
+	file->align = ( (pageSize > TIFF_IO_PAGE) &&
+		(pageSize <= TIFF_IO_MAX_SPAN) ) ? (size_t)pageSize : TIFF_IO_PAGE;
+	file->bufferSize = TIFF_IO_MAX_SPAN;
+	if(posix_memalign( (void **)&file->buffer, file->align,
+		file->bufferSize) != 0)
+	{
+		fprintf(stderr, "out of memory reading %s\n", filename);
+		close(file->fd);
+		file->fd = -1;
+
+		return 1;
+	}
+	posix_fadvise(file->fd, 0, 0, POSIX_FADV_RANDOM);
+
+	file->size = (unsigned long long)st.st_size;
+	file->limit = limit;
+	file->io.read = uncachedRead;
+	file->io.prefetch = NULL;
+	file->io.size = uncachedSize;
+	file->io.handle = file;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOUncachedClose                                      **/
+/**                                                                      **/
+/**   Close a backend opened with tiffIOUncachedOpen.                    **/
+/**                                                                      **/
+
+void tiffIOUncachedClose(tiffIOUncached *file)
+{
+	if(file->fd >= 0)
+	{
+		close(file->fd);
+		file->fd = -1;
+	}
+	free(file->buffer);
+	file->buffer = NULL;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOIdlePriority                                       **/
+/**                                                                      **/
+/**   Put the calling process, and the threads it creates afterwards, in **/
+/**   the idle I/O scheduling class, so that its reads are served only   **/
+/**   when the disk has nothing else to do. Returns 0 on success, 1 where**/
+/**   the kernel does not support it.                                    **/
+/**                                                                      **/
+/**   No input parameters                                                **/
+/**                                                                      **/
+
+int tiffIOIdlePriority(void)
+{
+#ifdef SYS_ioprio_set
+	/* IOPRIO_WHO_PROCESS, the calling process, IOPRIO_CLASS_IDLE */
+	if(syscall(SYS_ioprio_set, 1, 0, 3 << 13) == 0)
+	{
+		return 0;
+	}
+#endif
+
+	return 1;
+}
+
+
+/**                                                                      **/
+/**   Function: latencyRead                                              **/
+/**                                                                      **/
+/**   tiffIO read function of the latency backend: one round trip.       **/
+/**                                                                      **/
+
+static int latencyRead(void *handle, tiffIORange *ranges,
+	unsigned int numRanges)
+{
+	tiffIOLatency *latency = (tiffIOLatency *)handle;
+	struct timespec delay;
+	unsigned int i;
+	int status;
+
+	delay.tv_sec = (time_t)(latency->latencyNs / 1000000000ULL);
+	delay.tv_nsec = (long)(latency->latencyNs % 1000000000ULL);
+	while( (nanosleep(&delay, &delay) != 0) && (errno == EINTR) )
+	{
+		continue;
+	}
+
+	status = latency->backend->read(latency->backend->handle, ranges,
+		numRanges);
+
+	latency->roundTrips++;
+	for(i = 0;i < numRanges;i++)
+	{
+		latency->bytes += ranges[i].got;
+	}
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: latencySize                                              **/
+/**                                                                      **/
+/**   tiffIO size function of the latency backend. The size is taken to  **/
+/**   come with the first response, so it costs no round trip.           **/
+/**                                                                      **/
+
+static unsigned long long latencySize(void *handle)
+{
+	tiffIOLatency *latency = (tiffIOLatency *)handle;
+
+	return latency->backend->size(latency->backend->handle);
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOLatencyInit                                        **/
+/**                                                                      **/
+/**   Wrap a backend so that every read sleeps for a fixed latency.      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   latency    -- backend to initialize                                **/
+/**   backend    -- backend the reads are passed to                      **/
+/**   latencyUs  -- latency of a round trip in microseconds              **/
+/**                                                                      **/
+
+void tiffIOLatencyInit(tiffIOLatency *latency, tiffIO *backend,
+	unsigned long long latencyUs)
+{
+	memset(latency, 0, sizeof(*latency) );
+
+	latency->backend = backend;
+	latency->latencyNs = latencyUs * 1000;
+	latency->io.read = latencyRead;
+	latency->io.prefetch = NULL;
+	latency->io.size = latencySize;
+	latency->io.handle = latency;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: findBlock                                                **/
+/**                                                                      **/
+/**   Return the planner block holding the first byte of a range and     **/
+/**   as many of the others as there are, or NULL.                       **/
+/**                                                                      **/
+
+static const tiffIOBlock *findBlock(const tiffIOPlanner *planner,
+	unsigned long long offset)
+{
+	const tiffIOBlock *best = NULL;
+	const tiffIOBlock *block;
+	unsigned int i;
+
+	for(i = 0;i < planner->numBlocks;i++)
+	{
+		block = &planner->blocks[i];
+		if( (offset >= block->offset) &&
+			(offset < block->offset + block->length) &&
+			( (best == NULL) || (block->offset + block->length >
+			best->offset + best->length) ) )
+		{
+			best = block;
+		}
+	}
+
+	return best;
+}
+
+
+/**                                                                      **/
+/**   Function: isHeld                                                   **/
+/**                                                                      **/
+/**   Return 1 if the planner holds every byte of a range that lies      **/
+/**   inside the file, 0 otherwise.                                      **/
+/**                                                                      **/
+
+static int isHeld(const tiffIOPlanner *planner, unsigned long long offset,
+	size_t length, unsigned long long size)
+{
+	const tiffIOBlock *block;
+	unsigned long long end;
+
+	if(offset >= size)
+	{
+		return 1;
+	}
+
+	end = (length > size - offset) ? size : offset + length;
+	block = findBlock(planner, offset);
+
+	return (block != NULL) && (block->offset + block->length >= end);
+}
+
+
+/**                                                                      **/
+/**   Function: compareRanges                                            **/
+/**                                                                      **/
+/**   qsort comparison of ranges by offset.                              **/
+/**                                                                      **/
+
+static int compareRanges(const void *a, const void *b)
+{
+	const tiffIORange *ra = (const tiffIORange *)a;
+	const tiffIORange *rb = (const tiffIORange *)b;
+
+	if(ra->offset != rb->offset)
+	{
+		return (ra->offset < rb->offset) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: fetchRanges                                              **/
+/**                                                                      **/
+/**   Fetch ranges missing from the planner in one round trip. Each is   **/
+/**   widened to TIFF_IO_MIN_FETCH bytes, and ranges less than that far  **/
+/**   apart are merged. Returns 0 on success, 1 on failure.              **/
+/**                                                                      **/
+
+static int fetchRanges(tiffIOPlanner *planner, tiffIORange *ranges,
+	unsigned int numRanges, unsigned long long size)
+{
+	tiffIORange fetch[TIFF_IO_MAX_RANGES];
+	tiffIOBlock *blocks;
+	unsigned long long end;
+	unsigned int numFetch = 0;
+	unsigned int i;
+	int status;
+
+	qsort(ranges, numRanges, sizeof(*ranges), compareRanges);
+
+	for(i = 0;i < numRanges;i++)
+	{
+		if(ranges[i].offset >= size)
+		{
+			continue;
+		}
+
+		end = ranges[i].offset + ( (ranges[i].length > TIFF_IO_MIN_FETCH) ?
+			ranges[i].length : TIFF_IO_MIN_FETCH);
+		if(end > size)
+		{
+			end = size;
+		}
+
+		if( (numFetch > 0) && (ranges[i].offset <=
+			fetch[numFetch - 1].offset + fetch[numFetch - 1].length +
+			TIFF_IO_MIN_FETCH) )
+		{
+			if(end > fetch[numFetch - 1].offset +
+				fetch[numFetch - 1].length)
+			{
+				fetch[numFetch - 1].length = (size_t)(end -
+					fetch[numFetch - 1].offset);
+			}
+		}
+		else
+		{
+			fetch[numFetch].offset = ranges[i].offset;
+			fetch[numFetch].length = (size_t)(end - ranges[i].offset);
+			numFetch++;
+		}
+	}
+
+	if(numFetch == 0)
+	{
+		return 0;
+	}
+
+	if(planner->numBlocks + numFetch > planner->maxBlocks)
+	{
+		blocks = (tiffIOBlock *)realloc(planner->blocks,
+			(planner->numBlocks + numFetch + 16) * sizeof(*blocks) );
+		if(blocks == NULL)
+		{
+			return 1;
+		}
+		planner->blocks = blocks;
+		planner->maxBlocks = planner->numBlocks + numFetch + 16;
+	}
+
+	status = 0;
+	for(i = 0;i < numFetch;i++)
+	{
+		fetch[i].got = 0;
+		fetch[i].dst = (unsigned char *)malloc(fetch[i].length);
+		if(fetch[i].dst == NULL)
+		{
+			status = 1;
+		}
+	}
+
+	if(status == 0)
+	{
+		status = planner->backend->read(planner->backend->handle, fetch,
+			numFetch);
+	}
+	planner->roundTrips += (status == 0);
+
+	for(i = 0;i < numFetch;i++)
+	{
+		if( (status != 0) || (fetch[i].got == 0) )
+		{
+			free(fetch[i].dst);
+			continue;
+		}
+
+		planner->blocks[planner->numBlocks].offset = fetch[i].offset;
+		planner->blocks[planner->numBlocks].length = fetch[i].got;
+		planner->blocks[planner->numBlocks].data = fetch[i].dst;
+		planner->numBlocks++;
+		planner->bytesFetched += fetch[i].got;
+	}
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: setWindows                                               **/
+/**                                                                      **/
+/**   Take the windows of a planner from its policy, once per file.      **/
+/**                                                                      **/
+
+static void setWindows(tiffIOPlanner *planner)
+{
+	if(planner->windowsSet)
+	{
+		return;
+	}
+
+	if(planner->policy != NULL)
+	{
+		pthread_mutex_lock(&planner->policy->lock);
+		planner->headBytes = planner->policy->headBytes;
+		planner->tailBytes = planner->policy->tailBytes;
+		pthread_mutex_unlock(&planner->policy->lock);
+	}
+	planner->windowsSet = 1;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: inWindows                                                **/
+/**                                                                      **/
+/**   Return 1 if a range lies inside the head or the tail window.       **/
+/**                                                                      **/
+
+static int inWindows(const tiffIOPlanner *planner, unsigned long long offset,
+	size_t length, unsigned long long size)
+{
+	unsigned long long end;
+
+	end = (offset + length < size) ? offset + length : size;
+
+	return (end <= planner->headBytes) ||
+		( (planner->tailBytes > 0) && (offset + planner->tailBytes >= size) );
+}
+
+
+/**                                                                      **/
+/**   Function: fetchMissing                                             **/
+/**                                                                      **/
+/**   Fetch the ranges the planner doesn't hold, in one round trip per   **/
+/**   TIFF_IO_MAX_RANGES of them. The first fetch of a file also brings  **/
+/**   in its head and tail windows. Returns 0 on success, 1 on failure.  **/
+/**                                                                      **/
+
+static int fetchMissing(tiffIOPlanner *planner, const tiffIORange *ranges,
+	unsigned int numRanges)
+{
+	tiffIORange missing[TIFF_IO_MAX_RANGES];
+	unsigned long long size;
+	unsigned int numMissing = 0;
+	unsigned int i;
+	int first;
+
+	size = planner->backend->size(planner->backend->handle);
+
+	first = (planner->roundTrips == 0);
+	if(first)
+	{
+		setWindows(planner);
+		if(planner->headBytes > 0)
+		{
+			missing[numMissing].offset = 0;
+			missing[numMissing].length = planner->headBytes;
+			numMissing++;
+		}
+		if( (planner->tailBytes > 0) && (size > planner->headBytes) )
+		{
+			missing[numMissing].offset =
+				(size - planner->headBytes > planner->tailBytes) ?
+				size - planner->tailBytes : planner->headBytes;
+			missing[numMissing].length =
+				(size_t)(size - missing[numMissing].offset);
+			numMissing++;
+		}
+	}
+
+	for(i = 0;i < numRanges;i++)
+	{
+		if( (first && inWindows(planner, ranges[i].offset,
+			ranges[i].length, size) ) ||
+			isHeld(planner, ranges[i].offset, ranges[i].length, size) )
+		{
+			continue;
+		}
+
+		if(numMissing == TIFF_IO_MAX_RANGES)
+		{
+			if(fetchRanges(planner, missing, numMissing, size) != 0)
+			{
+				return 1;
+			}
+			numMissing = 0;
+		}
+		missing[numMissing] = ranges[i];
+		numMissing++;
+	}
+
+	if( (numMissing > 0) &&
+		(fetchRanges(planner, missing, numMissing, size) != 0) )
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: noteRead                                                 **/
+/**                                                                      **/
+/**   Count a read as a hit when it needs no round trip of its own, and  **/
+/**   remember how far from the start or the end of the file it lies.    **/
+/**                                                                      **/
+
+static void noteRead(tiffIOPlanner *planner, const tiffIORange *range,
+	unsigned long long size)
+{
+	unsigned long long maxBytes = TIFF_IO_MAX_WINDOW;
+	unsigned long long end;
+
+	planner->reads++;
+	if( (planner->roundTrips == 0) ?
+		inWindows(planner, range->offset, range->length, size) :
+		isHeld(planner, range->offset, range->length, size) )
+	{
+		planner->hits++;
+	}
+
+	if(planner->policy != NULL)
+	{
+		maxBytes = planner->policy->maxBytes;
+	}
+
+	end = (range->offset + range->length < size) ?
+		range->offset + range->length : size;
+	if( (end <= maxBytes) && (end > planner->headNeeded) )
+	{
+		planner->headNeeded = end;
+	}
+	else if( (end > maxBytes) && (range->offset < size) &&
+		(size - range->offset <= maxBytes) &&
+		(size - range->offset > planner->tailNeeded) )
+	{
+		planner->tailNeeded = size - range->offset;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: plannerRead                                              **/
+/**                                                                      **/
+/**   tiffIO read function of the planner: fetch what is missing, then   **/
+/**   copy every range from the blocks held.                             **/
+/**                                                                      **/
+
+static int plannerRead(void *handle, tiffIORange *ranges,
+	unsigned int numRanges)
+{
+	tiffIOPlanner *planner = (tiffIOPlanner *)handle;
+	const tiffIOBlock *block;
+	unsigned long long available;
+	unsigned long long size;
+	tiffIORange *range;
+	unsigned int i;
+
+	size = planner->backend->size(planner->backend->handle);
+	setWindows(planner);
+	for(i = 0;i < numRanges;i++)
+	{
+		noteRead(planner, &ranges[i], size);
+	}
+
+	if(fetchMissing(planner, ranges, numRanges) != 0)
+	{
+		return 1;
+	}
+
+	for(i = 0;i < numRanges;i++)
+	{
+		range = &ranges[i];
+		range->got = 0;
+		block = findBlock(planner, range->offset);
+		if(block == NULL)
+		{
+			continue;
+		}
+
+		available = block->offset + block->length - range->offset;
+		range->got = (available < range->length) ? (size_t)available :
+			range->length;
+		memcpy(range->dst, block->data + (range->offset - block->offset),
+			range->got);
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: plannerPrefetch                                          **/
+/**                                                                      **/
+/**   tiffIO prefetch function of the planner.                           **/
+/**                                                                      **/
+
+static void plannerPrefetch(void *handle, const tiffIORange *ranges,
+	unsigned int numRanges)
+{
+	fetchMissing( (tiffIOPlanner *)handle, ranges, numRanges);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: plannerSize                                              **/
+/**                                                                      **/
+/**   tiffIO size function of the planner.                               **/
+/**                                                                      **/
+
+static unsigned long long plannerSize(void *handle)
+{
+	tiffIOPlanner *planner = (tiffIOPlanner *)handle;
+
+	return planner->backend->size(planner->backend->handle);
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOPlannerInit                                        **/
+/**                                                                      **/
+/**   Wrap a backend in a read planner.                                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   planner        -- planner to initialize                            **/
+/**   backend        -- backend fetched from                             **/
+/**   prefetchBytes  -- head window of the first fetch, 0 for none       **/
+/**                                                                      **/
+
+void tiffIOPlannerInit(tiffIOPlanner *planner, tiffIO *backend,
+	size_t prefetchBytes)
+{
+	memset(planner, 0, sizeof(*planner) );
+
+	planner->backend = backend;
+	planner->headBytes = prefetchBytes;
+	planner->tailBytes = 0;
+	planner->policy = NULL;
+	planner->io.read = plannerRead;
+	planner->io.prefetch = plannerPrefetch;
+	planner->io.size = plannerSize;
+	planner->io.handle = planner;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOPlannerFree                                        **/
+/**                                                                      **/
+/**   Free the blocks held by a planner.                                 **/
+/**                                                                      **/
+
+void tiffIOPlannerFree(tiffIOPlanner *planner)
+{
+	unsigned int i;
+
+	for(i = 0;i < planner->numBlocks;i++)
+	{
+		free(planner->blocks[i].data);
+	}
+	free(planner->blocks);
+	planner->blocks = NULL;
+	planner->numBlocks = 0;
+	planner->maxBlocks = 0;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOPolicyInit                                         **/
+/**                                                                      **/
+/**   Initialize a prefetch policy.                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   policy     -- policy to initialize                                 **/
+/**   headBytes  -- initial head window                                  **/
+/**   tailBytes  -- initial tail window                                  **/
+/**   maxBytes   -- largest window                                       **/
+/**                                                                      **/
+
+void tiffIOPolicyInit(tiffIOPolicy *policy, size_t headBytes,
+	size_t tailBytes, size_t maxBytes)
+{
+	memset(policy, 0, sizeof(*policy) );
+
+	pthread_mutex_init(&policy->lock, NULL);
+	policy->headBytes = headBytes;
+	policy->tailBytes = tailBytes;
+	policy->maxBytes = maxBytes;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOPolicyFree                                         **/
+/**                                                                      **/
+/**   Free a prefetch policy.                                            **/
+/**                                                                      **/
+
+void tiffIOPolicyFree(tiffIOPolicy *policy)
+{
+	pthread_mutex_destroy(&policy->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: bucketOf                                                 **/
+/**                                                                      **/
+/**   Return the policy bucket of a distance in bytes.                   **/
+/**                                                                      **/
+
+static unsigned int bucketOf(unsigned long long n)
+{
+	unsigned int bucket = 1;
+
+	if(n == 0)
+	{
+		return 0;
+	}
+
+	while( (bucket < TIFF_IO_POLICY_BUCKETS - 1) &&
+		( (1ULL << (bucket - 1) ) < n) )
+	{
+		bucket++;
+	}
+
+	return bucket;
+}
+
+
+/**                                                                      **/
+/**   Function: coverWindow                                              **/
+/**                                                                      **/
+/**   Return the smallest window covering TIFF_IO_POLICY_COVER percent   **/
+/**   of the files counted in a bucket histogram.                        **/
+/**                                                                      **/
+
+static unsigned long long coverWindow(const unsigned long long *buckets,
+	unsigned long long files)
+{
+	unsigned long long covered = 0;
+	unsigned int i;
+
+	for(i = 0;i < TIFF_IO_POLICY_BUCKETS;i++)
+	{
+		covered += buckets[i];
+		if(covered * 100 >= files * TIFF_IO_POLICY_COVER)
+		{
+			return (i == 0) ? 0 : 1ULL << (i - 1);
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOPolicyLearn                                        **/
+/**                                                                      **/
+/**   Learn from the reads of a file once it was parsed, growing the     **/
+/**   windows of the policy to cover where they landed.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   policy   -- policy                                                 **/
+/**   planner  -- planner the file was read through                      **/
+/**                                                                      **/
+
+void tiffIOPolicyLearn(tiffIOPolicy *policy, const tiffIOPlanner *planner)
+{
+	unsigned long long window;
+
+	pthread_mutex_lock(&policy->lock);
+
+	policy->files++;
+	policy->oneTrip += (planner->roundTrips <= 1);
+	policy->reads += planner->reads;
+	policy->hits += planner->hits;
+	policy->head[bucketOf(planner->headNeeded)]++;
+	policy->tail[bucketOf(planner->tailNeeded)]++;
+
+	window = coverWindow(policy->head, policy->files);
+	if(window > policy->maxBytes)
+	{
+		window = policy->maxBytes;
+	}
+	if(window > policy->headBytes)
+	{
+		policy->headBytes = (size_t)window;
+	}
+
+	window = coverWindow(policy->tail, policy->files);
+	if(window > policy->maxBytes)
+	{
+		window = policy->maxBytes;
+	}
+	if(window > policy->tailBytes)
+	{
+		policy->tailBytes = (size_t)window;
+	}
+
+	pthread_mutex_unlock(&policy->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffIOPolicyPrint                                        **/
+/**                                                                      **/
+/**   Print the hit rates and the windows of a policy.                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   out     -- output stream                                           **/
+/**   policy  -- policy                                                  **/
+/**                                                                      **/
+
+void tiffIOPolicyPrint(FILE *out, tiffIOPolicy *policy)
+{
+	pthread_mutex_lock(&policy->lock);
+
+	fprintf(out, "prefetch files %llu, in one round trip %llu (%.1f%%)\n",
+		policy->files, policy->oneTrip, (policy->files == 0) ? 0.0 :
+		100.0 * policy->oneTrip / policy->files);
+	fprintf(out, "prefetch reads %llu, hits %llu (%.1f%%)\n",
+		policy->reads, policy->hits, (policy->reads == 0) ? 0.0 :
+		100.0 * policy->hits / policy->reads);
+	fprintf(out, "prefetch windows head %zu tail %zu bytes\n",
+		policy->headBytes, policy->tailBytes);
+
+	pthread_mutex_unlock(&policy->lock);
+
+	return;
+}
@@ -0,0 +1,356 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Random-access I/O backends.                                        **/
+/**                                                                      **/
+/**   The parser reads files through tiffReadAt. Local files opened by   **/
+/**   tiffOpen are mapped or read with stdio as before; setting          **/
+/**   internal->io before tiffOpen makes every read go through a tiffIO  **/
+/**   backend instead, so that files can be parsed where each read is a  **/
+/**   round trip, such as an object store answering HTTP range requests. **/
+/**                                                                      **/
+/**   A backend reads a batch of ranges per call, and every call counts  **/
+/**   as one round trip. Four backends are provided:                     **/
+/**                                                                      **/
+/**       tiffIOFile      local file read with pread(2)                  **/
+/**       tiffIOUncached  local file read so as to leave nothing behind  **/
+/**                       in the page cache                              **/
+/**       tiffIOLatency   wraps a backend, sleeping for a fixed latency  **/
+/**                       per call, to simulate a remote store           **/
+/**       tiffIOPlanner   wraps a backend to make few round trips: it    **/
+/**                       fetches a head and a tail window of the file   **/
+/**                       on the first read, fetches misses in blocks    **/
+/**                       of at least TIFF_IO_MIN_FETCH bytes, and keeps **/
+/**                       everything it fetched                          **/
+/**                                                                      **/
+/**   The planner also takes prefetch hints: once the entry table of an  **/
+/**   IFD is read, tiffIFDWalk hints the ranges of all its out-of-line   **/
+/**   values and of the IFDs it points to, and the planner fetches the   **/
+/**   ones it doesn't hold in a single round trip.                       **/
+/**                                                                      **/
+/**   Planners of a run may share a tiffIOPolicy, which sizes their      **/
+/**   windows. It starts from given head and tail windows, learns from   **/
+/**   every file where its reads landed (how far from the start, or from **/
+/**   the end), and grows each window to the smallest power of two       **/
+/**   covering TIFF_IO_POLICY_COVER percent of the files so far, up to   **/
+/**   a maximum. Files whose IFDs and values lie in the covered spots    **/
+/**   are then parsed with the single round trip of the first read.      **/
+/**                                                                      **/
+/**   The uncached backend is for scans sharing hosts with servers whose **/
+/**   working set lives in the page cache. It reads whole aligned pages  **/
+/**   with O_DIRECT, bypassing the cache, where the file system allows   **/
+/**   it. Elsewhere it turns off readahead and, after each read, drops   **/
+/**   with POSIX_FADV_DONTNEED the pages that mincore(2) showed were not **/
+/**   cached before, so the pages of other processes stay. It counts the **/
+/**   pages it read and those still cached afterwards. Under a planner,  **/
+/**   most files then take one or two reads. Token buckets (tiffIOLimit) **/
+/**   shared by the threads of a run cap the bytes and files per second, **/
+/**   and tiffIOIdlePriority puts the process in the idle I/O class.     **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_IO_H
+#define _TIFF_IO_H
+
+#include <pthread.h>
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Planner sizes: bytes fetched on the first read, smallest fetch, and **/
+/**  most ranges hinted or fetched at once                               **/
+/**                                                                      **/
+
+#define TIFF_IO_PREFETCH (64 * 1024)
+#define TIFF_IO_MIN_FETCH (16 * 1024)
+#define TIFF_IO_MAX_RANGES 64
+
+
+/**                                                                      **/
+/**  Policy limits: largest window, percentage of files the windows are  **/
+/**  grown to cover, and power-of-two buckets of read locations          **/
+/**                                                                      **/
+
+#define TIFF_IO_MAX_WINDOW (4 * 1024 * 1024)
+#define TIFF_IO_POLICY_COVER 90
+#define TIFF_IO_POLICY_BUCKETS 40
+
+
+/**                                                                      **/
+/**  Uncached reads: smallest page size, and largest span read at once   **/
+/**                                                                      **/
+
+#define TIFF_IO_PAGE 4096
+#define TIFF_IO_MAX_SPAN (1024 * 1024)
+
+
+/**                                                                      **/
+/**  Range read by a backend                                             **/
+/**                                                                      **/
+/**  offset, length                                                      **/
+/**      offset from the start of the file and number of bytes wanted    **/
+/**  dst                                                                 **/
+/**      buffer receiving the bytes, NULL for a prefetch hint            **/
+/**  got                                                                 **/
+/**      bytes read, less than length at the end of the file             **/
+/**                                                                      **/
+
+typedef struct tiffIORange
+{
+	unsigned long long offset;
+	size_t length;
+	unsigned char *dst;
+	size_t got;
+} tiffIORange;
+
+
+/**                                                                      **/
+/**  Backend interface                                                   **/
+/**                                                                      **/
+/**  read                                                                **/
+/**      read a batch of ranges in one round trip; returns 0 on success, **/
+/**      1 on failure                                                    **/
+/**  prefetch                                                            **/
+/**      hint ranges about to be read, or NULL if the backend ignores    **/
+/**      hints                                                           **/
+/**  size                                                                **/
+/**      size of the file                                                **/
+/**  handle                                                              **/
+/**      backend state passed to the functions                           **/
+/**                                                                      **/
+
+typedef struct tiffIO
+{
+	int (*read)(void *handle, tiffIORange *ranges, unsigned int numRanges);
+	void (*prefetch)(void *handle, const tiffIORange *ranges,
+		unsigned int numRanges);
+	unsigned long long (*size)(void *handle);
+	void *handle;
+} tiffIO;
+
+
+/**                                                                      **/
+/**  Local file backend                                                  **/
+/**                                                                      **/
+
+typedef struct tiffIOFile
+{
+	tiffIO io;
+	int fd;
+	unsigned long long size;
+} tiffIOFile;
+
+
+/**                                                                      **/
+/**  Token bucket limiting a rate shared by several threads              **/
+/**                                                                      **/
+/**  lock                                                                **/
+/**      protects the other fields                                       **/
+/**  rate                                                                **/
+/**      units per second, 0 for no limit; at most one second worth of   **/
+/**      units is saved up                                               **/
+/**  tokens, lastNs                                                      **/
+/**      units available, negative when owed, and time of the last       **/
+/**      refill                                                          **/
+/**  waitNs                                                              **/
+/**      time all threads waited                                         **/
+/**                                                                      **/
+
+typedef struct tiffIOLimit
+{
+	pthread_mutex_t lock;
+	double rate;
+	double tokens;
+	unsigned long long lastNs;
+	unsigned long long waitNs;
+} tiffIOLimit;
+
+
+/**                                                                      **/
+/**  Uncached local file backend                                         **/
+/**                                                                      **/
+/**  fd, size                                                            **/
+/**      file and its size                                               **/
+/**  direct                                                              **/
+/**      1 while reading with O_DIRECT                                   **/
+/**  align                                                               **/
+/**      alignment of reads and size of the pages counted, the system    **/
+/**      page size                                                       **/
+/**  buffer, bufferSize                                                  **/
+/**      aligned buffer the pages are read into                          **/
+/**  limit                                                               **/
+/**      limit of bytes per second, or NULL                              **/
+/**  pagesRead, pagesLeft                                                **/
+/**      pages read, and those of them found cached after the read that  **/
+/**      were not before                                                 **/
+/**                                                                      **/
+
+typedef struct tiffIOUncached
+{
+	tiffIO io;
+	int fd;
+	unsigned long long size;
+	int direct;
+	size_t align;
+	unsigned char *buffer;
+	size_t bufferSize;
+	tiffIOLimit *limit;
+	unsigned long long pagesRead;
+	unsigned long long pagesLeft;
+} tiffIOUncached;
+
+
+/**                                                                      **/
+/**  Latency simulating backend                                          **/
+/**                                                                      **/
+/**  backend                                                             **/
+/**      backend the reads are passed to                                 **/
+/**  latencyNs                                                           **/
+/**      time slept per round trip                                       **/
+/**  roundTrips, bytes                                                   **/
+/**      calls made and bytes read                                       **/
+/**                                                                      **/
+
+typedef struct tiffIOLatency
+{
+	tiffIO io;
+	tiffIO *backend;
+	unsigned long long latencyNs;
+	unsigned long long roundTrips;
+	unsigned long long bytes;
+} tiffIOLatency;
+
+
+/**                                                                      **/
+/**  Block of a file held by the planner                                 **/
+/**                                                                      **/
+
+typedef struct tiffIOBlock
+{
+	unsigned long long offset;
+	size_t length;
+	unsigned char *data;
+} tiffIOBlock;
+
+
+/**                                                                      **/
+/**  Prefetch policy shared by the planners of a run                     **/
+/**                                                                      **/
+/**  lock                                                                **/
+/**      protects the other fields                                       **/
+/**  headBytes, tailBytes, maxBytes                                      **/
+/**      current windows, and the size they may grow to                  **/
+/**  files, oneTrip                                                      **/
+/**      files learnt from, and how many took a single round trip        **/
+/**  reads, hits                                                         **/
+/**      reads made, and how many were served without a round trip of    **/
+/**      their own                                                       **/
+/**  head, tail                                                          **/
+/**      files by bucket of the farthest read from the start and from    **/
+/**      the end within maxBytes; bucket 0 holds files without such      **/
+/**      reads, bucket b > 0 those within 2^(b-1) bytes                  **/
+/**                                                                      **/
+
+typedef struct tiffIOPolicy
+{
+	pthread_mutex_t lock;
+	size_t headBytes;
+	size_t tailBytes;
+	size_t maxBytes;
+	unsigned long long files;
+	unsigned long long oneTrip;
+	unsigned long long reads;
+	unsigned long long hits;
+	unsigned long long head[TIFF_IO_POLICY_BUCKETS];
+	unsigned long long tail[TIFF_IO_POLICY_BUCKETS];
+} tiffIOPolicy;
+
+
+/**                                                                      **/
+/**  Read planner                                                        **/
+/**                                                                      **/
+/**  backend                                                             **/
+/**      backend fetched from                                            **/
+/**  headBytes, tailBytes, policy                                        **/
+/**      windows fetched on the first read, taken from the policy when   **/
+/**      one is set                                                      **/
+/**  windowsSet                                                          **/
+/**      1 once the windows are final                                    **/
+/**  numBlocks, maxBlocks, blocks                                        **/
+/**      blocks fetched so far                                           **/
+/**  roundTrips, bytesFetched                                            **/
+/**      backend calls made and bytes they fetched                       **/
+/**  reads, hits, headNeeded, tailNeeded                                 **/
+/**      reads made, reads served without a round trip of their own,     **/
+/**      and the farthest read from the start and from the end, for the  **/
+/**      policy to learn from                                            **/
+/**                                                                      **/
+
+typedef struct tiffIOPlanner
+{
+	tiffIO io;
+	tiffIO *backend;
+	size_t headBytes;
+	size_t tailBytes;
+	tiffIOPolicy *policy;
+	int windowsSet;
+	unsigned int numBlocks;
+	unsigned int maxBlocks;
+	tiffIOBlock *blocks;
+	unsigned long long roundTrips;
+	unsigned long long bytesFetched;
+	unsigned long long reads;
+	unsigned long long hits;
+	unsigned long long headNeeded;
+	unsigned long long tailNeeded;
+} tiffIOPlanner;
+
+
+/**                                                                      **/
+/**  I/O API function declarations                                       **/
+/**                                                                      **/
+
+int tiffIOFileOpen(tiffIOFile *file, const char *filename);
+void tiffIOFileClose(tiffIOFile *file);
+int tiffIOUncachedOpen(tiffIOUncached *file, const char *filename,
+	tiffIOLimit *limit);
+void tiffIOUncachedClose(tiffIOUncached *file);
+void tiffIOLimitInit(tiffIOLimit *limit, double rate);
+void tiffIOLimitFree(tiffIOLimit *limit);
+void tiffIOLimitTake(tiffIOLimit *limit, double units);
+int tiffIOIdlePriority(void);
+void tiffIOLatencyInit(tiffIOLatency *latency, tiffIO *backend,
+	unsigned long long latencyUs);
+void tiffIOPlannerInit(tiffIOPlanner *planner, tiffIO *backend,
+	size_t prefetchBytes);
+void tiffIOPlannerFree(tiffIOPlanner *planner);
+void tiffIOPolicyInit(tiffIOPolicy *policy, size_t headBytes,
+	size_t tailBytes, size_t maxBytes);
+void tiffIOPolicyFree(tiffIOPolicy *policy);
+void tiffIOPolicyLearn(tiffIOPolicy *policy, const tiffIOPlanner *planner);
+void tiffIOPolicyPrint(FILE *out, tiffIOPolicy *policy);
+
+#endif
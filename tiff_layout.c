@@ -0,0 +1,535 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Strip and tile layout analysis.                                    **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdio.h>
+#include "tiff_metadata.h"
+#include "tiff_layout.h"
+#include "tiff_stats.h"
+
+
+/**                                                                      **/
+/**   Per IFD state collected by the layout walker callbacks             **/
+/**                                                                      **/
+
+typedef struct layoutCtx
+{
+	const char *filename;
+	unsigned long long fileSize;
+	tiffEntry offsets;
+	tiffEntry byteCounts;
+	int haveOffsets;
+	int haveByteCounts;
+	int tiled;
+	int numReports;
+} layoutCtx;
+
+
+/**                                                                      **/
+/**   Function: sortChunks                                               **/
+/**                                                                      **/
+/**   Sort chunks by offset with a least significant digit radix sort,   **/
+/**   8 bits per pass. Passes in which every key has the same digit,     **/
+/**   which is most of them for files under 16 MB, are skipped.          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   off, cnt        -- chunk offsets and byte counts, sorted in place  **/
+/**   n               -- number of chunks                                **/
+/**   tmpOff, tmpCnt  -- scratch arrays of n elements                    **/
+/**                                                                      **/
+
+static void sortChunks(unsigned int *off, unsigned int *cnt, size_t n,
+	unsigned int *tmpOff, unsigned int *tmpCnt)
+{
+	size_t hist[256];
+	size_t i;
+	size_t sum;
+	size_t pos;
+	unsigned int shift;
+	unsigned int *srcOff = off;
+	unsigned int *srcCnt = cnt;
+	unsigned int *dstOff = tmpOff;
+	unsigned int *dstCnt = tmpCnt;
+	unsigned int *swap;
+
+	for(shift = 0;shift < 32;shift += 8)
+	{
+		memset(hist, 0, sizeof(hist));
+		for(i = 0;i < n;i++)
+		{
+			hist[(srcOff[i] >> shift) & 0xff]++;
+		}
+
+		if(hist[(srcOff[0] >> shift) & 0xff] == n)
+		{
+			continue;
+		}
+
+		for(i = 0, sum = 0;i < 256;i++)
+		{
+			pos = hist[i];
+			hist[i] = sum;
+			sum += pos;
+		}
+
+		for(i = 0;i < n;i++)
+		{
+			pos = hist[(srcOff[i] >> shift) & 0xff]++;
+			dstOff[pos] = srcOff[i];
+			dstCnt[pos] = srcCnt[i];
+		}
+
+		swap = srcOff;
+		srcOff = dstOff;
+		dstOff = swap;
+		swap = srcCnt;
+		srcCnt = dstCnt;
+		dstCnt = swap;
+	}
+
+	if(srcOff != off)
+	{
+		memcpy(off, srcOff, n * sizeof(*off));
+		memcpy(cnt, srcCnt, n * sizeof(*cnt));
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffLayoutAnalyze                                        **/
+/**                                                                      **/
+/**   Reduce the offset and byte count arrays of a strip or tile layout  **/
+/**   to a tiffLayoutStats summary. The per chunk statistics are plain   **/
+/**   branch free reductions over the arrays so the compiler can         **/
+/**   vectorize them; only the gap and overlap count needs the chunks    **/
+/**   in offset order, and the arrays are only sorted when they are      **/
+/**   not already. Returns 0 on success, 1 on allocation failure.        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   offsets     -- chunk offsets, relative to the TIFF header          **/
+/**   byteCounts  -- chunk byte counts                                   **/
+/**   n           -- number of chunks                                    **/
+/**   limit       -- bytes available after the TIFF header, used to      **/
+/**                  find chunks running past the end of the file        **/
+/**   stats       -- summary filled in by the function                   **/
+/**                                                                      **/
+
+int tiffLayoutAnalyze(const unsigned int *offsets,
+	const unsigned int *byteCounts, size_t n, unsigned long long limit,
+	tiffLayoutStats *stats)
+{
+	size_t i;
+	size_t m;
+	unsigned long long total = 0;
+	unsigned long long past = 0;
+	unsigned long long empty = 0;
+	unsigned long long nonMonotonic = 0;
+	unsigned long long near = 0;
+	unsigned long long end;
+	unsigned long long prevEnd;
+	unsigned long long runEnd;
+	unsigned long long minOffset;
+	unsigned long long maxEnd;
+	unsigned int minBytes = UINT_MAX;
+	unsigned int maxBytes = 0;
+	unsigned int *work = NULL;
+	const unsigned int *off;
+	const unsigned int *cnt;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->chunks = n;
+	stats->locality = 1.0;
+	if(n == 0)
+	{
+		return 0;
+	}
+
+	for(i = 0;i < n;i++)
+	{
+		end = (unsigned long long)offsets[i] + byteCounts[i];
+		total += byteCounts[i];
+		minBytes = (byteCounts[i] < minBytes) ? byteCounts[i] : minBytes;
+		maxBytes = (byteCounts[i] > maxBytes) ? byteCounts[i] : maxBytes;
+		past += (end > limit);
+		empty += (byteCounts[i] == 0);
+	}
+
+	stats->totalBytes = total;
+	stats->minBytes = minBytes;
+	stats->maxBytes = maxBytes;
+	stats->meanBytes = (double)total / (double)n;
+	stats->pastEOF = past;
+	stats->emptyChunks = empty;
+
+	/* Sparse images mark missing chunks with a byte count of 0 and */
+	/* often an offset of 0; leave them out of the ordering checks.  */
+	off = offsets;
+	cnt = byteCounts;
+	m = n;
+	if(empty != 0)
+	{
+		work = (unsigned int *)malloc(4 * n * sizeof(*work));
+		if(work == NULL)
+		{
+			fprintf(stderr, "can't alloc buffer\n");
+
+			return 1;
+		}
+		for(i = 0, m = 0;i < n;i++)
+		{
+			if(byteCounts[i] != 0)
+			{
+				work[m] = offsets[i];
+				work[n + m] = byteCounts[i];
+				m++;
+			}
+		}
+		off = work;
+		cnt = work + n;
+	}
+
+	if(m == 0)
+	{
+		free(work);
+
+		return 0;
+	}
+
+	minOffset = off[0];
+	maxEnd = (unsigned long long)off[0] + cnt[0];
+	for(i = 1;i < m;i++)
+	{
+		prevEnd = (unsigned long long)off[i - 1] + cnt[i - 1];
+		end = (unsigned long long)off[i] + cnt[i];
+		nonMonotonic += (off[i] < off[i - 1]);
+		near += (off[i] >= prevEnd) &
+			(off[i] - prevEnd <= TIFF_LAYOUT_NEAR_BYTES);
+		minOffset = (off[i] < minOffset) ? off[i] : minOffset;
+		maxEnd = (end > maxEnd) ? end : maxEnd;
+	}
+
+	stats->nonMonotonic = nonMonotonic;
+	stats->span = maxEnd - minOffset;
+	if(m > 1)
+	{
+		stats->locality = (double)near / (double)(m - 1);
+	}
+
+	if(nonMonotonic != 0)
+	{
+		if(work == NULL)
+		{
+			work = (unsigned int *)malloc(4 * n * sizeof(*work));
+			if(work == NULL)
+			{
+				fprintf(stderr, "can't alloc buffer\n");
+
+				return 1;
+			}
+			memcpy(work, offsets, n * sizeof(*work));
+			memcpy(work + n, byteCounts, n * sizeof(*work));
+		}
+		sortChunks(work, work + n, m, work + 2 * n, work + 3 * n);
+		off = work;
+		cnt = work + n;
+	}
+
+	runEnd = (unsigned long long)off[0] + cnt[0];
+	for(i = 1;i < m;i++)
+	{
+		end = (unsigned long long)off[i] + cnt[i];
+		if(off[i] > runEnd)
+		{
+			stats->gaps++;
+			stats->gapBytes += off[i] - runEnd;
+		}
+		else if(off[i] < runEnd)
+		{
+			stats->overlaps++;
+			stats->overlapBytes += ( (end < runEnd) ? end : runEnd) -
+				off[i];
+		}
+		runEnd = (end > runEnd) ? end : runEnd;
+	}
+
+	free(work);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: layoutReport                                             **/
+/**                                                                      **/
+/**   Decode the chunk arrays collected for one IFD, analyze them and    **/
+/**   print the report. Returns 0 on success, 1 on failure.              **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   ctx       -- layout walker state                                   **/
+/**   internal  -- struct containing internal program data               **/
+/**   ifd       -- IFD the arrays belong to                              **/
+/**                                                                      **/
+
+static int layoutReport(layoutCtx *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	const char *offsetsName;
+	const char *byteCountsName;
+	unsigned int *offsets;
+	unsigned int *byteCounts;
+	size_t n;
+	tiffLayoutStats stats;
+	int status = 0;
+	tiffPhase_t phase;
+
+	offsetsName = getTagDescriptor(ctx->offsets.tag);
+	byteCountsName = getTagDescriptor(ctx->byteCounts.tag);
+
+	if(!ctx->haveByteCounts)
+	{
+		fprintf(stderr, "%s: IFD %d has %s but no %s\n", ctx->filename,
+			ifd->index, offsetsName, byteCountsName);
+
+		return 1;
+	}
+
+	/* A count the file can't possibly hold is corrupt; don't let it */
+	/* size an allocation.                                           */
+	if( (ctx->offsets.totalBytes > ctx->fileSize) ||
+		(ctx->byteCounts.totalBytes > ctx->fileSize) )
+	{
+		fprintf(stderr, "%s: IFD %d %s count exceeds file size\n",
+			ctx->filename, ifd->index, offsetsName);
+
+		return 1;
+	}
+
+	n = ctx->offsets.count;
+	if(ctx->byteCounts.count != ctx->offsets.count)
+	{
+		fprintf(stderr, "%s: IFD %d has %d %s but %d %s\n",
+			ctx->filename, ifd->index, ctx->offsets.count,
+			offsetsName, ctx->byteCounts.count, byteCountsName);
+		if(ctx->byteCounts.count < n)
+		{
+			n = ctx->byteCounts.count;
+		}
+	}
+
+	offsets = (unsigned int *)tiffMalloc(
+		( (size_t)ctx->offsets.count + 1) * sizeof(*offsets), internal);
+	byteCounts = (unsigned int *)tiffMalloc(
+		( (size_t)ctx->byteCounts.count + 1) * sizeof(*byteCounts),
+		internal);
+	if( (offsets == NULL) || (byteCounts == NULL) )
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+		free(offsets);
+		free(byteCounts);
+
+		return 1;
+	}
+
+	if( (tiffGetUIntArray(internal, &ctx->offsets, offsets) != 0) ||
+		(tiffGetUIntArray(internal, &ctx->byteCounts, byteCounts) != 0) ||
+		(tiffLayoutAnalyze(offsets, byteCounts, n,
+			ctx->fileSize - internal->tiffOffset, &stats) != 0) )
+	{
+		status = 1;
+	}
+	else
+	{
+		phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+		tiffPrintf(internal, "\nIFD %d %s\n", ifd->index,
+			ctx->tiled ? "tiles" : "strips");
+		tiffPrintf(internal, "\tChunks %llu\n", stats.chunks);
+		tiffPrintf(internal, "\tTotal bytes %llu\n", stats.totalBytes);
+		tiffPrintf(internal, "\tChunk bytes min %u max %u mean %.1f\n",
+			stats.minBytes, stats.maxBytes, stats.meanBytes);
+		tiffPrintf(internal, "\tEmpty chunks %llu\n",
+			stats.emptyChunks);
+		tiffPrintf(internal, "\tNon-monotonic offsets %llu\n",
+			stats.nonMonotonic);
+		tiffPrintf(internal, "\tGaps %llu (%llu bytes)\n", stats.gaps,
+			stats.gapBytes);
+		tiffPrintf(internal, "\tOverlaps %llu (%llu bytes)\n",
+			stats.overlaps, stats.overlapBytes);
+		tiffPrintf(internal, "\tPast EOF %llu\n", stats.pastEOF);
+		tiffPrintf(internal, "\tSpan %llu density %.3f\n", stats.span,
+			(stats.span != 0) ?
+			(double)stats.totalBytes / (double)stats.span : 1.0);
+		tiffPrintf(internal, "\tLocality %.3f\n", stats.locality);
+		TIFF_STATS_LEAVE(internal, phase);
+	}
+
+	free(offsets);
+	free(byteCounts);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   IFD walker callbacks collecting the chunk arrays of each IFD       **/
+/**                                                                      **/
+
+static tiffWalk_t layoutBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	layoutCtx *layout = (layoutCtx *)ctx;
+
+	layout->haveOffsets = 0;
+	layout->haveByteCounts = 0;
+	layout->tiled = 0;
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static tiffWalk_t layoutEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	layoutCtx *layout = (layoutCtx *)ctx;
+
+	/* Tiles take precedence over strips if a writer left both */
+	switch(entry->tag)
+	{
+		case StripOffsets:
+		{
+			if(!layout->tiled)
+			{
+				layout->offsets = *entry;
+				layout->haveOffsets = 1;
+			}
+			break;
+		}
+		case StripByteCounts:
+		{
+			if(!layout->tiled)
+			{
+				layout->byteCounts = *entry;
+				layout->haveByteCounts = 1;
+			}
+			break;
+		}
+		case TileOffsets:
+		{
+			if(!layout->tiled)
+			{
+				layout->haveByteCounts = 0;
+			}
+			layout->offsets = *entry;
+			layout->haveOffsets = 1;
+			layout->tiled = 1;
+			break;
+		}
+		case TileByteCounts:
+		{
+			layout->byteCounts = *entry;
+			layout->haveByteCounts = 1;
+			layout->tiled = 1;
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static tiffWalk_t layoutEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	layoutCtx *layout = (layoutCtx *)ctx;
+
+	if(!layout->haveOffsets)
+	{
+		return TIFF_WALK_CONTINUE;
+	}
+
+	layout->numReports++;
+	if(layoutReport(layout, internal, ifd) != 0)
+	{
+		return TIFF_WALK_ERROR;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor layoutVisitor = {
+	layoutBeginIFD,
+	layoutEntry,
+	layoutEndIFD,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffLayoutPrint                                          **/
+/**                                                                      **/
+/**   Print a strip or tile layout report for every IFD of a file.       **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+int tiffLayoutPrint(const char *filename, internalStruct *internal)
+{
+	layoutCtx layout;
+	tiffWalk_t status;
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	memset(&layout, 0, sizeof(layout));
+	layout.filename = filename;
+	layout.fileSize = tiffFileSize(internal);
+
+	tiffPrintf(internal, "Layout of %s\n", filename);
+
+	status = tiffWalkFile(filename, internal, &layoutVisitor, &layout);
+
+	if( (status != TIFF_WALK_ERROR) && (layout.numReports == 0) )
+	{
+		tiffPrintf(internal, "\nno strip or tile offsets\n");
+	}
+
+	tiffClose(internal);
+
+	return (status == TIFF_WALK_ERROR) ? 1 : 0;
+}
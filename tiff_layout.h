@@ -0,0 +1,106 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Strip and tile layout analysis.                                    **/
+/**                                                                      **/
+/**   The StripOffsets/StripByteCounts (or TileOffsets/TileByteCounts)   **/
+/**   arrays of every IFD are decoded in bulk and reduced to a short     **/
+/**   report showing whether the image data can be read sequentially.    **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_LAYOUT_H
+#define _TIFF_LAYOUT_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Distance in bytes between the end of a chunk and the start of the   **/
+/**  next one up to which the two still count as local to each other.    **/
+/**                                                                      **/
+
+#define TIFF_LAYOUT_NEAR_BYTES 65536
+
+
+/**                                                                      **/
+/**  Summary of a strip or tile layout                                   **/
+/**                                                                      **/
+/**  chunks                                                              **/
+/**      number of strips or tiles                                       **/
+/**  totalBytes                                                          **/
+/**      sum of all chunk sizes                                          **/
+/**  minBytes, maxBytes, meanBytes                                       **/
+/**      chunk size statistics                                           **/
+/**  emptyChunks                                                         **/
+/**      chunks with a byte count of 0, which are left out of the        **/
+/**      ordering statistics below                                       **/
+/**  nonMonotonic                                                        **/
+/**      chunks whose offset is lower than the one before them           **/
+/**  gaps, gapBytes                                                      **/
+/**      holes between chunks once sorted by offset, and their size      **/
+/**  overlaps, overlapBytes                                              **/
+/**      chunks starting before the end of an earlier chunk once         **/
+/**      sorted by offset, and the number of bytes shared                **/
+/**  pastEOF                                                             **/
+/**      chunks ending beyond the end of the file                        **/
+/**  span                                                                **/
+/**      bytes from the lowest chunk offset to the highest chunk end     **/
+/**  locality                                                            **/
+/**      fraction of chunks, in stored order, starting at most           **/
+/**      TIFF_LAYOUT_NEAR_BYTES after the end of the previous one;       **/
+/**      1.0 means the image data can be read front to back              **/
+/**                                                                      **/
+
+typedef struct tiffLayoutStats
+{
+	unsigned long long chunks;
+	unsigned long long totalBytes;
+	unsigned int minBytes;
+	unsigned int maxBytes;
+	double meanBytes;
+	unsigned long long emptyChunks;
+	unsigned long long nonMonotonic;
+	unsigned long long gaps;
+	unsigned long long gapBytes;
+	unsigned long long overlaps;
+	unsigned long long overlapBytes;
+	unsigned long long pastEOF;
+	unsigned long long span;
+	double locality;
+} tiffLayoutStats;
+
+
+/**                                                                      **/
+/**  Layout API function declarations                                    **/
+/**                                                                      **/
+
+int tiffLayoutAnalyze(const unsigned int *offsets,
+	const unsigned int *byteCounts, size_t n, unsigned long long limit,
+	tiffLayoutStats *stats);
+int tiffLayoutPrint(const char *filename, internalStruct *internal);
+
+#endif
@@ -0,0 +1,835 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Vendor MakerNote decoding.                                         **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_makernote.h"
+
+
+/**                                                                      **/
+/**  Number of values and UNDEFINED bytes printed by printNoteValue      **/
+/**                                                                      **/
+
+#define NOTE_PRINT_VALUES 8
+#define NOTE_PRINT_BYTES 64
+#define NOTE_PRINT_DUMP 16
+
+
+/**                                                                      **/
+/**  Vendor tag tables, terminated by an entry without a name            **/
+/**                                                                      **/
+
+static const tiffMakerNoteTag canonTags[] = {
+	{ 0x0001, "CameraSettings", NULL, },
+	{ 0x0002, "FocalLength", NULL, },
+	{ 0x0003, "FlashInfo", NULL, },
+	{ 0x0004, "ShotInfo", NULL, },
+	{ 0x0005, "Panorama", NULL, },
+	{ 0x0006, "ImageType", NULL, },
+	{ 0x0007, "FirmwareVersion", NULL, },
+	{ 0x0008, "FileNumber", NULL, },
+	{ 0x0009, "OwnerName", NULL, },
+	{ 0x000c, "SerialNumber", NULL, },
+	{ 0x000d, "CameraInfo", NULL, },
+	{ 0x000f, "CustomFunctions", NULL, },
+	{ 0x0010, "ModelID", NULL, },
+	{ 0x0026, "AFInfo2", NULL, },
+	{ 0x0093, "FileInfo", NULL, },
+	{ 0x0095, "LensModel", NULL, },
+	{ 0x0096, "InternalSerialNumber", NULL, },
+	{ 0x0097, "DustRemovalData", NULL, },
+	{ 0x00a0, "ProcessingInfo", NULL, },
+	{ 0x00aa, "MeasuredColor", NULL, },
+	{ 0x00b4, "ColorSpace", NULL, },
+	{ 0x00e0, "SensorInfo", NULL, },
+	{ 0x4001, "ColorData", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag nikonPreviewTags[] = {
+	{ 0x0103, "Compression", NULL, },
+	{ 0x011a, "XResolution", NULL, },
+	{ 0x011b, "YResolution", NULL, },
+	{ 0x0128, "ResolutionUnit", NULL, },
+	{ 0x0201, "PreviewImageStart", NULL, },
+	{ 0x0202, "PreviewImageLength", NULL, },
+	{ 0x0213, "YCbCrPositioning", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag nikonTags[] = {
+	{ 0x0001, "MakerNoteVersion", NULL, },
+	{ 0x0002, "ISO", NULL, },
+	{ 0x0003, "ColorMode", NULL, },
+	{ 0x0004, "Quality", NULL, },
+	{ 0x0005, "WhiteBalance", NULL, },
+	{ 0x0006, "Sharpness", NULL, },
+	{ 0x0007, "FocusMode", NULL, },
+	{ 0x0008, "FlashSetting", NULL, },
+	{ 0x0009, "FlashType", NULL, },
+	{ 0x000b, "WhiteBalanceFineTune", NULL, },
+	{ 0x000d, "ProgramShift", NULL, },
+	{ 0x000e, "ExposureDifference", NULL, },
+	{ 0x0011, "PreviewIFD", nikonPreviewTags, },
+	{ 0x0012, "FlashExposureComp", NULL, },
+	{ 0x0013, "ISOSetting", NULL, },
+	{ 0x0017, "ExternalFlashExposureComp", NULL, },
+	{ 0x0018, "FlashExposureBracketValue", NULL, },
+	{ 0x0019, "ExposureBracketValue", NULL, },
+	{ 0x001b, "CropHiSpeed", NULL, },
+	{ 0x001d, "SerialNumber", NULL, },
+	{ 0x001e, "ColorSpace", NULL, },
+	{ 0x0022, "ActiveDLighting", NULL, },
+	{ 0x0023, "PictureControlData", NULL, },
+	{ 0x0024, "WorldTime", NULL, },
+	{ 0x0025, "ISOInfo", NULL, },
+	{ 0x002a, "VignetteControl", NULL, },
+	{ 0x0080, "ImageAdjustment", NULL, },
+	{ 0x0081, "ToneComp", NULL, },
+	{ 0x0082, "AuxiliaryLens", NULL, },
+	{ 0x0083, "LensType", NULL, },
+	{ 0x0084, "Lens", NULL, },
+	{ 0x0085, "ManualFocusDistance", NULL, },
+	{ 0x0086, "DigitalZoom", NULL, },
+	{ 0x0087, "FlashMode", NULL, },
+	{ 0x0088, "AFInfo", NULL, },
+	{ 0x0089, "ShootingMode", NULL, },
+	{ 0x008b, "LensFStops", NULL, },
+	{ 0x008c, "ContrastCurve", NULL, },
+	{ 0x0091, "ShotInfo", NULL, },
+	{ 0x0092, "HueAdjustment", NULL, },
+	{ 0x0095, "NoiseReduction", NULL, },
+	{ 0x0097, "ColorBalance", NULL, },
+	{ 0x0098, "LensData", NULL, },
+	{ 0x0099, "RawImageCenter", NULL, },
+	{ 0x00a7, "ShutterCount", NULL, },
+	{ 0x00a8, "FlashInfo", NULL, },
+	{ 0x00a9, "ImageOptimization", NULL, },
+	{ 0x00ab, "VariProgram", NULL, },
+	{ 0x00b1, "HighISONoiseReduction", NULL, },
+	{ 0x00b7, "AFInfo2", NULL, },
+	{ 0x00b8, "FileInfo", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag sonyTags[] = {
+	{ 0x0102, "Quality", NULL, },
+	{ 0x0104, "FlashExposureComp", NULL, },
+	{ 0x0105, "Teleconverter", NULL, },
+	{ 0x0112, "WhiteBalanceFineTune", NULL, },
+	{ 0x0114, "CameraSettings", NULL, },
+	{ 0x0115, "WhiteBalance", NULL, },
+	{ 0x0116, "ExtraInfo", NULL, },
+	{ 0x0e00, "PrintIM", NULL, },
+	{ 0x1000, "MultiBurstMode", NULL, },
+	{ 0x2001, "PreviewImage", NULL, },
+	{ 0x2002, "Rating", NULL, },
+	{ 0x2004, "Contrast", NULL, },
+	{ 0x2005, "Saturation", NULL, },
+	{ 0x2006, "Sharpness", NULL, },
+	{ 0x200a, "HDR", NULL, },
+	{ 0x2011, "ColorTemperature", NULL, },
+	{ 0x201b, "FocusMode", NULL, },
+	{ 0xb000, "FileFormat", NULL, },
+	{ 0xb001, "SonyModelID", NULL, },
+	{ 0xb020, "CreativeStyle", NULL, },
+	{ 0xb021, "ColorTemperature", NULL, },
+	{ 0xb023, "SceneMode", NULL, },
+	{ 0xb024, "ZoneMatching", NULL, },
+	{ 0xb025, "DynamicRangeOptimizer", NULL, },
+	{ 0xb026, "ImageStabilization", NULL, },
+	{ 0xb027, "LensType", NULL, },
+	{ 0xb029, "ColorMode", NULL, },
+	{ 0xb02a, "LensSpec", NULL, },
+	{ 0xb02b, "FullImageSize", NULL, },
+	{ 0xb02c, "PreviewImageSize", NULL, },
+	{ 0xb041, "ExposureMode", NULL, },
+	{ 0xb042, "FocusMode", NULL, },
+	{ 0xb043, "AFAreaMode", NULL, },
+	{ 0xb047, "JPEGQuality", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag fujifilmTags[] = {
+	{ 0x0000, "Version", NULL, },
+	{ 0x0010, "InternalSerialNumber", NULL, },
+	{ 0x1000, "Quality", NULL, },
+	{ 0x1001, "Sharpness", NULL, },
+	{ 0x1002, "WhiteBalance", NULL, },
+	{ 0x1003, "Saturation", NULL, },
+	{ 0x1004, "Contrast", NULL, },
+	{ 0x1005, "ColorTemperature", NULL, },
+	{ 0x100a, "WhiteBalanceFineTune", NULL, },
+	{ 0x100e, "NoiseReduction", NULL, },
+	{ 0x1010, "FujiFlashMode", NULL, },
+	{ 0x1011, "FlashExposureComp", NULL, },
+	{ 0x1020, "Macro", NULL, },
+	{ 0x1021, "FocusMode", NULL, },
+	{ 0x1030, "SlowSync", NULL, },
+	{ 0x1031, "PictureMode", NULL, },
+	{ 0x1100, "AutoBracketing", NULL, },
+	{ 0x1101, "SequenceNumber", NULL, },
+	{ 0x1300, "BlurWarning", NULL, },
+	{ 0x1301, "FocusWarning", NULL, },
+	{ 0x1302, "ExposureWarning", NULL, },
+	{ 0x1400, "DynamicRange", NULL, },
+	{ 0x1401, "FilmMode", NULL, },
+	{ 0x1402, "DynamicRangeSetting", NULL, },
+	{ 0x1404, "MinFocalLength", NULL, },
+	{ 0x1405, "MaxFocalLength", NULL, },
+	{ 0x1406, "MaxApertureAtMinFocal", NULL, },
+	{ 0x1407, "MaxApertureAtMaxFocal", NULL, },
+	{ 0x1438, "ImageCount", NULL, },
+	{ 0x8000, "FileSource", NULL, },
+	{ 0x8002, "OrderNumber", NULL, },
+	{ 0x8003, "FrameNumber", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag olympusEquipmentTags[] = {
+	{ 0x0000, "EquipmentVersion", NULL, },
+	{ 0x0100, "CameraType2", NULL, },
+	{ 0x0101, "SerialNumber", NULL, },
+	{ 0x0102, "InternalSerialNumber", NULL, },
+	{ 0x0103, "FocalPlaneDiagonal", NULL, },
+	{ 0x0104, "BodyFirmwareVersion", NULL, },
+	{ 0x0201, "LensType", NULL, },
+	{ 0x0202, "LensSerialNumber", NULL, },
+	{ 0x0203, "LensModel", NULL, },
+	{ 0x0204, "LensFirmwareVersion", NULL, },
+	{ 0x0205, "MaxApertureAtMinFocal", NULL, },
+	{ 0x0206, "MaxApertureAtMaxFocal", NULL, },
+	{ 0x0207, "MinFocalLength", NULL, },
+	{ 0x0208, "MaxFocalLength", NULL, },
+	{ 0x020a, "MaxAperture", NULL, },
+	{ 0x020b, "LensProperties", NULL, },
+	{ 0x0301, "Extender", NULL, },
+	{ 0x0302, "ExtenderSerialNumber", NULL, },
+	{ 0x0303, "ExtenderModel", NULL, },
+	{ 0x0304, "ExtenderFirmwareVersion", NULL, },
+	{ 0x1000, "FlashType", NULL, },
+	{ 0x1001, "FlashModel", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag olympusCameraSettingsTags[] = {
+	{ 0x0000, "CameraSettingsVersion", NULL, },
+	{ 0x0100, "PreviewImageValid", NULL, },
+	{ 0x0101, "PreviewImageStart", NULL, },
+	{ 0x0102, "PreviewImageLength", NULL, },
+	{ 0x0200, "ExposureMode", NULL, },
+	{ 0x0201, "AELock", NULL, },
+	{ 0x0202, "MeteringMode", NULL, },
+	{ 0x0203, "ExposureShift", NULL, },
+	{ 0x0300, "MacroMode", NULL, },
+	{ 0x0301, "FocusMode", NULL, },
+	{ 0x0302, "FocusProcess", NULL, },
+	{ 0x0303, "AFSearch", NULL, },
+	{ 0x0304, "AFAreas", NULL, },
+	{ 0x0400, "FlashMode", NULL, },
+	{ 0x0401, "FlashExposureComp", NULL, },
+	{ 0x0500, "WhiteBalance2", NULL, },
+	{ 0x0501, "WhiteBalanceTemperature", NULL, },
+	{ 0x0600, "DriveMode", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+static const tiffMakerNoteTag olympusTags[] = {
+	{ 0x0000, "MakerNoteVersion", NULL, },
+	{ 0x0040, "CompressedImageSize", NULL, },
+	{ 0x0081, "PreviewImageData", NULL, },
+	{ 0x0088, "PreviewImageStart", NULL, },
+	{ 0x0089, "PreviewImageLength", NULL, },
+	{ 0x0100, "ThumbnailImage", NULL, },
+	{ 0x0104, "BodyFirmwareVersion", NULL, },
+	{ 0x0200, "SpecialMode", NULL, },
+	{ 0x0201, "Quality", NULL, },
+	{ 0x0202, "Macro", NULL, },
+	{ 0x0204, "DigitalZoom", NULL, },
+	{ 0x0207, "CameraType", NULL, },
+	{ 0x0208, "TextInfo", NULL, },
+	{ 0x0209, "CameraID", NULL, },
+	{ 0x0e00, "PrintIM", NULL, },
+	{ 0x1004, "FlashMode", NULL, },
+	{ 0x1015, "WhiteBalance", NULL, },
+	{ 0x2010, "Equipment", olympusEquipmentTags, },
+	{ 0x2020, "CameraSettings", olympusCameraSettingsTags, },
+	{ 0x2030, "RawDevelopment", NULL, },
+	{ 0x2040, "ImageProcessing", NULL, },
+	{ 0x2050, "FocusInfo", NULL, },
+	{ 0, NULL, NULL, },
+};
+
+
+/**                                                                      **/
+/**  State of tiffMakerNoteWalk, wrapping the caller's visitor           **/
+/**                                                                      **/
+/**  note                                                                **/
+/**      MakerNote being walked                                          **/
+/**  visitor, ctx                                                        **/
+/**      caller's callbacks and their context                            **/
+/**  stopped                                                             **/
+/**      1 once a callback of the caller stopped the walk                **/
+/**                                                                      **/
+
+typedef struct noteWalk
+{
+	tiffMakerNote *note;
+	const tiffVisitor *visitor;
+	void *ctx;
+	int stopped;
+} noteWalk;
+
+
+/**                                                                      **/
+/**   Function: findTag                                                  **/
+/**                                                                      **/
+/**   Return the entry of a tag in a vendor tag table, or NULL.          **/
+/**                                                                      **/
+
+static const tiffMakerNoteTag *findTag(const tiffMakerNoteTag *table,
+	unsigned short tag)
+{
+	for(;(table != NULL) && (table->name != NULL);table++)
+	{
+		if(table->tag == tag)
+		{
+			return table;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffMakerNoteOpen                                        **/
+/**                                                                      **/
+/**   Recognize the layout of a MakerNote entry from its header and, for **/
+/**   Canon and headerless Sony notes, from the camera Make. On success  **/
+/**   note is set up to walk the MakerNote IFD and 0 is returned; 1 is   **/
+/**   returned for unknown layouts and for IFDs not fitting in the value **/
+/**   (such as notes of unexpected models).                              **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing internal program data of the file   **/
+/**   entry     -- MakerNote entry of the Exif IFD                       **/
+/**   make      -- Make of the camera, or NULL                           **/
+/**   note      -- MakerNote to set up                                   **/
+/**                                                                      **/
+
+int tiffMakerNoteOpen(internalStruct *internal, const tiffEntry *entry,
+	const char *make, tiffMakerNote *note)
+{
+	unsigned char head[18];
+	size_t n;
+	unsigned int offset = entry->valueOffset;
+	internalStruct *sub = &note->internal;
+	unsigned short numEntries;
+	long long start;
+	byte4 tmp;
+
+	memset(note, 0, sizeof(*note) );
+	*sub = *internal;
+	sub->exifHeader = 0;
+
+	if( (entry->tag != MakerNote) || entry->isInline)
+	{
+		return 1;
+	}
+
+	memset(head, 0, sizeof(head) );
+	n = sizeof(head);
+	if(entry->totalBytes < n)
+	{
+		n = (size_t)entry->totalBytes;
+	}
+	if(tiffGetValueBytes(internal, entry, 0, head, n) != 0)
+	{
+		return 1;
+	}
+
+	if(memcmp(head, "Nikon\0\2", 7) == 0)
+	{
+		/* Type 3: a TIFF header of its own follows the 10 byte header */
+		note->vendor = TIFF_MAKERNOTE_NIKON;
+		note->table = nikonTags;
+		sub->tiffOffset = internal->tiffOffset + offset + 10;
+		if(memcmp(head + 10, "II", 2) == 0)
+		{
+			sub->fileEndian = 1;
+		}
+		else if(memcmp(head + 10, "MM", 2) == 0)
+		{
+			sub->fileEndian = 0;
+		}
+		else
+		{
+			return 1;
+		}
+		memcpy(tmp.b, head + 14, 4);
+		sub->tiffIFDOffset = cSwapUInt(tmp.u, sub);
+	}
+	else if(memcmp(head, "SONY", 4) == 0)
+	{
+		/* "SONY DSC ", "SONY CAM " or "SONY MOBILE", 12 bytes */
+		note->vendor = TIFF_MAKERNOTE_SONY;
+		note->table = sonyTags;
+		sub->tiffIFDOffset = offset + 12;
+	}
+	else if(memcmp(head, "FUJIFILM", 8) == 0)
+	{
+		/* Always little-endian, offsets from the MakerNote start */
+		note->vendor = TIFF_MAKERNOTE_FUJIFILM;
+		note->table = fujifilmTags;
+		sub->tiffOffset = internal->tiffOffset + offset;
+		sub->fileEndian = 1;
+		memcpy(tmp.b, head + 8, 4);
+		sub->tiffIFDOffset = cSwapUInt(tmp.u, sub);
+	}
+	else if( (memcmp(head, "OLYMPUS\0", 8) == 0) ||
+		(memcmp(head, "OM SYSTEM\0\0\0", 12) == 0) )
+	{
+		/* Byte order and version follow the name, offsets from the start */
+		n = (head[0] == 'O' && head[1] == 'M') ? 12 : 8;
+		note->vendor = TIFF_MAKERNOTE_OLYMPUS;
+		note->table = olympusTags;
+		sub->tiffOffset = internal->tiffOffset + offset;
+		sub->fileEndian = (memcmp(head + n, "II", 2) == 0);
+		sub->tiffIFDOffset = n + 4;
+	}
+	else if(memcmp(head, "OLYMP\0", 6) == 0)
+	{
+		note->vendor = TIFF_MAKERNOTE_OLYMPUS;
+		note->table = olympusTags;
+		sub->tiffIFDOffset = offset + 8;
+	}
+	else if( (make != NULL) && (strncmp(make, "Canon", 5) == 0) )
+	{
+		note->vendor = TIFF_MAKERNOTE_CANON;
+		note->table = canonTags;
+		sub->tiffIFDOffset = offset;
+	}
+	else if( (make != NULL) && (strncmp(make, "SONY", 4) == 0) )
+	{
+		note->vendor = TIFF_MAKERNOTE_SONY;
+		note->table = sonyTags;
+		sub->tiffIFDOffset = offset;
+	}
+	else
+	{
+		return 1;
+	}
+
+	/* The IFD table must lie within the MakerNote value */
+	start = (long long)sub->tiffOffset + sub->tiffIFDOffset -
+		internal->tiffOffset - offset;
+	if( (start < 0) || ( (unsigned long long)start + 2 > entry->totalBytes) ||
+		(tiffGetValueBytes(internal, entry, (unsigned long long)start,
+		tmp.b, 2) != 0) )
+	{
+		return 1;
+	}
+	numEntries = cSwapUShort(tmp.s, sub);
+	if( (numEntries == 0) || ( (unsigned long long)start + 2 +
+		numEntries * 12ULL > entry->totalBytes) )
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffMakerNoteVendorName                                  **/
+/**                                                                      **/
+/**   Return the name of a MakerNote vendor.                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   vendor  -- MakerNote vendor                                        **/
+/**                                                                      **/
+
+const char *tiffMakerNoteVendorName(tiffMakerNote_t vendor)
+{
+	switch(vendor)
+	{
+		case TIFF_MAKERNOTE_CANON:
+		{
+			return "Canon";
+		}
+		case TIFF_MAKERNOTE_NIKON:
+		{
+			return "Nikon";
+		}
+		case TIFF_MAKERNOTE_SONY:
+		{
+			return "Sony";
+		}
+		case TIFF_MAKERNOTE_FUJIFILM:
+		{
+			return "Fujifilm";
+		}
+		case TIFF_MAKERNOTE_OLYMPUS:
+		{
+			return "Olympus";
+		}
+		default:
+		{
+			return "unknown";
+		}
+	}
+}
+
+
+/**                                                                      **/
+/**   Function: tiffMakerNoteTagName                                     **/
+/**                                                                      **/
+/**   Return the name of a tag of the MakerNote IFD being walked, or     **/
+/**   "unknown".                                                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   note  -- MakerNote being walked                                    **/
+/**   tag   -- tag number                                                **/
+/**                                                                      **/
+
+const char *tiffMakerNoteTagName(const tiffMakerNote *note,
+	unsigned short tag)
+{
+	const tiffMakerNoteTag *p = findTag(note->table, tag);
+
+	return (p != NULL) ? p->name : "unknown";
+}
+
+
+/**                                                                      **/
+/**  IFD walker callbacks forwarding to the caller's visitor. The walk   **/
+/**  is stopped after one IFD since MakerNote IFDs are not chained, and  **/
+/**  the sub-IFDs found on the way are recorded.                         **/
+/**                                                                      **/
+
+static tiffWalk_t noteBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	noteWalk *walk = (noteWalk *)ctx;
+	tiffWalk_t status = TIFF_WALK_CONTINUE;
+
+	if(walk->visitor->beginIFD != NULL)
+	{
+		status = walk->visitor->beginIFD(walk->ctx, internal, ifd);
+	}
+	walk->stopped = (status == TIFF_WALK_STOP);
+
+	return status;
+}
+
+static tiffWalk_t noteEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	noteWalk *walk = (noteWalk *)ctx;
+	tiffMakerNote *note = walk->note;
+	const tiffMakerNoteTag *tag;
+	tiffWalk_t status = TIFF_WALK_CONTINUE;
+
+	tag = findTag(note->table, entry->tag);
+	if( (note->parent == NULL) && (tag != NULL) &&
+		(tag->subTable != NULL) &&
+		(note->numSubIFDs < TIFF_MAKERNOTE_SUBIFDS) )
+	{
+		note->subIFDs[note->numSubIFDs] = entry->valueOffset;
+		note->subIFDTags[note->numSubIFDs] = tag;
+		note->numSubIFDs++;
+	}
+
+	if(walk->visitor->entry != NULL)
+	{
+		status = walk->visitor->entry(walk->ctx, internal, entry);
+	}
+	walk->stopped = (status == TIFF_WALK_STOP);
+
+	return status;
+}
+
+static tiffWalk_t noteEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	noteWalk *walk = (noteWalk *)ctx;
+	tiffWalk_t status = TIFF_WALK_CONTINUE;
+
+	if(walk->visitor->endIFD != NULL)
+	{
+		status = walk->visitor->endIFD(walk->ctx, internal, ifd);
+	}
+	walk->stopped = (status == TIFF_WALK_STOP);
+
+	return (status == TIFF_WALK_CONTINUE) ? TIFF_WALK_STOP : status;
+}
+
+static const tiffVisitor noteVisitor = {
+	noteBeginIFD,
+	noteEntry,
+	noteEndIFD,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffMakerNoteWalk                                        **/
+/**                                                                      **/
+/**   Walk the IFD of a MakerNote opened with tiffMakerNoteOpen, then    **/
+/**   the sub-IFDs it points to, calling visitor with IFD_MAKERNOTE      **/
+/**   IFDs. During the walk note->table and note->parent describe the    **/
+/**   IFD being visited. Returns as tiffIFDWalk.                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name, for error messages                         **/
+/**   note      -- MakerNote                                             **/
+/**   visitor   -- callbacks                                             **/
+/**   ctx       -- visitor context passed to each callback               **/
+/**                                                                      **/
+
+tiffWalk_t tiffMakerNoteWalk(const char *filename, tiffMakerNote *note,
+	const tiffVisitor *visitor, void *ctx)
+{
+	noteWalk walk;
+	const tiffMakerNoteTag *table = note->table;
+	unsigned int ifdOffset = note->internal.tiffIFDOffset;
+	unsigned int i;
+	tiffWalk_t status;
+
+	walk.note = note;
+	walk.visitor = visitor;
+	walk.ctx = ctx;
+	walk.stopped = 0;
+
+	note->parent = NULL;
+	note->numSubIFDs = 0;
+	status = tiffIFDWalk(filename, &note->internal, IFD_MAKERNOTE,
+		&noteVisitor, &walk);
+
+	for(i = 0;(i < note->numSubIFDs) && (status == TIFF_WALK_STOP) &&
+		!walk.stopped;i++)
+	{
+		note->parent = note->subIFDTags[i];
+		note->table = note->parent->subTable;
+		note->internal.tiffIFDOffset = note->subIFDs[i];
+		status = tiffIFDWalk(filename, &note->internal, IFD_MAKERNOTE,
+			&noteVisitor, &walk);
+	}
+
+	/* Leave the note ready for another walk */
+	note->table = table;
+	note->parent = NULL;
+	note->internal.tiffIFDOffset = ifdOffset;
+
+	if( (status == TIFF_WALK_STOP) && !walk.stopped)
+	{
+		status = TIFF_WALK_CONTINUE;
+	}
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: printNoteValue                                           **/
+/**                                                                      **/
+/**   Print the type, count and first values of a MakerNote entry on     **/
+/**   the current line. Returns 0 on success, 1 on failure.              **/
+/**                                                                      **/
+
+static int printNoteValue(internalStruct *internal, const tiffEntry *entry)
+{
+	unsigned char bytes[NOTE_PRINT_BYTES];
+	const unsigned char *p = bytes;
+	size_t size = getFieldTypeNumBytes( (fieldType_t)entry->fieldType);
+	size_t n;
+	size_t i;
+	tiffValue value;
+
+	tiffPrintf(internal, "  %s[%u]",
+		getTIFFTypeDesc( (fieldType_t)entry->fieldType), entry->count);
+
+	n = sizeof(bytes);
+	if(entry->totalBytes < n)
+	{
+		n = (size_t)entry->totalBytes;
+	}
+	if( (size == 0) || (n == 0) )
+	{
+		return 0;
+	}
+	if(tiffGetValueBytes(internal, entry, 0, bytes, n) != 0)
+	{
+		return 1;
+	}
+
+	if(entry->fieldType == FT_ASCII)
+	{
+		tiffPrintf(internal, " \"");
+		for(i = 0;(i < n) && (bytes[i] != '\0');i++)
+		{
+			if(isprint(bytes[i]) && (bytes[i] != '"') &&
+				(bytes[i] != '\\') )
+			{
+				tiffPrintf(internal, "%c", bytes[i]);
+			}
+			else
+			{
+				tiffPrintf(internal, "\\%03o", bytes[i]);
+			}
+		}
+		tiffPrintf(internal, "\"%s",
+			(i == n) && (n < entry->totalBytes) ? "..." : "");
+
+		return 0;
+	}
+
+	if(entry->fieldType == FT_UNDEFINED)
+	{
+		tiffPrintf(internal, " ");
+		for(i = 0;(i < n) && (i < NOTE_PRINT_DUMP);i++)
+		{
+			tiffPrintf(internal, "%02x", bytes[i]);
+		}
+		if(i < entry->totalBytes)
+		{
+			tiffPrintf(internal, "...");
+		}
+
+		return 0;
+	}
+
+	for(i = 0;(i < n / size) && (i < NOTE_PRINT_VALUES);i++, p += size)
+	{
+		tiffDecodeValue(p, (fieldType_t)entry->fieldType, internal, &value);
+		if( (entry->fieldType == FT_FLOAT) ||
+			(entry->fieldType == FT_DOUBLE) )
+		{
+			tiffPrintf(internal, " %g", value.real);
+		}
+		else if( (entry->fieldType == FT_RATIONAL) ||
+			(entry->fieldType == FT_SRATIONAL) )
+		{
+			tiffPrintf(internal, " %lld/%lld", value.integer,
+				value.denominator);
+		}
+		else
+		{
+			tiffPrintf(internal, " %lld", value.integer);
+		}
+	}
+
+	if(i < entry->count)
+	{
+		tiffPrintf(internal, " ...");
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**  IFD walker callbacks printing a MakerNote                           **/
+/**                                                                      **/
+
+static tiffWalk_t printNoteBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	const tiffMakerNote *note = (const tiffMakerNote *)ctx;
+	tiffPhase_t phase;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+	if(note->parent == NULL)
+	{
+		tiffPrintf(internal, "\tMakerNote %s, %d entries\n",
+			tiffMakerNoteVendorName(note->vendor), ifd->numEntries);
+	}
+	else
+	{
+		tiffPrintf(internal, "\t%s IFD, %d entries\n", note->parent->name,
+			ifd->numEntries);
+	}
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static tiffWalk_t printNoteEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	const tiffMakerNote *note = (const tiffMakerNote *)ctx;
+	tiffWalk_t status = TIFF_WALK_CONTINUE;
+	tiffPhase_t phase;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+	tiffPrintf(internal, "\t  Tag %d  (%04X.H)   %s", entry->tag,
+		entry->tag, tiffMakerNoteTagName(note, entry->tag) );
+	if(printNoteValue(internal, entry) != 0)
+	{
+		status = TIFF_WALK_ERROR;
+	}
+	tiffPrintf(internal, "\n");
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return status;
+}
+
+static const tiffVisitor printNoteVisitor = {
+	printNoteBeginIFD,
+	printNoteEntry,
+	NULL,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffMakerNotePrint                                       **/
+/**                                                                      **/
+/**   Print the entries of a MakerNote opened with tiffMakerNoteOpen,    **/
+/**   one line each. Returns 0 on success, 1 on failure.                 **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name, for error messages                         **/
+/**   note      -- MakerNote                                             **/
+/**                                                                      **/
+
+int tiffMakerNotePrint(const char *filename, tiffMakerNote *note)
+{
+	if(tiffMakerNoteWalk(filename, note, &printNoteVisitor, note) ==
+		TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+
+	return 0;
+}
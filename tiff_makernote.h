@@ -0,0 +1,125 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Vendor MakerNote decoding.                                         **/
+/**                                                                      **/
+/**   Most cameras store a MakerNote (37500) as an IFD in one of a few   **/
+/**   vendor layouts: a header in front of the IFD, its own byte order,  **/
+/**   or offsets counted from the MakerNote rather than the TIFF         **/
+/**   header. tiffMakerNoteOpen recognizes the layout and sets up an     **/
+/**   internalStruct so the IFD walker can decode the IFD unchanged;     **/
+/**   tag names come from a table per vendor. Nothing is decoded until   **/
+/**   a caller asks for it, so files are walked as cheaply as before.    **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_MAKERNOTE_H
+#define _TIFF_MAKERNOTE_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  MakerNote vendors                                                   **/
+/**                                                                      **/
+
+typedef enum {
+	TIFF_MAKERNOTE_UNKNOWN = 0,
+	TIFF_MAKERNOTE_CANON,
+	TIFF_MAKERNOTE_NIKON,
+	TIFF_MAKERNOTE_SONY,
+	TIFF_MAKERNOTE_FUJIFILM,
+	TIFF_MAKERNOTE_OLYMPUS,
+} tiffMakerNote_t;
+
+
+/**                                                                      **/
+/**  Most sub-IFDs of a MakerNote that are walked                        **/
+/**                                                                      **/
+
+#define TIFF_MAKERNOTE_SUBIFDS 4
+
+
+/**                                                                      **/
+/**  Tag of a vendor tag table                                           **/
+/**                                                                      **/
+/**  tag, name                                                           **/
+/**      tag number and name                                             **/
+/**  subTable                                                            **/
+/**      tag table of the IFD the tag points to, NULL for plain values   **/
+/**                                                                      **/
+
+typedef struct tiffMakerNoteTag
+{
+	unsigned short tag;
+	const char *name;
+	const struct tiffMakerNoteTag *subTable;
+} tiffMakerNoteTag;
+
+
+/**                                                                      **/
+/**  MakerNote opened with tiffMakerNoteOpen                             **/
+/**                                                                      **/
+/**  vendor                                                              **/
+/**      MakerNote layout                                                **/
+/**  internal                                                            **/
+/**      copy of the file's internalStruct with the byte order, base     **/
+/**      offset (tiffOffset) and IFD offset (tiffIFDOffset) of the       **/
+/**      MakerNote; pass it to tiffGetValueBytes and friends             **/
+/**  table, parent                                                       **/
+/**      tag table of the IFD being walked and the tag pointing to it,   **/
+/**      parent being NULL for the MakerNote IFD itself                  **/
+/**  numSubIFDs, subIFDs, subIFDTags                                     **/
+/**      offsets of the sub-IFDs found in the MakerNote IFD and the      **/
+/**      tags pointing to them                                           **/
+/**                                                                      **/
+
+typedef struct tiffMakerNote
+{
+	tiffMakerNote_t vendor;
+	internalStruct internal;
+	const tiffMakerNoteTag *table;
+	const tiffMakerNoteTag *parent;
+	unsigned int numSubIFDs;
+	unsigned int subIFDs[TIFF_MAKERNOTE_SUBIFDS];
+	const tiffMakerNoteTag *subIFDTags[TIFF_MAKERNOTE_SUBIFDS];
+} tiffMakerNote;
+
+
+/**                                                                      **/
+/**  MakerNote API function declarations                                 **/
+/**                                                                      **/
+
+int tiffMakerNoteOpen(internalStruct *internal, const tiffEntry *entry,
+	const char *make, tiffMakerNote *note);
+const char *tiffMakerNoteVendorName(tiffMakerNote_t vendor);
+const char *tiffMakerNoteTagName(const tiffMakerNote *note,
+	unsigned short tag);
+tiffWalk_t tiffMakerNoteWalk(const char *filename, tiffMakerNote *note,
+	const tiffVisitor *visitor, void *ctx);
+int tiffMakerNotePrint(const char *filename, tiffMakerNote *note);
+
+#endif
@@ -39,190 +39,91 @@ SOFTWARE.
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "tiff_metadata.h"
-
-/* field types */
-typedef enum {
-	FT_UNKNOWN = 0,
-	FT_BYTE,
-	FT_ASCII,
-	FT_SHORT,
-	FT_LONG,
-	FT_RATIONAL,
-	FT_SBYTE,
-	FT_UNDEFINED,
-	FT_SSHORT,
-	FT_SLONG,
-	FT_SRATIONAL,
-	FT_FLOAT,
-	FT_DOUBLE,
-	FT_MIN = FT_BYTE,
-	FT_MAX = FT_DOUBLE,
-} fieldType_t;
+#include "tiff_stats.h"
+#include "tiff_io.h"
+#include "tiff_makernote.h"
+#include "tiff_tagdb.h"
+
+/* size of the buffer values stored out of line are read through */
+#define VALUE_CHUNK_BYTES 4096
+
+/* values decoded at once, and printed at either end, of summarized arrays */
+#define SUMMARY_BLOCK_VALUES 256
+#define SUMMARY_EDGE_VALUES 8
+
+/* decoder of one value of a field type, and printer of decoded values */
+typedef void (*decodeFunc)(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+typedef void (*printFunc)(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+
+static void decodeUnsigned8(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeSigned8(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeUnsigned16(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeSigned16(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeUnsigned32(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeSigned32(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeRational(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeSRational(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeFloat(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeDouble(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void decodeNone(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value);
+static void printHex(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+static void printChar(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+static void printEnum(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+static void printSigned(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+static void printRational(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+static void printFloat(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
+static void printDouble(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal);
 
 /* field type details lookup table entry*/
 typedef struct {
 	fieldType_t type;
 	const char *desc;
 	size_t numBytes;
+	decodeFunc decode;
+	printFunc print;
 } fieldTypeData_t;
 
-/* field type details lookup table */
+/* field type details lookup table, indexed by fieldType_t */
 static const fieldTypeData_t fieldTypeLookup[] = {
-	{ FT_BYTE, "BYTE", 1, },
-	{ FT_ASCII, "ASCII", 1, },
-	{ FT_SHORT, "SHORT", 2, },
-	{ FT_LONG, "LONG", 4, },
-	{ FT_RATIONAL, "RATIONAL", 8, },
-	{ FT_SBYTE, "SBYTE", 1, },
-	{ FT_UNDEFINED, "UNDEFINED", 1, },
-	{ FT_SSHORT, "SSHORT", 2, },
-	{ FT_SLONG, "SLONG", 4, },
-	{ FT_SRATIONAL, "SRATIONAL", 8, },
-	{ FT_FLOAT, "FLOAT", 4, },
-	{ FT_DOUBLE, "DOUBLE", 8, },
+	{ FT_UNKNOWN, "unknown", 0, decodeNone, printHex, },
+	{ FT_BYTE, "BYTE", 1, decodeUnsigned8, printHex, },
+	{ FT_ASCII, "ASCII", 1, decodeUnsigned8, printChar, },
+	{ FT_SHORT, "SHORT", 2, decodeUnsigned16, printEnum, },
+	{ FT_LONG, "LONG", 4, decodeUnsigned32, printEnum, },
+	{ FT_RATIONAL, "RATIONAL", 8, decodeRational, printRational, },
+	{ FT_SBYTE, "SBYTE", 1, decodeSigned8, printSigned, },
+	{ FT_UNDEFINED, "UNDEFINED", 1, decodeUnsigned8, printHex, },
+	{ FT_SSHORT, "SSHORT", 2, decodeSigned16, printSigned, },
+	{ FT_SLONG, "SLONG", 4, decodeSigned32, printSigned, },
+	{ FT_SRATIONAL, "SRATIONAL", 8, decodeSRational, printRational, },
+	{ FT_FLOAT, "FLOAT", 4, decodeFloat, printFloat, },
+	{ FT_DOUBLE, "DOUBLE", 8, decodeDouble, printDouble, },
 };
 
-/* tag numbers */
-typedef enum {
-	NewSubfileType = 254,
-	SubfileType = 255,
-	ImageWidth = 256,
-	ImageLength = 257,
-	BitsPerSample = 258,
-	Compression = 259,
-	PhotometricInterpretation = 262,
-	Threshholding = 263,
-	CellWidth = 264,
-	CellLength = 265,
-	FillOrder = 266,
-	DocumentName = 269,
-	ImageDescription = 270,
-	Make = 271,
-	Model = 272,
-	StripOffsets = 273,
-	Orientation = 274,
-	SamplesPerPixel = 277,
-	RowsPerStrip = 278,
-	StripByteCounts = 279,
-	MinSampleValue = 280,
-	MaxSampleValue = 281,
-	XResolution = 282,
-	YResolution = 283,
-	PlanarConfiguration = 284,
-	XPosition = 286,
-	YPosition = 287,
-	FreeOffsets = 288,
-	FreeByteCounts = 289,
-	GrayResponseUnit = 290,
-	GrayResponseCurve = 291,
-	T4Options = 292,
-	T6Options = 293,
-	ResolutionUnit = 296,
-	PageNumber = 297,
-	TransferFunction = 301,
-	Software = 305,
-	DateTime = 306,
-	Artist = 315,
-	HostComputer = 316,
-	Predictor = 317,
-	WhitePoint = 318,
-	PrimaryChromaticities = 319,
-	ColorMap = 320,
-	HalftoneHints = 321,
-	TileWidth = 322,
-	TileHeight = 323,
-	TileOffsets = 324,
-	TileByteCounts = 325,
-	InkSet = 332,
-	InkNames = 333,
-	NumberOfInks = 334,
-	DotRange = 336,
-	TargetPrinter = 337,
-	ExtraSamples = 338,
-	SampleFormat = 339,
-	SMinSampleValue = 340,
-	SMaxSampleValue = 341,
-	TransferRange = 342,
-	JPEGProc = 512,
-	JPEGInterchangeFormat = 513,
-	JPEGInterchangeFormatLength = 514,
-	JPEGRestartInterval = 515,
-	JPEGLosslessPredictors = 517,
-	JPEGPointTransforms = 518,
-	JPEGQTables = 519,
-	JPEGDCTables = 520,
-	JPEGACTables = 521,
-	YCbCrCoefficients = 529,
-	YCbCrSubSampling = 530,
-	YCbCrPositioning = 531,
-	ReferenceBlackWhite = 532,
-	ExposureTime = 33434,
-	FNumber = 33437,
-	ExifIFDPointer = 34665,
-	ExposureTime2 = 34434,
-	ExposureProgram = 34850,
-	SpectralSensitivity = 34852,
-	ISOSpeedRatings = 34855,
-	OECF = 34856,
-	ExifVersion = 36864,
-	DateTimeOriginal = 36867,
-	DateTimeDigitized = 36868,
-	ComponentsConfiguration = 37121,
-	CompressedBitsPerPixel = 37122,
-	ShutterSpeedValue = 37377,
-	ApertureValue = 37378,
-	BrightnessValue = 37379,
-	ExposureBiasValue = 37380,
-	MaxApertureValue = 37381,
-	SubjectDistance = 37382,
-	MeteringMode = 37383,
-	LightSource = 37384,
-	Flash = 37385,
-	FocalLength = 37386,
-	SubjectArea = 37396,
-	MakerNote = 37500,
-	UserComment = 37510,
-	SubSecTime = 37520,
-	SubSecTimeOriginal = 37521,
-	SubSecTimeDigitized = 37522,
-	FlashpixVersion = 40960,
-	ColorSpace = 40961,
-	PixelXDimension = 40962,
-	PixelYDimension = 40963,
-	RelatedSoundFile = 40964,
-	FlashEnergy = 41483,
-	SpatialFrequencyResponse = 41484,
-	FocalPlaneXResolution = 41486,
-	FocalPlaneYResolution = 41487,
-	FocalPlaneResolutionUnit = 41488,
-	SubjectLocation = 41492,
-	ExposureIndex = 41493,
-	SensingMethod = 41495,
-	FileSource = 41728,
-	SceneType = 41729,
-	CFAPattern = 41730,
-	CustomRendered = 41985,
-	ExposureMode = 41986,
-	WhiteBalance = 41987,
-	DigitalZoomRatio = 41988,
-	FocalLengthIn35mmFilm = 41989,
-	SceneCaptureType = 41990,
-	GainControl = 41991,
-	Contrast = 41992,
-	Saturation = 41993,
-	Sharpness = 41994,
-	DeviceSettingDescription = 41995,
-	SubjectDistanceRange = 41996,
-	ImageUniqueID = 42016,
-	CameraOwnerName = 42032,
-	BodySerialNumber = 42033,
-	LensSpecification = 42034,
-	LensMake = 42035,
-	LensModel = 42036,
-	LensSerialNumber = 42037,
-} tagNum_t;
-
 
 /**                                                                      **/
 /**   macro which initializes a structure entry containing an enum and   **/
@@ -393,11 +294,296 @@ float cSwapFloat(float a, const internalStruct *internal)
 }
 
 
+/**                                                                      **/
+/**   Function: tiffPrintf                                               **/
+/**                                                                      **/
+/**   printf to the output stream of the file being processed, counting  **/
+/**   the bytes formatted. Returns the value returned by vfprintf.       **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing internal program data, including    **/
+/**                the output stream                                     **/
+/**   format    -- printf format                                         **/
+/**                                                                      **/
+
+int tiffPrintf(const internalStruct *internal, const char *format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = vfprintf(internal->out, format, args);
+	va_end(args);
+
+	TIFF_STAT_ADD(internal, bytesFormatted, (n > 0) ? n : 0);
+
+	return n;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffMalloc                                               **/
+/**                                                                      **/
+/**   malloc, counting the allocation.                                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   size      -- number of bytes to allocate                           **/
+/**   internal  -- struct containing internal program data               **/
+/**                                                                      **/
+
+void *tiffMalloc(size_t size, const internalStruct *internal)
+{
+	TIFF_STAT_ADD(internal, allocs, 1);
+
+	return malloc(size);
+}
+
+
+/**                                                                      **/
+/**   Function: tiffFread                                                **/
+/**                                                                      **/
+/**   fread, counting the call and the bytes read.                       **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   ptr       -- destination buffer                                    **/
+/**   size      -- size of an item                                       **/
+/**   n         -- number of items                                       **/
+/**   file      -- FILE pointer                                          **/
+/**   internal  -- struct containing internal program data               **/
+/**                                                                      **/
+
+size_t tiffFread(void *ptr, size_t size, size_t n, FILE *file,
+	const internalStruct *internal)
+{
+	size_t got;
+
+	got = fread(ptr, size, n, file);
+
+	TIFF_STAT_ADD(internal, reads, 1);
+	TIFF_STAT_ADD(internal, bytesRead, got * size);
+
+	return got;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffFseek                                                **/
+/**                                                                      **/
+/**   fseek to an absolute position, counting the call.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   file      -- FILE pointer                                          **/
+/**   offset    -- offset from the start of the file                     **/
+/**   internal  -- struct containing internal program data               **/
+/**                                                                      **/
+
+int tiffFseek(FILE *file, long offset, const internalStruct *internal)
+{
+	TIFF_STAT_ADD(internal, seeks, 1);
+
+	return fseek(file, offset, SEEK_SET);
+}
+
+
+/**                                                                      **/
+/**   Function: tiffReadAt                                               **/
+/**                                                                      **/
+/**   Read n bytes at an offset from the start of the file, through      **/
+/**   internal->io when set and with stdio otherwise, counting the read. **/
+/**   Returns the number of bytes read, less than n at the end of the    **/
+/**   file or on failure.                                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing the open file                       **/
+/**   offset    -- offset from the start of the file                     **/
+/**   dst       -- buffer of at least n bytes                            **/
+/**   n         -- number of bytes                                       **/
+/**                                                                      **/
+
+size_t tiffReadAt(const internalStruct *internal, unsigned long long offset,
+	void *dst, size_t n)
+{
+	tiffIORange range;
+
+	if(internal->io == NULL)
+	{
+		if(tiffFseek(internal->file, (long)offset, internal) != 0)
+		{
+			return 0;
+		}
+
+		return tiffFread(dst, 1, n, internal->file, internal);
+	}
+
+	range.offset = offset;
+	range.length = n;
+	range.dst = (unsigned char *)dst;
+	range.got = 0;
+	if(internal->io->read(internal->io->handle, &range, 1) != 0)
+	{
+		range.got = 0;
+	}
+
+	TIFF_STAT_ADD(internal, reads, 1);
+	TIFF_STAT_ADD(internal, bytesRead, range.got);
+
+	return range.got;
+}
+
+
+/* tag name lookup table */
+static const tagString tagDescLookup[] = {
+	INIT_ENUM_STR(NewSubfileType),
+	INIT_ENUM_STR(SubfileType),
+	INIT_ENUM_STR(ImageWidth),
+	INIT_ENUM_STR(ImageLength),
+	INIT_ENUM_STR(BitsPerSample),
+	INIT_ENUM_STR(Compression),
+	INIT_ENUM_STR(PhotometricInterpretation),
+	INIT_ENUM_STR(Threshholding),
+	INIT_ENUM_STR(CellWidth),
+	INIT_ENUM_STR(CellLength),
+	INIT_ENUM_STR(FillOrder),
+	INIT_ENUM_STR(DocumentName),
+	INIT_ENUM_STR(ImageDescription),
+	INIT_ENUM_STR(Make),
+	INIT_ENUM_STR(Model),
+	INIT_ENUM_STR(StripOffsets),
+	INIT_ENUM_STR(Orientation),
+	INIT_ENUM_STR(SamplesPerPixel),
+	INIT_ENUM_STR(RowsPerStrip),
+	INIT_ENUM_STR(StripByteCounts),
+	INIT_ENUM_STR(MinSampleValue),
+	INIT_ENUM_STR(MaxSampleValue),
+	INIT_ENUM_STR(XResolution),
+	INIT_ENUM_STR(YResolution),
+	INIT_ENUM_STR(PlanarConfiguration),
+	INIT_ENUM_STR(XPosition),
+	INIT_ENUM_STR(YPosition),
+	INIT_ENUM_STR(FreeOffsets),
+	INIT_ENUM_STR(FreeByteCounts),
+	INIT_ENUM_STR(GrayResponseUnit),
+	INIT_ENUM_STR(GrayResponseCurve),
+	INIT_ENUM_STR(T4Options),
+	INIT_ENUM_STR(T6Options),
+	INIT_ENUM_STR(ResolutionUnit),
+	INIT_ENUM_STR(PageNumber),
+	INIT_ENUM_STR(TransferFunction),
+	INIT_ENUM_STR(Software),
+	INIT_ENUM_STR(DateTime),
+	INIT_ENUM_STR(Artist),
+	INIT_ENUM_STR(HostComputer),
+	INIT_ENUM_STR(Predictor),
+	INIT_ENUM_STR(WhitePoint),
+	INIT_ENUM_STR(PrimaryChromaticities),
+	INIT_ENUM_STR(ColorMap),
+	INIT_ENUM_STR(HalftoneHints),
+	INIT_ENUM_STR(TileWidth),
+	INIT_ENUM_STR(TileHeight),
+	INIT_ENUM_STR(TileOffsets),
+	INIT_ENUM_STR(TileByteCounts),
+	INIT_ENUM_STR(InkSet),
+	INIT_ENUM_STR(InkNames),
+	INIT_ENUM_STR(NumberOfInks),
+	INIT_ENUM_STR(DotRange),
+	INIT_ENUM_STR(TargetPrinter),
+	INIT_ENUM_STR(ExtraSamples),
+	INIT_ENUM_STR(SampleFormat),
+	INIT_ENUM_STR(SMinSampleValue),
+	INIT_ENUM_STR(SMaxSampleValue),
+	INIT_ENUM_STR(TransferRange),
+	INIT_ENUM_STR(JPEGProc),
+	INIT_ENUM_STR(JPEGInterchangeFormat),
+	INIT_ENUM_STR(JPEGInterchangeFormatLength),
+	INIT_ENUM_STR(JPEGRestartInterval),
+	INIT_ENUM_STR(JPEGLosslessPredictors),
+	INIT_ENUM_STR(JPEGPointTransforms),
+	INIT_ENUM_STR(JPEGQTables),
+	INIT_ENUM_STR(JPEGDCTables),
+	INIT_ENUM_STR(JPEGACTables),
+	INIT_ENUM_STR(YCbCrCoefficients),
+	INIT_ENUM_STR(YCbCrSubSampling),
+	INIT_ENUM_STR(YCbCrPositioning),
+	INIT_ENUM_STR(ReferenceBlackWhite),
+	INIT_ENUM_STR(ExposureTime),
+	INIT_ENUM_STR(FNumber),
+	INIT_ENUM_STR(ModelPixelScaleTag),
+	INIT_ENUM_STR(ModelTiepointTag),
+	INIT_ENUM_STR(ModelTransformationTag),
+	INIT_ENUM_STR(ExifIFDPointer),
+	INIT_ENUM_STR(GeoKeyDirectoryTag),
+	INIT_ENUM_STR(GeoDoubleParamsTag),
+	INIT_ENUM_STR(GeoAsciiParamsTag),
+	INIT_ENUM_STR(ExposureTime2),
+	INIT_ENUM_STR(ExposureProgram),
+	INIT_ENUM_STR(SpectralSensitivity),
+	INIT_ENUM_STR(ISOSpeedRatings),
+	INIT_ENUM_STR(OECF),
+	INIT_ENUM_STR(ExifVersion),
+	INIT_ENUM_STR(DateTimeOriginal),
+	INIT_ENUM_STR(DateTimeDigitized),
+	INIT_ENUM_STR(ComponentsConfiguration),
+	INIT_ENUM_STR(CompressedBitsPerPixel),
+	INIT_ENUM_STR(ShutterSpeedValue),
+	INIT_ENUM_STR(ApertureValue),
+	INIT_ENUM_STR(BrightnessValue),
+	INIT_ENUM_STR(ExposureBiasValue),
+	INIT_ENUM_STR(MaxApertureValue),
+	INIT_ENUM_STR(SubjectDistance),
+	INIT_ENUM_STR(MeteringMode),
+	INIT_ENUM_STR(LightSource),
+	INIT_ENUM_STR(Flash),
+	INIT_ENUM_STR(FocalLength),
+	INIT_ENUM_STR(SubjectArea),
+	INIT_ENUM_STR(MakerNote),
+	INIT_ENUM_STR(UserComment),
+	INIT_ENUM_STR(SubSecTime),
+	INIT_ENUM_STR(SubSecTimeOriginal),
+	INIT_ENUM_STR(SubSecTimeDigitized),
+	INIT_ENUM_STR(FlashpixVersion),
+	INIT_ENUM_STR(ColorSpace),
+	INIT_ENUM_STR(PixelXDimension),
+	INIT_ENUM_STR(PixelYDimension),
+	INIT_ENUM_STR(RelatedSoundFile),
+	INIT_ENUM_STR(FlashEnergy),
+	INIT_ENUM_STR(SpatialFrequencyResponse),
+	INIT_ENUM_STR(FocalPlaneXResolution),
+	INIT_ENUM_STR(FocalPlaneYResolution),
+	INIT_ENUM_STR(FocalPlaneResolutionUnit),
+	INIT_ENUM_STR(SubjectLocation),
+	INIT_ENUM_STR(ExposureIndex),
+	INIT_ENUM_STR(SensingMethod),
+	INIT_ENUM_STR(FileSource),
+	INIT_ENUM_STR(SceneType),
+	INIT_ENUM_STR(CFAPattern),
+	INIT_ENUM_STR(CustomRendered),
+	INIT_ENUM_STR(ExposureMode),
+	INIT_ENUM_STR(WhiteBalance),
+	INIT_ENUM_STR(DigitalZoomRatio),
+	INIT_ENUM_STR(FocalLengthIn35mmFilm),
+	INIT_ENUM_STR(SceneCaptureType),
+	INIT_ENUM_STR(GainControl),
+	INIT_ENUM_STR(Contrast),
+	INIT_ENUM_STR(Saturation),
+	INIT_ENUM_STR(Sharpness),
+	INIT_ENUM_STR(DeviceSettingDescription),
+	INIT_ENUM_STR(SubjectDistanceRange),
+	INIT_ENUM_STR(ImageUniqueID),
+	INIT_ENUM_STR(CameraOwnerName),
+	INIT_ENUM_STR(BodySerialNumber),
+	INIT_ENUM_STR(LensSpecification),
+	INIT_ENUM_STR(LensMake),
+	INIT_ENUM_STR(LensModel),
+	INIT_ENUM_STR(LensSerialNumber),
+};
+
+
 /**                                                                      **/
 /**   Function: getTagDescriptor                                         **/
 /**                                                                      **/
 /**   Return a pointer to a constant string description of the supplied  **/
-/**   Tag descriptor.                                                    **/
+/**   Tag descriptor, as given by the registered tag dictionaries or     **/
+/**   else by the built-in tags.                                         **/
 /**                                                                      **/
 /**   Input parameters:                                                  **/
 /**   tag     -- tag number                                              **/
@@ -408,152 +594,20 @@ const char *getTagDescriptor(unsigned short tag)
 {
 	unsigned int i;
 	const char *str = "unknown";
-	static const tagString desc[] = {
-		INIT_ENUM_STR(NewSubfileType),
-		INIT_ENUM_STR(SubfileType),
-		INIT_ENUM_STR(ImageWidth),
-		INIT_ENUM_STR(ImageLength),
-		INIT_ENUM_STR(BitsPerSample),
-		INIT_ENUM_STR(Compression),
-		INIT_ENUM_STR(PhotometricInterpretation),
-		INIT_ENUM_STR(Threshholding),
-		INIT_ENUM_STR(CellWidth),
-		INIT_ENUM_STR(CellLength),
-		INIT_ENUM_STR(FillOrder),
-		INIT_ENUM_STR(DocumentName),
-		INIT_ENUM_STR(ImageDescription),
-		INIT_ENUM_STR(Make),
-		INIT_ENUM_STR(Model),
-		INIT_ENUM_STR(StripOffsets),
-		INIT_ENUM_STR(Orientation),
-		INIT_ENUM_STR(SamplesPerPixel),
-		INIT_ENUM_STR(RowsPerStrip),
-		INIT_ENUM_STR(StripByteCounts),
-		INIT_ENUM_STR(MinSampleValue),
-		INIT_ENUM_STR(MaxSampleValue),
-		INIT_ENUM_STR(XResolution),
-		INIT_ENUM_STR(YResolution),
-		INIT_ENUM_STR(PlanarConfiguration),
-		INIT_ENUM_STR(XPosition),
-		INIT_ENUM_STR(YPosition),
-		INIT_ENUM_STR(FreeOffsets),
-		INIT_ENUM_STR(FreeByteCounts),
-		INIT_ENUM_STR(GrayResponseUnit),
-		INIT_ENUM_STR(GrayResponseCurve),
-		INIT_ENUM_STR(T4Options),
-		INIT_ENUM_STR(T6Options),
-		INIT_ENUM_STR(ResolutionUnit),
-		INIT_ENUM_STR(PageNumber),
-		INIT_ENUM_STR(TransferFunction),
-		INIT_ENUM_STR(Software),
-		INIT_ENUM_STR(DateTime),
-		INIT_ENUM_STR(Artist),
-		INIT_ENUM_STR(HostComputer),
-		INIT_ENUM_STR(Predictor),
-		INIT_ENUM_STR(WhitePoint),
-		INIT_ENUM_STR(PrimaryChromaticities),
-		INIT_ENUM_STR(ColorMap),
-		INIT_ENUM_STR(HalftoneHints),
-		INIT_ENUM_STR(TileWidth),
-		INIT_ENUM_STR(TileHeight),
-		INIT_ENUM_STR(TileOffsets),
-		INIT_ENUM_STR(TileByteCounts),
-		INIT_ENUM_STR(InkSet),
-		INIT_ENUM_STR(InkNames),
-		INIT_ENUM_STR(NumberOfInks),
-		INIT_ENUM_STR(DotRange),
-		INIT_ENUM_STR(TargetPrinter),
-		INIT_ENUM_STR(ExtraSamples),
-		INIT_ENUM_STR(SampleFormat),
-		INIT_ENUM_STR(SMinSampleValue),
-		INIT_ENUM_STR(SMaxSampleValue),
-		INIT_ENUM_STR(TransferRange),
-		INIT_ENUM_STR(JPEGProc),
-		INIT_ENUM_STR(JPEGInterchangeFormat),
-		INIT_ENUM_STR(JPEGInterchangeFormatLength),
-		INIT_ENUM_STR(JPEGRestartInterval),
-		INIT_ENUM_STR(JPEGLosslessPredictors),
-		INIT_ENUM_STR(JPEGPointTransforms),
-		INIT_ENUM_STR(JPEGQTables),
-		INIT_ENUM_STR(JPEGDCTables),
-		INIT_ENUM_STR(JPEGACTables),
-		INIT_ENUM_STR(YCbCrCoefficients),
-		INIT_ENUM_STR(YCbCrSubSampling),
-		INIT_ENUM_STR(YCbCrPositioning),
-		INIT_ENUM_STR(ReferenceBlackWhite),
-		INIT_ENUM_STR(ExposureTime),
-		INIT_ENUM_STR(FNumber),
-		INIT_ENUM_STR(ExifIFDPointer),
-		INIT_ENUM_STR(ExposureTime2),
-		INIT_ENUM_STR(ExposureProgram),
-		INIT_ENUM_STR(SpectralSensitivity),
-		INIT_ENUM_STR(ISOSpeedRatings),
-		INIT_ENUM_STR(OECF),
-		INIT_ENUM_STR(ExifVersion),
-		INIT_ENUM_STR(DateTimeOriginal),
-		INIT_ENUM_STR(DateTimeDigitized),
-		INIT_ENUM_STR(ComponentsConfiguration),
-		INIT_ENUM_STR(CompressedBitsPerPixel),
-		INIT_ENUM_STR(ShutterSpeedValue),
-		INIT_ENUM_STR(ApertureValue),
-		INIT_ENUM_STR(BrightnessValue),
-		INIT_ENUM_STR(ExposureBiasValue),
-		INIT_ENUM_STR(MaxApertureValue),
-		INIT_ENUM_STR(SubjectDistance),
-		INIT_ENUM_STR(MeteringMode),
-		INIT_ENUM_STR(LightSource),
-		INIT_ENUM_STR(Flash),
-		INIT_ENUM_STR(FocalLength),
-		INIT_ENUM_STR(SubjectArea),
-		INIT_ENUM_STR(MakerNote),
-		INIT_ENUM_STR(UserComment),
-		INIT_ENUM_STR(SubSecTime),
-		INIT_ENUM_STR(SubSecTimeOriginal),
-		INIT_ENUM_STR(SubSecTimeDigitized),
-		INIT_ENUM_STR(FlashpixVersion),
-		INIT_ENUM_STR(ColorSpace),
-		INIT_ENUM_STR(PixelXDimension),
-		INIT_ENUM_STR(PixelYDimension),
-		INIT_ENUM_STR(RelatedSoundFile),
-		INIT_ENUM_STR(FlashEnergy),
-		INIT_ENUM_STR(SpatialFrequencyResponse),
-		INIT_ENUM_STR(FocalPlaneXResolution),
-		INIT_ENUM_STR(FocalPlaneYResolution),
-		INIT_ENUM_STR(FocalPlaneResolutionUnit),
-		INIT_ENUM_STR(SubjectLocation),
-		INIT_ENUM_STR(ExposureIndex),
-		INIT_ENUM_STR(SensingMethod),
-		INIT_ENUM_STR(FileSource),
-		INIT_ENUM_STR(SceneType),
-		INIT_ENUM_STR(CFAPattern),
-		INIT_ENUM_STR(CustomRendered),
-		INIT_ENUM_STR(ExposureMode),
-		INIT_ENUM_STR(WhiteBalance),
-		INIT_ENUM_STR(DigitalZoomRatio),
-		INIT_ENUM_STR(FocalLengthIn35mmFilm),
-		INIT_ENUM_STR(SceneCaptureType),
-		INIT_ENUM_STR(GainControl),
-		INIT_ENUM_STR(Contrast),
-		INIT_ENUM_STR(Saturation),
-		INIT_ENUM_STR(Sharpness),
-		INIT_ENUM_STR(DeviceSettingDescription),
-		INIT_ENUM_STR(SubjectDistanceRange),
-		INIT_ENUM_STR(ImageUniqueID),
-		INIT_ENUM_STR(CameraOwnerName),
-		INIT_ENUM_STR(BodySerialNumber),
-		INIT_ENUM_STR(LensSpecification),
-		INIT_ENUM_STR(LensMake),
-		INIT_ENUM_STR(LensModel),
-		INIT_ENUM_STR(LensSerialNumber),
-	};
+	const char *name;
 
 	/* TODO: Add more efficient search algorithm. */
 
-	for(i = 0; i < N_ELEMENTS(desc); i++)
+	if( (name = tiffTagDBName(tag) ) != NULL)
 	{
-		if(desc[i].tag == (int)tag)
+		return name;
+	}
+
+	for(i = 0; i < N_ELEMENTS(tagDescLookup); i++)
+	{
+		if(tagDescLookup[i].tag == (int)tag)
 		{
-			str = desc[i].string;
+			str = tagDescLookup[i].string;
 			break;
 		}
 	}
@@ -562,12 +616,63 @@ const char *getTagDescriptor(unsigned short tag)
 }
 
 
+/**                                                                      **/
+/**   Function: getTagNumber                                             **/
+/**                                                                      **/
+/**   Return the number of the tag with the given name, as printed by    **/
+/**   getTagDescriptor, or -1 if the name is unknown.                    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   name    -- tag name                                                **/
+/**                                                                      **/
+
+int getTagNumber(const char *name)
+{
+	unsigned int i;
+	int tag;
+
+	if( (tag = tiffTagDBNumber(name) ) >= 0)
+	{
+		return tag;
+	}
+
+	for(i = 0; i < N_ELEMENTS(tagDescLookup); i++)
+	{
+		if(strcmp(tagDescLookup[i].string, name) == 0)
+		{
+			return tagDescLookup[i].tag;
+		}
+	}
+
+	return -1;
+}
+
+
+/**                                                                      **/
+/**   Function: getBuiltinTag                                            **/
+/**                                                                      **/
+/**   Return the number of the built-in tag of the given index, the tags **/
+/**   of tagNum_t being numbered from 0, or -1 past the last one.        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   index   -- index of the tag                                        **/
+/**                                                                      **/
+
+int getBuiltinTag(unsigned int index)
+{
+	return (index < N_ELEMENTS(tagDescLookup) ) ?
+		tagDescLookup[index].tag : -1;
+}
+
+
 /**                                                                      **/
 /**   Function: getTIFFValueDesc                                         **/
 /**                                                                      **/
 /**   Return a pointer to a string describing the Value of the given tag **/
 /**   descriptor and possibly value numbers, or "unknown" if unknown Tag **/
-/**   descriptor.                                                        **/
+/**   descriptor. Registered tag dictionaries are consulted first; tags  **/
+/**   they define but whose value they don't describe have no            **/
+/**   description.                                                       **/
 /**                                                                      **/
 /**   Input parameters:                                                  **/
 /**   tag     -- tag number                                              **/
@@ -652,8 +757,14 @@ const char *getTIFFValueDesc(unsigned short tag, unsigned int value)
 		{ FocalPlaneResolutionUnit, 0, 0, "", },
 	};
 	const lookup_t *p;
+	const char *desc;
 	unsigned int i;
 
+	if( (desc = tiffTagDBValueDesc(tag, value) ) != NULL)
+	{
+		return desc;
+	}
+
 	for (i = 0, p = lookup; i < N_ELEMENTS(lookup); i++, p++)
 	{
 		if (tag == p->tag && (p->checkValue == 0 || value == p->value))
@@ -663,10 +774,33 @@ const char *getTIFFValueDesc(unsigned short tag, unsigned int value)
 		}
 	}
 
+	if( (i == N_ELEMENTS(lookup) ) && (tiffTagDBName(tag) != NULL) )
+	{
+		str = "";
+	}
+
 	return str;
 }
 
 
+/**                                                                      **/
+/**   Function: fieldTypeData                                            **/
+/**                                                                      **/
+/**   Return the lookup table entry of a field type, the FT_UNKNOWN one  **/
+/**   for types out of range.                                            **/
+/**                                                                      **/
+
+static const fieldTypeData_t *fieldTypeData(fieldType_t fieldType)
+{
+	if( (unsigned int)fieldType > FT_MAX)
+	{
+		fieldType = FT_UNKNOWN;
+	}
+
+	return &fieldTypeLookup[fieldType];
+}
+
+
 /**                                                                      **/
 /**   Function: getFieldTypeNumBytes                                     **/
 /**                                                                      **/
@@ -680,20 +814,7 @@ const char *getTIFFValueDesc(unsigned short tag, unsigned int value)
 
 size_t getFieldTypeNumBytes(fieldType_t fieldType)
 {
-	size_t num = 0;
-	unsigned int i;
-	const fieldTypeData_t *p;
-
-	for (i = 0, p = fieldTypeLookup; i < N_ELEMENTS(fieldTypeLookup); i++, p++)
-	{
-		if (fieldType == p->type)
-		{
-			num = p->numBytes;
-			break;
-		}
-	}
-
-	return num;
+	return fieldTypeData(fieldType)->numBytes;
 }
 
 
@@ -710,167 +831,341 @@ size_t getFieldTypeNumBytes(fieldType_t fieldType)
 
 const char *getTIFFTypeDesc(fieldType_t fieldType)
 {
-	const char *str = "unknown";
-	unsigned int i;
-	const fieldTypeData_t *p;
-
-	for (i = 0, p = fieldTypeLookup; i < N_ELEMENTS(fieldTypeLookup); i++, p++)
-	{
-		if (fieldType == p->type)
-		{
-			str = p->desc;
-			break;
-		}
-	}
-
-	return str;
+	return fieldTypeData(fieldType)->desc;
 }
 
 
 /**                                                                      **/
-/**   Function: printEntry                                               **/
+/**   Functions: decodeUnsigned8, decodeSigned8, decodeUnsigned16,       **/
+/**   decodeSigned16, decodeUnsigned32, decodeSigned32, decodeRational,  **/
+/**   decodeSRational, decodeFloat, decodeDouble, decodeNone             **/
 /**                                                                      **/
-/**   Copy the name of the given Type of an Image File Directory (IFD)   **/
-/**   entry into the given buffer.                                       **/
+/**   Decoders of one value of each field type, see fieldTypeLookup.     **/
 /**                                                                      **/
 /**   Input parameters:                                                  **/
-/**   buffer     -- buffer containing entry value                        **/
-/**   tag        -- tag number                                           **/
-/**   fieldType  -- the Type number of an Image File Directory (IFD)     **/
-/**                 entry.                                               **/
-/**   internal   -- struct containing internal program data, including   **/
-/**                 machineEndian and fileEndian fields                  **/
+/**   src       -- value bytes in file order                             **/
+/**   internal  -- struct containing the endianness of the file          **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   value     -- decoded value                                         **/
 /**                                                                      **/
 
-void printEntry(const unsigned char *buffer, unsigned short tag,
-	fieldType_t fieldType, const internalStruct *internal)
+static void setInteger(tiffValue *value, long long integer)
+{
+	value->integer = integer;
+	value->denominator = 1;
+	value->real = (double)integer;
+
+	return;
+}
+
+static void decodeUnsigned8(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	setInteger(value, src[0]);
+
+	return;
+}
+
+static void decodeSigned8(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	setInteger(value, (signed char)src[0]);
+
+	return;
+}
+
+static void decodeUnsigned16(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
 {
 	byte4 tmp;
-	const char *desc;
-	unsigned int numerator, denominator;
-	int snumerator, sdenominator;
-	double result;
 
-	size_t numBytes = getFieldTypeNumBytes(fieldType);
+	memcpy(tmp.b, src, 2);
+	setInteger(value, cSwapUShort(tmp.s, internal) );
 
-	switch(fieldType)
-	{
-		case FT_ASCII:
-		{
-			if( (buffer[0] > 31) && (buffer[0] < 128) )
-			{
-				printf("Value '%c'\n", buffer[0]);
-			}
-			else
-			{
-				printf("Value %d\n", buffer[0]);
-			}
+	return;
+}
 
-			break;
-		}
-		case FT_SHORT:
-		{
-			memcpy(tmp.b, buffer, numBytes);
+static void decodeSigned16(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	byte4 tmp;
 
-			tmp.s = cSwapUShort(tmp.s, internal);
+	memcpy(tmp.b, src, 2);
+	setInteger(value, (short)cSwapUShort(tmp.s, internal) );
 
-			desc = getTIFFValueDesc(tag, (unsigned int)tmp.s);
-			printf("Value %d %s\n", tmp.s, desc);
+	return;
+}
 
-			break;
-		}
-		case FT_LONG:
-		{
-			memcpy(tmp.b, buffer, numBytes);
+static void decodeUnsigned32(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	byte4 tmp;
 
-			tmp.u = cSwapUInt(tmp.u, internal);
+	memcpy(tmp.b, src, 4);
+	setInteger(value, cSwapUInt(tmp.u, internal) );
 
-			desc = getTIFFValueDesc(tag, tmp.u);
-			printf("Value %d %s\n", tmp.u, desc);
+	return;
+}
 
-			break;
-		}
-		case FT_RATIONAL:
-		{
-			memcpy(tmp.b, buffer, numBytes / 2);
-			numerator = cSwapUInt(tmp.u, internal);
-			memcpy(tmp.b, buffer + numBytes / 2, numBytes / 2);
-			denominator = cSwapUInt(tmp.u, internal);
+static void decodeSigned32(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	byte4 tmp;
 
-			result = (double)numerator/(double)denominator;
+	memcpy(tmp.b, src, 4);
+	setInteger(value, cSwapInt(tmp.i, internal) );
 
-			printf("Value (%d/%d) %lf\n", numerator, denominator,
-				result);
+	return;
+}
 
-			break;
-		}
-		case FT_SRATIONAL:
-		{
-			memcpy(tmp.b, buffer, numBytes / 2);
-			snumerator = cSwapInt(tmp.u, internal);
-			memcpy(tmp.b, buffer + numBytes / 2, numBytes / 2);
-			sdenominator = cSwapInt(tmp.u, internal);
+static void decodeRational(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	byte4 tmp;
+
+	memcpy(tmp.b, src, 4);
+	value->integer = cSwapUInt(tmp.u, internal);
+	memcpy(tmp.b, src + 4, 4);
+	value->denominator = cSwapUInt(tmp.u, internal);
+	value->real = (double)value->integer / (double)value->denominator;
 
-			result = (double)snumerator/(double)sdenominator;
+	return;
+}
 
-			printf("Value (%d/%d) %lf\n", snumerator, sdenominator,
-				result);
+static void decodeSRational(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	byte4 tmp;
 
-			break;
-		}
-		default:
-		{
-			printf("Value 0x%x\n", buffer[0]);
-			break;
-		}
+	memcpy(tmp.b, src, 4);
+	value->integer = cSwapInt(tmp.i, internal);
+	memcpy(tmp.b, src + 4, 4);
+	value->denominator = cSwapInt(tmp.i, internal);
+	value->real = (double)value->integer / (double)value->denominator;
+
+	return;
+}
+
+static void decodeFloat(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	byte4 tmp;
+
+	memcpy(tmp.b, src, 4);
+	value->real = cSwapFloat(tmp.f, internal);
+	value->integer = (long long)value->real;
+	value->denominator = 1;
+
+	return;
+}
+
+static void decodeDouble(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	unsigned char bytes[8];
+	unsigned int i;
+
+	for(i = 0;i < 8;i++)
+	{
+		bytes[i] = (internal->fileEndian != internal->machineEndian) ?
+			src[7 - i] : src[i];
 	}
+	memcpy(&value->real, bytes, 8);
+	value->integer = (long long)value->real;
+	value->denominator = 1;
+
+	return;
+}
+
+static void decodeNone(const unsigned char *src,
+	const internalStruct *internal, tiffValue *value)
+{
+	setInteger(value, 0);
 
 	return;
 }
 
 
 /**                                                                      **/
-/**   Function: printDump                                                **/
+/**   Functions: printHex, printChar, printEnum, printSigned,            **/
+/**   printRational, printFloat, printDouble                             **/
 /**                                                                      **/
-/**   Print a hexadecimal dump of the first count bytes of buffer        **/
-/**   buffer in canonical hex+ASCII format.                              **/
+/**   Printers of a decoded value as a Value line, see fieldTypeLookup.  **/
 /**                                                                      **/
 /**   Input parameters:                                                  **/
-/**   buffer  -- unsigned char buffer to be dumped                       **/
-/**   count   -- number of bytes to dump                                 **/
+/**   value     -- decoded value                                         **/
+/**   tag       -- tag number, for the descriptions of SHORT and LONG    **/
+/**   internal  -- struct containing the output stream                   **/
 /**                                                                      **/
 
-void printDump(const unsigned char *buffer, int count)
+static void printHex(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
 {
-	int i, j;
-	int i2;
-	int bytesPerLine = 16;
+	tiffPrintf(internal, "Value 0x%llx\n",
+		(unsigned long long)value->integer);
 
-	for(i = 0;i < count;i++)
+	return;
+}
+
+static void printChar(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
+{
+	if( (value->integer > 31) && (value->integer < 128) )
 	{
-		if( (i % bytesPerLine) == 0)
-		{
-			printf("%08x  %02x ", i, buffer[i]);
-		}
-		else if( (i % bytesPerLine) == (bytesPerLine - 1) )
-		{
-			printf("%02x  |", buffer[i]);
-			for(j = i - (bytesPerLine - 1);j <= i;j++)
-			{
-				if( (buffer[j] > 31) && (buffer[j] < 128) )
+		tiffPrintf(internal, "Value '%c'\n", (int)value->integer);
+	}
+	else
+	{
+		tiffPrintf(internal, "Value %lld\n", value->integer);
+	}
+
+	return;
+}
+
+static void printEnum(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
+{
+	tiffPrintf(internal, "Value %lld %s\n", value->integer,
+		getTIFFValueDesc(tag, (unsigned int)value->integer) );
+
+	return;
+}
+
+static void printSigned(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
+{
+	tiffPrintf(internal, "Value %lld\n", value->integer);
+
+	return;
+}
+
+static void printRational(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
+{
+	tiffPrintf(internal, "Value (%lld/%lld) %lf\n", value->integer,
+		value->denominator, value->real);
+
+	return;
+}
+
+static void printFloat(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
+{
+	tiffPrintf(internal, "Value %.7g\n", value->real);
+
+	return;
+}
+
+static void printDouble(const tiffValue *value, unsigned short tag,
+	const internalStruct *internal)
+{
+	tiffPrintf(internal, "Value %.15g\n", value->real);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffDecodeValue                                          **/
+/**                                                                      **/
+/**   Decode one value of an IFD entry.                                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   src        -- value bytes in file order, getFieldTypeNumBytes of   **/
+/**                 them                                                 **/
+/**   fieldType  -- field type of the entry                              **/
+/**   internal   -- struct containing the endianness of the file         **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   value      -- decoded value                                        **/
+/**                                                                      **/
+
+void tiffDecodeValue(const unsigned char *src, fieldType_t fieldType,
+	const internalStruct *internal, tiffValue *value)
+{
+	fieldTypeData(fieldType)->decode(src, internal, value);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: printEntry                                               **/
+/**                                                                      **/
+/**   Print one value of an Image File Directory (IFD) entry as a Value  **/
+/**   line.                                                              **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   buffer     -- buffer containing entry value                        **/
+/**   tag        -- tag number                                           **/
+/**   fieldType  -- the Type number of an Image File Directory (IFD)     **/
+/**                 entry.                                               **/
+/**   internal   -- struct containing internal program data, including   **/
+/**                 machineEndian and fileEndian fields                  **/
+/**                                                                      **/
+
+void printEntry(const unsigned char *buffer, unsigned short tag,
+	fieldType_t fieldType, const internalStruct *internal)
+{
+	const fieldTypeData_t *type = fieldTypeData(fieldType);
+	tiffValue value;
+
+	type->decode(buffer, internal, &value);
+	type->print(&value, tag, internal);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: printDumpLines                                           **/
+/**                                                                      **/
+/**   Print count bytes of buffer in canonical hex+ASCII format, without **/
+/**   the closing offset line. Addresses start at start, so a long value **/
+/**   can be dumped in pieces; every piece but the last must hold a      **/
+/**   whole number of lines.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   buffer    -- unsigned char buffer to be dumped                     **/
+/**   count     -- number of bytes to dump                               **/
+/**   start     -- offset of buffer[0] within the value                  **/
+/**   internal  -- struct containing internal program data, including    **/
+/**                the output stream                                     **/
+/**                                                                      **/
+
+static void printDumpLines(const unsigned char *buffer, int count,
+	unsigned long long start, const internalStruct *internal)
+{
+	int i, j;
+	int i2;
+	int bytesPerLine = 16;
+
+	for(i = 0;i < count;i++)
+	{
+		if( (i % bytesPerLine) == 0)
+		{
+			tiffPrintf(internal, "%08llx  %02x ", start + i, buffer[i]);
+		}
+		else if( (i % bytesPerLine) == (bytesPerLine - 1) )
+		{
+			tiffPrintf(internal, "%02x  |", buffer[i]);
+			for(j = i - (bytesPerLine - 1);j <= i;j++)
+			{
+				if( (buffer[j] > 31) && (buffer[j] < 128) )
 				{
-					printf("%c", buffer[j]);
+					tiffPrintf(internal, "%c", buffer[j]);
 				}
 				else
 				{
-					printf(".");
+					tiffPrintf(internal, ".");
 				}
 			}
-			printf("|\n");
+			tiffPrintf(internal, "|\n");
 		}
 		else
 		{
-			printf("%02x ", buffer[i]);
+			tiffPrintf(internal, "%02x ", buffer[i]);
 		}
 	}
 	if( (i % bytesPerLine) != 0)
@@ -878,380 +1173,1687 @@ void printDump(const unsigned char *buffer, int count)
 		i2 = i;
 		for(i2 = i;(i2 % bytesPerLine) != (bytesPerLine - 1);i2++)
 		{
-			printf("   ");
+			tiffPrintf(internal, "   ");
 		}
-		printf("    |");
+		tiffPrintf(internal, "    |");
 		i2 -= (bytesPerLine - 1);
 		for(j = i2;j < i;j++)
 		{
 			if( (buffer[j] > 31) && (buffer[j] < 128) )
 			{
-				printf("%c", buffer[j]);
+				tiffPrintf(internal, "%c", buffer[j]);
 			}
 			else
 			{
-				printf(".");
+				tiffPrintf(internal, ".");
 			}
 		}
-		printf("|\n");
+		tiffPrintf(internal, "|\n");
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: printDump                                                **/
+/**                                                                      **/
+/**   Print a hexadecimal dump of the first count bytes of buffer        **/
+/**   buffer in canonical hex+ASCII format.                              **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   buffer    -- unsigned char buffer to be dumped                     **/
+/**   count     -- number of bytes to dump                               **/
+/**   internal  -- struct containing internal program data, including    **/
+/**                the output stream                                     **/
+/**                                                                      **/
+
+void printDump(const unsigned char *buffer, int count,
+	const internalStruct *internal)
+{
+	printDumpLines(buffer, count, 0, internal);
+	tiffPrintf(internal, "%08x\n", count);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: mapFile                                                  **/
+/**                                                                      **/
+/**   Map a regular file into memory read-only, so that values can be    **/
+/**   used in place instead of being read. Files that can't be mapped    **/
+/**   (pipes, empty files) are left to stdio.                            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing the open file                       **/
+/**                                                                      **/
+
+static void mapFile(internalStruct *internal)
+{
+	struct stat st;
+	void *map;
+
+	internal->map = NULL;
+	internal->mapSize = 0;
+
+	if( (fstat(fileno(internal->file), &st) != 0) ||
+		!S_ISREG(st.st_mode) || (st.st_size == 0) )
+	{
+		return;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+		fileno(internal->file), 0);
+	if(map != MAP_FAILED)
+	{
+		internal->map = (const unsigned char *)map;
+		internal->mapSize = (unsigned long long)st.st_size;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: mapRange                                                 **/
+/**                                                                      **/
+/**   Return a pointer to n mapped bytes at offset from the TIFF header, **/
+/**   or NULL if the file is not mapped or the range runs past its end.  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing internal program data               **/
+/**   offset    -- offset from the TIFF header                           **/
+/**   n         -- number of bytes                                       **/
+/**                                                                      **/
+
+static const unsigned char *mapRange(const internalStruct *internal,
+	unsigned long long offset, unsigned long long n)
+{
+	offset += internal->tiffOffset;
+
+	if( (internal->map == NULL) || (offset > internal->mapSize) ||
+		(n > internal->mapSize - offset) )
+	{
+		return NULL;
+	}
+
+	return internal->map + offset;
+}
+
+
+/**                                                                      **/
+/**  Function: printStrings                                              **/
+/**                                                                      **/
+/**  Print a piece of an ASCII value as one String line per NUL          **/
+/**  terminated string. A value may be printed in several pieces; the    **/
+/**  state carries an unterminated string over to the next piece.        **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  bytes       -- piece of the value                                   **/
+/**  n           -- size of the piece                                    **/
+/**  inString    -- 1 while a String line is open, updated               **/
+/**  numStrings  -- number of strings printed so far, updated            **/
+/**  internal    -- struct containing the output stream                  **/
+/**                                                                      **/
+
+static void printStrings(const unsigned char *bytes, size_t n,
+	int *inString, unsigned int *numStrings,
+	const internalStruct *internal)
+{
+	const unsigned char *end = bytes + n;
+	const unsigned char *nul;
+
+	while(bytes < end)
+	{
+		nul = (const unsigned char *)memchr(bytes, '\0', end - bytes);
+		if(nul == NULL)
+		{
+			nul = end;
+		}
+
+		if( (nul > bytes) && !*inString)
+		{
+			tiffPrintf(internal, "\t  String \"");
+			*inString = 1;
+			(*numStrings)++;
+		}
+		if(nul > bytes)
+		{
+			tiffPrintf(internal, "%.*s", (int)(nul - bytes),
+				(const char *)bytes);
+		}
+		if( (nul < end) && *inString)
+		{
+			tiffPrintf(internal, "\"\n");
+			*inString = 0;
+		}
+
+		bytes = (nul < end) ? nul + 1 : end;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Function: printStringsEnd                                           **/
+/**                                                                      **/
+/**  Close the last string of an ASCII value printed with printStrings,  **/
+/**  or print an empty one if the value held none.                       **/
+/**                                                                      **/
+
+static void printStringsEnd(int inString, unsigned int numStrings,
+	const internalStruct *internal)
+{
+	if(inString)
+	{
+		tiffPrintf(internal, "\"\n");
+	}
+	else if(numStrings == 0)
+	{
+		tiffPrintf(internal, "\t  String \"\"\n");
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Function: printValues                                               **/
+/**                                                                      **/
+/**  Print the values held by n bytes of an entry, one numbered Value    **/
+/**  line each. The decoder and printer of the field type are looked up  **/
+/**  once, so the loop doesn't depend on the type.                       **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  src        -- value bytes in file order                             **/
+/**  n          -- number of bytes, a multiple of the value size         **/
+/**  index      -- number of the first value, updated                    **/
+/**  tag        -- tag number                                            **/
+/**  fieldType  -- field type of the entry                               **/
+/**  internal   -- struct containing internal program data               **/
+/**                                                                      **/
+
+static void printValues(const unsigned char *src, size_t n,
+	unsigned int *index, unsigned short tag, fieldType_t fieldType,
+	const internalStruct *internal)
+{
+	const fieldTypeData_t *type = fieldTypeData(fieldType);
+	tiffValue value;
+	size_t j;
+
+	if(type->numBytes == 0)
+	{
+		return;
+	}
+
+	for(j = 0;j + type->numBytes <= n;j += type->numBytes)
+	{
+		type->decode(src + j, internal, &value);
+		tiffPrintf(internal, "\t  %d ", *index);
+		type->print(&value, tag, internal);
+		(*index)++;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Summary of a numeric array, accumulated a block at a time           **/
+/**                                                                      **/
+/**  isReal                                                              **/
+/**      1 for RATIONAL, SRATIONAL, FLOAT and DOUBLE values, whose       **/
+/**      statistics are kept as doubles                                  **/
+/**  min, max, sum                                                       **/
+/**      statistics of integer values, sum wrapping around               **/
+/**  minReal, maxReal, sumReal                                           **/
+/**      statistics of real values                                       **/
+/**  ups, downs                                                          **/
+/**      number of values above and below the one before them            **/
+/**  last, lastReal                                                      **/
+/**      last value of the previous block                                **/
+/**                                                                      **/
+
+typedef struct valueSummary
+{
+	int isReal;
+	long long min;
+	long long max;
+	unsigned long long sum;
+	double minReal;
+	double maxReal;
+	double sumReal;
+	unsigned long long ups;
+	unsigned long long downs;
+	long long last;
+	double lastReal;
+} valueSummary;
+
+
+/**                                                                      **/
+/**  Function: summarizeBlock                                            **/
+/**                                                                      **/
+/**  Add a block of decoded values to a summary. The value before the    **/
+/**  block is at index 0 and the block at 1 to n, so that a single       **/
+/**  branch-free pass compares each value with the one before it; it     **/
+/**  vectorizes where the target has 64-bit vector compares (-O3 with    **/
+/**  AVX2, say).                                                         **/
+/**                                                                      **/
+
+static void summarizeBlock(valueSummary *summary, long long *ints,
+	double *reals, size_t n)
+{
+	long long min = summary->min;
+	long long max = summary->max;
+	unsigned long long sum = summary->sum;
+	double minReal = summary->minReal;
+	double maxReal = summary->maxReal;
+	double sumReal = summary->sumReal;
+	unsigned long long ups = 0;
+	unsigned long long downs = 0;
+	size_t j;
+
+	if(summary->isReal)
+	{
+		reals[0] = summary->lastReal;
+		for(j = 1;j <= n;j++)
+		{
+			minReal = (reals[j] < minReal) ? reals[j] : minReal;
+			maxReal = (reals[j] > maxReal) ? reals[j] : maxReal;
+			sumReal += reals[j];
+			ups += (reals[j] > reals[j - 1]);
+			downs += (reals[j] < reals[j - 1]);
+		}
+		summary->lastReal = reals[n];
+	}
+	else
+	{
+		ints[0] = summary->last;
+		for(j = 1;j <= n;j++)
+		{
+			min = (ints[j] < min) ? ints[j] : min;
+			max = (ints[j] > max) ? ints[j] : max;
+			sum += (unsigned long long)ints[j];
+			ups += (ints[j] > ints[j - 1]);
+			downs += (ints[j] < ints[j - 1]);
+		}
+		summary->last = ints[n];
+	}
+
+	summary->min = min;
+	summary->max = max;
+	summary->sum = sum;
+	summary->minReal = minReal;
+	summary->maxReal = maxReal;
+	summary->sumReal = sumReal;
+	summary->ups += ups;
+	summary->downs += downs;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Function: summarizeValues                                           **/
+/**                                                                      **/
+/**  Summarize the values held by n bytes of an array of count values,   **/
+/**  printing those among the first and last SUMMARY_EDGE_VALUES as      **/
+/**  printValues would, and a line counting the values left out.         **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  src        -- value bytes in file order                             **/
+/**  n          -- number of bytes, a multiple of the value size         **/
+/**  index      -- number of the first value, updated                    **/
+/**  count      -- number of values of the array                         **/
+/**  tag        -- tag number                                            **/
+/**  fieldType  -- field type of the entry                               **/
+/**  summary    -- summary of the values before, updated                 **/
+/**  internal   -- struct containing internal program data               **/
+/**                                                                      **/
+
+static void summarizeValues(const unsigned char *src, size_t n,
+	unsigned int *index, unsigned int count, unsigned short tag,
+	fieldType_t fieldType, valueSummary *summary,
+	const internalStruct *internal)
+{
+	const fieldTypeData_t *type = fieldTypeData(fieldType);
+	long long ints[SUMMARY_BLOCK_VALUES + 1];
+	double reals[SUMMARY_BLOCK_VALUES + 1];
+	unsigned int tail = count - SUMMARY_EDGE_VALUES;
+	unsigned int first = *index;
+	unsigned int shown;
+	tiffValue value;
+	size_t m;
+	size_t j;
+
+	if(type->numBytes == 0)
+	{
+		return;
+	}
+	n -= n % type->numBytes;
+
+	if(first == 0)
+	{
+		type->decode(src, internal, &value);
+		summary->min = summary->max = summary->last = value.integer;
+		summary->minReal = summary->maxReal = summary->lastReal =
+			value.real;
+	}
+
+	while(n > 0)
+	{
+		m = n / type->numBytes;
+		if(m > SUMMARY_BLOCK_VALUES)
+		{
+			m = SUMMARY_BLOCK_VALUES;
+		}
+		for(j = 0;j < m;j++)
+		{
+			type->decode(src + j * type->numBytes, internal, &value);
+			ints[j + 1] = value.integer;
+			reals[j + 1] = value.real;
+		}
+		summarizeBlock(summary, ints, reals, m);
+
+		/* the values of the block at either end of the array */
+		if(first < SUMMARY_EDGE_VALUES)
+		{
+			shown = SUMMARY_EDGE_VALUES - first;
+			printValues(src, ( (shown < m) ? shown : m) * type->numBytes,
+				index, tag, fieldType, internal);
+		}
+		if( (first <= tail) && (tail < first + m) )
+		{
+			tiffPrintf(internal, "\t  ... %u values\n",
+				tail - SUMMARY_EDGE_VALUES);
+		}
+		if(first + m > tail)
+		{
+			shown = (first > tail) ? first : tail;
+			*index = shown;
+			printValues(src + (shown - first) * type->numBytes,
+				(first + m - shown) * type->numBytes, index, tag,
+				fieldType, internal);
+		}
+
+		first += (unsigned int)m;
+		src += m * type->numBytes;
+		n -= m * type->numBytes;
+	}
+	*index = first;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Function: printSummary                                              **/
+/**                                                                      **/
+/**  Print the statistics of a summarized array of count values.         **/
+/**                                                                      **/
+
+static void printSummary(const valueSummary *summary, unsigned int count,
+	const internalStruct *internal)
+{
+	const char *order;
+
+	if( (summary->ups == 0) && (summary->downs == 0) )
+	{
+		order = "constant";
+	}
+	else if( (summary->downs == 0) && (summary->ups == count - 1) )
+	{
+		order = "increasing";
+	}
+	else if(summary->downs == 0)
+	{
+		order = "non-decreasing";
+	}
+	else if( (summary->ups == 0) && (summary->downs == count - 1) )
+	{
+		order = "decreasing";
+	}
+	else if(summary->ups == 0)
+	{
+		order = "non-increasing";
+	}
+	else
+	{
+		order = "unordered";
+	}
+
+	if(summary->isReal)
+	{
+		tiffPrintf(internal, "\t  Summary count %u min %g max %g sum %g "
+			"%s\n", count, summary->minReal, summary->maxReal,
+			summary->sumReal, order);
+	}
+	else
+	{
+		tiffPrintf(internal, "\t  Summary count %u min %lld max %lld "
+			"sum %lld %s\n", count, summary->min, summary->max,
+			(long long)summary->sum, order);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Function: getOffsetValues                                           **/
+/**                                                                      **/
+/**  Print the values of an IFD entry whose value does not fit in the    **/
+/**  4 byte value field. Returns 0 on success, 1 on failure. Values of   **/
+/**  mapped files are printed in place; otherwise they are read and      **/
+/**  printed VALUE_CHUNK_BYTES at a time, so memory use does not depend  **/
+/**  on count. ASCII values print one line per NUL separated string.     **/
+/**  ASCII and UNDEFINED values longer than internal->maxValueBytes are  **/
+/**  cut short with a truncation marker. Numeric arrays of more than     **/
+/**  internal->maxArrayValues values print their first and last          **/
+/**  SUMMARY_EDGE_VALUES values and a Summary line with their count,     **/
+/**  minimum, maximum, sum and order instead of every value.             **/
+/**                                                                      **/
+/**  tag          -- tag number                                          **/
+/**  fieldType    -- the Type number of an Image File Directory (IFD)    **/
+/**                  entry.                                              **/
+/**  count        -- number of items in this entry                       **/
+/**  valueOffset  -- value or offset                                     **/
+/**  internal     -- struct containing internal program data, including  **/
+/**                  machineEndian, fileEndian, and tiffOffset fields    **/
+/**                                                                      **/
+
+int getOffsetValues(unsigned short tag, fieldType_t fieldType,
+	unsigned int count, unsigned int valueOffset,
+	const internalStruct *internal)
+{
+	unsigned char buffer[VALUE_CHUNK_BYTES];
+	valueSummary summary;
+	const unsigned char *mapped;
+	const unsigned char *src;
+	unsigned long long totalBytes;
+	unsigned long long shownBytes;
+	unsigned long long done;
+	unsigned int i = 0;
+	unsigned int numStrings = 0;
+	size_t entry_bytes;
+	size_t chunkBytes;
+	size_t n;
+	int inString = 0;
+	int summarize;
+	int status = 0;
+	tiffPhase_t phase;
+	tiffPhase_t renderPhase;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_FETCH);
+	TIFF_STAT_ADD(internal, fetches, 1);
+
+	/* Read whole values only, and whole dump lines for UNDEFINED */
+	entry_bytes = getFieldTypeNumBytes(fieldType);
+	totalBytes = (unsigned long long)entry_bytes * count;
+	chunkBytes = (entry_bytes == 0) ? VALUE_CHUNK_BYTES :
+		VALUE_CHUNK_BYTES - VALUE_CHUNK_BYTES % entry_bytes;
+
+	shownBytes = totalBytes;
+	if( ( (fieldType == FT_ASCII) || (fieldType == FT_UNDEFINED) ) &&
+		(internal->maxValueBytes != 0) &&
+		(internal->maxValueBytes + (fieldType == FT_ASCII) <
+		totalBytes) )
+	{
+		shownBytes = internal->maxValueBytes;
+	}
+
+	summarize = (fieldType != FT_ASCII) && (fieldType != FT_UNDEFINED) &&
+		(internal->maxArrayValues != 0) &&
+		(count > internal->maxArrayValues) &&
+		(count > 2 * SUMMARY_EDGE_VALUES);
+	memset(&summary, 0, sizeof(summary) );
+	summary.isReal = (fieldType == FT_RATIONAL) ||
+		(fieldType == FT_SRATIONAL) || (fieldType == FT_FLOAT) ||
+		(fieldType == FT_DOUBLE);
+
+	mapped = mapRange(internal, valueOffset, shownBytes);
+
+	for(done = 0;done < shownBytes;done += n)
+	{
+		n = chunkBytes;
+		if( (mapped != NULL) || (shownBytes - done < n) )
+		{
+			n = (size_t)(shownBytes - done);
+		}
+
+		if(mapped != NULL)
+		{
+			src = mapped + done;
+		}
+		else if(tiffReadAt(internal, (unsigned long long)
+			internal->tiffOffset + valueOffset + done, buffer, n) == n)
+		{
+			src = buffer;
+		}
+		else
+		{
+			if( (fieldType == FT_ASCII) || (fieldType == FT_UNDEFINED) )
+			{
+				fprintf(stderr, "can't read %s entry\n",
+					getTIFFTypeDesc(fieldType));
+			}
+			else
+			{
+				fprintf(stderr, "can't read offset entry\n");
+			}
+			status = 1;
+			break;
+		}
+
+		renderPhase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+		if(fieldType == FT_ASCII)
+		{
+			printStrings(src, n, &inString, &numStrings,
+				internal);
+		}
+		else if(fieldType == FT_UNDEFINED)
+		{
+			printDumpLines(src, (int)n, done, internal);
+		}
+		else if(summarize)
+		{
+			summarizeValues(src, n, &i, count, tag, fieldType, &summary,
+				internal);
+		}
+		else
+		{
+			printValues(src, n, &i, tag, fieldType, internal);
+		}
+		TIFF_STATS_LEAVE(internal, renderPhase);
+	}
+
+	renderPhase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+	if( (status == 0) && (fieldType == FT_ASCII) )
+	{
+		printStringsEnd(inString, numStrings, internal);
+	}
+	else if( (status == 0) && (fieldType == FT_UNDEFINED) )
+	{
+		tiffPrintf(internal, "%08llx\n", shownBytes);
+	}
+	else if( (status == 0) && summarize)
+	{
+		printSummary(&summary, count, internal);
+	}
+	if( (status == 0) && (shownBytes < totalBytes) )
+	{
+		tiffPrintf(internal,
+			"\t  ... truncated, %llu of %llu bytes shown\n",
+			shownBytes, totalBytes);
+	}
+	TIFF_STATS_LEAVE(internal, renderPhase);
+
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffInitInternal                                         **/
+/**                                                                      **/
+/**   Initialize an internal structure before a file is opened with      **/
+/**   tiffOpen.                                                          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing internal program data               **/
+/**                                                                      **/
+
+void tiffInitInternal(internalStruct *internal)
+{
+	memset(internal, 0, sizeof(*internal));
+
+	internal->machineEndian = detectMachineEndian();
+	internal->out = stdout;
+	internal->stats = NULL;
+	internal->worker = NULL;
+	internal->maxValueBytes = 0;
+	internal->maxArrayValues = 0;
+	internal->decodeMakerNotes = 0;
+	internal->map = NULL;
+	internal->mapSize = 0;
+	internal->io = NULL;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: readHeader                                               **/
+/**                                                                      **/
+/**   Open a file and read its TIFF header for tiffOpen.                 **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+static int readHeader(const char *filename, internalStruct *internal)
+{
+	struct tiffImageFileHeader tiff_hdr;
+	unsigned char buffer[128];
+	size_t got;
+
+	/* Files read through a backend are neither opened nor mapped */
+	if(internal->io == NULL)
+	{
+		internal->file = fopen(filename, "r");
+		if(internal->file == NULL)
+		{
+			fprintf(stderr, "can't open %s to read\n", filename);
+
+			return 1;
+		}
+		mapFile(internal);
+	}
+
+	/* Small TIFF files may be shorter than the probe buffer */
+	got = tiffReadAt(internal, 0, buffer, sizeof(buffer) );
+	if(got < sizeof(struct tiffImageFileHeader))
+	{
+		fprintf(stderr, "can't read header of %s\n", filename);
+		tiffClose(internal);
+
+		return 1;
+	}
+
+	internal->tiffOffset = 0;
+	if( (buffer[0] == 0xff) && (buffer[1] == 0xd8) )
+	{
+		if( (got >= 20) &&
+			(buffer[2] == 0xff) && (buffer[3] == 0xe1) &&
+			(buffer[6] == 'E') && (buffer[7] == 'x') &&
+			(buffer[8] == 'i') && (buffer[9] == 'f') )
+		{
+			internal->tiffOffset = 12;
+		}
+		else
+		{
+			fprintf(stderr, "can't find Exif header in %s\n",
+				filename);
+			tiffClose(internal);
+
+			return 1;
+		}
+	}
+
+	if( (buffer[internal->tiffOffset] == 'I') &&
+		(buffer[internal->tiffOffset + 1] == 'I') )
+	{
+		internal->fileEndian = 1;
+	}
+	else if( (buffer[internal->tiffOffset] == 'M') &&
+		(buffer[internal->tiffOffset + 1] == 'M') )
+	{
+		internal->fileEndian = 0;
+	}
+	else
+	{
+		fprintf(stderr, "unsupported file type %s\n", filename);
+		tiffClose(internal);
+
+		return 1;
+	}
+
+	/* The probe holds the whole header, so it isn't read again */
+	memcpy(&tiff_hdr, buffer + internal->tiffOffset, sizeof(tiff_hdr) );
+
+	internal->exifHeader = 0;
+
+	tiff_hdr.magic = cSwapUShort(tiff_hdr.magic, internal);
+	if(tiff_hdr.magic != TIFF_MAGIC)
+	{
+		fprintf(stderr, "bad magic number 0x%x -- exiting\n",
+			tiff_hdr.magic);
+		tiffClose(internal);
+
+		return 1;
+	}
+
+	internal->tiffIFDOffset = cSwapUInt(tiff_hdr.ifd_offset, internal);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffOpen                                                 **/
+/**                                                                      **/
+/**   Open a TIFF file or a JPEG file with an Exif header and read its   **/
+/**   TIFF header. On success the file is left open in internal->file    **/
+/**   and internal->fileEndian, tiffOffset and tiffIFDOffset are set.    **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+int tiffOpen(const char *filename, internalStruct *internal)
+{
+	tiffPhase_t phase;
+	int status;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_HEADER);
+	status = readHeader(filename, internal);
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffClose                                                **/
+/**                                                                      **/
+/**   Close the file opened by tiffOpen.                                 **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing internal program data               **/
+/**                                                                      **/
+
+void tiffClose(internalStruct *internal)
+{
+	if(internal->map != NULL)
+	{
+		munmap( (void *)internal->map, (size_t)internal->mapSize);
+		internal->map = NULL;
+		internal->mapSize = 0;
+	}
+
+	if(internal->file != NULL)
+	{
+		fclose(internal->file);
+		internal->file = NULL;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffFileSize                                             **/
+/**                                                                      **/
+/**   Return the size in bytes of the open file.                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing the open file                       **/
+/**                                                                      **/
+
+unsigned long long tiffFileSize(const internalStruct *internal)
+{
+	struct stat st;
+
+	if(internal->io != NULL)
+	{
+		return internal->io->size(internal->io->handle);
+	}
+
+	if(fstat(fileno(internal->file), &st) != 0)
+	{
+		return 0;
+	}
+
+	return (unsigned long long)st.st_size;
+}
+
+
+/**                                                                      **/
+/**  Function: prefetchIFD                                               **/
+/**                                                                      **/
+/**  Hint the backend of a file read through internal->io with the       **/
+/**  ranges about to be read once an IFD entry table is known: values    **/
+/**  stored out of line, and the IFDs the entries and the next IFD       **/
+/**  offset point to. A planner then fetches them in one round trip      **/
+/**  instead of one per dependent read.                                  **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  internal  -- struct containing internal program data                **/
+/**  table     -- IFD entry table followed by the next IFD offset        **/
+/**  got       -- bytes of the table read                                **/
+/**                                                                      **/
+
+static void prefetchIFD(const internalStruct *internal,
+	const unsigned char *table, size_t got)
+{
+	tiffIORange ranges[TIFF_IO_MAX_RANGES];
+	unsigned int numRanges = 0;
+	unsigned long long totalBytes;
+	unsigned short tag;
+	unsigned short fieldType;
+	unsigned int count;
+	unsigned int offset;
+	size_t i;
+	byte4 tmp;
+
+	if( (internal->io == NULL) || (internal->io->prefetch == NULL) )
+	{
+		return;
+	}
+
+	for(i = 0;(i + 12 <= got) && (numRanges < TIFF_IO_MAX_RANGES);
+		i += 12)
+	{
+		memcpy(tmp.b, table + i, 2);
+		tag = cSwapUShort(tmp.s, internal);
+		memcpy(tmp.b, table + i + 2, 2);
+		fieldType = cSwapUShort(tmp.s, internal);
+		memcpy(tmp.b, table + i + 4, 4);
+		count = cSwapUInt(tmp.u, internal);
+		memcpy(tmp.b, table + i + 8, 4);
+		offset = cSwapUInt(tmp.u, internal);
+		totalBytes = (unsigned long long)getFieldTypeNumBytes(
+			(fieldType_t)fieldType) * count;
+
+		/* Exif, GPS and Interoperability IFD pointers, or type IFD */
+		if( (count == 1) && ( (fieldType == 13) ||
+			( (fieldType == FT_LONG) && ( (tag == ExifIFDPointer) ||
+			(tag == 34853) || (tag == 40965) ) ) ) )
+		{
+			totalBytes = 2;
+		}
+		else if(totalBytes <= 4)
+		{
+			continue;
+		}
+
+		ranges[numRanges].offset = (unsigned long long)
+			internal->tiffOffset + offset;
+		ranges[numRanges].length = (size_t)totalBytes;
+		ranges[numRanges].dst = NULL;
+		ranges[numRanges].got = 0;
+		numRanges++;
+	}
+
+	if( (got % 12 == 4) && (numRanges < TIFF_IO_MAX_RANGES) )
+	{
+		memcpy(tmp.b, table + got - 4, 4);
+		offset = cSwapUInt(tmp.u, internal);
+		if(offset != 0)
+		{
+			ranges[numRanges].offset = (unsigned long long)
+				internal->tiffOffset + offset;
+			ranges[numRanges].length = 2;
+			ranges[numRanges].dst = NULL;
+			ranges[numRanges].got = 0;
+			numRanges++;
+		}
+	}
+
+	if(numRanges > 0)
+	{
+		internal->io->prefetch(internal->io->handle, ranges, numRanges);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**  Function: tiffIFDWalk                                               **/
+/**                                                                      **/
+/**  Walk a chain of IFDs starting at internal->tiffIFDOffset and call   **/
+/**  the visitor for every IFD and every entry. The entry table and the  **/
+/**  next IFD offset of each IFD are read with a single read. Entries    **/
+/**  are passed to the visitor decoded to machine byte order; values     **/
+/**  stored out of line are left for the visitor to fetch.               **/
+/**                                                                      **/
+/**  While walking the main chain the Exif IFD pointer is recorded in    **/
+/**  internal->exifHeader and internal->exifIFDOffset.                   **/
+/**                                                                      **/
+/**  The offsets of the IFDs walked are kept, so that a chain pointing   **/
+/**  back to one of its IFDs, or longer than TIFF_MAX_IFDS, ends the     **/
+/**  walk with an error instead of looping.                              **/
+/**                                                                      **/
+/**  Returns TIFF_WALK_CONTINUE once the end of the chain is reached,    **/
+/**  TIFF_WALK_STOP if the visitor stopped the walk, or TIFF_WALK_ERROR. **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  filename  -- file name, for error messages                          **/
+/**  internal  -- struct containing internal program data, including     **/
+/**               the open file and tiffIFDOffset                        **/
+/**  kind      -- chain being walked                                     **/
+/**  visitor   -- callbacks                                              **/
+/**  ctx       -- visitor context passed to each callback                **/
+/**                                                                      **/
+
+tiffWalk_t tiffIFDWalk(const char *filename, internalStruct *internal,
+	ifdKind_t kind, const tiffVisitor *visitor, void *ctx)
+{
+	tiffIFDInfo ifd;
+	tiffEntry entry;
+	unsigned short numEntries;
+	unsigned int *visited = NULL;
+	unsigned int numVisited = 0;
+	unsigned int maxVisited = 0;
+	unsigned int *grown;
+	unsigned char *buffer;
+	const unsigned char *table;
+	const unsigned char *mapped;
+	const unsigned char *p;
+	size_t tableBytes;
+	size_t got;
+	unsigned int i;
+	tiffWalk_t status = TIFF_WALK_CONTINUE;
+	tiffPhase_t phase;
+	byte4 tmp;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_WALK);
+
+	ifd.kind = kind;
+	ifd.index = 0;
+
+	while( (internal->tiffIFDOffset != 0) &&
+		(status == TIFF_WALK_CONTINUE) )
+	{
+		ifd.offset = internal->tiffIFDOffset;
+		ifd.nextOffset = 0;
+
+		for(i = 0;(i < numVisited) && (visited[i] != ifd.offset);i++)
+		{
+			continue;
+		}
+		if(i < numVisited)
+		{
+			fprintf(stderr, "IFD chain of %s loops back to offset %u\n",
+				filename, ifd.offset);
+			status = TIFF_WALK_ERROR;
+			break;
+		}
+		if(numVisited == TIFF_MAX_IFDS)
+		{
+			fprintf(stderr, "more than %d IFDs in a chain of %s\n",
+				TIFF_MAX_IFDS, filename);
+			status = TIFF_WALK_ERROR;
+			break;
+		}
+		if(numVisited == maxVisited)
+		{
+			maxVisited = (maxVisited == 0) ? 16 : maxVisited * 2;
+			grown = (unsigned int *)realloc(visited,
+				maxVisited * sizeof(*visited) );
+			if(grown == NULL)
+			{
+				fprintf(stderr, "can't alloc buffer\n");
+				status = TIFF_WALK_ERROR;
+				break;
+			}
+			visited = grown;
+		}
+		visited[numVisited++] = ifd.offset;
+
+		/* Mapped files are walked in place */
+		mapped = mapRange(internal, internal->tiffIFDOffset,
+			sizeof(numEntries) );
+		if(mapped != NULL)
+		{
+			memcpy(&numEntries, mapped, sizeof(numEntries) );
+		}
+		else if(tiffReadAt(internal, (unsigned long long)
+			internal->tiffIFDOffset + internal->tiffOffset,
+			&numEntries, sizeof(numEntries) ) != sizeof(numEntries) )
+		{
+			fprintf(stderr,
+				"can't read number of IFD entries of %s\n",
+				filename);
+			status = TIFF_WALK_ERROR;
+			break;
+		}
+		ifd.numEntries = cSwapUShort(numEntries, internal);
+		TIFF_STAT_ADD(internal, ifds, 1);
+
+		tableBytes = (size_t)ifd.numEntries * 12 + 4;
+		buffer = NULL;
+		if(mapped != NULL)
+		{
+			table = mapped + sizeof(numEntries);
+			got = internal->map + internal->mapSize - table;
+			if(got > tableBytes)
+			{
+				got = tableBytes;
+			}
+		}
+		else
+		{
+			buffer = (unsigned char *)tiffMalloc(tableBytes, internal);
+			if(buffer == NULL)
+			{
+				fprintf(stderr, "can't alloc buffer\n");
+				status = TIFF_WALK_ERROR;
+				break;
+			}
+			got = tiffReadAt(internal, (unsigned long long)
+				internal->tiffIFDOffset + internal->tiffOffset +
+				sizeof(numEntries), buffer, tableBytes);
+			table = buffer;
+			prefetchIFD(internal, table, got);
+		}
+
+		if(visitor->beginIFD != NULL)
+		{
+			status = visitor->beginIFD(ctx, internal, &ifd);
+		}
+
+		for(i = 0;(i < ifd.numEntries) &&
+			(status == TIFF_WALK_CONTINUE);i++)
+		{
+			if( (i + 1) * 12 > got)
+			{
+				fprintf(stderr, "can't read IFD entry of %s\n",
+					filename);
+				status = TIFF_WALK_ERROR;
+				break;
+			}
+			p = table + i * 12;
+
+			entry.ifd = &ifd;
+			entry.index = i;
+			memcpy(tmp.b, p, 2);
+			entry.tag = cSwapUShort(tmp.s, internal);
+			memcpy(tmp.b, p + 2, 2);
+			entry.fieldType = cSwapUShort(tmp.s, internal);
+			memcpy(tmp.b, p + 4, 4);
+			entry.count = cSwapUInt(tmp.u, internal);
+			memcpy(entry.value, p + 8, 4);
+			memcpy(tmp.b, p + 8, 4);
+			entry.valueOffset = cSwapUInt(tmp.u, internal);
+			entry.totalBytes = (unsigned long long)
+				getFieldTypeNumBytes(entry.fieldType) *
+				entry.count;
+			entry.isInline = (entry.totalBytes <= 4);
+			TIFF_STAT_ADD(internal, entries, 1);
+
+			if( (kind == IFD_TIFF) && (entry.tag == ExifIFDPointer) &&
+				(entry.fieldType == FT_LONG) && entry.isInline)
+			{
+				internal->exifHeader = 1;
+				internal->exifIFDOffset = entry.valueOffset;
+			}
+
+			if(visitor->entry != NULL)
+			{
+				status = visitor->entry(ctx, internal, &entry);
+			}
+		}
+
+		if( (status == TIFF_WALK_CONTINUE) && (got < tableBytes) )
+		{
+			fprintf(stderr, "can't read next IFD offset in %s\n",
+				filename);
+			status = TIFF_WALK_ERROR;
+		}
+
+		if(status == TIFF_WALK_CONTINUE)
+		{
+			memcpy(tmp.b, table + tableBytes - 4, 4);
+			ifd.nextOffset = cSwapUInt(tmp.u, internal);
+
+			if(visitor->endIFD != NULL)
+			{
+				status = visitor->endIFD(ctx, internal, &ifd);
+			}
+		}
+
+		free(buffer);
+
+		internal->tiffIFDOffset = ifd.nextOffset;
+		ifd.index++;
+	}
+
+	free(visited);
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**  Function: tiffWalkFile                                              **/
+/**                                                                      **/
+/**  Walk the main IFD chain of a file opened with tiffOpen, followed    **/
+/**  by its Exif IFD if the first chain points to one.                   **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  filename  -- file name, for error messages                          **/
+/**  internal  -- struct containing internal program data                **/
+/**  visitor   -- callbacks                                              **/
+/**  ctx       -- visitor context passed to each callback                **/
+/**                                                                      **/
+
+tiffWalk_t tiffWalkFile(const char *filename, internalStruct *internal,
+	const tiffVisitor *visitor, void *ctx)
+{
+	tiffWalk_t status;
+
+	status = tiffIFDWalk(filename, internal, IFD_TIFF, visitor, ctx);
+
+	if( (status == TIFF_WALK_CONTINUE) && (internal->exifHeader == 1) )
+	{
+		internal->tiffIFDOffset = internal->exifIFDOffset;
+		status = tiffIFDWalk(filename, internal, IFD_EXIF, visitor,
+			ctx);
 	}
-	printf("%08x\n", i);
 
-	return;
+	return status;
 }
 
 
 /**                                                                      **/
-/**  Function: getOffsetValues                                           **/
+/**  Function: tiffGetValuePointer                                       **/
 /**                                                                      **/
-/**  file         -- FILE pointer                                        **/
-/**  tag          -- tag number                                          **/
-/**  fieldType    -- the Type number of an Image File Directory (IFD)    **/
-/**                  entry.                                              **/
-/**  count        -- number of items in this entry                       **/
-/**  valueOffset  -- value or offset                                     **/
-/**  internal     -- struct containing internal program data, including  **/
-/**                  machineEndian, fileEndian, and tiffOffset fields    **/
+/**  Return a pointer to the value bytes of an entry, in file byte       **/
+/**  order, without copying them: into entry->value for inline values,   **/
+/**  into the file mapping otherwise. Returns NULL if the file is not    **/
+/**  mapped or the value runs past the end of the file. The pointer is   **/
+/**  valid as long as the entry, or until tiffClose, respectively.       **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  internal  -- struct containing internal program data                **/
+/**  entry     -- IFD entry                                              **/
 /**                                                                      **/
 
-void getOffsetValues(FILE *file, unsigned short tag,
-	fieldType_t fieldType, unsigned int count,
-	unsigned int valueOffset, const internalStruct *internal)
+const unsigned char *tiffGetValuePointer(const internalStruct *internal,
+	const tiffEntry *entry)
 {
-	int i;
-	int cur_pos;
-	int entry_bytes;
-	unsigned char *buffer;
+	if(entry->isInline)
+	{
+		return entry->value;
+	}
+
+	return mapRange(internal, entry->valueOffset, entry->totalBytes);
+}
 
-	cur_pos = ftell(file);
 
-	fseek(file, (int)(valueOffset + internal->tiffOffset), SEEK_SET);
+/**                                                                      **/
+/**  Function: tiffGetValueBytes                                         **/
+/**                                                                      **/
+/**  Copy n raw bytes of an entry value, starting start bytes into the   **/
+/**  value, to dst. Bytes are left in file byte order. Values stored     **/
+/**  out of line are copied from the file mapping or read with a single  **/
+/**  read. Returns 0 on success, 1 on failure.                           **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  internal  -- struct containing internal program data                **/
+/**  entry     -- IFD entry                                              **/
+/**  start     -- first byte of the value to copy                        **/
+/**  dst       -- buffer of at least n bytes                             **/
+/**  n         -- number of bytes to copy                                **/
+/**                                                                      **/
+
+int tiffGetValueBytes(internalStruct *internal, const tiffEntry *entry,
+	unsigned long long start, void *dst, size_t n)
+{
+	const unsigned char *src;
+	tiffPhase_t phase;
 
-	if(fieldType == FT_ASCII)
+	if(start + n > entry->totalBytes)
 	{
-		buffer = (unsigned char *)malloc(count);
-		if(buffer == NULL)
-		{
-			fprintf(stderr, "can't alloc buffer\n");
-			exit(1);
-		}
-		if(fread(buffer, 1, count, file) != count)
-		{
-			fprintf(stderr, "can't read ASCII entry\n");
-			exit(1);
-		}
-		printf("\t  String \"%s\"\n", buffer);
+		fprintf(stderr, "value of tag %d is too short\n", entry->tag);
+
+		return 1;
 	}
-	else if(fieldType == FT_UNDEFINED)
+
+	src = tiffGetValuePointer(internal, entry);
+	if(src != NULL)
 	{
-		buffer = (unsigned char *)malloc(count);
-		if(buffer == NULL)
-		{
-			fprintf(stderr, "can't alloc buffer\n");
-			exit(1);
-		}
-		if(fread(buffer, 1, count, file) != count)
-		{
-			fprintf(stderr, "can't read UNDEFINED entry\n");
-			exit(1);
-		}
-		printDump(buffer, count);
+		memcpy(dst, src + start, n);
+
+		return 0;
+	}
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_FETCH);
+	TIFF_STAT_ADD(internal, fetches, 1);
+
+	if(tiffReadAt(internal, (unsigned long long)internal->tiffOffset +
+		entry->valueOffset + start, dst, n) != n)
+	{
+		fprintf(stderr, "can't read values of tag %d\n", entry->tag);
+		TIFF_STATS_LEAVE(internal, phase);
+
+		return 1;
 	}
-	else /* all other types */
+
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**  Function: tiffSplitStrings                                          **/
+/**                                                                      **/
+/**  Split an ASCII value into its NUL separated strings without         **/
+/**  copying it. Every view points into bytes and its length excludes    **/
+/**  the NUL; a last string missing its NUL ends at the end of the       **/
+/**  value. Returns the number of strings, of which only the first       **/
+/**  maxViews are stored.                                                **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  bytes     -- ASCII value                                            **/
+/**  n         -- size of the value in bytes                             **/
+/**  views     -- array of at least maxViews views                       **/
+/**  maxViews  -- size of views                                          **/
+/**                                                                      **/
+
+unsigned int tiffSplitStrings(const unsigned char *bytes, size_t n,
+	tiffStringView *views, unsigned int maxViews)
+{
+	const unsigned char *end = bytes + n;
+	const unsigned char *nul;
+	unsigned int numViews = 0;
+
+	while(bytes < end)
 	{
-		entry_bytes = getFieldTypeNumBytes(fieldType);
-		buffer = (unsigned char *)malloc(entry_bytes);
-		if(buffer == NULL)
+		nul = (const unsigned char *)memchr(bytes, '\0', end - bytes);
+		if(nul == NULL)
 		{
-			fprintf(stderr, "can't alloc buffer\n");
-			exit(1);
+			nul = end;
 		}
 
-		for(i = 0;i < count;i++)
+		if(numViews < maxViews)
 		{
-			if(fread(buffer, entry_bytes, 1, file) != 1)
-			{
-				fprintf(stderr, "can't read offset entry\n");
-				exit(1);
-			}
-			printf("\t  %d ", i);
-			printEntry(buffer, tag, fieldType, internal);
+			views[numViews].ptr = (const char *)bytes;
+			views[numViews].length = nul - bytes;
 		}
+		numViews++;
+
+		bytes = (nul < end) ? nul + 1 : end;
 	}
 
-	/*  Reposition file position indicator to value at start of  */
-	/*  function.  */
-	fseek(file, (int)cur_pos, SEEK_SET);
+	return numViews;
+}
 
-	free(buffer);
 
-	return;
+/**                                                                      **/
+/**  Function: tiffGetStrings                                            **/
+/**                                                                      **/
+/**  Return the strings of an ASCII entry as views into the file         **/
+/**  mapping (or into entry->value for values of up to 4 bytes), so no   **/
+/**  memory is allocated. Returns the number of strings as               **/
+/**  tiffSplitStrings does, or -1 if the entry is not ASCII or its       **/
+/**  value can't be reached in place.                                    **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  internal  -- struct containing internal program data                **/
+/**  entry     -- IFD entry                                              **/
+/**  views     -- array of at least maxViews views                       **/
+/**  maxViews  -- size of views                                          **/
+/**                                                                      **/
+
+int tiffGetStrings(const internalStruct *internal, const tiffEntry *entry,
+	tiffStringView *views, unsigned int maxViews)
+{
+	const unsigned char *bytes;
+
+	if(entry->fieldType != FT_ASCII)
+	{
+		return -1;
+	}
+
+	bytes = tiffGetValuePointer(internal, entry);
+	if(bytes == NULL)
+	{
+		return -1;
+	}
+
+	return (int)tiffSplitStrings(bytes, (size_t)entry->totalBytes, views,
+		maxViews);
 }
 
 
 /**                                                                      **/
-/**  Function: tiffIFDPrint                                              **/
+/**  Function: tiffGetUIntArray                                          **/
 /**                                                                      **/
-/**  Print the entries of a TIFF or an Exif IFD.                         **/
+/**  Decode all values of a SHORT or LONG entry, such as StripOffsets    **/
+/**  or TileByteCounts, into an array of unsigned ints with a single     **/
+/**  read. SHORT values are read into the front of dst and widened in    **/
+/**  place, so no other buffer is needed. Returns 0 on success, 1 on     **/
+/**  failure.                                                            **/
 /**                                                                      **/
 /**  Input parameters:                                                   **/
-/**  filename  -- file name                                              **/
-/**  file      -- FILE pointer                                           **/
-/**  internal  -- struct containing internal program data, including     **/
-/**               fileEndian field                                       **/
+/**  internal  -- struct containing internal program data                **/
+/**  entry     -- IFD entry                                              **/
+/**  dst       -- array of at least entry->count unsigned ints           **/
 /**                                                                      **/
 
-void tiffIFDPrint(const char *filename, FILE *file, internalStruct *internal)
+int tiffGetUIntArray(internalStruct *internal, const tiffEntry *entry,
+	unsigned int *dst)
 {
-	int i;
-	unsigned short tiffIFDEntries;
-	struct tiffIFDEntry ifd_entry;
-	int total_bytes;
-	const char *desc;
-	unsigned int value;
-	byte4 tmp;
+	size_t i;
+	size_t n = entry->count;
+	unsigned char *bytes = (unsigned char *)dst;
+	unsigned short s;
+	unsigned int u;
+	int swapBytes;
 
-	while(internal->tiffIFDOffset != 0)
+	if( (entry->fieldType != FT_SHORT) && (entry->fieldType != FT_LONG) )
 	{
-		fseek(file, (internal->tiffIFDOffset + internal->tiffOffset),
-			SEEK_SET);
+		fprintf(stderr, "tag %d is not a SHORT or LONG array\n",
+			entry->tag);
 
-		if(fread(&tiffIFDEntries, sizeof(tiffIFDEntries), 1, file) !=
-			1)
-		{
-			fprintf(stderr,
-				"can't read number of IFD entries of %s\n",
-				filename);
-			exit(1);
-		}
+		return 1;
+	}
+
+	if(tiffGetValueBytes(internal, entry, 0, bytes,
+		(size_t)entry->totalBytes) != 0)
+	{
+		return 1;
+	}
 
-		tiffIFDEntries = cSwapUShort(tiffIFDEntries, internal);
-		printf("number of IFD entries %d\n", tiffIFDEntries);
+	/* Keep the swap decision out of the loops so they vectorize */
+	swapBytes = internal->machineEndian ^ internal->fileEndian;
 
-		for(i = 0;i < tiffIFDEntries;i++)
+	if(entry->fieldType == FT_LONG)
+	{
+		if(swapBytes)
 		{
-			printf("\nIFD entry %d\n", i + 1);
-			if(fread(&ifd_entry, sizeof(ifd_entry), 1, file) != 1)
+			for(i = 0;i < n;i++)
 			{
-				fprintf(stderr, "can't IFD entry of %s\n",
-					filename);
-				exit(1);
+				u = dst[i];
+				dst[i] = ( (u & 0xff000000) >> 24) +
+					( (u & 0xff0000) >> 8) +
+					( (u & 0xff00) << 8) + ( (u & 0xff) << 24);
 			}
-			ifd_entry.tag = cSwapUShort(ifd_entry.tag, internal);
-			desc = getTagDescriptor(ifd_entry.tag);
-			printf("\tTag %d  (%04X.H)   %s\n", ifd_entry.tag,
-				ifd_entry.tag, desc);
-			ifd_entry.fieldType = cSwapUShort(ifd_entry.fieldType,
-				internal);
+		}
+	}
+	else
+	{
+		/* Widen from the end so no unread SHORT is overwritten */
+		for(i = n;i-- > 0;)
+		{
+			memcpy(&s, bytes + i * 2, 2);
+			if(swapBytes)
+			{
+				s = ( (s & 0xff00) >> 8) + ( (s & 0xff) << 8);
+			}
+			dst[i] = s;
+		}
+	}
 
-			desc = getTIFFTypeDesc(ifd_entry.fieldType);
-			printf("\tType %d %s\n", ifd_entry.fieldType, desc);
+	return 0;
+}
 
-			ifd_entry.count = cSwapUInt(ifd_entry.count, internal);
-			printf("\tCount %d\n", ifd_entry.count);
 
-			total_bytes = getFieldTypeNumBytes(ifd_entry.fieldType)
-				* ifd_entry.count;
-			if(total_bytes > 4)
-			{
-				ifd_entry.valueOffset =
-					cSwapUInt(ifd_entry.valueOffset,
-						internal);
-				printf("\tOffset %d\n", ifd_entry.valueOffset);
-				getOffsetValues(file, ifd_entry.tag,
-					ifd_entry.fieldType,
-					ifd_entry.count,
-					ifd_entry.valueOffset, internal);
-			}
-			else
-			{
-				tmp.u = ifd_entry.valueOffset;
-				if(ifd_entry.fieldType == FT_SHORT)
-				{
-					value = (unsigned int)
-						cSwapUShort(tmp.s, internal);
-				}
-				else if(ifd_entry.fieldType == FT_LONG)
-				{
-					value = cSwapUInt(
-						ifd_entry.valueOffset,
-						internal);
-					if(ifd_entry.tag == 0x8769)
-					{
-						internal->exifHeader = 1;
-						internal->exifIFDOffset =
-							value;
-					}
-				}
-				else if(ifd_entry.fieldType == FT_UNDEFINED)
-				{
-					printDump( (unsigned char *)tmp.b,
-						total_bytes);
-				}
-				else
-				{
-					value = cSwapUInt(tmp.u, internal);
-				}
+/**                                                                      **/
+/**  State of the IFD walker callbacks printing every IFD entry          **/
+/**                                                                      **/
+/**  filename                                                            **/
+/**      file name, for error messages                                   **/
+/**  make                                                                **/
+/**      start of the Make of the main IFD chain, which tells Canon      **/
+/**      MakerNotes apart (only kept with decodeMakerNotes)              **/
+/**                                                                      **/
 
-				if(ifd_entry.fieldType != FT_UNDEFINED)
-				{
-					desc = getTIFFValueDesc(
-						ifd_entry.tag,
-						value);
-					printf("\tValue %d %s\n", value,
-						desc);
-				}
-			}
+typedef struct printCtx
+{
+	const char *filename;
+	char make[16];
+} printCtx;
 
 
-		}
-		printf("\n");
+/**                                                                      **/
+/**  IFD walker callbacks printing every IFD entry                       **/
+/**                                                                      **/
+
+static tiffWalk_t printBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	tiffPhase_t phase;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+	tiffPrintf(internal, "number of IFD entries %d\n", ifd->numEntries);
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static tiffWalk_t printIFDEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	printCtx *print = (printCtx *)ctx;
+	tiffMakerNote note;
+	const char *desc;
+	unsigned int numStrings = 0;
+	unsigned int index = 0;
+	int inString = 0;
+	size_t n;
+	tiffWalk_t status = TIFF_WALK_CONTINUE;
+	tiffPhase_t phase;
 
-		if(fread(&(internal->tiffIFDOffset),
-			sizeof(internal->tiffIFDOffset), 1, file) != 1)
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+
+	if(internal->decodeMakerNotes && (entry->ifd->kind == IFD_TIFF) &&
+		(entry->tag == Make) && (entry->fieldType == FT_ASCII) )
+	{
+		n = sizeof(print->make) - 1;
+		if(entry->totalBytes < n)
 		{
-			fprintf(stderr, "can't read next IFD offset in %s\n",
-				filename);
-			exit(1);
+			n = (size_t)entry->totalBytes;
 		}
+		memset(print->make, 0, sizeof(print->make) );
+		tiffGetValueBytes(internal, entry, 0, print->make, n);
+	}
+
+	tiffPrintf(internal, "\nIFD entry %d\n", entry->index + 1);
+	desc = getTagDescriptor(entry->tag);
+	tiffPrintf(internal, "\tTag %d  (%04X.H)   %s\n", entry->tag,
+		entry->tag, desc);
+
+	desc = getTIFFTypeDesc(entry->fieldType);
+	tiffPrintf(internal, "\tType %d %s\n", entry->fieldType, desc);
+
+	tiffPrintf(internal, "\tCount %d\n", entry->count);
 
-		internal->tiffIFDOffset = cSwapUInt(internal->tiffIFDOffset,
-			internal);
-		if(internal->tiffIFDOffset == 0)
+	if(!entry->isInline)
+	{
+		tiffPrintf(internal, "\tOffset %d\n", entry->valueOffset);
+
+		/* MakerNotes are only looked into when asked for */
+		if(internal->decodeMakerNotes && (entry->tag == MakerNote) &&
+			(tiffMakerNoteOpen(internal, entry, print->make,
+			&note) == 0) )
 		{
-			printf("End of IFD list\n");
+			if(tiffMakerNotePrint(print->filename, &note) != 0)
+			{
+				status = TIFF_WALK_ERROR;
+			}
 		}
-		else
+		else if(getOffsetValues(entry->tag, entry->fieldType,
+			entry->count, entry->valueOffset, internal) != 0)
 		{
-			printf("next IFD offset %d\n",
-				internal->tiffIFDOffset);
+			status = TIFF_WALK_ERROR;
 		}
 	}
+	else if(entry->fieldType == FT_UNDEFINED)
+	{
+		printDump(entry->value, (int)entry->totalBytes, internal);
+	}
+	else if(entry->fieldType == FT_ASCII)
+	{
+		printStrings(entry->value, (size_t)entry->totalBytes, &inString,
+			&numStrings, internal);
+		printStringsEnd(inString, numStrings, internal);
+	}
+	else if(entry->totalBytes == 0)
+	{
+		/* Unknown types only show the raw value field */
+		tiffPrintf(internal, "\tValue 0x%x\n", entry->valueOffset);
+	}
+	else if(entry->count == 1)
+	{
+		tiffPrintf(internal, "\t");
+		printEntry(entry->value, entry->tag, entry->fieldType, internal);
+	}
+	else
+	{
+		/* Several values fit in the value field, such as 2 SHORTs */
+		printValues(entry->value, (size_t)entry->totalBytes, &index,
+			entry->tag, entry->fieldType, internal);
+	}
 
-	return;
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return status;
+}
+
+static tiffWalk_t printEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	tiffPhase_t phase;
+
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
+
+	tiffPrintf(internal, "\n");
+
+	if(ifd->nextOffset == 0)
+	{
+		tiffPrintf(internal, "End of IFD list\n");
+	}
+	else
+	{
+		tiffPrintf(internal, "next IFD offset %d\n", ifd->nextOffset);
+	}
+
+	TIFF_STATS_LEAVE(internal, phase);
+
+	return TIFF_WALK_CONTINUE;
 }
 
+static const tiffVisitor printVisitor = {
+	printBeginIFD,
+	printIFDEntry,
+	printEndIFD,
+};
+
 
 /**                                                                      **/
-/**   Function: tiffMetadataPrint                                        **/
+/**  Function: tiffIFDPrint                                              **/
+/**                                                                      **/
+/**  Print the entries of a TIFF or an Exif IFD. Returns 0 on success,   **/
+/**  1 on failure.                                                       **/
+/**                                                                      **/
+/**  Input parameters:                                                   **/
+/**  filename  -- file name                                              **/
+/**  internal  -- struct containing internal program data, including     **/
+/**               fileEndian field                                       **/
+/**                                                                      **/
+
+int tiffIFDPrint(const char *filename, internalStruct *internal)
+{
+	printCtx print;
+
+	memset(&print, 0, sizeof(print) );
+	print.filename = filename;
+
+	if(tiffIFDWalk(filename, internal, IFD_TIFF, &printVisitor, &print) ==
+		TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffMetadataPrintFile                                    **/
 /**                                                                      **/
 /**   Print the metadata of a TIFF file or a JPEG file with an Exif      **/
-/**   header.                                                            **/
+/**   header to internal->out. Returns 0 on success, 1 on failure.       **/
 /**                                                                      **/
 /**   Input parameters:                                                  **/
 /**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
 /**                                                                      **/
 
-int tiffMetadataPrint(const char *filename)
+int tiffMetadataPrintFile(const char *filename, internalStruct *internal)
 {
-	FILE *file;
-	struct tiffImageFileHeader tiff_hdr;
-	unsigned char buffer[1024];
-	internalStruct internal;
-
-	internal.machineEndian = detectMachineEndian();
+	printCtx print;
+	tiffWalk_t status;
+	tiffPhase_t phase;
 
 #if DEBUG
-	if(internal.machineEndian == 1)
+	if(internal->machineEndian == 1)
 	{
-		printf("This machine has little-endian architecture.\n");
+		tiffPrintf(internal,
+			"This machine has little-endian architecture.\n");
 	}
 	else
 	{
-		printf("This machine has big-endian architecture.\n");
+		tiffPrintf(internal,
+			"This machine has big-endian architecture.\n");
 	}
 #endif
 
-	file = fopen(filename, "r");
-	if(file == NULL)
+	if(tiffOpen(filename, internal) != 0)
 	{
-		fprintf(stderr, "can't open %s to read\n", filename);
-
 		return 1;
 	}
 
-	if(fread(buffer, 1, 128, file) != 128)
-	{
-		fprintf(stderr, "can't read header of %s\n", filename);
-
-		return 1;
-	}
+	phase = TIFF_STATS_ENTER(internal, TIFF_PHASE_RENDER);
 
-	internal.tiffOffset = 0;
-	if( (buffer[0] == 0xff) && (buffer[1] == 0xd8) )
+	if(internal->tiffOffset != 0)
 	{
-		printf("JPEG file\n");
-
-		if( (buffer[2] == 0xff) && (buffer[3] == 0xe1) &&
-			(buffer[6] == 'E') && (buffer[7] == 'x') &&
-			(buffer[8] == 'i') && (buffer[9] == 'f') )
-		{
-			internal.tiffOffset = 12;
-		}
-		else
-		{
-			fprintf(stderr, "can't find Exif header\n");
-
-			return 1;
-		}
+		tiffPrintf(internal, "JPEG file\n");
 	}
 
-	if( (buffer[internal.tiffOffset] == 'I') &&
-		(buffer[internal.tiffOffset + 1] == 'I') )
-	{
-		internal.fileEndian = 1;
-		printf("Intel (little-endian) byte order\n");
-	}
-	else if( (buffer[internal.tiffOffset] == 'M') &&
-		(buffer[internal.tiffOffset + 1] == 'M') )
+	if(internal->fileEndian == 1)
 	{
-		internal.fileEndian = 0;
-		printf("Motorola (big-endian) byte order\n");
+		tiffPrintf(internal, "Intel (little-endian) byte order\n");
 	}
 	else
 	{
-		fprintf(stderr, "unsupported file type\n");
-
-		return 1;
+		tiffPrintf(internal, "Motorola (big-endian) byte order\n");
 	}
 
-	fseek(file, internal.tiffOffset, SEEK_SET);
+	tiffPrintf(internal, "Magic %d\n", TIFF_MAGIC);
+	tiffPrintf(internal, "IFD offset %d\n", internal->tiffIFDOffset);
 
-	if(fread(&tiff_hdr, sizeof(struct tiffImageFileHeader), 1, file) != 1)
-	{
-		fprintf(stderr, "can't read header of %s\n", filename);
+	TIFF_STATS_LEAVE(internal, phase);
 
-		return 1;
-	}
+	memset(&print, 0, sizeof(print) );
+	print.filename = filename;
 
-	internal.exifHeader = 0;
+	status = tiffIFDWalk(filename, internal, IFD_TIFF, &printVisitor,
+		&print);
 
-	tiff_hdr.magic = cSwapUShort(tiff_hdr.magic, &internal);
-	if(tiff_hdr.magic != TIFF_MAGIC)
+	/* If the first IFD contains an Exif header, print that too */
+	if( (status == TIFF_WALK_CONTINUE) && (internal->exifHeader == 1) )
 	{
-		fprintf(stderr, "bad magic number 0x%x -- exiting\n",
-			tiff_hdr.magic);
+		internal->tiffIFDOffset = internal->exifIFDOffset;
 
-		return 1;
+		tiffPrintf(internal, "\nExif header\n");
+		status = tiffIFDWalk(filename, internal, IFD_EXIF,
+			&printVisitor, &print);
 	}
-	printf("Magic %d\n", tiff_hdr.magic);
 
-	tiff_hdr.ifd_offset = cSwapUInt(tiff_hdr.ifd_offset, &internal);
-	printf("IFD offset %d\n", tiff_hdr.ifd_offset);
+	tiffClose(internal);
 
-	internal.tiffIFDOffset = tiff_hdr.ifd_offset;
-	tiffIFDPrint(filename, file, &internal);
+	return (status == TIFF_WALK_ERROR) ? 1 : 0;
+}
 
-	/* If the first IFD contains an Exif header, print that too */
-	if(internal.exifHeader == 1)
-	{
-		internal.tiffIFDOffset = internal.exifIFDOffset;
 
-		printf("\nExif header\n");
-		tiffIFDPrint(filename, file, &internal);
-	}
+/**                                                                      **/
+/**   Function: tiffMetadataPrint                                        **/
+/**                                                                      **/
+/**   Print the metadata of a TIFF file or a JPEG file with an Exif      **/
+/**   header.                                                            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**                                                                      **/
+
+int tiffMetadataPrint(const char *filename)
+{
+	internalStruct internal;
 
-	fclose(file);
+	tiffInitInternal(&internal);
 
-	return 0;
+	return tiffMetadataPrintFile(filename, &internal);
 }
@@ -50,6 +50,12 @@ SOFTWARE.
 
 # define TIFF_MAGIC 42
 
+/* numeric values printed one by one by default, see maxArrayValues */
+#define TIFF_ARRAY_VALUES 64
+
+/* most IFDs walked in one chain, see tiffIFDWalk */
+#define TIFF_MAX_IFDS 8192
+
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -99,6 +105,27 @@ struct tiffIFDEntry
 /**      offset of TIFF file header from file start                      **/
 /**  tiffIFDOffset                                                       **/
 /**      offset of TIFF IFD from file start                              **/
+/**  file                                                                **/
+/**      FILE pointer of the open TIFF or JPEG file                      **/
+/**  out                                                                 **/
+/**      stream the metadata is printed to, stdout by default            **/
+/**  stats                                                               **/
+/**      performance counters to update, or NULL (see tiff_stats.h)      **/
+/**  worker                                                              **/
+/**      state of the batch worker running the file, or NULL (see        **/
+/**      tiff_batch.h)                                                   **/
+/**  map, mapSize                                                        **/
+/**      read-only mapping of the open file and its size, or NULL        **/
+/**  io                                                                  **/
+/**      backend the file is read through instead of being opened, or    **/
+/**      NULL (see tiff_io.h)                                            **/
+/**  maxValueBytes                                                       **/
+/**      most bytes of an ASCII or UNDEFINED value printed, 0 for all    **/
+/**  maxArrayValues                                                      **/
+/**      most values of a numeric value printed one by one, longer ones  **/
+/**      being summarized, 0 for all                                     **/
+/**  decodeMakerNotes                                                    **/
+/**      1 to print MakerNotes of known vendors decoded instead of dumped**/
 /**                                                                      **/
 
 typedef struct internalStruct
@@ -109,6 +136,16 @@ typedef struct internalStruct
 	unsigned int tiffIFDOffset;
 	int exifHeader;
 	unsigned int exifIFDOffset;
+	FILE *file;
+	FILE *out;
+	struct tiffStats *stats;
+	void *worker;
+	const unsigned char *map;
+	unsigned long long mapSize;
+	struct tiffIO *io;
+	unsigned long long maxValueBytes;
+	unsigned int maxArrayValues;
+	int decodeMakerNotes;
 } internalStruct;
 
 
@@ -139,40 +176,367 @@ typedef struct tagString
 
 
 /**                                                                      **/
-<<<<<<< HEAD
-/**    External declarations                                             **/
+/**  TIFF field types                                                    **/
 /**                                                                      **/
 
-EXTERN int detectMachineEndian(void);
-EXTERN unsigned short cSwapUShort(unsigned short a,
-	struct internalStruct *internal);
-EXTERN unsigned int cSwapUInt(unsigned int a, internalStruct *internal);
-EXTERN int cSwapInt(int a, internalStruct *internal);
-EXTERN float cSwapFloat(float a, internalStruct *internal);
-EXTERN void getTagDescriptor(char *buffer, unsigned short tag);
-EXTERN void getTIFFValueDesc(char *buffer, unsigned short tag,
-	unsigned int value);
-EXTERN int getFieldTypeNumBytes(unsigned short fieldType);
-EXTERN void getTIFFTypeDesc(char *buffer, unsigned short fieldType);
-EXTERN void printEntry(unsigned char *buffer, unsigned short tag,
-        unsigned short fieldType, internalStruct *internal);
-EXTERN void printDump(unsigned char *buffer, int count);
-EXTERN void getOffsetValues(FILE *file, unsigned short tag,
-        unsigned short fieldType, unsigned int count,
-        unsigned int valueOffset, internalStruct *internal);
-EXTERN void tiffIFDPrint(char *filename, FILE *file, internalStruct *internal);
-EXTERN int tiffMetadataPrint(char *filename);
+typedef enum {
+	FT_UNKNOWN = 0,
+	FT_BYTE,
+	FT_ASCII,
+	FT_SHORT,
+	FT_LONG,
+	FT_RATIONAL,
+	FT_SBYTE,
+	FT_UNDEFINED,
+	FT_SSHORT,
+	FT_SLONG,
+	FT_SRATIONAL,
+	FT_FLOAT,
+	FT_DOUBLE,
+	FT_MIN = FT_BYTE,
+	FT_MAX = FT_DOUBLE,
+} fieldType_t;
+
+
+/**                                                                      **/
+/**  TIFF and Exif tag numbers                                           **/
+/**                                                                      **/
+
+typedef enum {
+	NewSubfileType = 254,
+	SubfileType = 255,
+	ImageWidth = 256,
+	ImageLength = 257,
+	BitsPerSample = 258,
+	Compression = 259,
+	PhotometricInterpretation = 262,
+	Threshholding = 263,
+	CellWidth = 264,
+	CellLength = 265,
+	FillOrder = 266,
+	DocumentName = 269,
+	ImageDescription = 270,
+	Make = 271,
+	Model = 272,
+	StripOffsets = 273,
+	Orientation = 274,
+	SamplesPerPixel = 277,
+	RowsPerStrip = 278,
+	StripByteCounts = 279,
+	MinSampleValue = 280,
+	MaxSampleValue = 281,
+	XResolution = 282,
+	YResolution = 283,
+	PlanarConfiguration = 284,
+	XPosition = 286,
+	YPosition = 287,
+	FreeOffsets = 288,
+	FreeByteCounts = 289,
+	GrayResponseUnit = 290,
+	GrayResponseCurve = 291,
+	T4Options = 292,
+	T6Options = 293,
+	ResolutionUnit = 296,
+	PageNumber = 297,
+	TransferFunction = 301,
+	Software = 305,
+	DateTime = 306,
+	Artist = 315,
+	HostComputer = 316,
+	Predictor = 317,
+	WhitePoint = 318,
+	PrimaryChromaticities = 319,
+	ColorMap = 320,
+	HalftoneHints = 321,
+	TileWidth = 322,
+	TileHeight = 323,
+	TileOffsets = 324,
+	TileByteCounts = 325,
+	InkSet = 332,
+	InkNames = 333,
+	NumberOfInks = 334,
+	DotRange = 336,
+	TargetPrinter = 337,
+	ExtraSamples = 338,
+	SampleFormat = 339,
+	SMinSampleValue = 340,
+	SMaxSampleValue = 341,
+	TransferRange = 342,
+	JPEGProc = 512,
+	JPEGInterchangeFormat = 513,
+	JPEGInterchangeFormatLength = 514,
+	JPEGRestartInterval = 515,
+	JPEGLosslessPredictors = 517,
+	JPEGPointTransforms = 518,
+	JPEGQTables = 519,
+	JPEGDCTables = 520,
+	JPEGACTables = 521,
+	YCbCrCoefficients = 529,
+	YCbCrSubSampling = 530,
+	YCbCrPositioning = 531,
+	ReferenceBlackWhite = 532,
+	ExposureTime = 33434,
+	FNumber = 33437,
+	ModelPixelScaleTag = 33550,
+	ModelTiepointTag = 33922,
+	ModelTransformationTag = 34264,
+	ExifIFDPointer = 34665,
+	GeoKeyDirectoryTag = 34735,
+	GeoDoubleParamsTag = 34736,
+	GeoAsciiParamsTag = 34737,
+	ExposureTime2 = 34434,
+	ExposureProgram = 34850,
+	SpectralSensitivity = 34852,
+	ISOSpeedRatings = 34855,
+	OECF = 34856,
+	ExifVersion = 36864,
+	DateTimeOriginal = 36867,
+	DateTimeDigitized = 36868,
+	ComponentsConfiguration = 37121,
+	CompressedBitsPerPixel = 37122,
+	ShutterSpeedValue = 37377,
+	ApertureValue = 37378,
+	BrightnessValue = 37379,
+	ExposureBiasValue = 37380,
+	MaxApertureValue = 37381,
+	SubjectDistance = 37382,
+	MeteringMode = 37383,
+	LightSource = 37384,
+	Flash = 37385,
+	FocalLength = 37386,
+	SubjectArea = 37396,
+	MakerNote = 37500,
+	UserComment = 37510,
+	SubSecTime = 37520,
+	SubSecTimeOriginal = 37521,
+	SubSecTimeDigitized = 37522,
+	FlashpixVersion = 40960,
+	ColorSpace = 40961,
+	PixelXDimension = 40962,
+	PixelYDimension = 40963,
+	RelatedSoundFile = 40964,
+	FlashEnergy = 41483,
+	SpatialFrequencyResponse = 41484,
+	FocalPlaneXResolution = 41486,
+	FocalPlaneYResolution = 41487,
+	FocalPlaneResolutionUnit = 41488,
+	SubjectLocation = 41492,
+	ExposureIndex = 41493,
+	SensingMethod = 41495,
+	FileSource = 41728,
+	SceneType = 41729,
+	CFAPattern = 41730,
+	CustomRendered = 41985,
+	ExposureMode = 41986,
+	WhiteBalance = 41987,
+	DigitalZoomRatio = 41988,
+	FocalLengthIn35mmFilm = 41989,
+	SceneCaptureType = 41990,
+	GainControl = 41991,
+	Contrast = 41992,
+	Saturation = 41993,
+	Sharpness = 41994,
+	DeviceSettingDescription = 41995,
+	SubjectDistanceRange = 41996,
+	ImageUniqueID = 42016,
+	CameraOwnerName = 42032,
+	BodySerialNumber = 42033,
+	LensSpecification = 42034,
+	LensMake = 42035,
+	LensModel = 42036,
+	LensSerialNumber = 42037,
+} tagNum_t;
 
-#endif
 
-=======
+/**                                                                      **/
+/**  IFD kinds visited by the IFD walker                                 **/
+/**                                                                      **/
+/**  IFD_TIFF                                                            **/
+/**      IFD in the main TIFF chain (IFD0, IFD1, ...)                    **/
+/**  IFD_EXIF                                                            **/
+/**      Exif private IFD pointed to by ExifIFDPointer                   **/
+/**  IFD_MAKERNOTE                                                       **/
+/**      vendor MakerNote IFD or one of its sub-IFDs (tiff_makernote.h)  **/
+/**                                                                      **/
+
+typedef enum {
+	IFD_TIFF = 0,
+	IFD_EXIF,
+	IFD_MAKERNOTE,
+} ifdKind_t;
+
+
+/**                                                                      **/
+/**  Image File Directory (IFD) as seen by the IFD walker                **/
+/**                                                                      **/
+/**  kind                                                                **/
+/**      chain the IFD belongs to                                        **/
+/**  index                                                               **/
+/**      position of the IFD within its chain, starting at 0             **/
+/**  offset                                                              **/
+/**      offset of the IFD from the TIFF header                          **/
+/**  numEntries                                                          **/
+/**      number of entries in the IFD                                    **/
+/**  nextOffset                                                          **/
+/**      offset of the next IFD in the chain, 0 at the end of the        **/
+/**      chain (only valid once all entries have been visited)           **/
+/**                                                                      **/
+
+typedef struct tiffIFDInfo
+{
+	ifdKind_t kind;
+	unsigned int index;
+	unsigned int offset;
+	unsigned short numEntries;
+	unsigned int nextOffset;
+} tiffIFDInfo;
+
+
+/**                                                                      **/
+/**  IFD entry decoded to machine byte order by the IFD walker           **/
+/**                                                                      **/
+/**  ifd                                                                 **/
+/**      IFD containing the entry                                        **/
+/**  index                                                               **/
+/**      position of the entry within its IFD, starting at 0             **/
+/**  tag, fieldType, count                                               **/
+/**      entry fields, swapped to machine byte order                     **/
+/**  valueOffset                                                         **/
+/**      value or offset field, swapped as a 4 byte unsigned int         **/
+/**  value                                                               **/
+/**      raw value or offset field bytes in file byte order              **/
+/**  totalBytes                                                          **/
+/**      size in bytes of the entry value                                **/
+/**  isInline                                                            **/
+/**      1 if the value fits in the 4 byte value field, 0 if the         **/
+/**      value is stored at valueOffset                                  **/
+/**                                                                      **/
+
+typedef struct tiffEntry
+{
+	const tiffIFDInfo *ifd;
+	unsigned int index;
+	unsigned short tag;
+	unsigned short fieldType;
+	unsigned int count;
+	unsigned int valueOffset;
+	unsigned char value[4];
+	unsigned long long totalBytes;
+	int isInline;
+} tiffEntry;
+
+
+/**                                                                      **/
+/**  Value of an IFD entry decoded from its field type                   **/
+/**                                                                      **/
+/**  integer                                                             **/
+/**      value of integer types and ASCII, numerator of rationals,       **/
+/**      truncated value of FLOAT and DOUBLE                             **/
+/**  denominator                                                         **/
+/**      denominator of rationals, 1 for other types                     **/
+/**  real                                                                **/
+/**      value as a double, the quotient of rationals                    **/
+/**                                                                      **/
+
+typedef struct tiffValue
+{
+	long long integer;
+	long long denominator;
+	double real;
+} tiffValue;
+
+
+/**                                                                      **/
+/**  View of a string stored in a file, not NUL terminated               **/
+/**                                                                      **/
+/**  ptr, length                                                         **/
+/**      first character and number of characters                        **/
+/**                                                                      **/
+
+typedef struct tiffStringView
+{
+	const char *ptr;
+	size_t length;
+} tiffStringView;
+
+
+/**                                                                      **/
+/**  Visitor callbacks for the IFD walker. Each callback may be NULL     **/
+/**  and returns one of the tiffWalk_t values; the walk continues        **/
+/**  only while callbacks return TIFF_WALK_CONTINUE.                     **/
+/**                                                                      **/
+
+typedef enum {
+	TIFF_WALK_CONTINUE = 0,
+	TIFF_WALK_STOP,
+	TIFF_WALK_ERROR,
+} tiffWalk_t;
+
+typedef struct tiffVisitor
+{
+	tiffWalk_t (*beginIFD)(void *ctx, internalStruct *internal,
+		const tiffIFDInfo *ifd);
+	tiffWalk_t (*entry)(void *ctx, internalStruct *internal,
+		const tiffEntry *entry);
+	tiffWalk_t (*endIFD)(void *ctx, internalStruct *internal,
+		const tiffIFDInfo *ifd);
+} tiffVisitor;
+
+
+/**                                                                      **/
 /**  Library API function declarations                                   **/
 /**                                                                      **/
 
 int tiffMetadataPrint(const char *filename);
+int tiffMetadataPrintFile(const char *filename, internalStruct *internal);
 int detectMachineEndian(void);
 unsigned short cSwapUShort(unsigned short a, const internalStruct *internal);
 unsigned int cSwapUInt(unsigned int a, const internalStruct *internal);
 int cSwapInt(int a, const internalStruct *internal);
 float cSwapFloat(float a, const internalStruct *internal);
->>>>>>> bc69b05aba6d0c37d9501f3df67dd7122fd708e6
+const char *getTagDescriptor(unsigned short tag);
+int getTagNumber(const char *name);
+int getBuiltinTag(unsigned int index);
+const char *getTIFFValueDesc(unsigned short tag, unsigned int value);
+size_t getFieldTypeNumBytes(fieldType_t fieldType);
+const char *getTIFFTypeDesc(fieldType_t fieldType);
+void printEntry(const unsigned char *buffer, unsigned short tag,
+	fieldType_t fieldType, const internalStruct *internal);
+void tiffDecodeValue(const unsigned char *src, fieldType_t fieldType,
+	const internalStruct *internal, tiffValue *value);
+void printDump(const unsigned char *buffer, int count,
+	const internalStruct *internal);
+int getOffsetValues(unsigned short tag, fieldType_t fieldType,
+	unsigned int count, unsigned int valueOffset,
+	const internalStruct *internal);
+int tiffIFDPrint(const char *filename, internalStruct *internal);
+#ifdef __GNUC__
+__attribute__((format(printf, 2, 3)))
+#endif
+int tiffPrintf(const internalStruct *internal, const char *format, ...);
+void *tiffMalloc(size_t size, const internalStruct *internal);
+size_t tiffFread(void *ptr, size_t size, size_t n, FILE *file,
+	const internalStruct *internal);
+int tiffFseek(FILE *file, long offset, const internalStruct *internal);
+size_t tiffReadAt(const internalStruct *internal, unsigned long long offset,
+	void *dst, size_t n);
+void tiffInitInternal(internalStruct *internal);
+int tiffOpen(const char *filename, internalStruct *internal);
+void tiffClose(internalStruct *internal);
+unsigned long long tiffFileSize(const internalStruct *internal);
+tiffWalk_t tiffIFDWalk(const char *filename, internalStruct *internal,
+	ifdKind_t kind, const tiffVisitor *visitor, void *ctx);
+tiffWalk_t tiffWalkFile(const char *filename, internalStruct *internal,
+	const tiffVisitor *visitor, void *ctx);
+const unsigned char *tiffGetValuePointer(const internalStruct *internal,
+	const tiffEntry *entry);
+int tiffGetValueBytes(internalStruct *internal, const tiffEntry *entry,
+	unsigned long long start, void *dst, size_t n);
+unsigned int tiffSplitStrings(const unsigned char *bytes, size_t n,
+	tiffStringView *views, unsigned int maxViews);
+int tiffGetStrings(const internalStruct *internal, const tiffEntry *entry,
+	tiffStringView *views, unsigned int maxViews);
+int tiffGetUIntArray(internalStruct *internal, const tiffEntry *entry,
+	unsigned int *dst);
+
+#endif
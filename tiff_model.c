@@ -0,0 +1,489 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   In-memory entry model of a file's metadata.                        **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_fingerprint.h"
+#include "tiff_model.h"
+
+
+/**                                                                      **/
+/**  Number of values and UNDEFINED bytes printed by tiffModelPrintValue **/
+/**                                                                      **/
+
+#define MODEL_PRINT_VALUES 16
+#define MODEL_PRINT_BYTES 32
+
+
+/**                                                                      **/
+/**   Function: loadLE                                                   **/
+/**                                                                      **/
+/**   Load n (at most 8) little-endian bytes as a number.                **/
+/**                                                                      **/
+
+static unsigned long long loadLE(const unsigned char *p, size_t n)
+{
+	unsigned long long v = 0;
+
+	while(n-- > 0)
+	{
+		v = (v << 8) | p[n];
+	}
+
+	return v;
+}
+
+
+/**                                                                      **/
+/**  IFD walker callbacks building a model                               **/
+/**                                                                      **/
+
+static tiffWalk_t modelBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	tiffModel *model = (tiffModel *)ctx;
+	tiffModelIFD *ifds;
+	tiffModelIFD *p;
+
+	ifds = (tiffModelIFD *)realloc(model->ifds,
+		(model->numIFDs + 1) * sizeof(*ifds) );
+	if(ifds == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return TIFF_WALK_ERROR;
+	}
+	TIFF_STAT_ADD(internal, allocs, 1);
+	model->ifds = ifds;
+
+	p = &model->ifds[model->numIFDs++];
+	p->kind = ifd->kind;
+	p->index = ifd->index;
+	p->numEntries = 0;
+	p->entries = (tiffModelEntry *)tiffMalloc(
+		( (size_t)ifd->numEntries + 1) * sizeof(*p->entries), internal);
+	if(p->entries == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return TIFF_WALK_ERROR;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static tiffWalk_t modelEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	tiffModel *model = (tiffModel *)ctx;
+	tiffModelIFD *ifd = &model->ifds[model->numIFDs - 1];
+	tiffModelEntry *e = &ifd->entries[ifd->numEntries];
+	tiffHash128 hash;
+
+	memset(e, 0, sizeof(*e) );
+	e->tag = entry->tag;
+	e->fieldType = entry->fieldType;
+	e->count = entry->count;
+	e->index = entry->index;
+	e->totalBytes = entry->totalBytes;
+	ifd->numEntries++;
+
+	if(tiffTagIsOffset(entry->tag) || (entry->totalBytes == 0) )
+	{
+		return TIFF_WALK_CONTINUE;
+	}
+
+	e->valueBytes = TIFF_MODEL_VALUE_BYTES;
+	if(entry->totalBytes < e->valueBytes)
+	{
+		e->valueBytes = (size_t)entry->totalBytes;
+	}
+	e->value = (unsigned char *)tiffMalloc(e->valueBytes, internal);
+	if(e->value == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return TIFF_WALK_ERROR;
+	}
+
+	tiffHashInit(&hash, 0);
+	if(tiffHashValues(&hash, internal, entry, e->value,
+		e->valueBytes) != 0)
+	{
+		return TIFF_WALK_ERROR;
+	}
+	tiffHashFinal(&hash, e->hash);
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static int compareEntries(const void *a, const void *b)
+{
+	const tiffModelEntry *ea = (const tiffModelEntry *)a;
+	const tiffModelEntry *eb = (const tiffModelEntry *)b;
+
+	if(ea->tag != eb->tag)
+	{
+		return (ea->tag < eb->tag) ? -1 : 1;
+	}
+
+	return (ea->index < eb->index) ? -1 : (ea->index > eb->index);
+}
+
+static tiffWalk_t modelEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	tiffModel *model = (tiffModel *)ctx;
+	tiffModelIFD *p = &model->ifds[model->numIFDs - 1];
+
+	qsort(p->entries, p->numEntries, sizeof(*p->entries),
+		compareEntries);
+
+	return TIFF_WALK_CONTINUE;
+}
+
+static const tiffVisitor modelVisitor = {
+	modelBeginIFD,
+	modelEntry,
+	modelEndIFD,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffModelLoad                                            **/
+/**                                                                      **/
+/**   Build the model of a file. Returns 0 on success, 1 on failure, in  **/
+/**   which case the model is left empty.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**   model     -- model to fill in                                      **/
+/**                                                                      **/
+
+int tiffModelLoad(const char *filename, internalStruct *internal,
+	tiffModel *model)
+{
+	tiffWalk_t status;
+
+	memset(model, 0, sizeof(*model) );
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	status = tiffWalkFile(filename, internal, &modelVisitor, model);
+	tiffClose(internal);
+
+	if(status == TIFF_WALK_ERROR)
+	{
+		tiffModelFree(model);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffModelFree                                            **/
+/**                                                                      **/
+/**   Release the memory held by a model.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   model  -- model                                                    **/
+/**                                                                      **/
+
+void tiffModelFree(tiffModel *model)
+{
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0;i < model->numIFDs;i++)
+	{
+		if(model->ifds[i].entries != NULL)
+		{
+			for(j = 0;j < model->ifds[i].numEntries;j++)
+			{
+				free(model->ifds[i].entries[j].value);
+			}
+			free(model->ifds[i].entries);
+		}
+	}
+	free(model->ifds);
+
+	memset(model, 0, sizeof(*model) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffModelFind                                            **/
+/**                                                                      **/
+/**   Binary search an IFD for a tag. Returns the first entry with that  **/
+/**   tag, or NULL.                                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   ifd  -- model IFD                                                  **/
+/**   tag  -- tag number                                                 **/
+/**                                                                      **/
+
+const tiffModelEntry *tiffModelFind(const tiffModelIFD *ifd,
+	unsigned short tag)
+{
+	unsigned int lo = 0;
+	unsigned int hi = ifd->numEntries;
+	unsigned int mid;
+
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(ifd->entries[mid].tag < tag)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	if( (lo < ifd->numEntries) && (ifd->entries[lo].tag == tag) )
+	{
+		return &ifd->entries[lo];
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffModelPrintIFDName                                    **/
+/**                                                                      **/
+/**   Print the name of an IFD: IFD0, IFD1, ... or Exif.                 **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing the output stream                   **/
+/**   ifd       -- model IFD                                             **/
+/**                                                                      **/
+
+void tiffModelPrintIFDName(const internalStruct *internal,
+	const tiffModelIFD *ifd)
+{
+	if(ifd->kind == IFD_EXIF)
+	{
+		tiffPrintf(internal, "Exif");
+	}
+	else
+	{
+		tiffPrintf(internal, "IFD%u", ifd->index);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffModelPrintValue                                      **/
+/**                                                                      **/
+/**   Print the type, count and decoded value of a model entry on one    **/
+/**   line, without the newline. Long values are cut short with "...".   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct containing the output stream                   **/
+/**   entry     -- model entry                                           **/
+/**                                                                      **/
+
+void tiffModelPrintValue(const internalStruct *internal,
+	const tiffModelEntry *entry)
+{
+	const unsigned char *p = entry->value;
+	size_t size;
+	size_t n;
+	size_t i;
+	unsigned long long v;
+	byte4 tmp;
+	double d;
+	const char *desc;
+
+	tiffPrintf(internal, "%s[%u]",
+		getTIFFTypeDesc( (fieldType_t)entry->fieldType), entry->count);
+
+	if(tiffTagIsOffset(entry->tag) )
+	{
+		tiffPrintf(internal, " <offset>");
+
+		return;
+	}
+
+	size = getFieldTypeNumBytes( (fieldType_t)entry->fieldType);
+	if( (size == 0) || (p == NULL) )
+	{
+		return;
+	}
+
+	switch(entry->fieldType)
+	{
+		case FT_ASCII:
+		{
+			n = entry->valueBytes;
+			if( (n == entry->totalBytes) && (n > 0) && (p[n - 1] == 0) )
+			{
+				n--;
+			}
+			tiffPrintf(internal, " \"");
+			for(i = 0;i < n;i++)
+			{
+				if( (p[i] == '"') || (p[i] == '\\') )
+				{
+					tiffPrintf(internal, "\\%c", p[i]);
+				}
+				else if(isprint(p[i]) )
+				{
+					tiffPrintf(internal, "%c", p[i]);
+				}
+				else
+				{
+					tiffPrintf(internal, "\\%03o", p[i]);
+				}
+			}
+			tiffPrintf(internal, "\"%s",
+				(entry->valueBytes < entry->totalBytes) ? "..." : "");
+
+			return;
+		}
+		case FT_UNDEFINED:
+		{
+			n = (entry->valueBytes < MODEL_PRINT_BYTES) ?
+				entry->valueBytes : MODEL_PRINT_BYTES;
+			tiffPrintf(internal, " ");
+			for(i = 0;i < n;i++)
+			{
+				tiffPrintf(internal, "%02x", p[i]);
+			}
+			if(n < entry->totalBytes)
+			{
+				tiffPrintf(internal, "...");
+			}
+
+			return;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	n = entry->valueBytes / size;
+	if(n > MODEL_PRINT_VALUES)
+	{
+		n = MODEL_PRINT_VALUES;
+	}
+
+	for(i = 0;i < n;i++, p += size)
+	{
+		switch(entry->fieldType)
+		{
+			case FT_SBYTE:
+			{
+				tiffPrintf(internal, " %d", (signed char)p[0]);
+				break;
+			}
+			case FT_SSHORT:
+			{
+				tiffPrintf(internal, " %d", (short)loadLE(p, 2) );
+				break;
+			}
+			case FT_SLONG:
+			{
+				tiffPrintf(internal, " %d", (int)loadLE(p, 4) );
+				break;
+			}
+			case FT_RATIONAL:
+			{
+				tiffPrintf(internal, " %u/%u",
+					(unsigned int)loadLE(p, 4),
+					(unsigned int)loadLE(p + 4, 4) );
+				break;
+			}
+			case FT_SRATIONAL:
+			{
+				tiffPrintf(internal, " %d/%d", (int)loadLE(p, 4),
+					(int)loadLE(p + 4, 4) );
+				break;
+			}
+			case FT_FLOAT:
+			{
+				tmp.u = (unsigned int)loadLE(p, 4);
+				tiffPrintf(internal, " %g", tmp.f);
+				break;
+			}
+			case FT_DOUBLE:
+			{
+				v = loadLE(p, 8);
+				memcpy(&d, &v, sizeof(d) );
+				tiffPrintf(internal, " %g", d);
+				break;
+			}
+			default:
+			{
+				v = loadLE(p, size);
+				tiffPrintf(internal, " %llu", v);
+
+				/* Describe single values such as Compression */
+				if(entry->count == 1)
+				{
+					desc = getTIFFValueDesc(entry->tag,
+						(unsigned int)v);
+					if( (*desc != '\0') &&
+						(strcmp(desc, "unknown") != 0) )
+					{
+						tiffPrintf(internal, " (%s)", desc);
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	if(n < entry->count)
+	{
+		tiffPrintf(internal, " ...");
+	}
+
+	return;
+}
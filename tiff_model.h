@@ -0,0 +1,125 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   In-memory entry model of a file's metadata.                        **/
+/**                                                                      **/
+/**   A model holds every IFD of a file with its entries sorted by tag.  **/
+/**   Entry values are kept in canonical (little-endian) byte order up   **/
+/**   to TIFF_MODEL_VALUE_BYTES bytes, together with a hash of the whole **/
+/**   value, so that models of large files stay small and two values can **/
+/**   be compared without reading either file again. A loaded model is   **/
+/**   never modified, so it can be shared by several threads.            **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_MODEL_H
+#define _TIFF_MODEL_H
+
+#include "tiff_metadata.h"
+#include "tiff_fingerprint.h"
+
+
+/**                                                                      **/
+/**  Number of value bytes kept for display                              **/
+/**                                                                      **/
+
+#define TIFF_MODEL_VALUE_BYTES 256
+
+
+/**                                                                      **/
+/**  Entry of a model IFD                                                **/
+/**                                                                      **/
+/**  tag, fieldType, count                                               **/
+/**      entry fields                                                    **/
+/**  index                                                               **/
+/**      position of the entry within its IFD in the file                **/
+/**  totalBytes                                                          **/
+/**      size in bytes of the entry value                                **/
+/**  valueBytes, value                                                   **/
+/**      first bytes of the value in little-endian order, NULL for tags  **/
+/**      holding file offsets (see tiffTagIsOffset)                      **/
+/**  hash                                                                **/
+/**      hash of the whole value in little-endian order, zero for tags   **/
+/**      holding file offsets                                            **/
+/**                                                                      **/
+
+typedef struct tiffModelEntry
+{
+	unsigned short tag;
+	unsigned short fieldType;
+	unsigned int count;
+	unsigned int index;
+	unsigned long long totalBytes;
+	size_t valueBytes;
+	unsigned char *value;
+	unsigned char hash[TIFF_FINGERPRINT_BYTES];
+} tiffModelEntry;
+
+
+/**                                                                      **/
+/**  IFD of a model                                                      **/
+/**                                                                      **/
+/**  kind, index                                                         **/
+/**      chain and position of the IFD, as in tiffIFDInfo                **/
+/**  numEntries, entries                                                 **/
+/**      entries sorted by tag                                           **/
+/**                                                                      **/
+
+typedef struct tiffModelIFD
+{
+	ifdKind_t kind;
+	unsigned int index;
+	unsigned int numEntries;
+	tiffModelEntry *entries;
+} tiffModelIFD;
+
+
+/**                                                                      **/
+/**  Model of a file, IFDs in walk order: main chain, then Exif IFD      **/
+/**                                                                      **/
+
+typedef struct tiffModel
+{
+	unsigned int numIFDs;
+	tiffModelIFD *ifds;
+} tiffModel;
+
+
+/**                                                                      **/
+/**  Model API function declarations                                     **/
+/**                                                                      **/
+
+int tiffModelLoad(const char *filename, internalStruct *internal,
+	tiffModel *model);
+void tiffModelFree(tiffModel *model);
+const tiffModelEntry *tiffModelFind(const tiffModelIFD *ifd,
+	unsigned short tag);
+void tiffModelPrintIFDName(const internalStruct *internal,
+	const tiffModelIFD *ifd);
+void tiffModelPrintValue(const internalStruct *internal,
+	const tiffModelEntry *entry);
+
+#endif
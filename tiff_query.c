@@ -0,0 +1,711 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Predicate queries over tag values.                                 **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+#include "tiff_query.h"
+
+
+/**                                                                      **/
+/**  Result of a term or of the program while a file is walked           **/
+/**                                                                      **/
+
+#define QUERY_FALSE 0
+#define QUERY_TRUE 1
+#define QUERY_UNKNOWN -1
+
+
+/**                                                                      **/
+/**  Longest tag name                                                    **/
+/**                                                                      **/
+
+#define QUERY_MAX_NAME 64
+
+
+/**                                                                      **/
+/**  Parser state                                                        **/
+/**                                                                      **/
+/**  expr                                                                **/
+/**      whole expression, for error messages                            **/
+/**  p                                                                   **/
+/**      next character to parse                                         **/
+/**  query                                                               **/
+/**      query being compiled                                            **/
+/**                                                                      **/
+
+typedef struct queryParser
+{
+	const char *expr;
+	const char *p;
+	tiffQuery *query;
+} queryParser;
+
+
+/**                                                                      **/
+/**  State of one file being tested                                      **/
+/**                                                                      **/
+/**  query                                                               **/
+/**      compiled query                                                  **/
+/**  values                                                              **/
+/**      result of every term, QUERY_UNKNOWN until its tag is seen       **/
+/**  result                                                              **/
+/**      result of the program                                           **/
+/**                                                                      **/
+
+typedef struct queryCtx
+{
+	const tiffQuery *query;
+	signed char values[TIFF_QUERY_MAX_TERMS];
+	int result;
+} queryCtx;
+
+
+/**                                                                      **/
+/**   Function: parseError                                               **/
+/**                                                                      **/
+/**   Print a compile error pointing at the current position. Returns 1. **/
+/**                                                                      **/
+
+static int parseError(const queryParser *parser, const char *message)
+{
+	fprintf(stderr, "bad query \"%s\": %s at \"%s\"\n", parser->expr,
+		message, parser->p);
+
+	return 1;
+}
+
+
+/**                                                                      **/
+/**   Function: accept                                                   **/
+/**                                                                      **/
+/**   Skip white space, then the token if it comes next. Returns 1 if    **/
+/**   the token was skipped; an empty token only skips white space.      **/
+/**                                                                      **/
+
+static int accept(queryParser *parser, const char *token)
+{
+	size_t n = strlen(token);
+
+	while(isspace( (unsigned char)*parser->p) )
+	{
+		parser->p++;
+	}
+
+	if(strncmp(parser->p, token, n) == 0)
+	{
+		parser->p += n;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: emit                                                     **/
+/**                                                                      **/
+/**   Append an instruction to the program. Returns 0 on success, 1 if   **/
+/**   the program is too long.                                           **/
+/**                                                                      **/
+
+static int emit(queryParser *parser, tiffQueryOp_t op, unsigned int term)
+{
+	tiffQuery *query = parser->query;
+
+	if(query->numOps == TIFF_QUERY_MAX_OPS)
+	{
+		return parseError(parser, "expression too long");
+	}
+
+	query->ops[query->numOps].op = op;
+	query->ops[query->numOps].term = term;
+	query->numOps++;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: parseValue                                               **/
+/**                                                                      **/
+/**   Parse the number or string a term compares with.                   **/
+/**                                                                      **/
+
+static int parseValue(queryParser *parser, tiffQueryTerm *term)
+{
+	size_t n = 0;
+	char *end;
+
+	if(!accept(parser, "\"") )
+	{
+		term->number = strtod(parser->p, &end);
+		if(end == parser->p)
+		{
+			return parseError(parser, "number or string expected");
+		}
+		parser->p = end;
+
+		return 0;
+	}
+
+	term->isString = 1;
+	while(*parser->p != '"')
+	{
+		if( (*parser->p == '\\') && (parser->p[1] != '\0') )
+		{
+			parser->p++;
+		}
+		if(*parser->p == '\0')
+		{
+			return parseError(parser, "unterminated string");
+		}
+		if(n == sizeof(term->string) - 1)
+		{
+			return parseError(parser, "string too long");
+		}
+		term->string[n++] = *parser->p++;
+	}
+	term->string[n] = '\0';
+	parser->p++;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: parseTerm                                                **/
+/**                                                                      **/
+/**   Parse a tag and its optional comparison.                           **/
+/**                                                                      **/
+
+static int parseTerm(queryParser *parser)
+{
+	static const struct {
+		const char *token;
+		tiffQueryCmp_t cmp;
+	} cmps[] = {
+		{ "==", TIFF_QUERY_EQ, },
+		{ "!=", TIFF_QUERY_NE, },
+		{ "<=", TIFF_QUERY_LE, },
+		{ ">=", TIFF_QUERY_GE, },
+		{ "<", TIFF_QUERY_LT, },
+		{ ">", TIFF_QUERY_GT, },
+		{ "~", TIFF_QUERY_CONTAINS, },
+	};
+	tiffQuery *query = parser->query;
+	tiffQueryTerm *term;
+	char name[QUERY_MAX_NAME];
+	unsigned long number;
+	size_t n = 0;
+	unsigned int i;
+	int tag;
+	char *end;
+
+	if(query->numTerms == TIFF_QUERY_MAX_TERMS)
+	{
+		return parseError(parser, "too many comparisons");
+	}
+	term = &query->terms[query->numTerms];
+	memset(term, 0, sizeof(*term) );
+
+	accept(parser, "");
+	if(isdigit( (unsigned char)*parser->p) )
+	{
+		number = strtoul(parser->p, &end, 0);
+		if(number > 0xffff)
+		{
+			return parseError(parser, "bad tag number");
+		}
+		parser->p = end;
+		tag = (int)number;
+	}
+	else
+	{
+		while( (isalnum( (unsigned char)parser->p[n]) ||
+			(parser->p[n] == '_') ) && (n < sizeof(name) - 1) )
+		{
+			name[n] = parser->p[n];
+			n++;
+		}
+		name[n] = '\0';
+
+		tag = (n > 0) ? getTagNumber(name) : -1;
+		if(tag < 0)
+		{
+			return parseError(parser, (n > 0) ? "unknown tag" :
+				"tag expected");
+		}
+		parser->p += n;
+	}
+	term->tag = (unsigned short)tag;
+	term->cmp = TIFF_QUERY_EXISTS;
+
+	for(i = 0;i < sizeof(cmps) / sizeof(*cmps);i++)
+	{
+		if(accept(parser, cmps[i].token) )
+		{
+			term->cmp = cmps[i].cmp;
+			if(parseValue(parser, term) != 0)
+			{
+				return 1;
+			}
+			break;
+		}
+	}
+
+	return emit(parser, TIFF_QUERY_OP_TERM, query->numTerms++);
+}
+
+
+static int parseOr(queryParser *parser);
+
+
+/**                                                                      **/
+/**   Function: parseNot                                                 **/
+/**                                                                      **/
+/**   Parse a negation, a parenthesized expression or a term.            **/
+/**                                                                      **/
+
+static int parseNot(queryParser *parser)
+{
+	if(accept(parser, "!") )
+	{
+		if(parseNot(parser) != 0)
+		{
+			return 1;
+		}
+
+		return emit(parser, TIFF_QUERY_OP_NOT, 0);
+	}
+
+	if(accept(parser, "(") )
+	{
+		if(parseOr(parser) != 0)
+		{
+			return 1;
+		}
+		if(!accept(parser, ")") )
+		{
+			return parseError(parser, "\")\" expected");
+		}
+
+		return 0;
+	}
+
+	return parseTerm(parser);
+}
+
+
+/**                                                                      **/
+/**   Function: parseAnd                                                 **/
+/**                                                                      **/
+/**   Parse terms joined by "&&".                                        **/
+/**                                                                      **/
+
+static int parseAnd(queryParser *parser)
+{
+	if(parseNot(parser) != 0)
+	{
+		return 1;
+	}
+
+	while(accept(parser, "&&") )
+	{
+		if( (parseNot(parser) != 0) ||
+			(emit(parser, TIFF_QUERY_OP_AND, 0) != 0) )
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: parseOr                                                  **/
+/**                                                                      **/
+/**   Parse terms joined by "||".                                        **/
+/**                                                                      **/
+
+static int parseOr(queryParser *parser)
+{
+	if(parseAnd(parser) != 0)
+	{
+		return 1;
+	}
+
+	while(accept(parser, "||") )
+	{
+		if( (parseAnd(parser) != 0) ||
+			(emit(parser, TIFF_QUERY_OP_OR, 0) != 0) )
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffQueryCompile                                         **/
+/**                                                                      **/
+/**   Compile a query expression (see tiff_query.h). Returns 0 on        **/
+/**   success, 1 after printing an error message.                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   expr   -- expression                                               **/
+/**   query  -- compiled query                                           **/
+/**                                                                      **/
+
+int tiffQueryCompile(const char *expr, tiffQuery *query)
+{
+	queryParser parser;
+
+	parser.expr = expr;
+	parser.p = expr;
+	parser.query = query;
+	query->numTerms = 0;
+	query->numOps = 0;
+
+	if(parseOr(&parser) != 0)
+	{
+		return 1;
+	}
+
+	accept(&parser, "");
+	if(*parser.p != '\0')
+	{
+		return parseError(&parser, "end of expression expected");
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: queryEval                                                **/
+/**                                                                      **/
+/**   Run the program over the term results, unknown results being       **/
+/**   propagated (three-valued logic). Returns QUERY_TRUE, QUERY_FALSE,  **/
+/**   or QUERY_UNKNOWN if the unknown terms can still change the result. **/
+/**                                                                      **/
+
+static int queryEval(const tiffQuery *query, const signed char *values)
+{
+	signed char stack[TIFF_QUERY_MAX_OPS];
+	unsigned int top = 0;
+	unsigned int i;
+	signed char a;
+	signed char b;
+
+	for(i = 0;i < query->numOps;i++)
+	{
+		switch(query->ops[i].op)
+		{
+			case TIFF_QUERY_OP_TERM:
+			{
+				stack[top++] = values[query->ops[i].term];
+				break;
+			}
+			case TIFF_QUERY_OP_NOT:
+			{
+				a = stack[top - 1];
+				stack[top - 1] = (a == QUERY_UNKNOWN) ? a : !a;
+				break;
+			}
+			case TIFF_QUERY_OP_AND:
+			{
+				a = stack[--top];
+				b = stack[top - 1];
+				stack[top - 1] = ( (a == QUERY_FALSE) ||
+					(b == QUERY_FALSE) ) ? QUERY_FALSE :
+					( (a == QUERY_TRUE) && (b == QUERY_TRUE) ) ?
+					QUERY_TRUE : QUERY_UNKNOWN;
+				break;
+			}
+			case TIFF_QUERY_OP_OR:
+			{
+				a = stack[--top];
+				b = stack[top - 1];
+				stack[top - 1] = ( (a == QUERY_TRUE) ||
+					(b == QUERY_TRUE) ) ? QUERY_TRUE :
+					( (a == QUERY_FALSE) && (b == QUERY_FALSE) ) ?
+					QUERY_FALSE : QUERY_UNKNOWN;
+				break;
+			}
+		}
+	}
+
+	return stack[0];
+}
+
+
+/**                                                                      **/
+/**   Function: tiffQueryFetch                                           **/
+/**                                                                      **/
+/**   Read the first value of an entry. Returns 0 on success, 1 on       **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct of the open file                               **/
+/**   entry     -- entry                                                 **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   value     -- first value of the entry                              **/
+/**                                                                      **/
+
+int tiffQueryFetch(internalStruct *internal, const tiffEntry *entry,
+	tiffQueryValue *value)
+{
+	size_t size = getFieldTypeNumBytes( (fieldType_t)entry->fieldType);
+	size_t n;
+	unsigned char bytes[8];
+	tiffValue decoded;
+
+	memset(value, 0, sizeof(*value) );
+	if( (size == 0) || (entry->count == 0) )
+	{
+		return 0;
+	}
+
+	if( (entry->fieldType == FT_ASCII) ||
+		(entry->fieldType == FT_UNDEFINED) )
+	{
+		n = sizeof(value->string) - 1;
+		if(entry->totalBytes < n)
+		{
+			n = (size_t)entry->totalBytes;
+		}
+		value->hasValue = 1;
+		value->isString = 1;
+
+		return tiffGetValueBytes(internal, entry, 0, value->string, n);
+	}
+
+	if(tiffGetValueBytes(internal, entry, 0, bytes, size) != 0)
+	{
+		return 1;
+	}
+	tiffDecodeValue(bytes, (fieldType_t)entry->fieldType, internal,
+		&decoded);
+	value->hasValue = (decoded.denominator != 0);
+	value->number = decoded.real;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: queryCompare                                             **/
+/**                                                                      **/
+/**   Return the result of a term for a value.                           **/
+/**                                                                      **/
+
+static int queryCompare(const tiffQueryTerm *term,
+	const tiffQueryValue *value)
+{
+	int c;
+
+	if(term->cmp == TIFF_QUERY_EXISTS)
+	{
+		return QUERY_TRUE;
+	}
+
+	if(!value->hasValue || (term->isString != value->isString) )
+	{
+		return QUERY_FALSE;
+	}
+
+	if(term->isString)
+	{
+		if(term->cmp == TIFF_QUERY_CONTAINS)
+		{
+			return strstr(value->string, term->string) != NULL;
+		}
+		c = strcmp(value->string, term->string);
+	}
+	else
+	{
+		c = (value->number < term->number) ? -1 :
+			(value->number > term->number);
+	}
+
+	switch(term->cmp)
+	{
+		case TIFF_QUERY_EQ:
+		{
+			return c == 0;
+		}
+		case TIFF_QUERY_NE:
+		{
+			return c != 0;
+		}
+		case TIFF_QUERY_LT:
+		{
+			return c < 0;
+		}
+		case TIFF_QUERY_LE:
+		{
+			return c <= 0;
+		}
+		case TIFF_QUERY_GT:
+		{
+			return c > 0;
+		}
+		case TIFF_QUERY_GE:
+		{
+			return c >= 0;
+		}
+		default:
+		{
+			return QUERY_FALSE;
+		}
+	}
+}
+
+
+/**                                                                      **/
+/**  IFD walker callback deciding the terms of the entry's tag, which    **/
+/**  stops the walk once the result is known                             **/
+/**                                                                      **/
+
+static tiffWalk_t queryEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	queryCtx *query = (queryCtx *)ctx;
+	const tiffQueryTerm *term;
+	tiffQueryValue value;
+	int fetched = 0;
+	int decided = 0;
+	unsigned int i;
+
+	for(i = 0;i < query->query->numTerms;i++)
+	{
+		term = &query->query->terms[i];
+		if( (term->tag != entry->tag) ||
+			(query->values[i] != QUERY_UNKNOWN) )
+		{
+			continue;
+		}
+
+		/* Only fetch values that are compared */
+		if( (term->cmp != TIFF_QUERY_EXISTS) && !fetched)
+		{
+			if(tiffQueryFetch(internal, entry, &value) != 0)
+			{
+				return TIFF_WALK_ERROR;
+			}
+			fetched = 1;
+		}
+		query->values[i] = (signed char)queryCompare(term, &value);
+		decided = 1;
+	}
+
+	if(!decided)
+	{
+		return TIFF_WALK_CONTINUE;
+	}
+
+	query->result = queryEval(query->query, query->values);
+
+	return (query->result == QUERY_UNKNOWN) ? TIFF_WALK_CONTINUE :
+		TIFF_WALK_STOP;
+}
+
+static const tiffVisitor queryVisitor = {
+	NULL,
+	queryEntry,
+	NULL,
+};
+
+
+/**                                                                      **/
+/**   Function: tiffQueryMatch                                           **/
+/**                                                                      **/
+/**   Test a file against a compiled query, reading no more of it than   **/
+/**   needed. Returns 1 if the file matches, 0 if it doesn't, -1 on      **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   query     -- compiled query                                        **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**                                                                      **/
+
+int tiffQueryMatch(const tiffQuery *query, const char *filename,
+	internalStruct *internal)
+{
+	queryCtx ctx;
+	tiffWalk_t status;
+	unsigned int i;
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return -1;
+	}
+
+	ctx.query = query;
+	for(i = 0;i < query->numTerms;i++)
+	{
+		ctx.values[i] = QUERY_UNKNOWN;
+	}
+	ctx.result = QUERY_UNKNOWN;
+
+	status = tiffWalkFile(filename, internal, &queryVisitor, &ctx);
+
+	tiffClose(internal);
+
+	if(status == TIFF_WALK_ERROR)
+	{
+		return -1;
+	}
+
+	/* Tags not found are absent, so their comparisons fail */
+	if(ctx.result == QUERY_UNKNOWN)
+	{
+		for(i = 0;i < query->numTerms;i++)
+		{
+			if(ctx.values[i] == QUERY_UNKNOWN)
+			{
+				ctx.values[i] = QUERY_FALSE;
+			}
+		}
+		ctx.result = queryEval(query, ctx.values);
+	}
+
+	return ctx.result;
+}
@@ -0,0 +1,165 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Predicate queries over tag values.                                 **/
+/**                                                                      **/
+/**   An expression such as                                              **/
+/**                                                                      **/
+/**       Model == "X" && ImageWidth > 8000                              **/
+/**                                                                      **/
+/**   is compiled once into a postfix program of comparisons and logical **/
+/**   operators, which is then evaluated while the IFDs of each file are **/
+/**   walked. A comparison is decided by the first entry holding its tag **/
+/**   (main IFD chain first, then Exif). Until then it is unknown, and   **/
+/**   the walk stops as soon as the unknowns can no longer change the    **/
+/**   result, so later entries, IFDs and values are never read.          **/
+/**                                                                      **/
+/**   Grammar:                                                           **/
+/**                                                                      **/
+/**       expr := and { "||" and }                                       **/
+/**       and  := not { "&&" not }                                       **/
+/**       not  := "!" not | "(" expr ")" | tag [ op value ]              **/
+/**       op   := "==" | "!=" | "<" | "<=" | ">" | ">=" | "~"            **/
+/**                                                                      **/
+/**   A tag is a name as printed by getTagDescriptor, or a number. A     **/
+/**   value is a number or a double quoted string; "~" tests whether a   **/
+/**   string contains another. A tag alone tests whether it is present.  **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_QUERY_H
+#define _TIFF_QUERY_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Size limits of a compiled query                                     **/
+/**                                                                      **/
+
+#define TIFF_QUERY_MAX_TERMS 16
+#define TIFF_QUERY_MAX_OPS 64
+#define TIFF_QUERY_MAX_STRING 128
+
+
+/**                                                                      **/
+/**  Comparisons and program operators                                   **/
+/**                                                                      **/
+
+typedef enum {
+	TIFF_QUERY_EXISTS = 0,
+	TIFF_QUERY_EQ,
+	TIFF_QUERY_NE,
+	TIFF_QUERY_LT,
+	TIFF_QUERY_LE,
+	TIFF_QUERY_GT,
+	TIFF_QUERY_GE,
+	TIFF_QUERY_CONTAINS,
+} tiffQueryCmp_t;
+
+typedef enum {
+	TIFF_QUERY_OP_TERM = 0,
+	TIFF_QUERY_OP_NOT,
+	TIFF_QUERY_OP_AND,
+	TIFF_QUERY_OP_OR,
+} tiffQueryOp_t;
+
+
+/**                                                                      **/
+/**  Comparison of the first value of a tag with a constant              **/
+/**                                                                      **/
+/**  tag, cmp                                                            **/
+/**      tag and comparison                                              **/
+/**  isString, number, string                                            **/
+/**      constant compared with: numbers are compared with the first     **/
+/**      value of numeric types, strings with ASCII and UNDEFINED values **/
+/**                                                                      **/
+
+typedef struct tiffQueryTerm
+{
+	unsigned short tag;
+	tiffQueryCmp_t cmp;
+	int isString;
+	double number;
+	char string[TIFF_QUERY_MAX_STRING];
+} tiffQueryTerm;
+
+
+/**                                                                      **/
+/**  Program instruction: push the result of a term, or combine the      **/
+/**  results on top of the stack                                         **/
+/**                                                                      **/
+
+typedef struct tiffQueryOp
+{
+	tiffQueryOp_t op;
+	unsigned int term;
+} tiffQueryOp;
+
+
+/**                                                                      **/
+/**  Compiled query. It is never modified while files are tested, so it  **/
+/**  can be shared by several threads.                                   **/
+/**                                                                      **/
+
+typedef struct tiffQuery
+{
+	unsigned int numTerms;
+	tiffQueryTerm terms[TIFF_QUERY_MAX_TERMS];
+	unsigned int numOps;
+	tiffQueryOp ops[TIFF_QUERY_MAX_OPS];
+} tiffQuery;
+
+
+/**                                                                      **/
+/**  First value of an entry, as compared with terms                     **/
+/**                                                                      **/
+/**  hasValue                                                            **/
+/**      0 if the entry has no value of a known type                     **/
+/**  isString, number, string                                            **/
+/**      the value, a string for ASCII and UNDEFINED entries             **/
+/**                                                                      **/
+
+typedef struct tiffQueryValue
+{
+	int hasValue;
+	int isString;
+	double number;
+	char string[TIFF_QUERY_MAX_STRING];
+} tiffQueryValue;
+
+
+/**                                                                      **/
+/**  Query API function declarations                                     **/
+/**                                                                      **/
+
+int tiffQueryCompile(const char *expr, tiffQuery *query);
+int tiffQueryMatch(const tiffQuery *query, const char *filename,
+	internalStruct *internal);
+int tiffQueryFetch(internalStruct *internal, const tiffEntry *entry,
+	tiffQueryValue *value);
+
+#endif
@@ -0,0 +1,970 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Resident server answering metadata requests over a Unix socket.    **/
+/**                                                                      **/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "tiff_metadata.h"
+#include "tiff_model.h"
+#include "tiff_serve.h"
+
+
+/**                                                                      **/
+/**  Size of the text of one rendered value                              **/
+/**                                                                      **/
+
+#define SERVE_VALUE_TEXT 2048
+
+/* shortest and longest waits before accepting again after a failure */
+#define SERVE_BACKOFF_MIN_US 10000
+#define SERVE_BACKOFF_MAX_US 1000000
+
+
+/**                                                                      **/
+/**  Server shared by the worker threads                                 **/
+/**                                                                      **/
+/**  fd                                                                  **/
+/**      listening socket                                                **/
+/**  lock, stopping                                                      **/
+/**      set to 1, under the lock, when the workers are to return        **/
+/**  cache                                                               **/
+/**      model cache                                                     **/
+/**                                                                      **/
+
+typedef struct serveServer
+{
+	int fd;
+	pthread_mutex_t lock;
+	int stopping;
+	tiffCache cache;
+} serveServer;
+
+
+/**                                                                      **/
+/**   Function: tiffCacheInit                                            **/
+/**                                                                      **/
+/**   Initialize an empty cache holding up to capacity files. Returns 0  **/
+/**   on success, 1 on failure.                                          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cache     -- cache                                                 **/
+/**   capacity  -- most number of files kept                             **/
+/**                                                                      **/
+
+int tiffCacheInit(tiffCache *cache, unsigned int capacity)
+{
+	memset(cache, 0, sizeof(*cache) );
+	cache->capacity = (capacity > 0) ? capacity : 1;
+
+	/* Power of two of at least the capacity, so chains stay short */
+	cache->numBuckets = 16;
+	while(cache->numBuckets < cache->capacity)
+	{
+		cache->numBuckets *= 2;
+	}
+
+	cache->buckets = (tiffCacheEntry **)calloc(cache->numBuckets,
+		sizeof(*cache->buckets) );
+	if(cache->buckets == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return 1;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: freeEntry                                                **/
+/**                                                                      **/
+/**   Free a cache entry and its model.                                  **/
+/**                                                                      **/
+
+static void freeEntry(tiffCacheEntry *entry)
+{
+	tiffModelFree(&entry->model);
+	free(entry);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCacheFree                                            **/
+/**                                                                      **/
+/**   Free a cache and every entry in it. No entry may be in use.        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cache  -- cache                                                    **/
+/**                                                                      **/
+
+void tiffCacheFree(tiffCache *cache)
+{
+	tiffCacheEntry *entry;
+	tiffCacheEntry *next;
+
+	for(entry = cache->head;entry != NULL;entry = next)
+	{
+		next = entry->next;
+		freeEntry(entry);
+	}
+
+	free(cache->buckets);
+	pthread_mutex_destroy(&cache->lock);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: hashKey                                                  **/
+/**                                                                      **/
+/**   Return the hash bucket of a file.                                  **/
+/**                                                                      **/
+
+static unsigned int hashKey(const tiffCache *cache, dev_t dev, ino_t ino,
+	long mtimeNsec)
+{
+	unsigned long long h;
+
+	h = (unsigned long long)ino * 0x9e3779b97f4a7c15ULL;
+	h ^= (unsigned long long)dev + (h << 6) + (h >> 2);
+	h ^= (unsigned long long)mtimeNsec + (h << 6) + (h >> 2);
+
+	return (unsigned int)(h >> 32) & (cache->numBuckets - 1);
+}
+
+
+/**                                                                      **/
+/**   Function: findEntry                                                **/
+/**                                                                      **/
+/**   Return the entry of a file, or NULL. The caller holds the lock.    **/
+/**                                                                      **/
+
+static tiffCacheEntry *findEntry(const tiffCache *cache,
+	const struct stat *st)
+{
+	tiffCacheEntry *entry;
+
+	for(entry = cache->buckets[hashKey(cache, st->st_dev, st->st_ino,
+		st->st_mtim.tv_nsec)];entry != NULL;entry = entry->hashNext)
+	{
+		if( (entry->ino == st->st_ino) && (entry->dev == st->st_dev) &&
+			(entry->mtimeSec == (long long)st->st_mtim.tv_sec) &&
+			(entry->mtimeNsec == st->st_mtim.tv_nsec) &&
+			(entry->size == st->st_size) )
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: unlinkEntry                                              **/
+/**                                                                      **/
+/**   Remove an entry from the LRU list. The caller holds the lock.      **/
+/**                                                                      **/
+
+static void unlinkEntry(tiffCache *cache, tiffCacheEntry *entry)
+{
+	if(entry->prev != NULL)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		cache->head = entry->next;
+	}
+
+	if(entry->next != NULL)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		cache->tail = entry->prev;
+	}
+
+	entry->prev = NULL;
+	entry->next = NULL;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: pushEntry                                                **/
+/**                                                                      **/
+/**   Put an entry at the head of the LRU list. The caller holds the     **/
+/**   lock.                                                              **/
+/**                                                                      **/
+
+static void pushEntry(tiffCache *cache, tiffCacheEntry *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if(cache->head != NULL)
+	{
+		cache->head->prev = entry;
+	}
+	else
+	{
+		cache->tail = entry;
+	}
+	cache->head = entry;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: evictEntry                                               **/
+/**                                                                      **/
+/**   Remove the least recently used entry from the cache, freeing it    **/
+/**   unless it is in use. The caller holds the lock.                    **/
+/**                                                                      **/
+
+static void evictEntry(tiffCache *cache)
+{
+	tiffCacheEntry *entry = cache->tail;
+	tiffCacheEntry **p;
+
+	p = &cache->buckets[hashKey(cache, entry->dev, entry->ino,
+		entry->mtimeNsec)];
+	while(*p != entry)
+	{
+		p = &(*p)->hashNext;
+	}
+	*p = entry->hashNext;
+
+	unlinkEntry(cache, entry);
+	cache->numEntries--;
+	entry->cached = 0;
+
+	if(entry->refs == 0)
+	{
+		freeEntry(entry);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCacheGet                                             **/
+/**                                                                      **/
+/**   Return the cache entry of a file, loading the file if it is not    **/
+/**   cached or has changed since. The entry must be handed back with    **/
+/**   tiffCacheRelease. Returns NULL if the file can't be loaded.        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cache     -- cache                                                 **/
+/**   filename  -- file name                                             **/
+/**                                                                      **/
+
+tiffCacheEntry *tiffCacheGet(tiffCache *cache, const char *filename)
+{
+	struct stat st;
+	internalStruct internal;
+	tiffCacheEntry *entry;
+	tiffCacheEntry *loaded;
+	unsigned int bucket;
+
+	if(stat(filename, &st) != 0)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	entry = findEntry(cache, &st);
+	if(entry != NULL)
+	{
+		unlinkEntry(cache, entry);
+		pushEntry(cache, entry);
+		entry->refs++;
+		cache->hits++;
+		pthread_mutex_unlock(&cache->lock);
+
+		return entry;
+	}
+	cache->misses++;
+	pthread_mutex_unlock(&cache->lock);
+
+	/* Load without the lock, so hits aren't held up by a slow file */
+	loaded = (tiffCacheEntry *)calloc(1, sizeof(*loaded) );
+	if(loaded == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return NULL;
+	}
+	tiffInitInternal(&internal);
+	if(tiffModelLoad(filename, &internal, &loaded->model) != 0)
+	{
+		free(loaded);
+
+		return NULL;
+	}
+	loaded->dev = st.st_dev;
+	loaded->ino = st.st_ino;
+	loaded->mtimeSec = (long long)st.st_mtim.tv_sec;
+	loaded->mtimeNsec = st.st_mtim.tv_nsec;
+	loaded->size = st.st_size;
+	loaded->refs = 1;
+	loaded->cached = 1;
+
+	pthread_mutex_lock(&cache->lock);
+
+	/* Another thread may have loaded the same file meanwhile */
+	entry = findEntry(cache, &st);
+	if(entry != NULL)
+	{
+		entry->refs++;
+		pthread_mutex_unlock(&cache->lock);
+		freeEntry(loaded);
+
+		return entry;
+	}
+
+	bucket = hashKey(cache, st.st_dev, st.st_ino, st.st_mtim.tv_nsec);
+	loaded->hashNext = cache->buckets[bucket];
+	cache->buckets[bucket] = loaded;
+	pushEntry(cache, loaded);
+	cache->numEntries++;
+
+	while(cache->numEntries > cache->capacity)
+	{
+		evictEntry(cache);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return loaded;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCacheRelease                                         **/
+/**                                                                      **/
+/**   Hand back an entry returned by tiffCacheGet.                       **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   cache  -- cache                                                    **/
+/**   entry  -- entry                                                    **/
+/**                                                                      **/
+
+void tiffCacheRelease(tiffCache *cache, tiffCacheEntry *entry)
+{
+	int evicted;
+
+	pthread_mutex_lock(&cache->lock);
+	entry->refs--;
+	evicted = (entry->refs == 0) && !entry->cached;
+	pthread_mutex_unlock(&cache->lock);
+
+	if(evicted)
+	{
+		freeEntry(entry);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: putLE                                                    **/
+/**                                                                      **/
+/**   Write a number as n little-endian bytes.                           **/
+/**                                                                      **/
+
+static void putLE(FILE *out, unsigned int v, int n)
+{
+	while(n-- > 0)
+	{
+		fputc( (int)(v & 0xff), out);
+		v >>= 8;
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: putJSONString                                            **/
+/**                                                                      **/
+/**   Write a string as a JSON string.                                   **/
+/**                                                                      **/
+
+static void putJSONString(FILE *out, const char *s)
+{
+	fputc('"', out);
+	for(;*s != '\0';s++)
+	{
+		if( (*s == '"') || (*s == '\\') )
+		{
+			fprintf(out, "\\%c", *s);
+		}
+		else if( (unsigned char)*s < 0x20)
+		{
+			fprintf(out, "\\u%04x", (unsigned char)*s);
+		}
+		else
+		{
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: renderEntry                                              **/
+/**                                                                      **/
+/**   Write one entry as a JSON line or a binary record. value is a      **/
+/**   stream over text, used to format the value. JSON lines start with  **/
+/**   the file name when filename isn't NULL.                            **/
+/**                                                                      **/
+
+static void renderEntry(FILE *out, const char *filename,
+	const tiffModelIFD *ifd, const tiffModelEntry *entry, int binary,
+	internalStruct *value, char *text)
+{
+	const char *p;
+
+	if(binary)
+	{
+		putLE(out, (unsigned int)ifd->kind, 2);
+		putLE(out, ifd->index, 2);
+		putLE(out, entry->tag, 2);
+		putLE(out, entry->fieldType, 2);
+		putLE(out, entry->count, 4);
+		putLE(out, (entry->value != NULL) ?
+			(unsigned int)entry->valueBytes : 0, 4);
+		if(entry->value != NULL)
+		{
+			fwrite(entry->value, 1, entry->valueBytes, out);
+		}
+
+		return;
+	}
+
+	/* Format as tiffModelPrintValue does, without "TYPE[count]" */
+	rewind(value->out);
+	tiffModelPrintValue(value, entry);
+	fputc('\0', value->out);
+	fflush(value->out);
+	text[SERVE_VALUE_TEXT - 1] = '\0';
+	p = strchr(text, ']');
+	p = (p != NULL) ? p + 1 : text;
+	if(*p == ' ')
+	{
+		p++;
+	}
+
+	fputc('{', out);
+	if(filename != NULL)
+	{
+		fprintf(out, "\"file\":");
+		putJSONString(out, filename);
+		fputc(',', out);
+	}
+	if(ifd->kind == IFD_EXIF)
+	{
+		fprintf(out, "\"ifd\":\"Exif\"");
+	}
+	else
+	{
+		fprintf(out, "\"ifd\":\"IFD%u\"", ifd->index);
+	}
+	fprintf(out, ",\"tag\":%u,\"name\":", entry->tag);
+	putJSONString(out, getTagDescriptor(entry->tag) );
+	fprintf(out, ",\"type\":\"%s\",\"count\":%u,\"value\":",
+		getTIFFTypeDesc( (fieldType_t)entry->fieldType), entry->count);
+	putJSONString(out, p);
+	fprintf(out, "}\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffServeRender                                          **/
+/**                                                                      **/
+/**   Write the entries of a model as NDJSON lines or binary records,    **/
+/**   as described in tiff_serve.h.                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   out     -- output stream                                           **/
+/**   model   -- model                                                   **/
+/**   filename -- file name to start JSON lines with, or NULL            **/
+/**   tag     -- only entries with this tag, or -1 for all               **/
+/**   binary  -- 1 for binary records                                    **/
+/**                                                                      **/
+
+void tiffServeRender(FILE *out, const tiffModel *model,
+	const char *filename, int tag, int binary)
+{
+	char text[SERVE_VALUE_TEXT];
+	internalStruct value;
+	const tiffModelIFD *ifd;
+	const tiffModelEntry *entry;
+	unsigned int i;
+	unsigned int j;
+
+	tiffInitInternal(&value);
+	value.out = fmemopen(text, sizeof(text), "w");
+	if(value.out == NULL)
+	{
+		return;
+	}
+
+	for(i = 0;i < model->numIFDs;i++)
+	{
+		ifd = &model->ifds[i];
+		if(tag >= 0)
+		{
+			entry = tiffModelFind(ifd, (unsigned short)tag);
+			if(entry != NULL)
+			{
+				renderEntry(out, filename, ifd, entry, binary, &value,
+					text);
+			}
+			continue;
+		}
+
+		for(j = 0;j < ifd->numEntries;j++)
+		{
+			renderEntry(out, filename, ifd, &ifd->entries[j], binary,
+				&value, text);
+		}
+	}
+
+	fclose(value.out);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: readFull                                                 **/
+/**                                                                      **/
+/**   Read exactly n bytes. Returns 0 on success, 1 on end of file or    **/
+/**   failure.                                                           **/
+/**                                                                      **/
+
+static int readFull(int fd, void *buf, size_t n)
+{
+	ssize_t got;
+
+	while(n > 0)
+	{
+		got = read(fd, buf, n);
+		if( (got < 0) && (errno == EINTR) )
+		{
+			continue;
+		}
+		if(got <= 0)
+		{
+			return 1;
+		}
+		buf = (char *)buf + got;
+		n -= (size_t)got;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: writeFull                                                **/
+/**                                                                      **/
+/**   Write exactly n bytes. Returns 0 on success, 1 on failure.         **/
+/**                                                                      **/
+
+static int writeFull(int fd, const void *buf, size_t n)
+{
+	ssize_t put;
+
+	while(n > 0)
+	{
+		put = send(fd, buf, n, MSG_NOSIGNAL);
+		if( (put < 0) && (errno == EINTR) )
+		{
+			continue;
+		}
+		if(put <= 0)
+		{
+			return 1;
+		}
+		buf = (const char *)buf + put;
+		n -= (size_t)put;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: serveReply                                               **/
+/**                                                                      **/
+/**   Send an answer. Returns 0 on success, 1 on failure.                **/
+/**                                                                      **/
+
+static int serveReply(int fd, unsigned int status, const char *body,
+	size_t n)
+{
+	unsigned char header[8];
+	int i;
+
+	for(i = 0;i < 4;i++)
+	{
+		header[i] = (unsigned char)(status >> (24 - i * 8) );
+		header[4 + i] = (unsigned char)(n >> (24 - i * 8) );
+	}
+
+	if(writeFull(fd, header, sizeof(header) ) != 0)
+	{
+		return 1;
+	}
+
+	return writeFull(fd, body, n);
+}
+
+
+/**                                                                      **/
+/**   Function: serveRequest                                             **/
+/**                                                                      **/
+/**   Answer one request. Returns 0 on success, 1 if the connection      **/
+/**   failed.                                                            **/
+/**                                                                      **/
+
+static int serveRequest(serveServer *server, int fd, char *request,
+	size_t n)
+{
+	const char *path = request;
+	const char *option;
+	const char *end = request + n;
+	char message[256];
+	tiffCacheEntry *entry;
+	char *body = NULL;
+	size_t size = 0;
+	FILE *out;
+	int binary = 0;
+	int tag = -1;
+	char *stop;
+	int status;
+
+	for(option = path + strlen(path) + 1;option < end;
+		option += strlen(option) + 1)
+	{
+		if(strcmp(option, "binary") == 0)
+		{
+			binary = 1;
+		}
+		else if(strncmp(option, "tag=", 4) == 0)
+		{
+			tag = (int)strtoul(option + 4, &stop, 0);
+			if( (stop == option + 4) || (*stop != '\0') )
+			{
+				tag = getTagNumber(option + 4);
+			}
+			if( (tag < 0) || (tag > 0xffff) )
+			{
+				n = (size_t)snprintf(message, sizeof(message),
+					"unknown tag %.200s", option + 4);
+
+				return serveReply(fd, 1, message, n);
+			}
+		}
+		else
+		{
+			n = (size_t)snprintf(message, sizeof(message),
+				"unknown option %.200s", option);
+
+			return serveReply(fd, 1, message, n);
+		}
+	}
+
+	entry = tiffCacheGet(&server->cache, path);
+	if(entry == NULL)
+	{
+		n = (size_t)snprintf(message, sizeof(message), "can't load %.200s",
+			path);
+
+		return serveReply(fd, 1, message, n);
+	}
+
+	out = open_memstream(&body, &size);
+	if(out == NULL)
+	{
+		tiffCacheRelease(&server->cache, entry);
+
+		return serveReply(fd, 1, "out of memory", 13);
+	}
+	tiffServeRender(out, &entry->model, NULL, tag, binary);
+	fclose(out);
+	tiffCacheRelease(&server->cache, entry);
+
+	status = serveReply(fd, 0, body, size);
+	free(body);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: serveStopping                                            **/
+/**                                                                      **/
+/**   Return 1 once the workers of a server are to return.               **/
+/**                                                                      **/
+
+static int serveStopping(serveServer *server)
+{
+	int stopping;
+
+	pthread_mutex_lock(&server->lock);
+	stopping = server->stopping;
+	pthread_mutex_unlock(&server->lock);
+
+	return stopping;
+}
+
+
+/**                                                                      **/
+/**   Function: serveStop                                                **/
+/**                                                                      **/
+/**   Make the workers of a server return: the listening socket is shut  **/
+/**   down, so that accept fails in the workers waiting in it, and they  **/
+/**   return seeing the server stopping.                                 **/
+/**                                                                      **/
+
+static void serveStop(serveServer *server)
+{
+	pthread_mutex_lock(&server->lock);
+	server->stopping = 1;
+	pthread_mutex_unlock(&server->lock);
+	shutdown(server->fd, SHUT_RDWR);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: serveWorker                                              **/
+/**                                                                      **/
+/**   Worker thread: accept a connection and answer its requests until   **/
+/**   the client closes it or it times out, then accept the next one.    **/
+/**   Failures to accept, such as running out of descriptors, are        **/
+/**   retried after a wait doubling up to SERVE_BACKOFF_MAX_US.          **/
+/**                                                                      **/
+
+static void *serveWorker(void *arg)
+{
+	serveServer *server = (serveServer *)arg;
+	char request[TIFF_SERVE_MAX_REQUEST + 1];
+	unsigned char length[4];
+	struct timeval idle;
+	unsigned int backoffUs = SERVE_BACKOFF_MIN_US;
+	size_t n;
+	int fd;
+
+	while(1)
+	{
+		fd = accept(server->fd, NULL, NULL);
+		if( (fd < 0) && ( (errno == EINTR) || (errno == ECONNABORTED) ) )
+		{
+			continue;
+		}
+		if( (fd < 0) && serveStopping(server) )
+		{
+			break;
+		}
+		if(fd < 0)
+		{
+			perror("accept");
+			usleep(backoffUs);
+			backoffUs = (backoffUs * 2 > SERVE_BACKOFF_MAX_US) ?
+				SERVE_BACKOFF_MAX_US : backoffUs * 2;
+			continue;
+		}
+		backoffUs = SERVE_BACKOFF_MIN_US;
+
+		idle.tv_sec = TIFF_SERVE_IDLE_S;
+		idle.tv_usec = 0;
+		if( (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle,
+			sizeof(idle) ) != 0) || (setsockopt(fd, SOL_SOCKET,
+			SO_SNDTIMEO, &idle, sizeof(idle) ) != 0) )
+		{
+			perror("setsockopt");
+			close(fd);
+			continue;
+		}
+
+		while(readFull(fd, length, sizeof(length) ) == 0)
+		{
+			n = ( (size_t)length[0] << 24) | ( (size_t)length[1] << 16) |
+				( (size_t)length[2] << 8) | length[3];
+			if( (n == 0) || (n > TIFF_SERVE_MAX_REQUEST) )
+			{
+				serveReply(fd, 1, "bad request length", 18);
+				break;
+			}
+			if(readFull(fd, request, n) != 0)
+			{
+				break;
+			}
+			request[n] = '\0';
+
+			if(serveRequest(server, fd, request, n) != 0)
+			{
+				break;
+			}
+		}
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffServeMain                                            **/
+/**                                                                      **/
+/**   Serve requests on a Unix socket with numThreads worker threads,    **/
+/**   each serving one connection at a time. An existing socket file     **/
+/**   at path is replaced. Only returns on failure, returning 1 once     **/
+/**   the workers started are stopped and the socket removed.            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   path        -- socket path                                         **/
+/**   numThreads  -- number of worker threads                            **/
+/**                                                                      **/
+
+int tiffServeMain(const char *path, int numThreads)
+{
+	serveServer server;
+	struct sockaddr_un addr;
+	pthread_t *threads;
+	int started;
+	int i;
+
+	memset(&addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(addr.sun_path) )
+	{
+		fprintf(stderr, "socket path %s too long\n", path);
+
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if(tiffCacheInit(&server.cache, TIFF_SERVE_CACHE_FILES) != 0)
+	{
+		return 1;
+	}
+
+	server.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(server.fd < 0)
+	{
+		perror("socket");
+		tiffCacheFree(&server.cache);
+
+		return 1;
+	}
+	unlink(path);
+	if( (bind(server.fd, (struct sockaddr *)&addr, sizeof(addr) ) != 0) ||
+		(listen(server.fd, SOMAXCONN) != 0) )
+	{
+		fprintf(stderr, "can't listen on %s: %s\n", path, strerror(errno) );
+		close(server.fd);
+		tiffCacheFree(&server.cache);
+
+		return 1;
+	}
+	pthread_mutex_init(&server.lock, NULL);
+	server.stopping = 0;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	started = 0;
+	threads = (pthread_t *)malloc(numThreads * sizeof(*threads) );
+	if(threads == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+	}
+	while( (threads != NULL) && (started < numThreads) )
+	{
+		if(pthread_create(&threads[started], NULL, serveWorker,
+			&server) != 0)
+		{
+			fprintf(stderr, "can't create thread\n");
+			break;
+		}
+		started++;
+	}
+
+	/* Workers only return when stopped after they failed to start */
+	if(started < numThreads)
+	{
+		serveStop(&server);
+	}
+	for(i = 0;i < started;i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	free(threads);
+	close(server.fd);
+	unlink(path);
+	pthread_mutex_destroy(&server.lock);
+	tiffCacheFree(&server.cache);
+
+	return 1;
+}
@@ -0,0 +1,159 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Resident server answering metadata requests over a Unix socket.    **/
+/**                                                                      **/
+/**   Worker threads accept connections on a Unix stream socket and      **/
+/**   answer any number of requests on each. Files are loaded into the   **/
+/**   entry model (tiff_model.h) and kept in an LRU cache keyed on       **/
+/**   device, inode, modification time and size, so a repeated request   **/
+/**   costs a stat and the rendering of the answer. A connection idle    **/
+/**   for TIFF_SERVE_IDLE_S seconds, or whose client stops reading its   **/
+/**   answers, is closed, so that persistent connections of a pool of    **/
+/**   clients can't hold on to every worker.                             **/
+/**                                                                      **/
+/**   Request: a 4 byte big-endian length, then that many bytes holding  **/
+/**   NUL separated fields: the file path, then options:                 **/
+/**                                                                      **/
+/**       binary     answer with binary records instead of NDJSON        **/
+/**       tag=T      only entries with tag T (a name or a number)        **/
+/**                                                                      **/
+/**   Answer: a 4 byte big-endian status (0 on success), a 4 byte        **/
+/**   big-endian length, then that many bytes. On failure the bytes are  **/
+/**   an error message. Otherwise they are one JSON object per line and  **/
+/**   entry:                                                             **/
+/**                                                                      **/
+/**       {"ifd":"IFD0","tag":271,"name":"Make","type":"ASCII",          **/
+/**        "count":6,"value":"\"Canon\""}                                **/
+/**                                                                      **/
+/**   or, with binary, one record per entry of little-endian fields:     **/
+/**   IFD kind (2 bytes), IFD index (2), tag (2), type (2), count (4),   **/
+/**   number of value bytes n (4), then the first n value bytes in       **/
+/**   little-endian order (none for tags holding offsets).               **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_SERVE_H
+#define _TIFF_SERVE_H
+
+#include <sys/types.h>
+#include <pthread.h>
+#include "tiff_metadata.h"
+#include "tiff_model.h"
+
+
+/**                                                                      **/
+/**  Number of files kept by the server cache, and longest request       **/
+/**                                                                      **/
+
+#define TIFF_SERVE_CACHE_FILES 4096
+#define TIFF_SERVE_MAX_REQUEST 8192
+
+
+/**                                                                      **/
+/**  Seconds a connection may wait for a request, or an answer wait to   **/
+/**  be read, before the connection is closed                            **/
+/**                                                                      **/
+
+#define TIFF_SERVE_IDLE_S 5
+
+
+/**                                                                      **/
+/**  File of the model cache                                             **/
+/**                                                                      **/
+/**  dev, ino, mtimeSec, mtimeNsec, size                                 **/
+/**      key: identity and version of the file                           **/
+/**  model                                                               **/
+/**      model of the file                                               **/
+/**  refs                                                                **/
+/**      number of users of the model                                    **/
+/**  cached                                                              **/
+/**      1 while the entry is in the cache; an evicted entry is freed    **/
+/**      by its last user                                                **/
+/**  hashNext                                                            **/
+/**      next entry of the same hash bucket                              **/
+/**  prev, next                                                          **/
+/**      neighbours in the LRU list, most recently used first            **/
+/**                                                                      **/
+
+typedef struct tiffCacheEntry
+{
+	dev_t dev;
+	ino_t ino;
+	long long mtimeSec;
+	long mtimeNsec;
+	off_t size;
+	tiffModel model;
+	unsigned int refs;
+	int cached;
+	struct tiffCacheEntry *hashNext;
+	struct tiffCacheEntry *prev;
+	struct tiffCacheEntry *next;
+} tiffCacheEntry;
+
+
+/**                                                                      **/
+/**  LRU cache of file models, safe to share between threads             **/
+/**                                                                      **/
+/**  capacity, numEntries                                                **/
+/**      most and current number of entries                              **/
+/**  numBuckets, buckets                                                 **/
+/**      hash table of the entries                                       **/
+/**  head, tail                                                          **/
+/**      LRU list                                                        **/
+/**  hits, misses                                                        **/
+/**      lookup counters                                                 **/
+/**  lock                                                                **/
+/**      protects all of the above                                       **/
+/**                                                                      **/
+
+typedef struct tiffCache
+{
+	unsigned int capacity;
+	unsigned int numEntries;
+	unsigned int numBuckets;
+	tiffCacheEntry **buckets;
+	tiffCacheEntry *head;
+	tiffCacheEntry *tail;
+	unsigned long long hits;
+	unsigned long long misses;
+	pthread_mutex_t lock;
+} tiffCache;
+
+
+/**                                                                      **/
+/**  Server API function declarations                                    **/
+/**                                                                      **/
+
+int tiffCacheInit(tiffCache *cache, unsigned int capacity);
+void tiffCacheFree(tiffCache *cache);
+tiffCacheEntry *tiffCacheGet(tiffCache *cache, const char *filename);
+void tiffCacheRelease(tiffCache *cache, tiffCacheEntry *entry);
+void tiffServeRender(FILE *out, const tiffModel *model,
+	const char *filename, int tag, int binary);
+int tiffServeMain(const char *path, int numThreads);
+
+#endif
@@ -0,0 +1,237 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Performance counters and per phase timers.                         **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "tiff_metadata.h"
+#include "tiff_stats.h"
+
+
+/**                                                                      **/
+/**   Phase names, indexed by tiffPhase_t                                **/
+/**                                                                      **/
+
+static const char *const phaseNames[TIFF_NUM_PHASES] = {
+	"none",
+	"header",
+	"walk",
+	"fetch",
+	"render",
+};
+
+
+/**                                                                      **/
+/**   Function: tiffStatsInit                                            **/
+/**                                                                      **/
+/**   Clear a set of counters.                                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   stats  -- counters                                                 **/
+/**                                                                      **/
+
+void tiffStatsInit(tiffStats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->phase = TIFF_PHASE_NONE;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStatsClock                                           **/
+/**                                                                      **/
+/**   Return a monotonic timestamp in nanoseconds.                       **/
+/**                                                                      **/
+/**   No input parameters                                                **/
+/**                                                                      **/
+
+unsigned long long tiffStatsClock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL +
+		(unsigned long long)ts.tv_nsec;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStatsEnter                                           **/
+/**                                                                      **/
+/**   Charge the time since the last phase change to the current phase   **/
+/**   and switch to a new one. Returns the phase being left.             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   stats  -- counters                                                 **/
+/**   phase  -- phase being entered                                      **/
+/**                                                                      **/
+
+tiffPhase_t tiffStatsEnter(tiffStats *stats, tiffPhase_t phase)
+{
+	unsigned long long now;
+	tiffPhase_t previous;
+
+	now = tiffStatsClock();
+	previous = stats->phase;
+	if(previous != TIFF_PHASE_NONE)
+	{
+		stats->phaseNs[previous] += now - stats->phaseStart;
+	}
+	stats->phase = phase;
+	stats->phaseStart = now;
+
+	return previous;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStatsLeave                                           **/
+/**                                                                      **/
+/**   Charge the time since the last phase change to the current phase   **/
+/**   and return to the phase that was current before it.                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   stats     -- counters                                              **/
+/**   previous  -- phase returned by the matching tiffStatsEnter         **/
+/**                                                                      **/
+
+void tiffStatsLeave(tiffStats *stats, tiffPhase_t previous)
+{
+	tiffStatsEnter(stats, previous);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStatsMerge                                           **/
+/**                                                                      **/
+/**   Add one set of counters to another.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   dst  -- counters receiving the sum                                 **/
+/**   src  -- counters to add                                            **/
+/**                                                                      **/
+
+void tiffStatsMerge(tiffStats *dst, const tiffStats *src)
+{
+	int i;
+
+	dst->files += src->files;
+	dst->errors += src->errors;
+	dst->reads += src->reads;
+	dst->seeks += src->seeks;
+	dst->bytesRead += src->bytesRead;
+	dst->roundTrips += src->roundTrips;
+	dst->pagesRead += src->pagesRead;
+	dst->pagesLeft += src->pagesLeft;
+	dst->ifds += src->ifds;
+	dst->entries += src->entries;
+	dst->fetches += src->fetches;
+	dst->bytesFormatted += src->bytesFormatted;
+	dst->allocs += src->allocs;
+
+	for(i = 0;i < TIFF_NUM_PHASES;i++)
+	{
+		dst->phaseNs[i] += src->phaseNs[i];
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStatsPrint                                           **/
+/**                                                                      **/
+/**   Print a set of counters as a human readable summary or as a single **/
+/**   line JSON record. Phase times are summed over all threads, so      **/
+/**   with several workers they can exceed the wall clock time.          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   out     -- output stream                                           **/
+/**   stats   -- counters                                                **/
+/**   wallNs  -- elapsed wall clock time in nanoseconds                  **/
+/**   json    -- 1 for a JSON record, 0 for a summary                    **/
+/**                                                                      **/
+
+void tiffStatsPrint(FILE *out, const tiffStats *stats,
+	unsigned long long wallNs, int json)
+{
+	int i;
+
+	if(json)
+	{
+		fprintf(out, "{\"files\":%llu,\"errors\":%llu,"
+			"\"reads\":%llu,\"seeks\":%llu,\"bytes_read\":%llu,"
+			"\"round_trips\":%llu,\"pages_read\":%llu,"
+			"\"pages_left\":%llu,\"ifds\":%llu,\"entries\":%llu,"
+			"\"fetches\":%llu,\"bytes_formatted\":%llu,"
+			"\"allocations\":%llu,\"wall_ns\":%llu,\"phase_ns\":{",
+			stats->files, stats->errors, stats->reads,
+			stats->seeks, stats->bytesRead, stats->roundTrips,
+			stats->pagesRead, stats->pagesLeft, stats->ifds,
+			stats->entries, stats->fetches,
+			stats->bytesFormatted, stats->allocs, wallNs);
+		for(i = TIFF_PHASE_HEADER;i < TIFF_NUM_PHASES;i++)
+		{
+			fprintf(out, "%s\"%s\":%llu",
+				(i == TIFF_PHASE_HEADER) ? "" : ",",
+				phaseNames[i], stats->phaseNs[i]);
+		}
+		fprintf(out, "}}\n");
+	}
+	else
+	{
+		fprintf(out, "files %llu (%llu failed)\n", stats->files,
+			stats->errors);
+		fprintf(out, "read calls %llu\n", stats->reads);
+		fprintf(out, "seek calls %llu\n", stats->seeks);
+		fprintf(out, "bytes read %llu\n", stats->bytesRead);
+		fprintf(out, "round trips %llu\n", stats->roundTrips);
+		fprintf(out, "page cache pages read %llu\n", stats->pagesRead);
+		fprintf(out, "page cache pages left %llu\n", stats->pagesLeft);
+		fprintf(out, "IFDs visited %llu\n", stats->ifds);
+		fprintf(out, "entries visited %llu\n", stats->entries);
+		fprintf(out, "out-of-line fetches %llu\n", stats->fetches);
+		fprintf(out, "bytes formatted %llu\n", stats->bytesFormatted);
+		fprintf(out, "allocations %llu\n", stats->allocs);
+		for(i = TIFF_PHASE_HEADER;i < TIFF_NUM_PHASES;i++)
+		{
+			fprintf(out, "time %-6s %.6f s\n", phaseNames[i],
+				stats->phaseNs[i] / 1e9);
+		}
+		fprintf(out, "time wall   %.6f s\n", wallNs / 1e9);
+	}
+
+	return;
+}
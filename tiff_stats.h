@@ -0,0 +1,169 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Performance counters and per phase timers.                         **/
+/**                                                                      **/
+/**   Counters live in a tiffStats structure owned by one thread and are **/
+/**   reached through internalStruct->stats. Leaving that pointer NULL   **/
+/**   disables them at the cost of one untaken branch per counter;       **/
+/**   building with -DTIFF_NO_STATS removes them altogether. Batch       **/
+/**   workers each accumulate their own tiffStats, which are merged once **/
+/**   all files are done, so the counters need no locking.               **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_STATS_H
+#define _TIFF_STATS_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Timed phases. Time is charged to the innermost phase only, so the   **/
+/**  phase times add up to the time spent inside the parser.             **/
+/**                                                                      **/
+/**  TIFF_PHASE_NONE                                                     **/
+/**      not timed                                                       **/
+/**  TIFF_PHASE_HEADER                                                   **/
+/**      opening the file and detecting the TIFF header                  **/
+/**  TIFF_PHASE_WALK                                                     **/
+/**      reading IFD entry tables and dispatching their entries          **/
+/**  TIFF_PHASE_FETCH                                                    **/
+/**      reading values stored out of line                               **/
+/**  TIFF_PHASE_RENDER                                                   **/
+/**      formatting output                                               **/
+/**                                                                      **/
+
+typedef enum {
+	TIFF_PHASE_NONE = 0,
+	TIFF_PHASE_HEADER,
+	TIFF_PHASE_WALK,
+	TIFF_PHASE_FETCH,
+	TIFF_PHASE_RENDER,
+	TIFF_NUM_PHASES,
+} tiffPhase_t;
+
+
+/**                                                                      **/
+/**  Counters                                                            **/
+/**                                                                      **/
+/**  files, errors                                                       **/
+/**      files processed, and how many of them failed                    **/
+/**  reads, seeks, bytesRead                                             **/
+/**      read and seek calls issued on the file, and bytes read          **/
+/**  roundTrips                                                          **/
+/**      round trips made through a read planner (see tiff_io.h)         **/
+/**  pagesRead, pagesLeft                                                **/
+/**      pages read by the uncached backend, and how many of them it     **/
+/**      left in the page cache                                          **/
+/**  ifds, entries                                                       **/
+/**      IFDs and IFD entries visited                                    **/
+/**  fetches                                                             **/
+/**      values read from outside the IFD entry table                    **/
+/**  bytesFormatted                                                      **/
+/**      bytes of output produced                                        **/
+/**  allocs                                                              **/
+/**      heap allocations made by the parser                             **/
+/**  phaseNs                                                             **/
+/**      nanoseconds spent in each tiffPhase_t                           **/
+/**  phase, phaseStart                                                   **/
+/**      phase being timed and when it was entered                       **/
+/**                                                                      **/
+
+typedef struct tiffStats
+{
+	unsigned long long files;
+	unsigned long long errors;
+	unsigned long long reads;
+	unsigned long long seeks;
+	unsigned long long bytesRead;
+	unsigned long long roundTrips;
+	unsigned long long pagesRead;
+	unsigned long long pagesLeft;
+	unsigned long long ifds;
+	unsigned long long entries;
+	unsigned long long fetches;
+	unsigned long long bytesFormatted;
+	unsigned long long allocs;
+	unsigned long long phaseNs[TIFF_NUM_PHASES];
+	tiffPhase_t phase;
+	unsigned long long phaseStart;
+} tiffStats;
+
+
+/**                                                                      **/
+/**  Counter and timer macros used by the parser                         **/
+/**                                                                      **/
+/**  TIFF_STAT_ADD(internal, field, n)                                   **/
+/**      add n to a counter                                              **/
+/**  TIFF_STATS_ENTER(internal, phase)                                   **/
+/**      start charging time to phase; evaluates to the phase being      **/
+/**      left, which must be handed back to TIFF_STATS_LEAVE             **/
+/**  TIFF_STATS_LEAVE(internal, previous)                                **/
+/**      go back to the previous phase                                   **/
+/**                                                                      **/
+
+#ifdef TIFF_NO_STATS
+#define TIFF_STAT_ADD(internal, field, n)	((void)0)
+#define TIFF_STATS_ENTER(internal, phase)	TIFF_PHASE_NONE
+#define TIFF_STATS_LEAVE(internal, previous)	((void)(previous))
+#else
+#define TIFF_STAT_ADD(internal, field, n)				\
+	do								\
+	{								\
+		if( (internal)->stats != NULL)				\
+		{							\
+			(internal)->stats->field += (n);		\
+		}							\
+	} while(0)
+#define TIFF_STATS_ENTER(internal, phase)				\
+	( ( (internal)->stats != NULL) ?				\
+		tiffStatsEnter( (internal)->stats, (phase) ) :		\
+		TIFF_PHASE_NONE)
+#define TIFF_STATS_LEAVE(internal, previous)				\
+	do								\
+	{								\
+		if( (internal)->stats != NULL)				\
+		{							\
+			tiffStatsLeave( (internal)->stats, (previous) );\
+		}							\
+	} while(0)
+#endif
+
+
+/**                                                                      **/
+/**  Statistics API function declarations                                **/
+/**                                                                      **/
+
+void tiffStatsInit(tiffStats *stats);
+unsigned long long tiffStatsClock(void);
+tiffPhase_t tiffStatsEnter(tiffStats *stats, tiffPhase_t phase);
+void tiffStatsLeave(tiffStats *stats, tiffPhase_t previous);
+void tiffStatsMerge(tiffStats *dst, const tiffStats *src);
+void tiffStatsPrint(FILE *out, const tiffStats *stats,
+	unsigned long long wallNs, int json);
+
+#endif
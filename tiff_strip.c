@@ -0,0 +1,1223 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Metadata stripping into a new file.                                **/
+/**                                                                      **/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include "tiff_metadata.h"
+#include "tiff_fingerprint.h"
+#include "tiff_strip.h"
+
+
+/**                                                                      **/
+/**  Tags pointing to IFDs that are copied along                         **/
+/**                                                                      **/
+
+#define GPSInfoIFDPointer 34853
+#define InteroperabilityIFDPointer 40965
+
+
+/**                                                                      **/
+/**  Entry to write                                                      **/
+/**                                                                      **/
+/**  tag, fieldType, count, totalBytes                                   **/
+/**      entry, with offset tables widened to LONG                       **/
+/**  value                                                               **/
+/**      value bytes in file byte order, at least 4                      **/
+/**  pointer, subIFD                                                     **/
+/**      for IFD pointers, offset of the IFD in the source and its index **/
+/**      once loaded (-2 until then); -1 for other tags                  **/
+/**  outOffset                                                           **/
+/**      offset of the value in the new file, if not inline              **/
+/**                                                                      **/
+
+typedef struct stripEntry
+{
+	unsigned short tag;
+	unsigned short fieldType;
+	unsigned int count;
+	unsigned long long totalBytes;
+	unsigned char *value;
+	unsigned int pointer;
+	int subIFD;
+	unsigned int outOffset;
+} stripEntry;
+
+
+/**                                                                      **/
+/**  IFD to write                                                        **/
+/**                                                                      **/
+/**  srcOffset                                                           **/
+/**      offset of the IFD in the source                                 **/
+/**  chain                                                               **/
+/**      1 for IFDs of the main chain, which are linked in order         **/
+/**  numEntries, entries                                                 **/
+/**      entries kept                                                    **/
+/**  outOffset                                                           **/
+/**      offset of the IFD in the new file                               **/
+/**                                                                      **/
+
+typedef struct stripIFD
+{
+	unsigned int srcOffset;
+	int chain;
+	unsigned int numEntries;
+	stripEntry *entries;
+	unsigned int outOffset;
+} stripIFD;
+
+
+/**                                                                      **/
+/**  Image data chunk                                                    **/
+/**                                                                      **/
+/**  src, length, dest                                                   **/
+/**      offset in the source, size and offset in the new file           **/
+/**  entry, index                                                        **/
+/**      offset table holding the chunk and position in it               **/
+/**  startsRun                                                           **/
+/**      1 for the first chunk of a run, once sorted                     **/
+/**                                                                      **/
+
+typedef struct stripChunk
+{
+	unsigned long long src;
+	unsigned long long length;
+	unsigned long long dest;
+	stripEntry *entry;
+	unsigned int index;
+	int startsRun;
+} stripChunk;
+
+
+/**                                                                      **/
+/**  Loaded file                                                         **/
+/**                                                                      **/
+/**  options                                                             **/
+/**      strip options                                                   **/
+/**  fileSize                                                            **/
+/**      size of the source                                              **/
+/**  single                                                              **/
+/**      1 while walking a single IFD pointed to by an entry             **/
+/**  numIFDs, ifds                                                       **/
+/**      IFDs loaded, main chain first                                   **/
+/**  removed                                                             **/
+/**      number of entries left out                                      **/
+/**                                                                      **/
+
+typedef struct stripCtx
+{
+	const tiffStripOptions *options;
+	unsigned long long fileSize;
+	int single;
+	unsigned int numIFDs;
+	stripIFD ifds[TIFF_STRIP_MAX_IFDS];
+	unsigned int removed;
+} stripCtx;
+
+
+/**                                                                      **/
+/**   Function: tiffStripInit                                            **/
+/**                                                                      **/
+/**   Initialize strip options removing the GPS IFD and MakerNotes.      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   options  -- options                                                **/
+/**                                                                      **/
+
+void tiffStripInit(tiffStripOptions *options)
+{
+	options->numRemove = 0;
+	tiffStripRemove(options, GPSInfoIFDPointer, 1);
+	tiffStripRemove(options, MakerNote, 1);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStripRemove                                          **/
+/**                                                                      **/
+/**   Add a tag to the removed tags, or take it out. Returns 0 on        **/
+/**   success, 1 if too many tags are removed.                           **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   options  -- options                                                **/
+/**   tag      -- tag number                                             **/
+/**   remove   -- 1 to remove the tag, 0 to keep it                      **/
+/**                                                                      **/
+
+int tiffStripRemove(tiffStripOptions *options, unsigned short tag,
+	int remove)
+{
+	unsigned int i;
+
+	for(i = 0;i < options->numRemove;i++)
+	{
+		if(options->remove[i] == tag)
+		{
+			if(!remove)
+			{
+				options->remove[i] =
+					options->remove[--options->numRemove];
+			}
+
+			return 0;
+		}
+	}
+
+	if(remove)
+	{
+		if(options->numRemove == TIFF_STRIP_MAX_TAGS)
+		{
+			fprintf(stderr, "too many tags removed\n");
+
+			return 1;
+		}
+		options->remove[options->numRemove++] = tag;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: isRemoved                                                **/
+/**                                                                      **/
+/**   Return 1 if a tag is removed, 0 otherwise.                         **/
+/**                                                                      **/
+
+static int isRemoved(const tiffStripOptions *options, unsigned short tag)
+{
+	unsigned int i;
+
+	for(i = 0;i < options->numRemove;i++)
+	{
+		if(options->remove[i] == tag)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: isIFDPointer                                             **/
+/**                                                                      **/
+/**   Return 1 if a tag points to an IFD copied along, 0 otherwise.      **/
+/**                                                                      **/
+
+static int isIFDPointer(unsigned short tag)
+{
+	return (tag == ExifIFDPointer) || (tag == GPSInfoIFDPointer) ||
+		(tag == InteroperabilityIFDPointer);
+}
+
+
+/**                                                                      **/
+/**   Function: stripBeginIFD                                            **/
+/**                                                                      **/
+/**   Visitor callback adding an IFD.                                    **/
+/**                                                                      **/
+
+static tiffWalk_t stripBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	stripCtx *strip = (stripCtx *)ctx;
+	stripIFD *out;
+
+	if(strip->numIFDs == TIFF_STRIP_MAX_IFDS)
+	{
+		fprintf(stderr, "too many IFDs\n");
+
+		return TIFF_WALK_ERROR;
+	}
+
+	out = &strip->ifds[strip->numIFDs++];
+	memset(out, 0, sizeof(*out) );
+	out->srcOffset = ifd->offset;
+	out->chain = !strip->single;
+	out->entries = (stripEntry *)calloc(ifd->numEntries + 1,
+		sizeof(*out->entries) );
+	if(out->entries == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return TIFF_WALK_ERROR;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: stripEntryVisit                                          **/
+/**                                                                      **/
+/**   Visitor callback copying an entry and its value, unless removed.   **/
+/**                                                                      **/
+
+static tiffWalk_t stripEntryVisit(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	stripCtx *strip = (stripCtx *)ctx;
+	stripIFD *ifd = &strip->ifds[strip->numIFDs - 1];
+	stripEntry *out;
+
+	if(isRemoved(strip->options, entry->tag) )
+	{
+		strip->removed++;
+
+		return TIFF_WALK_CONTINUE;
+	}
+
+	/* Other offsets would be left pointing into the old layout */
+	if(tiffTagIsOffset(entry->tag) && !isIFDPointer(entry->tag) &&
+		(entry->tag != StripOffsets) && (entry->tag != TileOffsets) &&
+		(entry->tag != JPEGInterchangeFormat) )
+	{
+		fprintf(stderr, "can't relocate %s (%d), remove it with --remove\n",
+			getTagDescriptor(entry->tag), entry->tag);
+
+		return TIFF_WALK_ERROR;
+	}
+
+	if(entry->totalBytes > strip->fileSize)
+	{
+		fprintf(stderr, "value of tag %d is too long\n", entry->tag);
+
+		return TIFF_WALK_ERROR;
+	}
+
+	out = &ifd->entries[ifd->numEntries];
+	out->tag = entry->tag;
+	out->fieldType = entry->fieldType;
+	out->count = entry->count;
+	out->totalBytes = entry->totalBytes;
+	out->subIFD = -1;
+	out->value = (unsigned char *)calloc(
+		(entry->totalBytes > 4) ? entry->totalBytes : 4, 1);
+	if(out->value == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return TIFF_WALK_ERROR;
+	}
+	ifd->numEntries++;
+
+	if(entry->isInline)
+	{
+		memcpy(out->value, entry->value, 4);
+	}
+	else if(tiffGetValueBytes(internal, entry, 0, out->value,
+		(size_t)entry->totalBytes) != 0)
+	{
+		return TIFF_WALK_ERROR;
+	}
+
+	if(isIFDPointer(entry->tag) )
+	{
+		if(!entry->isInline || (entry->count != 1) )
+		{
+			fprintf(stderr, "bad %s\n", getTagDescriptor(entry->tag) );
+
+			return TIFF_WALK_ERROR;
+		}
+		out->pointer = entry->valueOffset;
+		out->subIFD = -2;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: stripEndIFD                                              **/
+/**                                                                      **/
+/**   Visitor callback stopping after an IFD pointed to by an entry.     **/
+/**                                                                      **/
+
+static tiffWalk_t stripEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	stripCtx *strip = (stripCtx *)ctx;
+
+	return strip->single ? TIFF_WALK_STOP : TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: loadFile                                                 **/
+/**                                                                      **/
+/**   Load the main IFD chain, then every IFD pointed to by a kept       **/
+/**   entry, Interoperability IFDs of Exif IFDs included. Returns 0 on   **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+
+static int loadFile(const char *filename, internalStruct *internal,
+	stripCtx *strip)
+{
+	static const tiffVisitor visitor = {
+		stripBeginIFD, stripEntryVisit, stripEndIFD,
+	};
+	stripEntry *entry;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	strip->fileSize = tiffFileSize(internal);
+	if(tiffIFDWalk(filename, internal, IFD_TIFF, &visitor, strip) ==
+		TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+
+	/* IFDs loaded here are scanned in turn as the loop goes on */
+	strip->single = 1;
+	for(i = 0;i < strip->numIFDs;i++)
+	{
+		for(j = 0;j < strip->ifds[i].numEntries;j++)
+		{
+			entry = &strip->ifds[i].entries[j];
+			if(entry->subIFD != -2)
+			{
+				continue;
+			}
+
+			for(k = 0;k < strip->numIFDs;k++)
+			{
+				if(strip->ifds[k].srcOffset == entry->pointer)
+				{
+					break;
+				}
+			}
+
+			if(k == strip->numIFDs)
+			{
+				internal->tiffIFDOffset = entry->pointer;
+				if( (tiffIFDWalk(filename, internal, IFD_EXIF, &visitor,
+					strip) == TIFF_WALK_ERROR) || (k == strip->numIFDs) )
+				{
+					fprintf(stderr, "can't read IFD of %s in %s\n",
+						getTagDescriptor(entry->tag), filename);
+
+					return 1;
+				}
+			}
+			entry->subIFD = (int)k;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: getUInt                                                  **/
+/**                                                                      **/
+/**   Return value i of a SHORT or LONG entry.                           **/
+/**                                                                      **/
+
+static unsigned int getUInt(const internalStruct *internal,
+	const stripEntry *entry, unsigned int i)
+{
+	unsigned short s;
+	unsigned int u;
+
+	if(entry->fieldType == FT_SHORT)
+	{
+		memcpy(&s, entry->value + 2 * i, 2);
+
+		return cSwapUShort(s, internal);
+	}
+
+	memcpy(&u, entry->value + 4 * i, 4);
+
+	return cSwapUInt(u, internal);
+}
+
+
+/**                                                                      **/
+/**   Function: findEntry                                                **/
+/**                                                                      **/
+/**   Return the entry of an IFD holding a tag, or NULL.                 **/
+/**                                                                      **/
+
+static stripEntry *findEntry(const stripIFD *ifd, unsigned short tag)
+{
+	unsigned int i;
+
+	for(i = 0;i < ifd->numEntries;i++)
+	{
+		if(ifd->entries[i].tag == tag)
+		{
+			return &ifd->entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: collectChunks                                            **/
+/**                                                                      **/
+/**   Gather the image data chunks of all IFDs, widening their offset    **/
+/**   tables to LONG. Returns the chunks, NULL on failure.               **/
+/**                                                                      **/
+
+static stripChunk *collectChunks(const char *filename,
+	const internalStruct *internal, stripCtx *strip,
+	unsigned long long *numChunks)
+{
+	static const unsigned short tables[][2] = {
+		{ StripOffsets, StripByteCounts, },
+		{ TileOffsets, TileByteCounts, },
+		{ JPEGInterchangeFormat, JPEGInterchangeFormatLength, },
+	};
+	stripChunk *chunks;
+	stripChunk *chunk;
+	stripEntry *offsets;
+	stripEntry *counts;
+	unsigned long long n = 0;
+	unsigned char *value;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	for(i = 0;i < strip->numIFDs;i++)
+	{
+		for(j = 0;j < sizeof(tables) / sizeof(tables[0]);j++)
+		{
+			offsets = findEntry(&strip->ifds[i], tables[j][0]);
+			counts = findEntry(&strip->ifds[i], tables[j][1]);
+			if(offsets == NULL)
+			{
+				continue;
+			}
+			if( (counts == NULL) || (counts->count != offsets->count) ||
+				( (offsets->fieldType != FT_SHORT) &&
+				(offsets->fieldType != FT_LONG) ) ||
+				( (counts->fieldType != FT_SHORT) &&
+				(counts->fieldType != FT_LONG) ) )
+			{
+				fprintf(stderr, "bad %s in %s\n",
+					getTagDescriptor(tables[j][0]), filename);
+
+				return NULL;
+			}
+			n += offsets->count;
+		}
+	}
+
+	chunks = (stripChunk *)calloc(n + 1, sizeof(*chunks) );
+	if(chunks == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return NULL;
+	}
+
+	chunk = chunks;
+	for(i = 0;i < strip->numIFDs;i++)
+	{
+		for(j = 0;j < sizeof(tables) / sizeof(tables[0]);j++)
+		{
+			offsets = findEntry(&strip->ifds[i], tables[j][0]);
+			counts = findEntry(&strip->ifds[i], tables[j][1]);
+			if(offsets == NULL)
+			{
+				continue;
+			}
+
+			for(k = 0;k < offsets->count;k++, chunk++)
+			{
+				chunk->src = getUInt(internal, offsets, k);
+				chunk->length = getUInt(internal, counts, k);
+				chunk->entry = offsets;
+				chunk->index = k;
+				if(chunk->src + chunk->length > strip->fileSize)
+				{
+					fprintf(stderr, "%s %u runs past the end of %s\n",
+						getTagDescriptor(tables[j][0]), k, filename);
+					free(chunks);
+
+					return NULL;
+				}
+			}
+
+			/* New offsets may not fit in a SHORT */
+			if(offsets->fieldType == FT_SHORT)
+			{
+				value = (unsigned char *)calloc(
+					(offsets->count > 1) ? offsets->count : 1, 4);
+				if(value == NULL)
+				{
+					fprintf(stderr, "can't alloc buffer\n");
+					free(chunks);
+
+					return NULL;
+				}
+				free(offsets->value);
+				offsets->value = value;
+				offsets->fieldType = FT_LONG;
+				offsets->totalBytes = 4ULL * offsets->count;
+			}
+		}
+	}
+
+	*numChunks = n;
+
+	return chunks;
+}
+
+
+/**                                                                      **/
+/**   Function: compareChunks                                            **/
+/**                                                                      **/
+/**   qsort comparison of chunk pointers by source offset.               **/
+/**                                                                      **/
+
+static int compareChunks(const void *a, const void *b)
+{
+	const stripChunk *ca = *(const stripChunk *const *)a;
+	const stripChunk *cb = *(const stripChunk *const *)b;
+
+	if(ca->src != cb->src)
+	{
+		return (ca->src < cb->src) ? -1 : 1;
+	}
+
+	return (ca->length < cb->length) ? -1 : (ca->length > cb->length);
+}
+
+
+/**                                                                      **/
+/**   Function: tiffCopyRange                                            **/
+/**                                                                      **/
+/**   Copy n bytes from one file offset to another, in the kernel when   **/
+/**   possible: copy_file_range(2), then sendfile(2), then pread and     **/
+/**   pwrite. Returns 0 on success, 1 on failure.                        **/
+/**                                                                      **/
+
+int tiffCopyRange(int in, int out, unsigned long long src,
+	unsigned long long dest, unsigned long long n)
+{
+	char buffer[65536];
+	loff_t inOffset;
+	loff_t outOffset;
+	off_t offset;
+	ssize_t got;
+	size_t want;
+
+	/* copy_file_range clones blocks where the file system can */
+	while(n > 0)
+	{
+		inOffset = (loff_t)src;
+		outOffset = (loff_t)dest;
+		got = copy_file_range(in, &inOffset, out, &outOffset, (size_t)n, 0);
+		if(got <= 0)
+		{
+			break;
+		}
+		src += (unsigned long long)got;
+		dest += (unsigned long long)got;
+		n -= (unsigned long long)got;
+	}
+
+	/* sendfile writes at the current position of the output */
+	if( (n > 0) && (lseek(out, (off_t)dest, SEEK_SET) == (off_t)dest) )
+	{
+		while(n > 0)
+		{
+			offset = (off_t)src;
+			got = sendfile(out, in, &offset, (size_t)n);
+			if(got <= 0)
+			{
+				break;
+			}
+			src += (unsigned long long)got;
+			dest += (unsigned long long)got;
+			n -= (unsigned long long)got;
+		}
+	}
+
+	while(n > 0)
+	{
+		want = (n < sizeof(buffer) ) ? (size_t)n : sizeof(buffer);
+		got = pread(in, buffer, want, (off_t)src);
+		if( (got <= 0) ||
+			(pwrite(out, buffer, (size_t)got, (off_t)dest) != got) )
+		{
+			return 1;
+		}
+		src += (unsigned long long)got;
+		dest += (unsigned long long)got;
+		n -= (unsigned long long)got;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: layoutMetadata                                           **/
+/**                                                                      **/
+/**   Place the IFDs and their values after the header. Returns the      **/
+/**   size of the metadata.                                              **/
+/**                                                                      **/
+
+static unsigned long long layoutMetadata(stripCtx *strip)
+{
+	unsigned long long pos = 8;
+	stripIFD *ifd;
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0;i < strip->numIFDs;i++)
+	{
+		ifd = &strip->ifds[i];
+		ifd->outOffset = (unsigned int)pos;
+		pos += 2 + 12ULL * ifd->numEntries + 4;
+
+		for(j = 0;j < ifd->numEntries;j++)
+		{
+			if(ifd->entries[j].totalBytes > 4)
+			{
+				ifd->entries[j].outOffset = (unsigned int)pos;
+				pos += (ifd->entries[j].totalBytes + 1) & ~1ULL;
+			}
+		}
+	}
+
+	return pos;
+}
+
+
+/**                                                                      **/
+/**   Function: layoutData                                               **/
+/**                                                                      **/
+/**   Merge the chunks into runs placed after the metadata and store     **/
+/**   the new offsets in the offset tables. Returns the end of the       **/
+/**   image data, 0 on failure.                                          **/
+/**                                                                      **/
+
+static unsigned long long layoutData(const internalStruct *internal,
+	stripChunk **sorted, unsigned long long numChunks,
+	unsigned long long pos, tiffStripResult *result)
+{
+	unsigned long long runSrc = 0;
+	unsigned long long runEnd = 0;
+	unsigned long long runDest = 0;
+	unsigned long long i;
+	stripChunk *chunk;
+	unsigned int u;
+
+	for(i = 0;i < numChunks;i++)
+	{
+		chunk = sorted[i];
+		if( (i == 0) || (chunk->src > runEnd + TIFF_STRIP_GAP) )
+		{
+			/* New run, at the source offset modulo the alignment */
+			runSrc = chunk->src;
+			runEnd = chunk->src;
+			runDest = pos + ( (runSrc - pos) & (TIFF_STRIP_ALIGN - 1) );
+			chunk->startsRun = 1;
+			result->runs++;
+		}
+		if(chunk->src + chunk->length > runEnd)
+		{
+			runEnd = chunk->src + chunk->length;
+			pos = runDest + (runEnd - runSrc);
+		}
+
+		chunk->dest = runDest + (chunk->src - runSrc);
+		if(chunk->dest + chunk->length > UINT_MAX)
+		{
+			return 0;
+		}
+		u = cSwapUInt( (unsigned int)chunk->dest, internal);
+		memcpy(chunk->entry->value + 4 * chunk->index, &u, 4);
+		result->chunks++;
+	}
+
+	return pos;
+}
+
+
+/**                                                                      **/
+/**   Function: copyRuns                                                 **/
+/**                                                                      **/
+/**   Copy the runs of image data, gaps between their chunks included.   **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+
+static int copyRuns(int in, int out, stripChunk *const *sorted,
+	unsigned long long numChunks, tiffStripResult *result)
+{
+	unsigned long long runEnd;
+	unsigned long long i;
+	unsigned long long j;
+
+	for(i = 0;i < numChunks;i = j)
+	{
+		runEnd = sorted[i]->src + sorted[i]->length;
+		for(j = i + 1;(j < numChunks) && !sorted[j]->startsRun;j++)
+		{
+			if(sorted[j]->src + sorted[j]->length > runEnd)
+			{
+				runEnd = sorted[j]->src + sorted[j]->length;
+			}
+		}
+
+		if(tiffCopyRange(in, out, sorted[i]->src, sorted[i]->dest,
+			runEnd - sorted[i]->src) != 0)
+		{
+			return 1;
+		}
+		result->dataBytes += runEnd - sorted[i]->src;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: buildMetadata                                            **/
+/**                                                                      **/
+/**   Fill in the header, IFDs and values of the new file.               **/
+/**                                                                      **/
+
+static void buildMetadata(const internalStruct *internal,
+	const stripCtx *strip, const unsigned char *magic,
+	unsigned char *buffer)
+{
+	const stripIFD *ifd;
+	const stripEntry *entry;
+	unsigned char *p;
+	unsigned short us;
+	unsigned int u;
+	unsigned int next;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	memcpy(buffer, magic, 4);
+	u = cSwapUInt(strip->ifds[0].outOffset, internal);
+	memcpy(buffer + 4, &u, 4);
+
+	for(i = 0;i < strip->numIFDs;i++)
+	{
+		ifd = &strip->ifds[i];
+		p = buffer + ifd->outOffset;
+		us = cSwapUShort( (unsigned short)ifd->numEntries, internal);
+		memcpy(p, &us, 2);
+		p += 2;
+
+		for(j = 0;j < ifd->numEntries;j++, p += 12)
+		{
+			entry = &ifd->entries[j];
+			us = cSwapUShort(entry->tag, internal);
+			memcpy(p, &us, 2);
+			us = cSwapUShort(entry->fieldType, internal);
+			memcpy(p + 2, &us, 2);
+			u = cSwapUInt(entry->count, internal);
+			memcpy(p + 4, &u, 4);
+
+			if(entry->subIFD >= 0)
+			{
+				u = cSwapUInt(strip->ifds[entry->subIFD].outOffset,
+					internal);
+				memcpy(p + 8, &u, 4);
+			}
+			else if(entry->totalBytes <= 4)
+			{
+				memcpy(p + 8, entry->value, 4);
+			}
+			else
+			{
+				u = cSwapUInt(entry->outOffset, internal);
+				memcpy(p + 8, &u, 4);
+				memcpy(buffer + entry->outOffset, entry->value,
+					(size_t)entry->totalBytes);
+			}
+		}
+
+		/* Link the main chain in order */
+		next = 0;
+		if(ifd->chain)
+		{
+			for(k = i + 1;k < strip->numIFDs;k++)
+			{
+				if(strip->ifds[k].chain)
+				{
+					next = strip->ifds[k].outOffset;
+					break;
+				}
+			}
+		}
+		u = cSwapUInt(next, internal);
+		memcpy(p, &u, 4);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: writeFile                                                **/
+/**                                                                      **/
+/**   Write the new file from the loaded IFDs. Returns 0 on success, 1   **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+
+static int writeFile(const char *input, const char *output,
+	const internalStruct *internal, stripCtx *strip,
+	tiffStripResult *result)
+{
+	stripChunk *chunks;
+	stripChunk **sorted;
+	unsigned long long numChunks = 0;
+	unsigned long long metadataBytes;
+	unsigned long long end;
+	unsigned long long i;
+	unsigned char magic[4];
+	unsigned char *buffer;
+	int status = 1;
+	int in;
+	int out;
+
+	chunks = collectChunks(input, internal, strip, &numChunks);
+	if(chunks == NULL)
+	{
+		return 1;
+	}
+	sorted = (stripChunk **)malloc( (numChunks + 1) * sizeof(*sorted) );
+	if(sorted == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+		free(chunks);
+
+		return 1;
+	}
+	for(i = 0;i < numChunks;i++)
+	{
+		sorted[i] = &chunks[i];
+	}
+	qsort(sorted, (size_t)numChunks, sizeof(*sorted), compareChunks);
+
+	metadataBytes = layoutMetadata(strip);
+	end = layoutData(internal, sorted, numChunks, metadataBytes, result);
+	buffer = (unsigned char *)calloc(metadataBytes, 1);
+	in = open(input, O_RDONLY);
+
+	if( (metadataBytes > UINT_MAX) || ( (numChunks > 0) && (end == 0) ) )
+	{
+		fprintf(stderr, "%s would be too large\n", output);
+	}
+	else if( (buffer == NULL) || (in < 0) ||
+		(pread(in, magic, sizeof(magic), 0) != sizeof(magic) ) )
+	{
+		fprintf(stderr, "can't read %s\n", input);
+	}
+	else
+	{
+		buildMetadata(internal, strip, magic, buffer);
+
+		out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if(out < 0)
+		{
+			fprintf(stderr, "can't open %s to write\n", output);
+		}
+		else
+		{
+			status = (pwrite(out, buffer, (size_t)metadataBytes, 0) !=
+				(ssize_t)metadataBytes) ||
+				(copyRuns(in, out, sorted, numChunks, result) != 0);
+			status = (close(out) != 0) || status;
+			if(status != 0)
+			{
+				fprintf(stderr, "can't write %s\n", output);
+				unlink(output);
+			}
+		}
+	}
+
+	result->ifds = strip->numIFDs;
+	result->removed = strip->removed;
+	result->metadataBytes = metadataBytes;
+
+	if(in >= 0)
+	{
+		close(in);
+	}
+	free(buffer);
+	free(sorted);
+	free(chunks);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: freeStrip                                                **/
+/**                                                                      **/
+/**   Free the loaded IFDs.                                              **/
+/**                                                                      **/
+
+static void freeStrip(stripCtx *strip)
+{
+	unsigned int i;
+	unsigned int j;
+
+	for(i = 0;i < strip->numIFDs;i++)
+	{
+		for(j = 0;j < strip->ifds[i].numEntries;j++)
+		{
+			free(strip->ifds[i].entries[j].value);
+		}
+		free(strip->ifds[i].entries);
+	}
+	strip->numIFDs = 0;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStripFile                                            **/
+/**                                                                      **/
+/**   Write a copy of a file without the removed tags, as described in   **/
+/**   tiff_strip.h. Returns 0 on success, 1 on failure.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   input    -- file name of the source                                **/
+/**   output   -- file name of the new file, replaced if it exists       **/
+/**   options  -- strip options                                          **/
+/**   result   -- receives what was written                              **/
+/**                                                                      **/
+
+int tiffStripFile(const char *input, const char *output,
+	const tiffStripOptions *options, tiffStripResult *result)
+{
+	internalStruct internal;
+	stripCtx *strip;
+	struct stat inSt;
+	struct stat outSt;
+	int status;
+
+	memset(result, 0, sizeof(*result) );
+
+	if( (stat(input, &inSt) == 0) && (stat(output, &outSt) == 0) &&
+		(inSt.st_dev == outSt.st_dev) && (inSt.st_ino == outSt.st_ino) )
+	{
+		fprintf(stderr, "%s and %s are the same file\n", input, output);
+
+		return 1;
+	}
+
+	strip = (stripCtx *)calloc(1, sizeof(*strip) );
+	if(strip == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return 1;
+	}
+	strip->options = options;
+
+	tiffInitInternal(&internal);
+	if(tiffOpen(input, &internal) != 0)
+	{
+		free(strip);
+
+		return 1;
+	}
+
+	/* Offsets inside a JPEG are relative to its Exif segment */
+	if(internal.tiffOffset != 0)
+	{
+		fprintf(stderr, "%s is not a TIFF file\n", input);
+		status = 1;
+	}
+	else
+	{
+		status = loadFile(input, &internal, strip);
+	}
+	tiffClose(&internal);
+
+	if( (status == 0) && (strip->numIFDs == 0) )
+	{
+		fprintf(stderr, "%s has no IFD\n", input);
+		status = 1;
+	}
+	if(status == 0)
+	{
+		status = writeFile(input, output, &internal, strip, result);
+	}
+
+	freeStrip(strip);
+	free(strip);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: usage                                                    **/
+/**                                                                      **/
+/**   Print the strip command line usage.                                **/
+/**                                                                      **/
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tiff_metadata strip [--remove Tag ...] "
+		"[--keep Tag ...] input output\n");
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: parseTag                                                 **/
+/**                                                                      **/
+/**   Return the number of a tag given by name or number, -1 if          **/
+/**   unknown.                                                           **/
+/**                                                                      **/
+
+static int parseTag(const char *name)
+{
+	char *end;
+	long tag;
+
+	tag = strtol(name, &end, 0);
+	if( (*name == '\0') || (*end != '\0') )
+	{
+		tag = getTagNumber(name);
+	}
+	if( (tag < 0) || (tag > 0xffff) )
+	{
+		fprintf(stderr, "unknown tag %s\n", name);
+
+		return -1;
+	}
+
+	return (int)tag;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffStripMain                                            **/
+/**                                                                      **/
+/**   Main function of the strip subcommand. Returns 0 on success, 1 on  **/
+/**   failure.                                                           **/
+/**                                                                      **/
+/**   Usage:                                                             **/
+/**   tiff_metadata strip [--remove Tag ...] [--keep Tag ...] input      **/
+/**       output                                                         **/
+/**                                                                      **/
+/**   -r, --remove Tag -- also remove a tag, given by name or number     **/
+/**   -k, --keep Tag   -- keep a tag removed by default (GPSInfo and     **/
+/**                       MakerNote)                                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   argc       -- argument count, argv[0] being "strip"                **/
+/**   argv       -- argument vector                                      **/
+/**                                                                      **/
+
+int tiffStripMain(int argc, char *argv[])
+{
+	static const struct option longOptions[] = {
+		{ "remove", required_argument, NULL, 'r', },
+		{ "keep", required_argument, NULL, 'k', },
+		{ NULL, 0, NULL, 0, },
+	};
+	tiffStripOptions options;
+	tiffStripResult result;
+	int tag;
+	int c;
+
+	tiffStripInit(&options);
+
+	optind = 1;
+	while( (c = getopt_long(argc, argv, "r:k:", longOptions, NULL)) != -1)
+	{
+		switch(c)
+		{
+			case 'r':
+			case 'k':
+			{
+				tag = parseTag(optarg);
+				if( (tag < 0) || (tiffStripRemove(&options,
+					(unsigned short)tag, c == 'r') != 0) )
+				{
+					return 1;
+				}
+				break;
+			}
+			default:
+			{
+				usage();
+
+				return 1;
+			}
+		}
+	}
+
+	if(argc - optind != 2)
+	{
+		usage();
+
+		return 1;
+	}
+
+	if(tiffStripFile(argv[optind], argv[optind + 1], &options,
+		&result) != 0)
+	{
+		return 1;
+	}
+
+	printf("%s: %u IFDs, %u entries removed, %llu bytes of metadata, "
+		"%llu chunks copied in %llu runs (%llu bytes)\n",
+		argv[optind + 1], result.ifds, result.removed,
+		result.metadataBytes, result.chunks, result.runs,
+		result.dataBytes);
+
+	return 0;
+}
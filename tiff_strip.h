@@ -0,0 +1,111 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Metadata stripping into a new file.                                **/
+/**                                                                      **/
+/**   The IFDs of a file (main chain, Exif, GPS and Interoperability)    **/
+/**   are loaded without the removed tags and written compactly at the   **/
+/**   start of a new file in the same byte order. Strips, tiles and the  **/
+/**   JPEG thumbnail are then copied unchanged by the kernel with        **/
+/**   copy_file_range(2), falling back to sendfile(2) and then to        **/
+/**   read/write when the file systems don't support it.                 **/
+/**                                                                      **/
+/**   Image data chunks are sorted by offset and merged into runs of     **/
+/**   nearly adjacent chunks; each run is copied with one call and       **/
+/**   placed at the same offset modulo TIFF_STRIP_ALIGN as in the        **/
+/**   source, so that file systems able to share blocks (btrfs, XFS)     **/
+/**   clone it instead of copying it. Chunk offsets are then remapped    **/
+/**   by run rather than one by one.                                     **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_STRIP_H
+#define _TIFF_STRIP_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Limits: removed tags, IFDs of a file, gap between chunks merged     **/
+/**  into a run, and block alignment kept for runs                       **/
+/**                                                                      **/
+
+#define TIFF_STRIP_MAX_TAGS 64
+#define TIFF_STRIP_MAX_IFDS 256
+#define TIFF_STRIP_GAP 4096
+#define TIFF_STRIP_ALIGN 4096
+
+
+/**                                                                      **/
+/**  Strip options                                                       **/
+/**                                                                      **/
+/**  numRemove, remove                                                   **/
+/**      tags left out of every IFD                                      **/
+/**                                                                      **/
+
+typedef struct tiffStripOptions
+{
+	unsigned int numRemove;
+	unsigned short remove[TIFF_STRIP_MAX_TAGS];
+} tiffStripOptions;
+
+
+/**                                                                      **/
+/**  Result of a strip                                                   **/
+/**                                                                      **/
+/**  ifds, removed                                                       **/
+/**      number of IFDs written and of entries left out                  **/
+/**  metadataBytes                                                       **/
+/**      size of the header, IFDs and values written                     **/
+/**  chunks, runs, dataBytes                                             **/
+/**      image data chunks, runs they were copied in, and bytes copied   **/
+/**                                                                      **/
+
+typedef struct tiffStripResult
+{
+	unsigned int ifds;
+	unsigned int removed;
+	unsigned long long metadataBytes;
+	unsigned long long chunks;
+	unsigned long long runs;
+	unsigned long long dataBytes;
+} tiffStripResult;
+
+
+/**                                                                      **/
+/**  Strip API function declarations                                     **/
+/**                                                                      **/
+
+void tiffStripInit(tiffStripOptions *options);
+int tiffStripRemove(tiffStripOptions *options, unsigned short tag,
+	int remove);
+int tiffStripFile(const char *input, const char *output,
+	const tiffStripOptions *options, tiffStripResult *result);
+int tiffStripMain(int argc, char *argv[]);
+int tiffCopyRange(int in, int out, unsigned long long src,
+	unsigned long long dest, unsigned long long n);
+
+#endif
@@ -0,0 +1,1230 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Tag dictionaries loaded at run time, see tiff_tagdb.h.             **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "tiff_metadata.h"
+#include "tiff_tagdb.h"
+
+
+/* byte order mark of compiled dictionaries, and largest table */
+#define TAGDB_BYTE_ORDER 0x01020304u
+#define TAGDB_MAX_SLOTS (1u << 24)
+
+
+/**                                                                      **/
+/**  Tag of a dictionary being built                                     **/
+/**                                                                      **/
+/**  tag, types                                                          **/
+/**      tag number and bit mask of the expected field types             **/
+/**  name                                                                **/
+/**      offset of the name in the string pool                           **/
+/**                                                                      **/
+
+typedef struct tagdbBuildTag
+{
+	unsigned short tag;
+	unsigned short types;
+	unsigned int name;
+} tagdbBuildTag;
+
+
+/**                                                                      **/
+/**  Dictionary being built from text                                    **/
+/**                                                                      **/
+/**  tags, numTags, maxTags                                              **/
+/**      tags read so far                                                **/
+/**  values, numValues, maxValues                                        **/
+/**      value descriptions read so far                                  **/
+/**  strings, stringBytes, maxStrings                                    **/
+/**      string pool, starting with an empty string                      **/
+/**                                                                      **/
+
+typedef struct tagdbBuild
+{
+	tagdbBuildTag *tags;
+	unsigned int numTags;
+	unsigned int maxTags;
+	tiffTagDBValue *values;
+	unsigned int numValues;
+	unsigned int maxValues;
+	char *strings;
+	size_t stringBytes;
+	size_t maxStrings;
+} tagdbBuild;
+
+
+/* dictionaries registered, consulted latest first */
+static const tiffTagDB *registered[TIFF_TAGDB_MAX];
+static unsigned int numRegistered;
+
+
+/**                                                                      **/
+/**   Functions: hashTag, hashValue, hashName                            **/
+/**                                                                      **/
+/**   Return the hash of a tag number, of a tag number and value, and    **/
+/**   the FNV-1a hash of a name. Tag numbers cluster, so they are mixed  **/
+/**   before their low bits pick a slot.                                 **/
+/**                                                                      **/
+
+static unsigned int hashTag(unsigned int tag)
+{
+	tag ^= tag >> 16;
+	tag *= 0x45d9f3bu;
+	tag ^= tag >> 16;
+	tag *= 0x45d9f3bu;
+	tag ^= tag >> 16;
+
+	return tag;
+}
+
+static unsigned int hashValue(unsigned short tag, unsigned int value)
+{
+	return hashTag(value ^ hashTag(tag) );
+}
+
+static unsigned int hashName(const char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	while(*name != '\0')
+	{
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+/**                                                                      **/
+/**   Function: tableSlots                                               **/
+/**                                                                      **/
+/**   Return the size of a table holding n entries: the smallest power   **/
+/**   of two at least twice n, so that probes stay short and always      **/
+/**   reach a free slot.                                                 **/
+/**                                                                      **/
+
+static unsigned int tableSlots(unsigned int n)
+{
+	unsigned int slots = 8;
+
+	while(slots < 2 * n)
+	{
+		slots *= 2;
+	}
+
+	return slots;
+}
+
+
+/**                                                                      **/
+/**   Function: setParts                                                 **/
+/**                                                                      **/
+/**   Point the parts of a dictionary into its block.                    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db      -- dictionary whose base holds a complete block            **/
+/**                                                                      **/
+
+static void setParts(tiffTagDB *db)
+{
+	const tiffTagDBHeader *header = (const tiffTagDBHeader *)db->base;
+	const unsigned char *p = db->base + sizeof(tiffTagDBHeader);
+
+	db->header = header;
+	db->tags = (const tiffTagDBTag *)p;
+	p += header->tagSlots * sizeof(tiffTagDBTag);
+	db->names = (const unsigned int *)p;
+	p += header->tagSlots * sizeof(unsigned int);
+	db->values = (const tiffTagDBValue *)p;
+	p += header->valueSlots * sizeof(tiffTagDBValue);
+	db->strings = (const char *)p;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: blockSize                                                **/
+/**                                                                      **/
+/**   Return the size of the block of a dictionary with the given table  **/
+/**   sizes and string pool size.                                        **/
+/**                                                                      **/
+
+static size_t blockSize(unsigned int tagSlots, unsigned int valueSlots,
+	size_t stringBytes)
+{
+	return sizeof(tiffTagDBHeader) +
+		(size_t)tagSlots * (sizeof(tiffTagDBTag) + sizeof(unsigned int)) +
+		(size_t)valueSlots * sizeof(tiffTagDBValue) + stringBytes;
+}
+
+
+/**                                                                      **/
+/**   Function: addString                                                **/
+/**                                                                      **/
+/**   Add a string of n bytes to the string pool of a dictionary being   **/
+/**   built. Returns its offset, or 0 if out of memory.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build   -- dictionary being built                                  **/
+/**   text    -- string, not terminated                                  **/
+/**   n       -- length of the string                                    **/
+/**                                                                      **/
+
+static unsigned int addString(tagdbBuild *build, const char *text, size_t n)
+{
+	unsigned int offset;
+	size_t maxStrings;
+	char *strings;
+
+	if(build->stringBytes + n + 1 > build->maxStrings)
+	{
+		maxStrings = (build->maxStrings == 0) ? 4096 :
+			2 * build->maxStrings;
+		while(build->stringBytes + n + 1 > maxStrings)
+		{
+			maxStrings *= 2;
+		}
+		if(maxStrings > TAGDB_MAX_SLOTS * (size_t)16)
+		{
+			fprintf(stderr, "tag dictionary strings too large\n");
+
+			return 0;
+		}
+		strings = (char *)realloc(build->strings, maxStrings);
+		if(strings == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+
+			return 0;
+		}
+		build->strings = strings;
+		build->maxStrings = maxStrings;
+	}
+
+	offset = (unsigned int)build->stringBytes;
+	memcpy(build->strings + offset, text, n);
+	build->strings[offset + n] = '\0';
+	build->stringBytes += n + 1;
+
+	return offset;
+}
+
+
+/**                                                                      **/
+/**   Function: parseTypes                                               **/
+/**                                                                      **/
+/**   Return the bit mask of field types given as TYPE|TYPE..., 0 for    **/
+/**   "-", or -1 if a type is unknown.                                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   text    -- field types                                             **/
+/**                                                                      **/
+
+static int parseTypes(const char *text)
+{
+	const char *end;
+	int types = 0;
+	int found;
+	int type;
+
+	if(strcmp(text, "-") == 0)
+	{
+		return 0;
+	}
+
+	while(1)
+	{
+		end = strchr(text, '|');
+		if(end == NULL)
+		{
+			end = text + strlen(text);
+		}
+
+		found = 0;
+		for(type = FT_MIN;type <= FT_MAX;type++)
+		{
+			if( (strlen(getTIFFTypeDesc( (fieldType_t)type) ) ==
+				(size_t)(end - text) ) &&
+				(strncmp(getTIFFTypeDesc( (fieldType_t)type), text,
+				(size_t)(end - text) ) == 0) )
+			{
+				types |= 1 << type;
+				found = 1;
+			}
+		}
+		if(!found)
+		{
+			return -1;
+		}
+
+		if(*end == '\0')
+		{
+			break;
+		}
+		text = end + 1;
+	}
+
+	return types;
+}
+
+
+/**                                                                      **/
+/**   Function: parseValues                                              **/
+/**                                                                      **/
+/**   Add the value descriptions value=description;... of a tag to a     **/
+/**   dictionary being built. Returns 0 on success, 1 on failure.        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build     -- dictionary being built                                **/
+/**   tag       -- tag number                                            **/
+/**   text      -- value descriptions                                    **/
+/**   filename  -- file name and line number, for messages               **/
+/**   line                                                               **/
+/**                                                                      **/
+
+static int parseValues(tagdbBuild *build, unsigned short tag, char *text,
+	const char *filename, unsigned int line)
+{
+	tiffTagDBValue *values;
+	unsigned long value;
+	char *desc;
+	char *end;
+
+	while(*text != '\0')
+	{
+		end = strchr(text, ';');
+		if(end != NULL)
+		{
+			*end = '\0';
+		}
+
+		errno = 0;
+		value = strtoul(text, &desc, 0);
+		if( (desc == text) || (*desc != '=') || (desc[1] == '\0') ||
+			(errno != 0) || (value > 0xffffffffUL) )
+		{
+			fprintf(stderr, "%s:%u: bad value description \"%s\"\n",
+				filename, line, text);
+
+			return 1;
+		}
+		desc++;
+
+		if(build->numValues == build->maxValues)
+		{
+			if(build->maxValues >= TAGDB_MAX_SLOTS / 2)
+			{
+				fprintf(stderr, "%s:%u: too many value descriptions\n",
+					filename, line);
+
+				return 1;
+			}
+			values = (tiffTagDBValue *)realloc(build->values,
+				2 * (build->maxValues + 32) * sizeof(tiffTagDBValue) );
+			if(values == NULL)
+			{
+				fprintf(stderr, "out of memory\n");
+
+				return 1;
+			}
+			build->values = values;
+			build->maxValues = 2 * (build->maxValues + 32);
+		}
+
+		build->values[build->numValues].tag = tag;
+		build->values[build->numValues].value = (unsigned int)value;
+		build->values[build->numValues].pad = 0;
+		build->values[build->numValues].desc = addString(build, desc,
+			strlen(desc) );
+		if(build->values[build->numValues].desc == 0)
+		{
+			return 1;
+		}
+		build->numValues++;
+
+		if(end == NULL)
+		{
+			break;
+		}
+		text = end + 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: parseLine                                                **/
+/**                                                                      **/
+/**   Add the tag of a line of a text dictionary to a dictionary being   **/
+/**   built. Returns 0 on success, 1 on failure.                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build     -- dictionary being built                                **/
+/**   text      -- line, without its end of line                         **/
+/**   filename  -- file name and line number, for messages               **/
+/**   line                                                               **/
+/**                                                                      **/
+
+static int parseLine(tagdbBuild *build, char *text, const char *filename,
+	unsigned int line)
+{
+	char *fields[3];
+	tagdbBuildTag *tags;
+	unsigned long tag;
+	unsigned int i;
+	char *end;
+	int types;
+
+	for(i = 0;i < 3;i++)
+	{
+		while(isspace( (unsigned char)*text) )
+		{
+			text++;
+		}
+		if( (i == 0) && ( (*text == '\0') || (*text == '#') ) )
+		{
+			return 0;
+		}
+		if(*text == '\0')
+		{
+			fprintf(stderr, "%s:%u: expected number, name and types\n",
+				filename, line);
+
+			return 1;
+		}
+		fields[i] = text;
+		while( (*text != '\0') && !isspace( (unsigned char)*text) )
+		{
+			text++;
+		}
+		if(*text != '\0')
+		{
+			*text++ = '\0';
+		}
+	}
+	while(isspace( (unsigned char)*text) )
+	{
+		text++;
+	}
+
+	errno = 0;
+	tag = strtoul(fields[0], &end, 0);
+	if( (*end != '\0') || (errno != 0) || (tag > 0xffff) )
+	{
+		fprintf(stderr, "%s:%u: bad tag number \"%s\"\n", filename, line,
+			fields[0]);
+
+		return 1;
+	}
+
+	for(end = fields[1];*end != '\0';end++)
+	{
+		if(!isalnum( (unsigned char)*end) && (*end != '_') )
+		{
+			fprintf(stderr, "%s:%u: bad tag name \"%s\"\n", filename,
+				line, fields[1]);
+
+			return 1;
+		}
+	}
+
+	types = parseTypes(fields[2]);
+	if(types < 0)
+	{
+		fprintf(stderr, "%s:%u: bad types \"%s\"\n", filename, line,
+			fields[2]);
+
+		return 1;
+	}
+
+	if(build->numTags == build->maxTags)
+	{
+		tags = (tagdbBuildTag *)realloc(build->tags,
+			2 * (build->maxTags + 32) * sizeof(tagdbBuildTag) );
+		if(tags == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+
+			return 1;
+		}
+		build->tags = tags;
+		build->maxTags = 2 * (build->maxTags + 32);
+	}
+
+	build->tags[build->numTags].tag = (unsigned short)tag;
+	build->tags[build->numTags].types = (unsigned short)types;
+	build->tags[build->numTags].name = addString(build, fields[1],
+		strlen(fields[1]) );
+	if(build->tags[build->numTags].name == 0)
+	{
+		return 1;
+	}
+	build->numTags++;
+
+	return parseValues(build, (unsigned short)tag, text, filename, line);
+}
+
+
+/**                                                                      **/
+/**   Function: buildIndex                                               **/
+/**                                                                      **/
+/**   Build the block of a dictionary from the tags, values and strings  **/
+/**   read, rejecting tags, names and values defined twice. Returns 0 on **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   build     -- dictionary read                                       **/
+/**   filename  -- dictionary file name, for messages                    **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   db        -- dictionary                                            **/
+/**                                                                      **/
+
+static int buildIndex(const tagdbBuild *build, const char *filename,
+	tiffTagDB *db)
+{
+	tiffTagDBHeader *header;
+	tiffTagDBTag *tags;
+	unsigned int *names;
+	tiffTagDBValue *values;
+	unsigned int tagSlots;
+	unsigned int valueSlots;
+	unsigned int i;
+	unsigned int j;
+
+	tagSlots = tableSlots(build->numTags);
+	valueSlots = tableSlots(build->numValues);
+
+	db->size = blockSize(tagSlots, valueSlots, build->stringBytes);
+	db->base = (unsigned char *)calloc(1, db->size);
+	if(db->base == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+
+		return 1;
+	}
+	db->mapped = 0;
+
+	header = (tiffTagDBHeader *)db->base;
+	memcpy(header->magic, TIFF_TAGDB_MAGIC, sizeof(header->magic) );
+	header->byteOrder = TAGDB_BYTE_ORDER;
+	header->numTags = build->numTags;
+	header->tagSlots = tagSlots;
+	header->numValues = build->numValues;
+	header->valueSlots = valueSlots;
+	header->stringBytes = (unsigned int)build->stringBytes;
+	setParts(db);
+
+	tags = (tiffTagDBTag *)db->tags;
+	names = (unsigned int *)db->names;
+	values = (tiffTagDBValue *)db->values;
+	memcpy( (char *)db->strings, build->strings, build->stringBytes);
+
+	for(i = 0;i < build->numTags;i++)
+	{
+		j = hashTag(build->tags[i].tag) & (tagSlots - 1);
+		while(tags[j].name != 0)
+		{
+			if(tags[j].tag == build->tags[i].tag)
+			{
+				fprintf(stderr, "%s: tag %u defined twice\n", filename,
+					tags[j].tag);
+				tiffTagDBFree(db);
+
+				return 1;
+			}
+			j = (j + 1) & (tagSlots - 1);
+		}
+		tags[j].name = build->tags[i].name;
+		tags[j].tag = build->tags[i].tag;
+		tags[j].types = build->tags[i].types;
+	}
+
+	for(i = 0;i < tagSlots;i++)
+	{
+		if(tags[i].name == 0)
+		{
+			continue;
+		}
+		j = hashName(db->strings + tags[i].name) & (tagSlots - 1);
+		while(names[j] != 0)
+		{
+			if(strcmp(db->strings + tags[names[j] - 1].name,
+				db->strings + tags[i].name) == 0)
+			{
+				fprintf(stderr, "%s: tag name %s defined twice\n",
+					filename, db->strings + tags[i].name);
+				tiffTagDBFree(db);
+
+				return 1;
+			}
+			j = (j + 1) & (tagSlots - 1);
+		}
+		names[j] = i + 1;
+	}
+
+	for(i = 0;i < build->numValues;i++)
+	{
+		j = hashValue(build->values[i].tag, build->values[i].value) &
+			(valueSlots - 1);
+		while(values[j].desc != 0)
+		{
+			if( (values[j].tag == build->values[i].tag) &&
+				(values[j].value == build->values[i].value) )
+			{
+				fprintf(stderr, "%s: value %u of tag %u described twice\n",
+					filename, values[j].value, values[j].tag);
+				tiffTagDBFree(db);
+
+				return 1;
+			}
+			j = (j + 1) & (valueSlots - 1);
+		}
+		values[j] = build->values[i];
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: loadText                                                 **/
+/**                                                                      **/
+/**   Read a text dictionary and build its block. Returns 0 on success,  **/
+/**   1 on failure.                                                      **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- dictionary file name                                  **/
+/**   file      -- the file, open at its start                           **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   db        -- dictionary                                            **/
+/**                                                                      **/
+
+static int loadText(const char *filename, FILE *file, tiffTagDB *db)
+{
+	char text[TIFF_TAGDB_MAX_LINE];
+	tagdbBuild build;
+	unsigned int line = 0;
+	size_t n;
+	int result = 0;
+
+	memset(&build, 0, sizeof(build) );
+	if(addString(&build, "", 0) != 0)
+	{
+		return 1;
+	}
+
+	while( (result == 0) && (fgets(text, sizeof(text), file) != NULL) )
+	{
+		line++;
+		n = strlen(text);
+		if( (n == sizeof(text) - 1) && (text[n - 1] != '\n') &&
+			!feof(file) )
+		{
+			fprintf(stderr, "%s:%u: line too long\n", filename, line);
+			result = 1;
+		}
+		else
+		{
+			while( (n > 0) &&
+				( (text[n - 1] == '\n') || (text[n - 1] == '\r') ) )
+			{
+				text[--n] = '\0';
+			}
+			result = parseLine(&build, text, filename, line);
+		}
+	}
+
+	if( (result == 0) && ferror(file) )
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+		result = 1;
+	}
+
+	if(result == 0)
+	{
+		result = buildIndex(&build, filename, db);
+	}
+
+	free(build.tags);
+	free(build.values);
+	free(build.strings);
+
+	return result;
+}
+
+
+/**                                                                      **/
+/**   Function: checkIndex                                               **/
+/**                                                                      **/
+/**   Check that a compiled dictionary is consistent, so that lookups    **/
+/**   stay within its block and always reach a free slot. Returns 0 on   **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- dictionary file name, for messages                    **/
+/**   db        -- dictionary, whose base and size are set               **/
+/**                                                                      **/
+
+static int checkIndex(const char *filename, tiffTagDB *db)
+{
+	const tiffTagDBHeader *header = (const tiffTagDBHeader *)db->base;
+	unsigned int used;
+	unsigned int i;
+
+	if(header->byteOrder != TAGDB_BYTE_ORDER)
+	{
+		fprintf(stderr, "%s: compiled with another byte order\n",
+			filename);
+
+		return 1;
+	}
+
+	if( (header->tagSlots == 0) || (header->valueSlots == 0) ||
+		(header->tagSlots > TAGDB_MAX_SLOTS) ||
+		(header->valueSlots > TAGDB_MAX_SLOTS) ||
+		( (header->tagSlots & (header->tagSlots - 1) ) != 0) ||
+		( (header->valueSlots & (header->valueSlots - 1) ) != 0) ||
+		(header->numTags >= header->tagSlots) ||
+		(header->numValues >= header->valueSlots) ||
+		(header->stringBytes == 0) ||
+		(db->size != blockSize(header->tagSlots, header->valueSlots,
+		header->stringBytes) ) )
+	{
+		fprintf(stderr, "%s: bad tag dictionary header\n", filename);
+
+		return 1;
+	}
+
+	setParts(db);
+
+	if( (db->strings[0] != '\0') ||
+		(db->strings[header->stringBytes - 1] != '\0') )
+	{
+		fprintf(stderr, "%s: bad tag dictionary strings\n", filename);
+
+		return 1;
+	}
+
+	used = 0;
+	for(i = 0;i < header->tagSlots;i++)
+	{
+		if(db->tags[i].name >= header->stringBytes)
+		{
+			fprintf(stderr, "%s: bad tag dictionary tags\n", filename);
+
+			return 1;
+		}
+		used += (db->tags[i].name != 0);
+	}
+	if(used != header->numTags)
+	{
+		fprintf(stderr, "%s: bad tag dictionary tags\n", filename);
+
+		return 1;
+	}
+
+	used = 0;
+	for(i = 0;i < header->tagSlots;i++)
+	{
+		if( (db->names[i] > header->tagSlots) || ( (db->names[i] != 0) &&
+			(db->tags[db->names[i] - 1].name == 0) ) )
+		{
+			fprintf(stderr, "%s: bad tag dictionary names\n", filename);
+
+			return 1;
+		}
+		used += (db->names[i] != 0);
+	}
+	if(used != header->numTags)
+	{
+		fprintf(stderr, "%s: bad tag dictionary names\n", filename);
+
+		return 1;
+	}
+
+	used = 0;
+	for(i = 0;i < header->valueSlots;i++)
+	{
+		if(db->values[i].desc >= header->stringBytes)
+		{
+			fprintf(stderr, "%s: bad tag dictionary values\n", filename);
+
+			return 1;
+		}
+		used += (db->values[i].desc != 0);
+	}
+	if(used != header->numValues)
+	{
+		fprintf(stderr, "%s: bad tag dictionary values\n", filename);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: loadCompiled                                             **/
+/**                                                                      **/
+/**   Map a compiled dictionary read-only and check it. Returns 0 on     **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- dictionary file name                                  **/
+/**   file      -- the file                                              **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   db        -- dictionary                                            **/
+/**                                                                      **/
+
+static int loadCompiled(const char *filename, FILE *file, tiffTagDB *db)
+{
+	struct stat st;
+	void *map;
+
+	if(fstat(fileno(file), &st) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+	if( (unsigned long long)st.st_size < sizeof(tiffTagDBHeader) )
+	{
+		fprintf(stderr, "%s: bad tag dictionary header\n", filename);
+
+		return 1;
+	}
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+		fileno(file), 0);
+	if(map == MAP_FAILED)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+	db->base = (unsigned char *)map;
+	db->size = (size_t)st.st_size;
+	db->mapped = 1;
+
+	if(checkIndex(filename, db) != 0)
+	{
+		tiffTagDBFree(db);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBLoad                                            **/
+/**                                                                      **/
+/**   Load a dictionary, text or compiled, telling them apart by the     **/
+/**   magic number. Returns 0 on success, 1 on failure.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- dictionary file name                                  **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   db        -- dictionary, freed with tiffTagDBFree                  **/
+/**                                                                      **/
+
+int tiffTagDBLoad(const char *filename, tiffTagDB *db)
+{
+	char magic[sizeof(TIFF_TAGDB_MAGIC) - 1];
+	FILE *file;
+	int result;
+
+	memset(db, 0, sizeof(*db) );
+
+	file = fopen(filename, "rb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	if( (fread(magic, 1, sizeof(magic), file) == sizeof(magic) ) &&
+		(memcmp(magic, TIFF_TAGDB_MAGIC, sizeof(magic) ) == 0) )
+	{
+		result = loadCompiled(filename, file, db);
+	}
+	else
+	{
+		rewind(file);
+		result = loadText(filename, file, db);
+	}
+
+	fclose(file);
+
+	return result;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBSave                                            **/
+/**                                                                      **/
+/**   Write the compiled form of a dictionary. Returns 0 on success, 1   **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db        -- dictionary                                            **/
+/**   filename  -- file name written                                     **/
+/**                                                                      **/
+
+int tiffTagDBSave(const tiffTagDB *db, const char *filename)
+{
+	FILE *file;
+
+	file = fopen(filename, "wb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	if(fwrite(db->base, 1, db->size, file) != db->size)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+		fclose(file);
+
+		return 1;
+	}
+
+	if(fclose(file) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno) );
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBFree                                            **/
+/**                                                                      **/
+/**   Release a dictionary, which must no longer be registered.          **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db      -- dictionary                                              **/
+/**                                                                      **/
+
+void tiffTagDBFree(tiffTagDB *db)
+{
+	if(db->mapped)
+	{
+		munmap(db->base, db->size);
+	}
+	else
+	{
+		free(db->base);
+	}
+	memset(db, 0, sizeof(*db) );
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBFind                                            **/
+/**                                                                      **/
+/**   Return the slot of a tag in a dictionary, or NULL if it doesn't    **/
+/**   define it.                                                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db      -- dictionary                                              **/
+/**   tag     -- tag number                                              **/
+/**                                                                      **/
+
+const tiffTagDBTag *tiffTagDBFind(const tiffTagDB *db, unsigned short tag)
+{
+	unsigned int mask = db->header->tagSlots - 1;
+	unsigned int i;
+
+	for(i = hashTag(tag) & mask;db->tags[i].name != 0;i = (i + 1) & mask)
+	{
+		if(db->tags[i].tag == tag)
+		{
+			return &db->tags[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBFindName                                        **/
+/**                                                                      **/
+/**   Return the number of the tag of a dictionary with the given name,  **/
+/**   or -1 if it doesn't define it.                                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db      -- dictionary                                              **/
+/**   name    -- tag name                                                **/
+/**                                                                      **/
+
+int tiffTagDBFindName(const tiffTagDB *db, const char *name)
+{
+	unsigned int mask = db->header->tagSlots - 1;
+	const tiffTagDBTag *tag;
+	unsigned int i;
+
+	for(i = hashName(name) & mask;db->names[i] != 0;i = (i + 1) & mask)
+	{
+		tag = &db->tags[db->names[i] - 1];
+		if(strcmp(db->strings + tag->name, name) == 0)
+		{
+			return tag->tag;
+		}
+	}
+
+	return -1;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBFindValue                                       **/
+/**                                                                      **/
+/**   Return the description of a value of a tag in a dictionary, or     **/
+/**   NULL if it doesn't describe it.                                    **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db      -- dictionary                                              **/
+/**   tag     -- tag number                                              **/
+/**   value   -- value number                                            **/
+/**                                                                      **/
+
+const char *tiffTagDBFindValue(const tiffTagDB *db, unsigned short tag,
+	unsigned int value)
+{
+	unsigned int mask = db->header->valueSlots - 1;
+	unsigned int i;
+
+	for(i = hashValue(tag, value) & mask;db->values[i].desc != 0;
+		i = (i + 1) & mask)
+	{
+		if( (db->values[i].tag == tag) && (db->values[i].value == value) )
+		{
+			return db->strings + db->values[i].desc;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBRegister                                        **/
+/**                                                                      **/
+/**   Make a dictionary consulted by the tag lookups of the library.     **/
+/**   Must be called before threads using them start; the dictionary     **/
+/**   stays in use until tiffTagDBUnregister. Returns 0 on success, 1    **/
+/**   if TIFF_TAGDB_MAX dictionaries are already registered.             **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   db      -- dictionary                                              **/
+/**                                                                      **/
+
+int tiffTagDBRegister(const tiffTagDB *db)
+{
+	if(numRegistered == TIFF_TAGDB_MAX)
+	{
+		fprintf(stderr, "more than %d tag dictionaries\n", TIFF_TAGDB_MAX);
+
+		return 1;
+	}
+
+	registered[numRegistered++] = db;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBUnregister                                      **/
+/**                                                                      **/
+/**   Stop consulting all registered dictionaries.                       **/
+/**                                                                      **/
+
+void tiffTagDBUnregister(void)
+{
+	numRegistered = 0;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Functions: tiffTagDBName, tiffTagDBNumber, tiffTagDBValueDesc,     **/
+/**   tiffTagDBTypes                                                     **/
+/**                                                                      **/
+/**   Return the name of a tag, the number of a tag name, the            **/
+/**   description of a value of a tag and the bit mask of the expected   **/
+/**   types of a tag, as given by the latest registered dictionary       **/
+/**   defining them; NULL, -1, NULL and 0 if none does.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   tag     -- tag number                                              **/
+/**   name    -- tag name                                                **/
+/**   value   -- value number                                            **/
+/**                                                                      **/
+
+const char *tiffTagDBName(unsigned short tag)
+{
+	const tiffTagDBTag *found;
+	unsigned int i;
+
+	for(i = numRegistered;i > 0;i--)
+	{
+		found = tiffTagDBFind(registered[i - 1], tag);
+		if(found != NULL)
+		{
+			return registered[i - 1]->strings + found->name;
+		}
+	}
+
+	return NULL;
+}
+
+int tiffTagDBNumber(const char *name)
+{
+	unsigned int i;
+	int tag;
+
+	for(i = numRegistered;i > 0;i--)
+	{
+		tag = tiffTagDBFindName(registered[i - 1], name);
+		if(tag >= 0)
+		{
+			return tag;
+		}
+	}
+
+	return -1;
+}
+
+const char *tiffTagDBValueDesc(unsigned short tag, unsigned int value)
+{
+	const char *desc;
+	unsigned int i;
+
+	for(i = numRegistered;i > 0;i--)
+	{
+		desc = tiffTagDBFindValue(registered[i - 1], tag, value);
+		if(desc != NULL)
+		{
+			return desc;
+		}
+	}
+
+	return NULL;
+}
+
+unsigned int tiffTagDBTypes(unsigned short tag)
+{
+	const tiffTagDBTag *found;
+	unsigned int i;
+
+	for(i = numRegistered;i > 0;i--)
+	{
+		found = tiffTagDBFind(registered[i - 1], tag);
+		if(found != NULL)
+		{
+			return found->types;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffTagDBMain                                            **/
+/**                                                                      **/
+/**   Main function of the tagdb subcommand, which compiles a text       **/
+/**   dictionary. Returns 0 on success, 1 on failure.                    **/
+/**                                                                      **/
+/**   Usage:                                                             **/
+/**   tiff_metadata tagdb input output                                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   argc       -- argument count, argv[0] being "tagdb"                **/
+/**   argv       -- argument vector                                      **/
+/**                                                                      **/
+
+int tiffTagDBMain(int argc, char *argv[])
+{
+	tiffTagDB db;
+	int result;
+
+	if(argc != 3)
+	{
+		fprintf(stderr, "usage: tiff_metadata tagdb input output\n");
+
+		return 1;
+	}
+
+	if(tiffTagDBLoad(argv[1], &db) != 0)
+	{
+		return 1;
+	}
+
+	result = tiffTagDBSave(&db, argv[2]);
+	if(result == 0)
+	{
+		printf("%s: %u tags, %u value descriptions, %zu bytes\n", argv[2],
+			db.header->numTags, db.header->numValues, db.size);
+	}
+
+	tiffTagDBFree(&db);
+
+	return result;
+}
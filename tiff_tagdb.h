@@ -0,0 +1,175 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Tag dictionaries loaded at run time.                               **/
+/**                                                                      **/
+/**   A dictionary adds tags to the ones built in, or renames them:      **/
+/**   their names, expected field types and descriptions of their        **/
+/**   values. It is read from a text file, one tag a line, lines         **/
+/**   starting with "#" being comments:                                  **/
+/**                                                                      **/
+/**       # number  name  types  [value=description;...]                 **/
+/**       50708  UniqueCameraModel  ASCII                                **/
+/**       50706  DNGVersion  BYTE                                        **/
+/**       50717  WhiteLevel  SHORT|LONG                                  **/
+/**       50778  CalibrationIlluminant1  SHORT  17=Light A;21=D65        **/
+/**                                                                      **/
+/**   Fields are separated by blanks, except the value descriptions      **/
+/**   which run to the end of the line; types is "-" when any goes.      **/
+/**                                                                      **/
+/**   A dictionary is built once into a single immutable block holding   **/
+/**   open addressing hash tables of tags by number, of tags by name and **/
+/**   of value descriptions by tag and value, followed by its strings.   **/
+/**   The block only holds offsets, so it is written to a file as it is  **/
+/**   ("tiff_metadata tagdb in.txt out.tdb") and later mapped read-only  **/
+/**   and used in place, without parsing or hashing: startup then costs  **/
+/**   one check of each slot. Compiled files are specific to the byte    **/
+/**   order of the machine that wrote them.                              **/
+/**                                                                      **/
+/**   Dictionaries are registered before worker threads start and are    **/
+/**   only read afterwards, so all threads share them without locking.   **/
+/**   getTagDescriptor, getTagNumber and getTIFFValueDesc consult the    **/
+/**   registered dictionaries, latest first, before the built-in tags.   **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_TAGDB_H
+#define _TIFF_TAGDB_H
+
+#include <stddef.h>
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Magic number of compiled dictionaries, most dictionaries registered **/
+/**  and longest line of a text dictionary                               **/
+/**                                                                      **/
+
+#define TIFF_TAGDB_MAGIC "TIFFTDB1"
+#define TIFF_TAGDB_MAX 8
+#define TIFF_TAGDB_MAX_LINE 4096
+
+
+/**                                                                      **/
+/**  Header of a compiled dictionary, followed by its tables and strings **/
+/**                                                                      **/
+/**  magic, byteOrder                                                    **/
+/**      TIFF_TAGDB_MAGIC, and 0x01020304 as written by the machine      **/
+/**  numTags, tagSlots                                                   **/
+/**      number of tags, and size of the tables by number and by name    **/
+/**  numValues, valueSlots                                               **/
+/**      number of value descriptions, and size of their table           **/
+/**  stringBytes                                                         **/
+/**      size of the string pool, which starts with an empty string      **/
+/**                                                                      **/
+
+typedef struct tiffTagDBHeader
+{
+	char magic[8];
+	unsigned int byteOrder;
+	unsigned int numTags;
+	unsigned int tagSlots;
+	unsigned int numValues;
+	unsigned int valueSlots;
+	unsigned int stringBytes;
+} tiffTagDBHeader;
+
+
+/**                                                                      **/
+/**  Slot of the table of tags by number, free when name is 0            **/
+/**                                                                      **/
+/**  name                                                                **/
+/**      offset of the name in the string pool                           **/
+/**  tag                                                                 **/
+/**      tag number                                                      **/
+/**  types                                                               **/
+/**      bit mask of the expected field types, 0 for any                 **/
+/**                                                                      **/
+
+typedef struct tiffTagDBTag
+{
+	unsigned int name;
+	unsigned short tag;
+	unsigned short types;
+} tiffTagDBTag;
+
+
+/**                                                                      **/
+/**  Slot of the table of value descriptions, free when desc is 0        **/
+/**                                                                      **/
+
+typedef struct tiffTagDBValue
+{
+	unsigned int value;
+	unsigned int desc;
+	unsigned short tag;
+	unsigned short pad;
+} tiffTagDBValue;
+
+
+/**                                                                      **/
+/**  Loaded dictionary                                                   **/
+/**                                                                      **/
+/**  base, size, mapped                                                  **/
+/**      the block and its size, mapped from a file or allocated         **/
+/**  header, tags, names, values, strings                                **/
+/**      parts of the block; names holds one plus the index in tags of   **/
+/**      the tag of each name slot, 0 for a free slot                    **/
+/**                                                                      **/
+
+typedef struct tiffTagDB
+{
+	unsigned char *base;
+	size_t size;
+	int mapped;
+	const tiffTagDBHeader *header;
+	const tiffTagDBTag *tags;
+	const unsigned int *names;
+	const tiffTagDBValue *values;
+	const char *strings;
+} tiffTagDB;
+
+
+/**                                                                      **/
+/**  Tag dictionary API function declarations                            **/
+/**                                                                      **/
+
+int tiffTagDBLoad(const char *filename, tiffTagDB *db);
+int tiffTagDBSave(const tiffTagDB *db, const char *filename);
+void tiffTagDBFree(tiffTagDB *db);
+const tiffTagDBTag *tiffTagDBFind(const tiffTagDB *db, unsigned short tag);
+int tiffTagDBFindName(const tiffTagDB *db, const char *name);
+const char *tiffTagDBFindValue(const tiffTagDB *db, unsigned short tag,
+	unsigned int value);
+int tiffTagDBRegister(const tiffTagDB *db);
+void tiffTagDBUnregister(void);
+const char *tiffTagDBName(unsigned short tag);
+int tiffTagDBNumber(const char *name);
+const char *tiffTagDBValueDesc(unsigned short tag, unsigned int value);
+unsigned int tiffTagDBTypes(unsigned short tag);
+int tiffTagDBMain(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,375 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Embedded thumbnail extraction.                                     **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "tiff_metadata.h"
+#include "tiff_strip.h"
+#include "tiff_thumbnail.h"
+
+
+/**                                                                      **/
+/**  Thumbnail walk state                                                **/
+/**                                                                      **/
+/**  offset, length, haveOffset, haveLength                              **/
+/**      values of the thumbnail tags of the current IFD                 **/
+/**                                                                      **/
+
+typedef struct thumbnailCtx
+{
+	unsigned int offset;
+	unsigned int length;
+	int haveOffset;
+	int haveLength;
+} thumbnailCtx;
+
+
+/**                                                                      **/
+/**   Function: thumbnailBeginIFD                                        **/
+/**                                                                      **/
+/**   Visitor callback forgetting the tags of the previous IFD.          **/
+/**                                                                      **/
+
+static tiffWalk_t thumbnailBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	thumbnailCtx *thumbnail = (thumbnailCtx *)ctx;
+
+	thumbnail->haveOffset = 0;
+	thumbnail->haveLength = 0;
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: thumbnailEntry                                           **/
+/**                                                                      **/
+/**   Visitor callback remembering the thumbnail tags.                   **/
+/**                                                                      **/
+
+static tiffWalk_t thumbnailEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	thumbnailCtx *thumbnail = (thumbnailCtx *)ctx;
+
+	if( (entry->fieldType != FT_LONG) || (entry->count != 1) )
+	{
+		return TIFF_WALK_CONTINUE;
+	}
+
+	if(entry->tag == JPEGInterchangeFormat)
+	{
+		thumbnail->offset = entry->valueOffset;
+		thumbnail->haveOffset = 1;
+	}
+	else if(entry->tag == JPEGInterchangeFormatLength)
+	{
+		thumbnail->length = entry->valueOffset;
+		thumbnail->haveLength = 1;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: thumbnailEndIFD                                          **/
+/**                                                                      **/
+/**   Visitor callback stopping at the first IFD holding both tags.      **/
+/**                                                                      **/
+
+static tiffWalk_t thumbnailEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	thumbnailCtx *thumbnail = (thumbnailCtx *)ctx;
+
+	if(thumbnail->haveOffset && thumbnail->haveLength)
+	{
+		return TIFF_WALK_STOP;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffThumbnailFind                                        **/
+/**                                                                      **/
+/**   Find the thumbnail of a file opened with tiffOpen, walking its     **/
+/**   main IFD chain until an IFD holds both JPEGInterchangeFormat and   **/
+/**   JPEGInterchangeFormatLength. Returns 0 when a thumbnail lying      **/
+/**   inside the file and starting with a JPEG SOI marker was found, 1   **/
+/**   with a message on stderr otherwise.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name, for messages                               **/
+/**   internal  -- struct of the open file                               **/
+/**   thumbnail -- receives the location of the thumbnail                **/
+/**                                                                      **/
+
+int tiffThumbnailFind(const char *filename, internalStruct *internal,
+	tiffThumbnail *thumbnail)
+{
+	static const tiffVisitor visitor = {
+		thumbnailBeginIFD, thumbnailEntry, thumbnailEndIFD,
+	};
+	unsigned char soi[2];
+	thumbnailCtx ctx;
+	tiffWalk_t status;
+	unsigned long long size;
+
+	memset(&ctx, 0, sizeof(ctx) );
+	memset(thumbnail, 0, sizeof(*thumbnail) );
+
+	status = tiffIFDWalk(filename, internal, IFD_TIFF, &visitor, &ctx);
+	if(status == TIFF_WALK_ERROR)
+	{
+		return 1;
+	}
+	if(!ctx.haveOffset || !ctx.haveLength || (ctx.length == 0) )
+	{
+		fprintf(stderr, "%s has no thumbnail\n", filename);
+
+		return 1;
+	}
+
+	/* Offsets of a TIFF inside a JPEG start at its header */
+	thumbnail->offset = (unsigned long long)internal->tiffOffset +
+		ctx.offset;
+	thumbnail->length = ctx.length;
+
+	size = tiffFileSize(internal);
+	if( (thumbnail->offset > size) ||
+		(thumbnail->length > size - thumbnail->offset) )
+	{
+		fprintf(stderr, "thumbnail of %s (%u bytes at %u) ends past the "
+			"end of the file\n", filename, ctx.length, ctx.offset);
+
+		return 1;
+	}
+
+	if( (tiffReadAt(internal, thumbnail->offset, soi, sizeof(soi) ) !=
+		sizeof(soi) ) ||
+		(soi[0] != 0xff) || (soi[1] != 0xd8) )
+	{
+		fprintf(stderr, "thumbnail of %s is not a JPEG image\n", filename);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffThumbnailView                                        **/
+/**                                                                      **/
+/**   Return a pointer to the thumbnail in the mapped file, valid until  **/
+/**   tiffClose, or NULL when the file isn't mapped.                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct of the open file                               **/
+/**   thumbnail -- thumbnail found by tiffThumbnailFind                  **/
+/**                                                                      **/
+
+const unsigned char *tiffThumbnailView(const internalStruct *internal,
+	const tiffThumbnail *thumbnail)
+{
+	if( (internal->map == NULL) ||
+		(thumbnail->offset + thumbnail->length > internal->mapSize) )
+	{
+		return NULL;
+	}
+
+	return internal->map + thumbnail->offset;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffThumbnailWrite                                       **/
+/**                                                                      **/
+/**   Write the thumbnail at the start of a file, copying it in the      **/
+/**   kernel when the file is local and reading it through internal->io  **/
+/**   otherwise. Returns 0 on success, 1 on failure.                     **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   internal  -- struct of the open file                               **/
+/**   thumbnail -- thumbnail found by tiffThumbnailFind                  **/
+/**   out       -- descriptor of the file written                        **/
+/**                                                                      **/
+
+int tiffThumbnailWrite(const internalStruct *internal,
+	const tiffThumbnail *thumbnail, int out)
+{
+	unsigned char buffer[65536];
+	unsigned long long done;
+	size_t n;
+
+	if(internal->io == NULL)
+	{
+		return tiffCopyRange(fileno(internal->file), out,
+			thumbnail->offset, 0, thumbnail->length);
+	}
+
+	for(done = 0;done < thumbnail->length;done += n)
+	{
+		n = (thumbnail->length - done < sizeof(buffer) ) ?
+			(size_t)(thumbnail->length - done) : sizeof(buffer);
+		if( (tiffReadAt(internal, thumbnail->offset + done, buffer, n) !=
+			n) || (pwrite(out, buffer, n, (off_t)done) != (ssize_t)n) )
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: thumbnailName                                            **/
+/**                                                                      **/
+/**   Build the name of the file a thumbnail is written to: the path of  **/
+/**   the source, without leading "./", followed by ".jpg", with "/"     **/
+/**   written "_" and "_" and "%" escaped as "%5F" and "%25". Distinct   **/
+/**   paths get distinct names (a/b.tif, a_b.tif and a/b.dng give        **/
+/**   a_b.tif.jpg, a%5Fb.tif.jpg and a_b.dng.jpg). Returns 0 on success, **/
+/**   1 if the name is too long.                                         **/
+/**                                                                      **/
+
+static int thumbnailName(const char *filename, const char *directory,
+	char *name, size_t size)
+{
+	size_t used;
+
+	while( (filename[0] == '.') && (filename[1] == '/') )
+	{
+		filename += 2;
+		while(filename[0] == '/')
+		{
+			filename++;
+		}
+	}
+
+	used = (size_t)snprintf(name, size, "%s/", directory);
+	for(;(*filename != '\0') && (used + 3 + sizeof(".jpg") <= size);
+		filename++)
+	{
+		if( (*filename == '_') || (*filename == '%') )
+		{
+			used += (size_t)sprintf(name + used, "%%%02X",
+				(unsigned char)*filename);
+		}
+		else
+		{
+			name[used++] = (*filename == '/') ? '_' : *filename;
+		}
+	}
+	if( (*filename != '\0') || (used + sizeof(".jpg") > size) )
+	{
+		return 1;
+	}
+	memcpy(name + used, ".jpg", sizeof(".jpg") );
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffThumbnailExtract                                     **/
+/**                                                                      **/
+/**   Write the thumbnail of a file into a directory, under the name     **/
+/**   built by thumbnailName. An existing file of that name is not       **/
+/**   overwritten but reported as a collision. Returns 0 on success, 1   **/
+/**   on failure.                                                        **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**   directory -- directory the thumbnail is written to                 **/
+/**                                                                      **/
+
+int tiffThumbnailExtract(const char *filename, internalStruct *internal,
+	const char *directory)
+{
+	char name[PATH_MAX];
+	tiffThumbnail thumbnail;
+	int status;
+	int out;
+
+	if(thumbnailName(filename, directory, name, sizeof(name) ) != 0)
+	{
+		fprintf(stderr, "thumbnail name for %s is too long\n", filename);
+
+		return 1;
+	}
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		return 1;
+	}
+
+	status = tiffThumbnailFind(filename, internal, &thumbnail);
+	if(status == 0)
+	{
+		out = open(name, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if( (out < 0) && (errno == EEXIST) )
+		{
+			fprintf(stderr, "thumbnail %s of %s already exists\n", name,
+				filename);
+			status = 1;
+		}
+		else if(out < 0)
+		{
+			fprintf(stderr, "can't open %s to write\n", name);
+			status = 1;
+		}
+		else
+		{
+			status = tiffThumbnailWrite(internal, &thumbnail, out);
+			if( (close(out) != 0) || (status != 0) )
+			{
+				fprintf(stderr, "can't write %s\n", name);
+				unlink(name);
+				status = 1;
+			}
+		}
+	}
+
+	tiffClose(internal);
+
+	return status;
+}
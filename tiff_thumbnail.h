@@ -0,0 +1,73 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Embedded thumbnail extraction.                                     **/
+/**                                                                      **/
+/**   The JPEG thumbnail a file carries (usually in IFD1) is found from  **/
+/**   its JPEGInterchangeFormat and JPEGInterchangeFormatLength tags,    **/
+/**   checked to lie inside the file and to start with a JPEG SOI        **/
+/**   marker, and then either used in place through a view into the      **/
+/**   mapped file or written out by the kernel with copy_file_range(2)   **/
+/**   or sendfile(2) (see tiffCopyRange). Neither the thumbnail nor the  **/
+/**   full image is ever decoded.                                        **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_THUMBNAIL_H
+#define _TIFF_THUMBNAIL_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Location of a thumbnail                                             **/
+/**                                                                      **/
+/**  offset, length                                                      **/
+/**      offset of the first byte from the start of the file (not of the **/
+/**      TIFF header), and size in bytes                                 **/
+/**                                                                      **/
+
+typedef struct tiffThumbnail
+{
+	unsigned long long offset;
+	unsigned long long length;
+} tiffThumbnail;
+
+
+/**                                                                      **/
+/**  Thumbnail API function declarations                                 **/
+/**                                                                      **/
+
+int tiffThumbnailFind(const char *filename, internalStruct *internal,
+	tiffThumbnail *thumbnail);
+const unsigned char *tiffThumbnailView(const internalStruct *internal,
+	const tiffThumbnail *thumbnail);
+int tiffThumbnailWrite(const internalStruct *internal,
+	const tiffThumbnail *thumbnail, int out);
+int tiffThumbnailExtract(const char *filename, internalStruct *internal,
+	const char *directory);
+
+#endif
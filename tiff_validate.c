@@ -0,0 +1,798 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Structural validation of files.                                    **/
+/**                                                                      **/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "tiff_metadata.h"
+#include "tiff_tagdb.h"
+#include "tiff_validate.h"
+
+
+/**                                                                      **/
+/**  Kinds of byte ranges                                                **/
+/**                                                                      **/
+
+typedef enum {
+	RANGE_HEADER = 0,
+	RANGE_IFD,
+	RANGE_VALUE,
+	RANGE_CHUNK,
+} rangeKind_t;
+
+
+/**                                                                      **/
+/**  Byte range referred to by a file                                    **/
+/**                                                                      **/
+/**  start, end                                                          **/
+/**      offsets of the first byte and past the last byte                **/
+/**  kind, ifdKind, ifdIndex                                             **/
+/**      what the range holds, and the IFD it belongs to                 **/
+/**  tag, index                                                          **/
+/**      tag of a value or chunk, and position of a chunk in its table   **/
+/**                                                                      **/
+
+typedef struct validateRange
+{
+	unsigned long long start;
+	unsigned long long end;
+	unsigned char kind;
+	unsigned char ifdKind;
+	unsigned short ifdIndex;
+	unsigned short tag;
+	unsigned int index;
+} validateRange;
+
+
+/**                                                                      **/
+/**  Chunk tables of an IFD: StripOffsets, StripByteCounts,              **/
+/**  TileOffsets and TileByteCounts                                      **/
+/**                                                                      **/
+
+#define TABLE_STRIPS 0
+#define TABLE_TILES 2
+#define NUM_TABLES 4
+
+
+/**                                                                      **/
+/**  Validation state of a file                                          **/
+/**                                                                      **/
+/**  filename, bound, result                                             **/
+/**      file, size of the TIFF data in it, and findings so far          **/
+/**  numRanges, maxRanges, ranges                                        **/
+/**      ranges collected                                                **/
+/**  numIFDs                                                             **/
+/**      IFDs walked                                                     **/
+/**  tables, haveTables                                                  **/
+/**      chunk table entries of the current IFD                          **/
+/**  thumbnail, thumbnailLength, haveThumbnail, haveThumbnailLength      **/
+/**      JPEG thumbnail of the current IFD                               **/
+/**  width, length, rowsPerStrip, tileWidth, tileLength, samples,        **/
+/**  planar                                                              **/
+/**      image geometry of the current IFD, 0 when not given             **/
+/**                                                                      **/
+
+typedef struct validateCtx
+{
+	const char *filename;
+	unsigned long long bound;
+	tiffValidateResult *result;
+	unsigned long long numRanges;
+	unsigned long long maxRanges;
+	validateRange *ranges;
+	unsigned int numIFDs;
+	tiffEntry tables[NUM_TABLES];
+	int haveTables[NUM_TABLES];
+	unsigned int thumbnail;
+	unsigned int thumbnailLength;
+	int haveThumbnail;
+	int haveThumbnailLength;
+	unsigned int width;
+	unsigned int length;
+	unsigned int rowsPerStrip;
+	unsigned int tileWidth;
+	unsigned int tileLength;
+	unsigned int samples;
+	unsigned int planar;
+} validateCtx;
+
+
+/**                                                                      **/
+/**   Function: finding                                                  **/
+/**                                                                      **/
+/**   Count a finding and print it, unless too many were printed.        **/
+/**                                                                      **/
+
+static void finding(validateCtx *ctx, const internalStruct *internal,
+	int error, const char *code, const char *format, ...)
+{
+	char detail[256];
+	va_list args;
+
+	if(error)
+	{
+		ctx->result->errors++;
+	}
+	else
+	{
+		ctx->result->warnings++;
+	}
+
+	if(ctx->result->errors + ctx->result->warnings >
+		TIFF_VALIDATE_MAX_FINDINGS)
+	{
+		return;
+	}
+
+	va_start(args, format);
+	vsnprintf(detail, sizeof(detail), format, args);
+	va_end(args);
+
+	tiffPrintf(internal, "%s\t%s\t%s\t%s\n", ctx->filename,
+		error ? "error" : "warning", code, detail);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: ifdName                                                  **/
+/**                                                                      **/
+/**   Write the name of an IFD: IFD0, IFD1, ... or Exif.                 **/
+/**                                                                      **/
+
+static void ifdName(unsigned int kind, unsigned int index, char *name,
+	size_t size)
+{
+	if(kind == IFD_EXIF)
+	{
+		snprintf(name, size, "Exif");
+	}
+	else
+	{
+		snprintf(name, size, "IFD%u", index);
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: describeRange                                            **/
+/**                                                                      **/
+/**   Write what a range holds and where it is.                          **/
+/**                                                                      **/
+
+static void describeRange(const validateRange *range, char *text,
+	size_t size)
+{
+	char name[16];
+	size_t n;
+
+	ifdName(range->ifdKind, range->ifdIndex, name, sizeof(name) );
+
+	switch(range->kind)
+	{
+		case RANGE_HEADER:
+		{
+			snprintf(text, size, "header");
+			break;
+		}
+		case RANGE_IFD:
+		{
+			snprintf(text, size, "%s", name);
+			break;
+		}
+		case RANGE_VALUE:
+		{
+			snprintf(text, size, "%s %s value", name,
+				getTagDescriptor(range->tag) );
+			break;
+		}
+		default:
+		{
+			snprintf(text, size, "%s %s[%u]", name,
+				getTagDescriptor(range->tag), range->index);
+			break;
+		}
+	}
+
+	n = strlen(text);
+	snprintf(text + n, size - n, " %llu-%llu", range->start, range->end);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: addRange                                                 **/
+/**                                                                      **/
+/**   Add a range, reporting it if it runs past the end of the file or   **/
+/**   if an IFD or value starts at an odd offset. Returns 0 on           **/
+/**   success, 1 on failure.                                             **/
+/**                                                                      **/
+
+static int addRange(validateCtx *ctx, const internalStruct *internal,
+	rangeKind_t kind, const tiffIFDInfo *ifd, unsigned short tag,
+	unsigned int index, unsigned long long start, unsigned long long n)
+{
+	validateRange *range;
+	char text[128];
+
+	if(ctx->numRanges == ctx->maxRanges)
+	{
+		ctx->maxRanges = (ctx->maxRanges == 0) ? 256 : ctx->maxRanges * 2;
+		range = (validateRange *)realloc(ctx->ranges,
+			ctx->maxRanges * sizeof(*range) );
+		if(range == NULL)
+		{
+			fprintf(stderr, "can't alloc buffer\n");
+
+			return 1;
+		}
+		ctx->ranges = range;
+	}
+
+	range = &ctx->ranges[ctx->numRanges++];
+	range->start = start;
+	range->end = start + n;
+	range->kind = (unsigned char)kind;
+	range->ifdKind = (ifd != NULL) ? (unsigned char)ifd->kind : 0;
+	range->ifdIndex = (ifd != NULL) ? (unsigned short)ifd->index : 0;
+	range->tag = tag;
+	range->index = index;
+
+	if(range->end > ctx->bound)
+	{
+		describeRange(range, text, sizeof(text) );
+		finding(ctx, internal, 1, "out-of-bounds",
+			"%s ends past the end of the file (%llu)", text, ctx->bound);
+	}
+	else if( ( (kind == RANGE_IFD) || (kind == RANGE_VALUE) ) &&
+		(start & 1) )
+	{
+		describeRange(range, text, sizeof(text) );
+		finding(ctx, internal, 0, "misaligned", "%s starts at an odd offset",
+			text);
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: validateBeginIFD                                         **/
+/**                                                                      **/
+/**   Visitor callback adding the range of an IFD.                       **/
+/**                                                                      **/
+
+static tiffWalk_t validateBeginIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	validateCtx *validate = (validateCtx *)ctx;
+
+	memset(validate->haveTables, 0, sizeof(validate->haveTables) );
+	validate->haveThumbnail = 0;
+	validate->haveThumbnailLength = 0;
+	validate->width = 0;
+	validate->length = 0;
+	validate->rowsPerStrip = 0;
+	validate->tileWidth = 0;
+	validate->tileLength = 0;
+	validate->samples = 0;
+	validate->planar = 0;
+
+	if(++validate->numIFDs > TIFF_VALIDATE_MAX_IFDS)
+	{
+		finding(validate, internal, 1, "ifd-loop", "more than %d IFDs",
+			TIFF_VALIDATE_MAX_IFDS);
+
+		return TIFF_WALK_STOP;
+	}
+
+	if(addRange(validate, internal, RANGE_IFD, ifd, 0, 0, ifd->offset,
+		2 + 12ULL * ifd->numEntries + 4) != 0)
+	{
+		return TIFF_WALK_ERROR;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: validateEntry                                            **/
+/**                                                                      **/
+/**   Visitor callback adding the range of a value stored out of line,   **/
+/**   and remembering the chunk tables and image geometry.               **/
+/**                                                                      **/
+
+static tiffWalk_t validateEntry(void *ctx, internalStruct *internal,
+	const tiffEntry *entry)
+{
+	validateCtx *validate = (validateCtx *)ctx;
+	unsigned int value = entry->valueOffset;
+	unsigned int types;
+	unsigned short s;
+	char name[16];
+	int table = -1;
+
+	/* Type 13 (IFD) is a TIFF extension naming an IFD offset */
+	if( ( (entry->fieldType < FT_MIN) || (entry->fieldType > FT_MAX) ) &&
+		(entry->fieldType != 13) )
+	{
+		ifdName(entry->ifd->kind, entry->ifd->index, name, sizeof(name) );
+		finding(validate, internal, 1, "bad-type",
+			"%s tag %u has unknown type %u", name, entry->tag,
+			entry->fieldType);
+
+		return TIFF_WALK_CONTINUE;
+	}
+
+	types = tiffTagDBTypes(entry->tag);
+	if( (types != 0) && ( (types & (1u << entry->fieldType) ) == 0) )
+	{
+		ifdName(entry->ifd->kind, entry->ifd->index, name, sizeof(name) );
+		finding(validate, internal, 0, "type-mismatch",
+			"%s tag %s has unexpected type %s", name,
+			getTagDescriptor(entry->tag),
+			getTIFFTypeDesc( (fieldType_t)entry->fieldType) );
+	}
+
+	if(!entry->isInline &&
+		(addRange(validate, internal, RANGE_VALUE, entry->ifd, entry->tag,
+		0, entry->valueOffset, entry->totalBytes) != 0) )
+	{
+		return TIFF_WALK_ERROR;
+	}
+
+	if(entry->fieldType == FT_SHORT)
+	{
+		memcpy(&s, entry->value, sizeof(s) );
+		value = cSwapUShort(s, internal);
+	}
+	else if(entry->fieldType != FT_LONG)
+	{
+		return TIFF_WALK_CONTINUE;
+	}
+
+	switch(entry->tag)
+	{
+		case StripOffsets:
+		{
+			table = TABLE_STRIPS;
+			break;
+		}
+		case StripByteCounts:
+		{
+			table = TABLE_STRIPS + 1;
+			break;
+		}
+		case TileOffsets:
+		{
+			table = TABLE_TILES;
+			break;
+		}
+		case TileByteCounts:
+		{
+			table = TABLE_TILES + 1;
+			break;
+		}
+		case JPEGInterchangeFormat:
+		{
+			validate->thumbnail = value;
+			validate->haveThumbnail = 1;
+			break;
+		}
+		case JPEGInterchangeFormatLength:
+		{
+			validate->thumbnailLength = value;
+			validate->haveThumbnailLength = 1;
+			break;
+		}
+		case ImageWidth:
+		{
+			validate->width = value;
+			break;
+		}
+		case ImageLength:
+		{
+			validate->length = value;
+			break;
+		}
+		case RowsPerStrip:
+		{
+			validate->rowsPerStrip = value;
+			break;
+		}
+		case TileWidth:
+		{
+			validate->tileWidth = value;
+			break;
+		}
+		case TileHeight:
+		{
+			validate->tileLength = value;
+			break;
+		}
+		case SamplesPerPixel:
+		{
+			validate->samples = value;
+			break;
+		}
+		case PlanarConfiguration:
+		{
+			validate->planar = value;
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+
+	if(table >= 0)
+	{
+		validate->tables[table] = *entry;
+		validate->tables[table].ifd = NULL;
+		validate->haveTables[table] = 1;
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: expectedChunks                                           **/
+/**                                                                      **/
+/**   Return the number of strips or tiles the image geometry calls      **/
+/**   for, 0 if it isn't known.                                          **/
+/**                                                                      **/
+
+static unsigned long long expectedChunks(const validateCtx *ctx,
+	int table)
+{
+	unsigned long long rows;
+	unsigned long long n;
+
+	if(ctx->length == 0)
+	{
+		return 0;
+	}
+
+	if(table == TABLE_TILES)
+	{
+		if( (ctx->width == 0) || (ctx->tileWidth == 0) ||
+			(ctx->tileLength == 0) )
+		{
+			return 0;
+		}
+		n = ( ( (unsigned long long)ctx->width + ctx->tileWidth - 1) /
+			ctx->tileWidth) *
+			( ( (unsigned long long)ctx->length + ctx->tileLength - 1) /
+			ctx->tileLength);
+	}
+	else
+	{
+		/* RowsPerStrip defaults to a single strip */
+		rows = (ctx->rowsPerStrip == 0) ? ctx->length : ctx->rowsPerStrip;
+		n = ( (unsigned long long)ctx->length + rows - 1) / rows;
+	}
+
+	if( (ctx->planar == 2) && (ctx->samples > 1) )
+	{
+		n *= ctx->samples;
+	}
+
+	return n;
+}
+
+
+/**                                                                      **/
+/**   Function: checkTables                                              **/
+/**                                                                      **/
+/**   Check the strip or tile tables of an IFD and add the range of      **/
+/**   every chunk. Returns 0 on success, 1 on failure.                   **/
+/**                                                                      **/
+
+static int checkTables(validateCtx *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd, int table)
+{
+	const tiffEntry *offsets = &ctx->tables[table];
+	const tiffEntry *counts = &ctx->tables[table + 1];
+	unsigned int *offsetValues;
+	unsigned int *countValues;
+	unsigned long long expected;
+	unsigned int i;
+	char name[16];
+	int status = 0;
+
+	if(!ctx->haveTables[table])
+	{
+		return 0;
+	}
+
+	ifdName(ifd->kind, ifd->index, name, sizeof(name) );
+	if(!ctx->haveTables[table + 1])
+	{
+		finding(ctx, internal, 1, "count-mismatch", "%s has %s but no %s",
+			name, getTagDescriptor(offsets->tag),
+			getTagDescriptor( (table == TABLE_STRIPS) ? StripByteCounts :
+			TileByteCounts) );
+
+		return 0;
+	}
+
+	if(offsets->count != counts->count)
+	{
+		finding(ctx, internal, 1, "count-mismatch",
+			"%s %s has %u values, %s %u", name,
+			getTagDescriptor(offsets->tag), offsets->count,
+			getTagDescriptor(counts->tag), counts->count);
+
+		return 0;
+	}
+
+	expected = expectedChunks(ctx, table);
+	if( (ifd->kind == IFD_TIFF) && (expected != 0) &&
+		(expected != offsets->count) )
+	{
+		finding(ctx, internal, 1, "count-mismatch",
+			"%s %s has %u values, the image size calls for %llu", name,
+			getTagDescriptor(offsets->tag), offsets->count, expected);
+	}
+
+	/* Tables past the end of the file were reported already */
+	if( (!offsets->isInline &&
+		(offsets->valueOffset + offsets->totalBytes > ctx->bound) ) ||
+		(!counts->isInline &&
+		(counts->valueOffset + counts->totalBytes > ctx->bound) ) )
+	{
+		return 0;
+	}
+
+	offsetValues = (unsigned int *)tiffMalloc(
+		( (size_t)offsets->count + 1) * sizeof(unsigned int), internal);
+	countValues = (unsigned int *)tiffMalloc(
+		( (size_t)counts->count + 1) * sizeof(unsigned int), internal);
+	if( (offsetValues == NULL) || (countValues == NULL) ||
+		(tiffGetUIntArray(internal, offsets, offsetValues) != 0) ||
+		(tiffGetUIntArray(internal, counts, countValues) != 0) )
+	{
+		status = 1;
+	}
+
+	for(i = 0;(i < offsets->count) && (status == 0);i++)
+	{
+		if(countValues[i] > 0)
+		{
+			status = addRange(ctx, internal, RANGE_CHUNK, ifd,
+				offsets->tag, i, offsetValues[i], countValues[i]);
+		}
+	}
+
+	free(offsetValues);
+	free(countValues);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: validateEndIFD                                           **/
+/**                                                                      **/
+/**   Visitor callback checking the chunks of an IFD and the link to     **/
+/**   the next one.                                                      **/
+/**                                                                      **/
+
+static tiffWalk_t validateEndIFD(void *ctx, internalStruct *internal,
+	const tiffIFDInfo *ifd)
+{
+	validateCtx *validate = (validateCtx *)ctx;
+	unsigned long long i;
+	char name[16];
+
+	if( (checkTables(validate, internal, ifd, TABLE_STRIPS) != 0) ||
+		(checkTables(validate, internal, ifd, TABLE_TILES) != 0) )
+	{
+		return TIFF_WALK_ERROR;
+	}
+
+	ifdName(ifd->kind, ifd->index, name, sizeof(name) );
+	if(validate->haveThumbnail && !validate->haveThumbnailLength)
+	{
+		finding(validate, internal, 1, "count-mismatch",
+			"%s has JPEGInterchangeFormat but no length", name);
+	}
+	else if(validate->haveThumbnail && (validate->thumbnailLength > 0) &&
+		(addRange(validate, internal, RANGE_CHUNK, ifd,
+		JPEGInterchangeFormat, 0, validate->thumbnail,
+		validate->thumbnailLength) != 0) )
+	{
+		return TIFF_WALK_ERROR;
+	}
+
+	for(i = 0;(ifd->nextOffset != 0) && (i < validate->numRanges);i++)
+	{
+		if( (validate->ranges[i].kind == RANGE_IFD) &&
+			(validate->ranges[i].start == ifd->nextOffset) )
+		{
+			finding(validate, internal, 1, "ifd-loop",
+				"%s points back to the IFD at %u", name, ifd->nextOffset);
+
+			return TIFF_WALK_STOP;
+		}
+	}
+
+	return TIFF_WALK_CONTINUE;
+}
+
+
+/**                                                                      **/
+/**   Function: compareRanges                                            **/
+/**                                                                      **/
+/**   qsort comparison of ranges by start, then end.                     **/
+/**                                                                      **/
+
+static int compareRanges(const void *a, const void *b)
+{
+	const validateRange *ra = (const validateRange *)a;
+	const validateRange *rb = (const validateRange *)b;
+
+	if(ra->start != rb->start)
+	{
+		return (ra->start < rb->start) ? -1 : 1;
+	}
+	if(ra->end != rb->end)
+	{
+		return (ra->end < rb->end) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: checkOverlaps                                            **/
+/**                                                                      **/
+/**   Sort the ranges and report every range starting before the end     **/
+/**   of the furthest reaching range before it.                          **/
+/**                                                                      **/
+
+static void checkOverlaps(validateCtx *ctx, const internalStruct *internal)
+{
+	const validateRange *range;
+	const validateRange *cover;
+	unsigned long long i;
+	char a[128];
+	char b[128];
+
+	qsort(ctx->ranges, (size_t)ctx->numRanges, sizeof(*ctx->ranges),
+		compareRanges);
+
+	cover = ctx->ranges;
+	for(i = 1;i < ctx->numRanges;i++)
+	{
+		range = &ctx->ranges[i];
+		if(range->start < cover->end)
+		{
+			describeRange(range, a, sizeof(a) );
+			describeRange(cover, b, sizeof(b) );
+
+			/* Writers may share one chunk between identical strips */
+			if( (range->kind == RANGE_CHUNK) &&
+				(cover->kind == RANGE_CHUNK) &&
+				(range->start == cover->start) && (range->end == cover->end) )
+			{
+				finding(ctx, internal, 0, "shared", "%s is the same as %s", a,
+					b);
+			}
+			else
+			{
+				finding(ctx, internal, 1, "overlap", "%s overlaps %s", a, b);
+			}
+		}
+
+		if(range->end > cover->end)
+		{
+			cover = range;
+		}
+	}
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffValidateFile                                         **/
+/**                                                                      **/
+/**   Check the structure of a file and print what is wrong with it, as  **/
+/**   described in tiff_validate.h. Returns 0 if no error was found, 1   **/
+/**   otherwise.                                                         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   filename  -- file name                                             **/
+/**   internal  -- struct initialized with tiffInitInternal              **/
+/**   result    -- receives the number of findings                       **/
+/**                                                                      **/
+
+int tiffValidateFile(const char *filename, internalStruct *internal,
+	tiffValidateResult *result)
+{
+	static const tiffVisitor visitor = {
+		validateBeginIFD, validateEntry, validateEndIFD,
+	};
+	validateCtx ctx;
+	tiffWalk_t status;
+	unsigned long long size;
+	unsigned int more;
+
+	memset(result, 0, sizeof(*result) );
+	memset(&ctx, 0, sizeof(ctx) );
+	ctx.filename = filename;
+	ctx.result = result;
+
+	if(tiffOpen(filename, internal) != 0)
+	{
+		finding(&ctx, internal, 1, "read-error", "not a TIFF file");
+
+		return 1;
+	}
+
+	/* Offsets of a TIFF inside a JPEG start at its header */
+	size = tiffFileSize(internal);
+	ctx.bound = (size > (unsigned long long)internal->tiffOffset) ?
+		size - (unsigned long long)internal->tiffOffset : 0;
+
+	status = (addRange(&ctx, internal, RANGE_HEADER, NULL, 0, 0, 0, 8) ==
+		0) ? tiffWalkFile(filename, internal, &visitor, &ctx) :
+		TIFF_WALK_ERROR;
+	if(status == TIFF_WALK_ERROR)
+	{
+		finding(&ctx, internal, 1, "read-error",
+			"IFDs can't be read to the end");
+	}
+
+	checkOverlaps(&ctx, internal);
+	result->ranges = ctx.numRanges;
+
+	more = result->errors + result->warnings;
+	if(more > TIFF_VALIDATE_MAX_FINDINGS)
+	{
+		tiffPrintf(internal, "%s\twarning\ttruncated\t%u more findings\n",
+			filename, more - TIFF_VALIDATE_MAX_FINDINGS);
+	}
+
+	tiffClose(internal);
+	free(ctx.ranges);
+
+	return (result->errors != 0);
+}
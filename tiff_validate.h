@@ -0,0 +1,96 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Structural validation of files.                                    **/
+/**                                                                      **/
+/**   Every byte range a file refers to is collected while its IFDs are  **/
+/**   walked: header, IFDs, values stored out of line, strips, tiles     **/
+/**   and the JPEG thumbnail. The ranges are sorted once by offset and   **/
+/**   swept to find overlaps, so a file with n ranges is checked in      **/
+/**   O(n log n). Each problem found is printed as one line of tab       **/
+/**   separated fields:                                                  **/
+/**                                                                      **/
+/**       file  severity  code  description                              **/
+/**                                                                      **/
+/**   severity is "error" or "warning", and code one of:                 **/
+/**                                                                      **/
+/**       read-error      the file can't be walked past some point       **/
+/**       ifd-loop        an IFD chain points back to an earlier IFD     **/
+/**       out-of-bounds   a range ends past the end of the file          **/
+/**       overlap         two ranges overlap                             **/
+/**       shared          two chunks have the same range (warning)       **/
+/**       misaligned      an IFD or value starts at an odd offset        **/
+/**                       (warning)                                      **/
+/**       bad-type        an entry has an unknown field type             **/
+/**       type-mismatch   an entry has a type its tag dictionary doesn't **/
+/**                       expect (warning)                               **/
+/**       count-mismatch  offset and byte count tables of different      **/
+/**                       sizes, or a number of strips or tiles not      **/
+/**                       matching the image size                        **/
+/**                                                                      **/
+/**   Valid files print nothing.                                         **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_VALIDATE_H
+#define _TIFF_VALIDATE_H
+
+#include "tiff_metadata.h"
+
+
+/**                                                                      **/
+/**  Most findings printed per file, and most IFDs walked                **/
+/**                                                                      **/
+
+#define TIFF_VALIDATE_MAX_FINDINGS 100
+#define TIFF_VALIDATE_MAX_IFDS 4096
+
+
+/**                                                                      **/
+/**  Result of a validation                                              **/
+/**                                                                      **/
+/**  errors, warnings                                                    **/
+/**      number of findings of each severity                             **/
+/**  ranges                                                              **/
+/**      number of byte ranges checked                                   **/
+/**                                                                      **/
+
+typedef struct tiffValidateResult
+{
+	unsigned int errors;
+	unsigned int warnings;
+	unsigned long long ranges;
+} tiffValidateResult;
+
+
+/**                                                                      **/
+/**  Validation API function declarations                                **/
+/**                                                                      **/
+
+int tiffValidateFile(const char *filename, internalStruct *internal,
+	tiffValidateResult *result);
+
+#endif
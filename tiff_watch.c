@@ -0,0 +1,819 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Watching a directory tree for new and changed files.               **/
+/**                                                                      **/
+
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "tiff_metadata.h"
+#include "tiff_batch.h"
+#include "tiff_watch.h"
+
+
+/**                                                                      **/
+/**  Events subscribed to, and size of the event buffer                  **/
+/**                                                                      **/
+
+#define WATCH_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR)
+#define WATCH_BUFFER 65536
+
+
+/**                                                                      **/
+/**  Set by the signal handler to stop tiffWatchRun                      **/
+/**                                                                      **/
+
+static volatile sig_atomic_t watchStop;
+
+
+/**                                                                      **/
+/**   Function: watchNow                                                 **/
+/**                                                                      **/
+/**   Wall clock time in nanoseconds, comparable to modification times.  **/
+/**                                                                      **/
+
+static unsigned long long watchNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/**                                                                      **/
+/**   Function: watchStat                                                **/
+/**                                                                      **/
+/**   Get the size and modification time of a regular file, following    **/
+/**   symbolic links. Returns 0 on success, 1 if path is missing or is   **/
+/**   not a regular file.                                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   path     -- file name                                              **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   size     -- file size                                              **/
+/**   mtimeNs  -- modification time in nanoseconds                       **/
+/**                                                                      **/
+
+static int watchStat(const char *path, unsigned long long *size,
+	unsigned long long *mtimeNs)
+{
+	struct stat st;
+
+	if( (stat(path, &st) != 0) || !S_ISREG(st.st_mode) )
+	{
+		return 1;
+	}
+	*size = (unsigned long long)st.st_size;
+	*mtimeNs = (unsigned long long)st.st_mtim.tv_sec * 1000000000ULL +
+		st.st_mtim.tv_nsec;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: watchHash                                                **/
+/**                                                                      **/
+/**   FNV-1a hash of a path.                                             **/
+/**                                                                      **/
+
+static unsigned int watchHash(const char *path)
+{
+	unsigned int hash = 2166136261u;
+
+	while(*path != '\0')
+	{
+		hash = (hash ^ (unsigned char)*path++) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+/**                                                                      **/
+/**   Function: watchFind                                                **/
+/**                                                                      **/
+/**   Find the record of a file, adding it when absent. A new record     **/
+/**   has a zero size and modification time, as if never processed.      **/
+/**   Returns NULL if memory runs out.                                   **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   watch  -- watch                                                    **/
+/**   path   -- file name                                                **/
+/**                                                                      **/
+
+static tiffWatchFile *watchFind(tiffWatch *watch, const char *path)
+{
+	tiffWatchFile **bucket;
+	tiffWatchFile *file;
+
+	bucket = &watch->buckets[watchHash(path) % TIFF_WATCH_BUCKETS];
+	for(file = *bucket;file != NULL;file = file->hashNext)
+	{
+		if(strcmp(file->path, path) == 0)
+		{
+			return file;
+		}
+	}
+
+	file = (tiffWatchFile *)calloc(1, sizeof(*file) );
+	if(file == NULL)
+	{
+		return NULL;
+	}
+	file->path = strdup(path);
+	if(file->path == NULL)
+	{
+		free(file);
+
+		return NULL;
+	}
+	file->generation = watch->generation;
+	file->hashNext = *bucket;
+	*bucket = file;
+
+	return file;
+}
+
+
+/**                                                                      **/
+/**   Function: watchPending                                             **/
+/**                                                                      **/
+/**   Mark a file pending, restarting its debounce interval.             **/
+/**                                                                      **/
+
+static void watchPending(tiffWatch *watch, tiffWatchFile *file,
+	unsigned long long now)
+{
+	if(!file->pending)
+	{
+		file->pending = 1;
+		watch->numPending++;
+	}
+	file->eventNs = now;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: watchAdd                                                 **/
+/**                                                                      **/
+/**   Watch a directory, remembering its path by watch descriptor.       **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+
+static int watchAdd(tiffWatch *watch, const char *dir)
+{
+	unsigned int size;
+	char **dirs;
+	char *copy;
+	int wd;
+
+	wd = inotify_add_watch(watch->fd, dir, WATCH_MASK);
+	if(wd < 0)
+	{
+		fprintf(stderr, "can't watch %s: %s\n", dir, strerror(errno) );
+
+		return 1;
+	}
+
+	if( (unsigned int)wd >= watch->maxDirs)
+	{
+		size = (watch->maxDirs > 0) ? watch->maxDirs : 64;
+		while(size <= (unsigned int)wd)
+		{
+			size *= 2;
+		}
+		dirs = (char **)realloc(watch->dirs, size * sizeof(*dirs) );
+		if(dirs == NULL)
+		{
+			fprintf(stderr, "can't alloc buffer\n");
+			inotify_rm_watch(watch->fd, wd);
+
+			return 1;
+		}
+		memset(dirs + watch->maxDirs, 0,
+			(size - watch->maxDirs) * sizeof(*dirs) );
+		watch->dirs = dirs;
+		watch->maxDirs = size;
+	}
+
+	/* A directory watched again, such as one moved within the tree,
+	   keeps its descriptor and takes its new path */
+	copy = strdup(dir);
+	if(copy == NULL)
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+
+		return 1;
+	}
+	free(watch->dirs[wd]);
+	watch->dirs[wd] = copy;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: watchScan                                                **/
+/**                                                                      **/
+/**   Watch a directory and every directory below it, and look at the    **/
+/**   files they hold. During the first scan the files are recorded as   **/
+/**   they are; afterwards new files and files whose size or             **/
+/**   modification time changed become pending. Directories are not      **/
+/**   followed through symbolic links. Returns 0 on success, 1 if some   **/
+/**   directory could not be watched or read.                            **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   watch    -- watch                                                  **/
+/**   dir      -- directory name                                         **/
+/**   initial  -- 1 during the first scan                                **/
+/**   now      -- current time                                           **/
+/**                                                                      **/
+
+static int watchScan(tiffWatch *watch, const char *dir, int initial,
+	unsigned long long now)
+{
+	struct dirent **names;
+	struct stat st;
+	tiffWatchFile *file;
+	unsigned long long size;
+	unsigned long long mtimeNs;
+	char *child;
+	size_t length;
+	int status;
+	int n;
+	int i;
+
+	status = watchAdd(watch, dir);
+	n = scandir(dir, &names, NULL, NULL);
+	if(n < 0)
+	{
+		fprintf(stderr, "can't read directory %s\n", dir);
+
+		return 1;
+	}
+
+	for(i = 0;i < n;i++)
+	{
+		if( (strcmp(names[i]->d_name, ".") == 0) ||
+			(strcmp(names[i]->d_name, "..") == 0) )
+		{
+			free(names[i]);
+			continue;
+		}
+
+		length = strlen(dir) + strlen(names[i]->d_name) + 2;
+		child = (char *)malloc(length);
+		if(child == NULL)
+		{
+			free(names[i]);
+			status = 1;
+			continue;
+		}
+		snprintf(child, length, "%s/%s", dir, names[i]->d_name);
+		free(names[i]);
+
+		if( (lstat(child, &st) == 0) && S_ISDIR(st.st_mode) )
+		{
+			if(watchScan(watch, child, initial, now) != 0)
+			{
+				status = 1;
+			}
+		}
+		else if(watchStat(child, &size, &mtimeNs) == 0)
+		{
+			file = watchFind(watch, child);
+			if(file == NULL)
+			{
+				status = 1;
+			}
+			else if(initial)
+			{
+				file->size = size;
+				file->mtimeNs = mtimeNs;
+			}
+			else if(!file->pending &&
+				( (size != file->size) || (mtimeNs != file->mtimeNs) ) )
+			{
+				watchPending(watch, file, now);
+			}
+			if(file != NULL)
+			{
+				file->generation = watch->generation;
+			}
+		}
+		free(child);
+	}
+	free(names);
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffWatchInit                                            **/
+/**                                                                      **/
+/**   Start watching a directory tree, recording the files it holds.     **/
+/**   Returns 0 on success, 1 on failure.                                **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   watch       -- watch                                               **/
+/**   root        -- directory                                           **/
+/**   debounceMs  -- time a file must stay unchanged before it is ready  **/
+/**   reconcileS  -- period of the reconciliation scans, 0 for none      **/
+/**                                                                      **/
+
+int tiffWatchInit(tiffWatch *watch, const char *root,
+	unsigned int debounceMs, unsigned int reconcileS)
+{
+	struct stat st;
+	unsigned long long now;
+
+	memset(watch, 0, sizeof(*watch) );
+	watch->fd = -1;
+
+	if( (stat(root, &st) != 0) || !S_ISDIR(st.st_mode) )
+	{
+		fprintf(stderr, "%s is not a directory\n", root);
+
+		return 1;
+	}
+
+	watch->root = strdup(root);
+	watch->buckets = (tiffWatchFile **)calloc(TIFF_WATCH_BUCKETS,
+		sizeof(*watch->buckets) );
+	if( (watch->root == NULL) || (watch->buckets == NULL) )
+	{
+		fprintf(stderr, "can't alloc buffer\n");
+		tiffWatchFree(watch);
+
+		return 1;
+	}
+
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(watch->fd < 0)
+	{
+		fprintf(stderr, "can't watch %s: %s\n", root, strerror(errno) );
+		tiffWatchFree(watch);
+
+		return 1;
+	}
+
+	watch->debounceNs = (unsigned long long)debounceMs * 1000000ULL;
+	watch->reconcileNs = (unsigned long long)reconcileS * 1000000000ULL;
+
+	/* Only the root must be watched; failures below it are reported
+	   and retried by the reconciliation scans */
+	if(watchAdd(watch, watch->root) != 0)
+	{
+		tiffWatchFree(watch);
+
+		return 1;
+	}
+	now = watchNow();
+	watch->scans++;
+	watchScan(watch, watch->root, 1, now);
+	watch->nextReconcileNs = (watch->reconcileNs > 0) ?
+		now + watch->reconcileNs : 0;
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffWatchFree                                            **/
+/**                                                                      **/
+/**   Stop watching and free everything the watch holds.                 **/
+/**                                                                      **/
+
+void tiffWatchFree(tiffWatch *watch)
+{
+	tiffWatchFile *file;
+	tiffWatchFile *next;
+	unsigned int i;
+
+	if(watch->fd >= 0)
+	{
+		close(watch->fd);
+	}
+	for(i = 0;i < watch->maxDirs;i++)
+	{
+		free(watch->dirs[i]);
+	}
+	free(watch->dirs);
+	if(watch->buckets != NULL)
+	{
+		for(i = 0;i < TIFF_WATCH_BUCKETS;i++)
+		{
+			for(file = watch->buckets[i];file != NULL;file = next)
+			{
+				next = file->hashNext;
+				free(file->path);
+				free(file);
+			}
+		}
+	}
+	free(watch->buckets);
+	for(i = 0;i < watch->numReady;i++)
+	{
+		free(watch->ready[i]);
+	}
+	free(watch->ready);
+	free(watch->root);
+	memset(watch, 0, sizeof(*watch) );
+	watch->fd = -1;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffWatchReconcile                                       **/
+/**                                                                      **/
+/**   Walk the whole tree, watching directories whose watch was missed   **/
+/**   and marking pending the files whose events were lost, then forget  **/
+/**   the files that are gone. Returns 0 on success, 1 if some           **/
+/**   directory could not be watched or read.                            **/
+/**                                                                      **/
+
+int tiffWatchReconcile(tiffWatch *watch)
+{
+	tiffWatchFile **link;
+	tiffWatchFile *file;
+	unsigned long long now;
+	unsigned int i;
+	int status;
+
+	now = watchNow();
+	watch->generation++;
+	watch->scans++;
+	status = watchScan(watch, watch->root, 0, now);
+
+	for(i = 0;i < TIFF_WATCH_BUCKETS;i++)
+	{
+		link = &watch->buckets[i];
+		while(*link != NULL)
+		{
+			file = *link;
+			if(file->generation == watch->generation)
+			{
+				link = &file->hashNext;
+				continue;
+			}
+			*link = file->hashNext;
+			if(file->pending)
+			{
+				watch->numPending--;
+			}
+			free(file->path);
+			free(file);
+		}
+	}
+
+	watch->nextReconcileNs = (watch->reconcileNs > 0) ?
+		now + watch->reconcileNs : 0;
+
+	return status;
+}
+
+
+/**                                                                      **/
+/**   Function: watchEvent                                               **/
+/**                                                                      **/
+/**   Handle one inotify event.                                          **/
+/**                                                                      **/
+
+static void watchEvent(tiffWatch *watch, const struct inotify_event *event,
+	unsigned long long now)
+{
+	tiffWatchFile *file;
+	char *path;
+	size_t length;
+
+	watch->events++;
+	if(event->mask & IN_Q_OVERFLOW)
+	{
+		watch->overflows++;
+		watch->nextReconcileNs = now;
+
+		return;
+	}
+	if( (event->wd < 0) || ( (unsigned int)event->wd >= watch->maxDirs) ||
+		(watch->dirs[event->wd] == NULL) )
+	{
+		return;
+	}
+	if(event->mask & IN_IGNORED)
+	{
+		free(watch->dirs[event->wd]);
+		watch->dirs[event->wd] = NULL;
+
+		return;
+	}
+	if(event->len == 0)
+	{
+		return;
+	}
+
+	length = strlen(watch->dirs[event->wd]) + strlen(event->name) + 2;
+	path = (char *)malloc(length);
+	if(path == NULL)
+	{
+		return;
+	}
+	snprintf(path, length, "%s/%s", watch->dirs[event->wd], event->name);
+
+	if(event->mask & IN_ISDIR)
+	{
+		/* Files may have been created before the watch was added */
+		watchScan(watch, path, 0, now);
+	}
+	else
+	{
+		file = watchFind(watch, path);
+		if(file != NULL)
+		{
+			file->generation = watch->generation;
+			watchPending(watch, file, now);
+		}
+	}
+	free(path);
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffWatchWait                                            **/
+/**                                                                      **/
+/**   Wait for events for up to timeoutMs milliseconds and handle the    **/
+/**   ones that came, then run a reconciliation scan when one is due.    **/
+/**   Returns 0 on success, 1 on failure; being interrupted by a signal  **/
+/**   is not a failure.                                                  **/
+/**                                                                      **/
+
+int tiffWatchWait(tiffWatch *watch, int timeoutMs)
+{
+	char buffer[WATCH_BUFFER]
+		__attribute__ ( (aligned(__alignof__(struct inotify_event) ) ) );
+	const struct inotify_event *event;
+	struct pollfd pfd;
+	unsigned long long now;
+	ssize_t got;
+	ssize_t i;
+
+	pfd.fd = watch->fd;
+	pfd.events = POLLIN;
+	if(poll(&pfd, 1, timeoutMs) < 0)
+	{
+		if(errno == EINTR)
+		{
+			return 0;
+		}
+		perror("poll");
+
+		return 1;
+	}
+
+	while(pfd.revents & POLLIN)
+	{
+		got = read(watch->fd, buffer, sizeof(buffer) );
+		if(got <= 0)
+		{
+			if( (got < 0) && (errno != EAGAIN) && (errno != EINTR) )
+			{
+				perror("read");
+
+				return 1;
+			}
+			break;
+		}
+
+		now = watchNow();
+		for(i = 0;i < got;i += sizeof(*event) + event->len)
+		{
+			event = (const struct inotify_event *)(buffer + i);
+			watchEvent(watch, event, now);
+		}
+	}
+
+	if( (watch->nextReconcileNs != 0) &&
+		(watchNow() >= watch->nextReconcileNs) )
+	{
+		tiffWatchReconcile(watch);
+	}
+
+	return 0;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffWatchReady                                           **/
+/**                                                                      **/
+/**   Collect the pending files that settled: no event for the debounce  **/
+/**   interval and not modified for as long. Files unchanged since they  **/
+/**   were last processed and files that are gone stop being pending     **/
+/**   without being returned. Returns the number of ready files.         **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   watch  -- watch                                                    **/
+/**                                                                      **/
+/**   Output parameters:                                                 **/
+/**   paths  -- names of the ready files, owned by the watch and valid   **/
+/**             until the next call                                      **/
+/**                                                                      **/
+
+unsigned int tiffWatchReady(tiffWatch *watch, char ***paths)
+{
+	tiffWatchFile *file;
+	unsigned long long now;
+	unsigned long long size;
+	unsigned long long mtimeNs;
+	unsigned int maxReady;
+	unsigned int i;
+	char **ready;
+
+	for(i = 0;i < watch->numReady;i++)
+	{
+		free(watch->ready[i]);
+	}
+	watch->numReady = 0;
+	*paths = watch->ready;
+
+	now = watchNow();
+	for(i = 0;(i < TIFF_WATCH_BUCKETS) && (watch->numPending > 0);i++)
+	{
+		for(file = watch->buckets[i];file != NULL;file = file->hashNext)
+		{
+			if(!file->pending || (now - file->eventNs < watch->debounceNs) )
+			{
+				continue;
+			}
+			if(watchStat(file->path, &size, &mtimeNs) != 0)
+			{
+				file->pending = 0;
+				watch->numPending--;
+				continue;
+			}
+			if( (mtimeNs <= now) && (now - mtimeNs < watch->debounceNs) )
+			{
+				continue;
+			}
+
+			file->pending = 0;
+			watch->numPending--;
+			if( (size == file->size) && (mtimeNs == file->mtimeNs) )
+			{
+				continue;
+			}
+			file->size = size;
+			file->mtimeNs = mtimeNs;
+
+			if(watch->numReady == watch->maxReady)
+			{
+				maxReady = (watch->maxReady > 0) ? watch->maxReady * 2 : 64;
+				ready = (char **)realloc(watch->ready,
+					maxReady * sizeof(*ready) );
+				if(ready == NULL)
+				{
+					continue;
+				}
+				watch->ready = ready;
+				watch->maxReady = maxReady;
+			}
+			watch->ready[watch->numReady] = strdup(file->path);
+			if(watch->ready[watch->numReady] != NULL)
+			{
+				watch->numReady++;
+			}
+		}
+	}
+
+	*paths = watch->ready;
+
+	return watch->numReady;
+}
+
+
+/**                                                                      **/
+/**   Function: watchSignal                                              **/
+/**                                                                      **/
+/**   SIGINT and SIGTERM handler stopping tiffWatchRun.                  **/
+/**                                                                      **/
+
+static void watchSignal(int sig)
+{
+	(void)sig;
+	watchStop = 1;
+
+	return;
+}
+
+
+/**                                                                      **/
+/**   Function: tiffWatchRun                                             **/
+/**                                                                      **/
+/**   Process the files of the tree as they become ready, with a batch   **/
+/**   run per round, until SIGINT or SIGTERM. The output of each round   **/
+/**   is flushed so that readers of a pipe see it at once, and           **/
+/**   batch->wallNs sums the time of all rounds. Returns the highest     **/
+/**   status of the batch runs, or 1 if waiting failed.                  **/
+/**                                                                      **/
+/**   Input parameters:                                                  **/
+/**   watch  -- watch set up with tiffWatchInit                          **/
+/**   batch  -- batch parameters set up with tiffBatchInit               **/
+/**                                                                      **/
+
+int tiffWatchRun(tiffWatch *watch, tiffBatch *batch)
+{
+	struct sigaction action;
+	struct sigaction oldInt;
+	struct sigaction oldTerm;
+	unsigned long long wallNs = 0;
+	char **paths;
+	unsigned int n;
+	int timeoutMs;
+	int status = 0;
+
+	/* No SA_RESTART, so that a signal interrupts poll */
+	memset(&action, 0, sizeof(action) );
+	action.sa_handler = watchSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, &oldInt);
+	sigaction(SIGTERM, &action, &oldTerm);
+	watchStop = 0;
+
+	while(!watchStop)
+	{
+		/* Poll often enough to notice pending files settling */
+		timeoutMs = 1000;
+		if( (watch->numPending > 0) &&
+			(watch->debounceNs / 1000000ULL < (unsigned long long)timeoutMs) )
+		{
+			timeoutMs = (int)(watch->debounceNs / 1000000ULL) + 10;
+		}
+		if(tiffWatchWait(watch, timeoutMs) != 0)
+		{
+			status = 1;
+			break;
+		}
+
+		n = tiffWatchReady(watch, &paths);
+		if(n > 0)
+		{
+			if(tiffBatchRun(batch, paths, (int)n) > status)
+			{
+				status = batch->status;
+			}
+			wallNs += batch->wallNs;
+			fflush(stdout);
+		}
+	}
+	batch->wallNs = wallNs;
+
+	sigaction(SIGINT, &oldInt, NULL);
+	sigaction(SIGTERM, &oldTerm, NULL);
+
+	return status;
+}
@@ -0,0 +1,163 @@
+
+/**************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2005-2015 Joel E. Merritt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+**************************************************************************/
+
+/**                                                                      **/
+/**   Watching a directory tree for new and changed files.               **/
+/**                                                                      **/
+/**   Every directory of the tree is watched with inotify(7) for files   **/
+/**   being created, closed after writing or moved in, and for new       **/
+/**   directories, which are watched in turn and scanned for the files   **/
+/**   created before their watch was added. Modifications themselves are **/
+/**   not subscribed to, so a large file being written costs two events  **/
+/**   and not one per write.                                             **/
+/**                                                                      **/
+/**   A file an event names becomes pending. It is ready once neither an **/
+/**   event nor its modification time is more recent than the debounce   **/
+/**   interval, so that files still being written (including by writers  **/
+/**   whose changes raise no event, such as on network file systems) are **/
+/**   left alone until they settle. Ready files whose size and           **/
+/**   modification time differ from when they were last processed are    **/
+/**   handed to a tiffBatch run, so that only what changed is parsed.    **/
+/**                                                                      **/
+/**   Events are lost when the kernel queue overflows, or for            **/
+/**   directories created and filled faster than their watch is added.   **/
+/**   A reconciliation scan therefore walks the tree periodically, and   **/
+/**   at once after an overflow, marking pending every file whose size   **/
+/**   or modification time differs from what was last seen, and          **/
+/**   forgetting deleted files. Files present when the watch starts are  **/
+/**   recorded without being processed.                                  **/
+/**                                                                      **/
+/**   fanotify(7) would avoid a watch per directory, but needs           **/
+/**   CAP_SYS_ADMIN and file handles resolved with CAP_DAC_READ_SEARCH;  **/
+/**   inotify works for any user.                                        **/
+/**                                                                      **/
+
+
+#ifndef _TIFF_WATCH_H
+#define _TIFF_WATCH_H
+
+#include "tiff_batch.h"
+
+
+/**                                                                      **/
+/**  Default debounce interval and reconciliation period, and size of    **/
+/**  the file table                                                      **/
+/**                                                                      **/
+
+#define TIFF_WATCH_DEBOUNCE_MS 2000
+#define TIFF_WATCH_RECONCILE_S 300
+#define TIFF_WATCH_BUCKETS 65536
+
+
+/**                                                                      **/
+/**  File of the watched tree                                            **/
+/**                                                                      **/
+/**  path                                                                **/
+/**      file name, below the watched directory                          **/
+/**  size, mtimeNs                                                       **/
+/**      size and modification time when last processed or seen by the   **/
+/**      first scan                                                      **/
+/**  eventNs                                                             **/
+/**      time of the latest event or scan naming the pending file        **/
+/**  generation                                                          **/
+/**      last reconciliation scan that found the file                    **/
+/**  pending                                                             **/
+/**      1 while the file waits to be processed                          **/
+/**  hashNext                                                            **/
+/**      next file of the same bucket                                    **/
+/**                                                                      **/
+
+typedef struct tiffWatchFile
+{
+	char *path;
+	unsigned long long size;
+	unsigned long long mtimeNs;
+	unsigned long long eventNs;
+	unsigned int generation;
+	int pending;
+	struct tiffWatchFile *hashNext;
+} tiffWatchFile;
+
+
+/**                                                                      **/
+/**  Watch of a directory tree                                           **/
+/**                                                                      **/
+/**  fd                                                                  **/
+/**      inotify descriptor                                              **/
+/**  root                                                                **/
+/**      watched directory                                               **/
+/**  dirs, maxDirs                                                       **/
+/**      path of each watched directory by watch descriptor, which the   **/
+/**      kernel allocates from 1 upwards                                 **/
+/**  buckets                                                             **/
+/**      table of files by path                                          **/
+/**  numPending                                                          **/
+/**      number of pending files                                         **/
+/**  debounceNs, reconcileNs                                             **/
+/**      debounce interval and reconciliation period                     **/
+/**  nextReconcileNs                                                     **/
+/**      time of the next reconciliation scan, 0 for none                **/
+/**  generation                                                          **/
+/**      number of the latest scan                                       **/
+/**  ready, numReady, maxReady                                           **/
+/**      paths returned by the latest tiffWatchReady                     **/
+/**  events, overflows, scans                                            **/
+/**      counters of events read, queue overflows and scans              **/
+/**                                                                      **/
+
+typedef struct tiffWatch
+{
+	int fd;
+	char *root;
+	char **dirs;
+	unsigned int maxDirs;
+	tiffWatchFile **buckets;
+	unsigned int numPending;
+	unsigned long long debounceNs;
+	unsigned long long reconcileNs;
+	unsigned long long nextReconcileNs;
+	unsigned int generation;
+	char **ready;
+	unsigned int numReady;
+	unsigned int maxReady;
+	unsigned long long events;
+	unsigned long long overflows;
+	unsigned long long scans;
+} tiffWatch;
+
+
+/**                                                                      **/
+/**  Watch API function declarations                                     **/
+/**                                                                      **/
+
+int tiffWatchInit(tiffWatch *watch, const char *root,
+	unsigned int debounceMs, unsigned int reconcileS);
+void tiffWatchFree(tiffWatch *watch);
+int tiffWatchWait(tiffWatch *watch, int timeoutMs);
+int tiffWatchReconcile(tiffWatch *watch);
+unsigned int tiffWatchReady(tiffWatch *watch, char ***paths);
+int tiffWatchRun(tiffWatch *watch, tiffBatch *batch);
+
+#endif